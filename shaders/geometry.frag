@@ -20,7 +20,7 @@ void main()
 
     Position = vec4(vf_position.xyz, emission.r);
 
-    vec3 sampled_normal = texture(NormalMap, uv).rgb * 2 - 1.0;
+    vec3 sampled_normal = sampleNormalMap(uv);
     sampled_normal.rg *= materialParams.OcclusionRoughnessMetallicNormalStrengths.a;
     Normal = vec4(normalize(TANGENT_TO_WORLD_ROT * sampled_normal), emission.g);
 
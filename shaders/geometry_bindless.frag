@@ -0,0 +1,53 @@
+#version 450 core
+#extension GL_EXT_nonuniform_qualifier : require
+
+// same as geometry.frag, with the material looked up by index (see BindlessScene)
+
+layout(location=0) in vec4 vf_position;
+layout(location=1) in vec2 vf_uv;
+layout(location=2) in mat3 TANGENT_TO_WORLD_ROT;
+layout(location=5) flat in uint vf_materialIndex;
+
+struct MaterialParams {
+    vec4 BaseColorFactor;
+    vec4 OcclusionRoughnessMetallicNormalStrengths;
+    vec4 EmissiveFactorClipThreshold;
+    vec4 _pad0;
+};
+
+layout(std430, set = 3, binding = 0) readonly buffer MaterialBuffer {
+    MaterialParams Materials[];
+};
+
+// material i's albedo, normal, orm and emissive maps are at 4i to 4i + 3
+layout(set = 3, binding = 2) uniform sampler2D Textures[];
+
+layout(location=0) out vec4 Position;
+layout(location=1) out vec4 Normal;
+layout(location=2) out vec4 Color;
+layout(location=3) out vec4 ORM;
+
+void main()
+{
+    vec2 uv = vf_uv;
+    MaterialParams materialParams = Materials[vf_materialIndex];
+    uint firstTexture = vf_materialIndex * 4;
+
+    // the index is uniform within a draw, but not within a subgroup that spans several draws
+    vec4 albedoSample = texture(Textures[nonuniformEXT(firstTexture)], uv);
+    if (albedoSample.a <= materialParams.EmissiveFactorClipThreshold.a) discard;
+
+    Color = vec4(albedoSample.rgb * materialParams.BaseColorFactor.rgb, 1);
+
+    vec3 emission = materialParams.EmissiveFactorClipThreshold.rgb * texture(Textures[nonuniformEXT(firstTexture + 3)], uv).rgb;
+
+    Position = vec4(vf_position.xyz, emission.r);
+
+    // see sampleNormalMap in gltf_vertex_out_material_params.glsl
+    vec2 xy = texture(Textures[nonuniformEXT(firstTexture + 1)], uv).rg * 2 - 1.0;
+    vec3 sampled_normal = vec3(xy, sqrt(max(0, 1 - dot(xy, xy))));
+    sampled_normal.rg *= materialParams.OcclusionRoughnessMetallicNormalStrengths.a;
+    Normal = vec4(normalize(TANGENT_TO_WORLD_ROT * sampled_normal), emission.g);
+
+    ORM = vec4(texture(Textures[nonuniformEXT(firstTexture + 2)], uv).rgb * materialParams.OcclusionRoughnessMetallicNormalStrengths.rgb, emission.b);
+}
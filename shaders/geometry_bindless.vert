@@ -0,0 +1,45 @@
+#version 450 core
+
+#include "scene_common.glsl"
+
+// same as geometry.vert, except the transform comes from the draw's entry (see BindlessScene)
+struct DrawData {
+  mat4 ModelMatrix;
+  uint MaterialIndex;
+};
+
+layout(std430, set = 3, binding = 1) readonly buffer DrawBuffer {
+  DrawData Draws[];
+};
+
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec3 in_normal;
+layout (location = 2) in vec4 in_tangent;
+layout (location = 3) in vec2 in_uv;
+
+layout (location = 0) out vec4 vf_position;
+layout (location = 1) out vec2 vf_uv;
+layout (location = 2) out mat3 TANGENT_TO_WORLD_ROT;
+layout (location = 5) flat out uint vf_materialIndex;
+
+void main()
+{
+  ViewInfo viewInfo = GetViewInfo();
+
+  // firstInstance of each indirect draw is its index
+  DrawData draw = Draws[gl_InstanceIndex];
+  mat4 ModelMatrix = draw.ModelMatrix;
+  vf_materialIndex = draw.MaterialIndex;
+
+  gl_Position = viewInfo.ProjectionMatrix * viewInfo.ViewMatrix * ModelMatrix * vec4(in_position, 1.0);
+  vf_position = ModelMatrix * vec4(in_position, 1.0) - vec4(viewInfo.CameraPosition, 0);
+
+  vf_uv = in_uv;
+
+  mat3 OBJECT_TO_WORLD_ROT = mat3(ModelMatrix);
+
+  vec3 N = normalize(OBJECT_TO_WORLD_ROT * in_normal);
+  vec3 T = normalize(OBJECT_TO_WORLD_ROT * in_tangent.xyz);
+  vec3 B = cross(N, T) * in_tangent.w;
+  TANGENT_TO_WORLD_ROT = mat3(T, B, N);
+}
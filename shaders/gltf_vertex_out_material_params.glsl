@@ -13,3 +13,9 @@ layout(set = 3, binding = 2) uniform sampler2D AlbedoMap;
 layout(set = 3, binding = 3) uniform sampler2D NormalMap;
 layout(set = 3, binding = 4) uniform sampler2D ORMMap;
 layout(set = 3, binding = 5) uniform sampler2D EmissiveMap;
+
+// tangent space normal. Only xy are read: cooked normal maps are BC5 (two channels), so z is reconstructed
+vec3 sampleNormalMap(vec2 uv) {
+    vec2 xy = texture(NormalMap, uv).rg * 2 - 1.0;
+    return vec3(xy, sqrt(max(0, 1 - dot(xy, xy))));
+}
@@ -12,7 +12,7 @@ void main() {
 
     vec3 color = albedoSample.rgb * materialParams.BaseColorFactor.rgb;
 
-    vec3 sampledNormal = texture(NormalMap, uv).rgb * 2 - 1.0;
+    vec3 sampledNormal = sampleNormalMap(uv);
     sampledNormal.rg = -sampledNormal.rg;
     vec3 normal = TANGENT_TO_WORLD_ROT * normalize(sampledNormal);
 
@@ -14,7 +14,7 @@ void main() {
     vec4 albedoSample = texture(AlbedoMap, uv);
     vec4 baseColor = albedoSample * materialParams.BaseColorFactor;
 
-    vec3 normal = texture(NormalMap, uv).rgb * 2 - 1.0f;
+    vec3 normal = sampleNormalMap(uv);
     normal.rg *= materialParams.OcclusionRoughnessMetallicNormalStrengths.a;
     normal = normalize(TANGENT_TO_WORLD_ROT * normal);
 
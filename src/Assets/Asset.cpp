@@ -2,12 +2,19 @@
 // Created by raind on 5/21/2022.
 //
 
+// before Asset.h, because of the time_t define
+#include "Utils/myn/FileWatcher.h"
+#include "Utils/myn/Threading.h"
 #include "Asset.h"
+#include "AssetGraph.h"
 #include "Utils/myn/Log.h"
+#include "Utils/myn/Profiler.h"
 #include "SceneAsset.h"
 #include "EnvironmentMapAsset.h"
+#include <algorithm>
 #include <filesystem>
 #include <unordered_map>
+#include <unordered_set>
 
 #ifdef MACOS
 #define to_time_t(diff) std::chrono::duration<time_t, std::ratio<86400>>(diff).count()
@@ -30,6 +37,10 @@ time_t get_last_write_time(const std::string& path)
 #ifdef MACOS
 	auto epoch = std::chrono::file_clock::time_point();
 	return to_time_t(file_time - epoch);
+#elif defined(LINUXOS)
+	// (libstdc++ only has clock_cast since gcc 13)
+	auto system_time = std::chrono::file_clock::to_sys(file_time);
+	return std::chrono::system_clock::to_time_t(system_time);
 #else
 	auto system_time = std::chrono::clock_cast<std::chrono::system_clock>(file_time);
 	return std::chrono::system_clock::to_time_t(system_time);
@@ -41,33 +52,93 @@ time_t get_last_write_time(const std::string& path)
 
 std::unordered_map<std::string, Asset*> Asset::assets_pool;
 
+namespace
+{
+	std::unique_ptr<myn::FileWatcher> watcher;
+
+	// main thread only
+	std::unordered_set<std::string> preparing;
+	std::unordered_set<std::string> changed_while_preparing;
+
+	// filled in by the background jobs
+	std::mutex prepared_mutex;
+	std::condition_variable prepared_cv;
+	std::vector<std::string> prepared;
+
+	void start_preparing(const std::string& key, const std::function<std::function<void()>()>& prepare_action) {
+		preparing.insert(key);
+		myn::JobQueue::background().push([key, job = prepare_action()]() {
+			{
+				PROFILE_SCOPE("prepare " + std::filesystem::path(key).filename().string())
+				job();
+			}
+			{
+				std::lock_guard<std::mutex> lock(prepared_mutex);
+				prepared.push_back(key);
+			}
+			prepared_cv.notify_all();
+		});
+	}
+
+	// blocks until key's background prepare (if any) is done, without waiting for anything else in the queue, and takes
+	// it out of update_watched's hands: the caller picks up (or drops) the result. Returns true if the file changed again
+	// while it was being prepared
+	bool finish_preparing(const std::string& key) {
+		if (!preparing.erase(key)) return false;
+		{
+			std::unique_lock<std::mutex> lock(prepared_mutex);
+			prepared_cv.wait(lock, [&key] { return std::find(prepared.begin(), prepared.end(), key) != prepared.end(); });
+			prepared.erase(std::find(prepared.begin(), prepared.end(), key));
+		}
+		return changed_while_preparing.erase(key) > 0;
+	}
+}
+
 Asset::Asset(const std::string &_path, const std::function<void()> &_load_action)
 {
 	relative_path = _path;
 	load_action_internal = _load_action;
 	reload_condition = [](){ return true; };
 	assets_pool[relative_path] = this;
+	if (watcher) watcher->watch(ROOT_DIR"/" + relative_path, relative_path);
 	if (load_action_internal) reload();
 }
 
 void Asset::reload() {
 	time_t last_write_time = get_last_write_time(ROOT_DIR"/" + relative_path);
-	if (last_load_time < last_write_time) {
-		if (!_initialized || reload_condition()) {
-			// begin reload callbacks
-			for (auto& fn : begin_reload) fn();
-			// reload
-			last_load_time = get_file_clock_now();
-			if (_initialized) bump_version();
-			ASSET("loading asset '%s (now at v%d)'", relative_path.c_str(), _version)
-			load_action_internal();
-			_initialized = true;
-			// finish reload callbacks
-			for (auto& fn : finish_reload) fn();
-		} else {
-			WARN("'%s' was edited but not reloaded: condition not met", relative_path.c_str())
+	if (last_load_time < last_write_time) reload_now();
+}
+
+bool Asset::reload_now() {
+	if (_initialized && !reload_condition()) {
+		WARN("'%s' was edited but not reloaded: condition not met", relative_path.c_str())
+		return false;
+	}
+	if (!prepare_action_internal) {
+		// skip saves that didn't change anything. Assets that prepare in the background compare their parts instead
+		bool changed = AssetGraph::update(relative_path, AssetGraph::hash_file(ROOT_DIR"/" + relative_path));
+		if (_initialized && !changed) {
+			ASSET("'%s' was saved but its content didn't change, skipping reload", relative_path.c_str())
+			return false;
 		}
 	}
+	// this load picks up a prepare that's still running in the background (only update_watched waits for them to land)
+	bool changed_again = finish_preparing(relative_path);
+	// begin reload callbacks
+	for (auto& fn : begin_reload) fn();
+	// reload
+	last_load_time = get_file_clock_now();
+	if (_initialized) bump_version();
+	ASSET("loading asset '%s (now at v%d)'", relative_path.c_str(), _version)
+	{
+		PROFILE_SCOPE("load " + std::filesystem::path(relative_path).filename().string())
+		load_action_internal();
+	}
+	_initialized = true;
+	// finish reload callbacks
+	for (auto& fn : finish_reload) fn();
+	if (changed_again) start_preparing(relative_path, prepare_action_internal);
+	return true;
 }
 
 Asset::~Asset() {
@@ -76,6 +147,8 @@ Asset::~Asset() {
 }
 
 void Asset::release_resources() {
+	// the prepare job writes into the asset
+	finish_preparing(relative_path);
 	if (_initialized) {
 		ASSET("releasing asset %s", relative_path.c_str())
 	}
@@ -88,7 +161,53 @@ void Asset::reload_all() {
 	}
 }
 
+void Asset::start_watching() {
+	if (watcher) return;
+	watcher = std::make_unique<myn::FileWatcher>();
+	for (auto& p : assets_pool) {
+		watcher->watch(ROOT_DIR"/" + p.first, p.first);
+	}
+}
+
+bool Asset::update_watched() {
+	if (!watcher) return false;
+
+	std::vector<std::string> ready;
+	{
+		std::lock_guard<std::mutex> lock(prepared_mutex);
+		ready.swap(prepared);
+	}
+	for (auto& key : ready) preparing.erase(key);
+
+	for (auto& key : watcher->poll_changes()) {
+		auto it = assets_pool.find(key);
+		if (it == assets_pool.end()) continue;
+		if (preparing.contains(key)) {
+			// the result would already be outdated; prepare again once it lands
+			changed_while_preparing.insert(key);
+		} else if (it->second->prepare_action_internal) {
+			start_preparing(key, it->second->prepare_action_internal);
+		} else {
+			ready.push_back(key);
+		}
+	}
+
+	bool reloaded = false;
+	for (auto& key : ready) {
+		auto it = assets_pool.find(key);
+		if (it == assets_pool.end()) continue;
+		if (changed_while_preparing.erase(key)) {
+			start_preparing(key, it->second->prepare_action_internal);
+			continue;
+		}
+		reloaded |= it->second->reload_now();
+	}
+	return reloaded;
+}
+
 void Asset::release_all() {
+	// (each asset waits for its own prepare job, if one is running)
+	watcher = nullptr;
 	for (const auto& pair : assets_pool) {
 		auto asset = pair.second;
 		if (asset) {
@@ -32,6 +32,13 @@ public:
 
 	static void reload_all();
 
+	// watch the files of all assets (including ones created later) for changes instead of polling them
+	static void start_watching();
+
+	// call once per frame on the main thread: starts preparing the assets whose files changed and reloads the ones
+	// that are ready. Returns true if anything got reloaded
+	static bool update_watched();
+
 	static void release_all();
 
 	static void delete_all();
@@ -40,10 +47,17 @@ protected:
 	Asset(const std::string &relative_path, const std::function<void()> &load_action);
 	std::string relative_path;
 	std::function<void()> load_action_internal = nullptr;
+	// optional, cpu-only part of loading (parsing, decoding..) that can run on a background thread ahead of
+	// load_action_internal. Called on the main thread, it returns the job to run in the background: whatever the job
+	// needs from the main thread (config values..) is read then. The job must not touch what's currently loaded;
+	// load_action_internal picks up its result, which is never read while the job still runs (see finish_preparing).
+	std::function<std::function<void()>()> prepare_action_internal = nullptr;
 
 	void bump_version() { _version += 1; }
 
 private:
+	bool reload_now();
+
 	bool _initialized = false;
 	time_t last_load_time = 0;
 	uint32_t _version = 0;
@@ -0,0 +1,99 @@
+#include "AssetGraph.h"
+#include <cstring>
+#include <fstream>
+
+std::unordered_map<std::string, AssetGraph::Node> AssetGraph::nodes;
+
+bool AssetGraph::update(const std::string &node_name, uint64_t content_hash)
+{
+	auto it = nodes.find(node_name);
+	if (it == nodes.end()) {
+		nodes[node_name].content_hash = content_hash;
+		return true;
+	}
+	if (it->second.content_hash == content_hash) return false;
+	it->second.content_hash = content_hash;
+	mark_changed(it->second);
+	return true;
+}
+
+void AssetGraph::set_dependencies(const std::string &node_name, const std::vector<std::string> &dependencies)
+{
+	auto& node = nodes[node_name];
+	for (auto& dependency : node.dependencies) {
+		auto it = nodes.find(dependency);
+		if (it != nodes.end()) it->second.dependents.erase(node_name);
+	}
+	node.dependencies = dependencies;
+	for (auto& dependency : node.dependencies) {
+		nodes[dependency].dependents.insert(node_name);
+	}
+}
+
+bool AssetGraph::consume_changed(const std::string &node_name)
+{
+	auto it = nodes.find(node_name);
+	if (it == nodes.end()) return true;
+	bool changed = it->second.changed;
+	it->second.changed = false;
+	return changed;
+}
+
+void AssetGraph::remove(const std::string &node_name)
+{
+	auto it = nodes.find(node_name);
+	if (it == nodes.end()) return;
+	auto& node = it->second;
+	mark_changed(node);
+	set_dependencies(node_name, {});
+	if (node.dependents.empty()) {
+		nodes.erase(it);
+	} else {
+		// keep the edges from its dependents, so they get notified again if it comes back
+		node.content_hash = 0;
+	}
+}
+
+void AssetGraph::mark_changed(Node &node)
+{
+	node.changed = true;
+	for (auto& dependent_name : node.dependents) {
+		auto it = nodes.find(dependent_name);
+		// already marked means its dependents are too (cycles stop here as well)
+		if (it != nodes.end() && !it->second.changed) mark_changed(it->second);
+	}
+}
+
+uint64_t AssetGraph::hash(const void *data, size_t size, uint64_t seed)
+{
+	// 8 bytes at a time; textures and mesh buffers go through here so plain byte-wise fnv would be too slow
+	constexpr uint64_t prime = 0x100000001b3ull;
+	constexpr uint64_t mix = 0x9e3779b97f4a7c15ull;
+	auto bytes = static_cast<const uint8_t*>(data);
+	uint64_t h = seed ^ (size * mix);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		word *= mix;
+		word ^= word >> 32;
+		h = (h ^ word) * prime;
+	}
+	for (; i < size; i++) {
+		h = (h ^ bytes[i]) * prime;
+	}
+	return h ^ (h >> 29);
+}
+
+uint64_t AssetGraph::hash_file(const std::string &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return 0;
+	uint64_t h = HASH_SEED;
+	std::vector<char> buffer(1 << 20);
+	while (file) {
+		file.read(buffer.data(), buffer.size());
+		if (file.gcount() > 0) h = hash(buffer.data(), file.gcount(), h);
+	}
+	return h;
+}
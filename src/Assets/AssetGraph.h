@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+ * Content hashes of the things assets are made of (files, textures, materials, mesh buffers..) and which of them
+ * are built from which. When an asset reloads it updates the hashes of its parts: only the parts whose hash changed,
+ * plus whatever (transitively) depends on them, need to be re-created.
+ * Main thread only, except for the hash functions.
+ */
+class AssetGraph
+{
+public:
+	// records the content hash of a node. If it's new or differs from the recorded one, the node and its dependents
+	// get marked as changed. Returns whether it changed
+	static bool update(const std::string& node, uint64_t content_hash);
+
+	// replaces what the node is built from: it gets marked as changed whenever one of these does
+	static void set_dependencies(const std::string& node, const std::vector<std::string>& dependencies);
+
+	// whether the node was marked as changed since the last call; clears the mark
+	static bool consume_changed(const std::string& node);
+
+	// the node is no longer part of any asset: marks its dependents as changed and drops its own dependencies
+	static void remove(const std::string& node);
+
+	static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+	static uint64_t hash(const void* data, size_t size, uint64_t seed = HASH_SEED);
+	static uint64_t hash(const std::string& str, uint64_t seed = HASH_SEED) { return hash(str.data(), str.size(), seed); }
+	template<typename T>
+	static uint64_t hash(const std::vector<T>& values, uint64_t seed = HASH_SEED) {
+		return hash(values.data(), values.size() * sizeof(T), seed);
+	}
+	// hash of the whole file's content (0 if it can't be read)
+	static uint64_t hash_file(const std::string& path);
+
+private:
+	struct Node {
+		uint64_t content_hash = 0;
+		bool changed = true;
+		std::vector<std::string> dependencies;
+		std::unordered_set<std::string> dependents;
+	};
+
+	static void mark_changed(Node& node);
+
+	static std::unordered_map<std::string, Node> nodes;
+};
@@ -6,7 +6,10 @@
 #include "Utils/myn/Log.h"
 #include <tinyexr/tinyexr.h>
 #if GRAPHICS_DISPLAY
+#include "ConfigAsset.hpp"
+#include "AssetGraph.h"
 #include "Render/Texture.h"
+#include "Render/TextureCook.h"
 #include "Render/Vulkan/VulkanUtils.h"
 #endif
 
@@ -27,12 +30,23 @@ EnvironmentMapAsset::EnvironmentMapAsset(
 			}
 #if GRAPHICS_DISPLAY
 			// TODO: use in rasterizer
-			texture2D = new Texture2D(
-				relative_path,
-				(uint8_t*)data4x32,
-				width, height,
-				{4, 32, 0},
-				true);
+			if (Config->lookup<int>("CookTextures") && Vulkan::Instance->textureCompressionBC) {
+				auto key = texture_cook::cache_key(
+					AssetGraph::hash(data4x32, size_t(width) * height * 4 * sizeof(float)), texture_cook::F_BC6H_UFLOAT);
+				auto cooked = texture_cook::load_cached(key);
+				if (!cooked) {
+					cooked = texture_cook::cook_hdr(data4x32, width, height);
+					texture_cook::save_cached(key, *cooked);
+				}
+				texture2D = new Texture2D(relative_path, *cooked);
+			} else {
+				texture2D = new Texture2D(
+					relative_path,
+					(uint8_t*)data4x32,
+					width, height,
+					{4, 32, 0},
+					true);
+			}
 			NAME_OBJECT(VK_OBJECT_TYPE_IMAGE, texture2D->resource.image, "Environment map")
 #endif
 			free(data4x32);
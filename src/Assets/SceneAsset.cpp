@@ -2,23 +2,35 @@
 // Created by raind on 5/22/2022.
 //
 
+#include "Utils/myn/Threading.h" // before Asset.h, which redefines time_t on macOS
+#include "Utils/myn/BinaryFile.h"
+#include "Utils/myn/Timer.h"
+#include "Utils/myn/Profiler.h"
+#include <filesystem>
 #include "Scene/Scene.hpp"
 #include "Scene/Camera.hpp"
 #include "Scene/Light.hpp"
 #include "Render/Mesh.h"
+#include "Render/MeshOptimizer.h"
 #include "ConfigAsset.hpp"
 #include "SceneAsset.h"
+#include "AssetGraph.h"
 #include "Render/Materials/GltfMaterialInfo.h"
 
 #include <glm/gtx/matrix_decompose.hpp>
 #include <tinygltf/tiny_gltf.h>
 
 #include <unordered_map>
+#include <unordered_set>
 #include <queue>
 #include "Scene/MeshObject.h"
 
+#include <stb_image/stb_image.h>
+
 #if GRAPHICS_DISPLAY
 #include "Render/Vulkan/VulkanUtils.h"
+#include "Render/TextureCook.h"
+#include "Render/TextureStreaming.h"
 #include "Render/Texture.h"
 #endif
 
@@ -174,6 +186,48 @@ bool findMaterialProperty(const tinygltf::Material& mat, const std::string& prop
 	return false;
 }
 
+/*
+ * Image loader for tinygltf that only reads the header: the encoded bytes stay in image->image,
+ * and get decoded later (in parallel, see decode_image) by whoever needs the pixels.
+ */
+bool defer_image_decoding(
+	tinygltf::Image* image, const int image_idx, std::string* err, std::string* warn,
+	int req_width, int req_height, const unsigned char* bytes, int size, void* user_data)
+{
+	int width = 0, height = 0, components = 0;
+	if (!stbi_info_from_memory(bytes, size, &width, &height, &components)) {
+		if (err) *err += "Unknown image format for image[" + std::to_string(image_idx) + "] '" + image->name + "'\n";
+		return false;
+	}
+	bool is_16_bit = stbi_is_16_bit_from_memory(bytes, size);
+	image->width = width;
+	image->height = height;
+	image->component = 4; // same as tinygltf's own loader with SetPreserveImageChannels(false)
+	image->bits = is_16_bit ? 16 : 8;
+	image->pixel_type = is_16_bit ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+	image->image.assign(bytes, bytes + size);
+	return true;
+}
+
+#if GRAPHICS_DISPLAY
+bool decode_image(
+	const uint8_t* encoded, uint64_t encoded_size, int channel_depth,
+	std::vector<uint8_t>& out_pixels, uint32_t& out_width, uint32_t& out_height)
+{
+	int width = 0, height = 0, components = 0;
+	void* data = channel_depth == 16 ?
+		(void*)stbi_load_16_from_memory(encoded, (int)encoded_size, &width, &height, &components, 4) :
+		(void*)stbi_load_from_memory(encoded, (int)encoded_size, &width, &height, &components, 4);
+	if (!data) return false;
+	auto* pixels = static_cast<uint8_t*>(data);
+	out_pixels.assign(pixels, pixels + size_t(width) * height * 4 * (channel_depth / 8));
+	out_width = width;
+	out_height = height;
+	stbi_image_free(data);
+	return true;
+}
+#endif
+
 }// anonymous namespace
 
 // for loading mesh buffers
@@ -236,17 +290,13 @@ void load_mesh_buffers(
 	// cpu (required)
 	std::unordered_map<PrimitiveBufferIndex, Mesh::CpuDataAccessor>& cpu_buffer_indices_map,
 	std::vector<Vertex>& vertex_buffer_cpu,
-	std::vector<VERTEX_INDEX_TYPE>& index_buffer_cpu
-#if GRAPHICS_DISPLAY
-	// gpu (optional)
-	, std::unordered_map<PrimitiveBufferIndex, Mesh::GpuDataAccessor>* gpu_buffer_indices_map = nullptr,
-	VmaBuffer* vbo = nullptr,
-	VmaBuffer* ibo = nullptr
-#endif
+	std::vector<VERTEX_INDEX_TYPE>& index_buffer_cpu,
+	std::vector<Mesh::Meshlet>& meshlet_buffer_cpu,
+	bool optimize_meshes
 ) {
 	/*
-	 * load all the cpu data first (append into given buffers and update map)
-	 * if gpu resources are given, create them from cpu data
+	 * load all the cpu data (append into given buffers and update map)
+	 * gpu resources get created from it afterwards, see create_mesh_gpu_buffers
 	 */
 	using namespace glm;
 
@@ -257,93 +307,173 @@ void load_mesh_buffers(
 		uint32_t* num_components=nullptr,
 		uint32_t* component_type=nullptr)
 	{
-		auto accessor = model.accessors[accessor_idx];
-		auto buffer_view = model.bufferViews[accessor.bufferView];
+		auto& accessor = model.accessors[accessor_idx];
+		auto& buffer_view = model.bufferViews[accessor.bufferView];
 		*out_data = &model.buffers[buffer_view.buffer].data[buffer_view.byteOffset + accessor.byteOffset];
 		*out_size = accessor.count;
 		if (num_components) *num_components = accessor.type;
 		if (component_type) *component_type = accessor.componentType;
 	};
 
-	// cpu
-	for (auto& mesh : model.meshes) {
-		for (auto& prim : mesh.primitives) {
-			PrimitiveBufferIndex prim_buf_idx = primitive_buffer_indices(prim);
-			if (!cpu_buffer_indices_map.contains(prim_buf_idx)) {
-
-				uint32_t offset_num_vertices = vertex_buffer_cpu.size();
-				uint32_t offset_num_indices = index_buffer_cpu.size();
-
-				// vertices
-				const vec3* positions;
-				const vec3* normals;
-				const vec4* tangents;
-				const vec2* uvs;
-				uint32_t positions_cnt, normals_cnt, tangents_cnt, uvs_cnt;
-				// TODO: can check for data types for safety (now assuming correct #components; all floats)
-				get_data(prim_buf_idx.vb_idx.position_acc_idx, reinterpret_cast<const uint8_t**>(&positions), &positions_cnt);
-				get_data(prim_buf_idx.vb_idx.normal_acc_idx, reinterpret_cast<const uint8_t**>(&normals), &normals_cnt);
-				get_data(prim_buf_idx.vb_idx.tangent_acc_idx, reinterpret_cast<const uint8_t**>(&tangents), &tangents_cnt);
-				get_data(prim_buf_idx.vb_idx.uv_acc_idx, reinterpret_cast<const uint8_t**>(&uvs), &uvs_cnt);
-
-				EXPECT_M(positions_cnt == normals_cnt && normals_cnt == tangents_cnt && tangents_cnt == uvs_cnt, true,
-						 "Mesh prims should have the same number of each attribute!");
-
-				for (auto i = 0; i < positions_cnt; i++) {
-					vertex_buffer_cpu.emplace_back();
-					Vertex& v = vertex_buffer_cpu.back();
-					v.position = positions[i];
-					v.normal = normals[i];
-					v.tangent = tangents[i];
-					v.uv = uvs[i];
-				}
+	// glTF allows 8, 16 or 32 bit indices; widen everything to VERTEX_INDEX_TYPE
+	auto copy_indices = [](const uint8_t* src, uint32_t count, uint32_t component_type, VERTEX_INDEX_TYPE* dst) {
+		switch (component_type) {
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				for (uint32_t i = 0; i < count; i++) dst[i] = src[i];
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+				for (uint32_t i = 0; i < count; i++) dst[i] = reinterpret_cast<const uint16_t*>(src)[i];
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+				memcpy(dst, src, count * sizeof(uint32_t));
+				break;
+			default:
+				ERR("Unsupported index component type %u!", component_type)
+		}
+	};
 
-				// faces
-				const VERTEX_INDEX_TYPE* indices_data;
-				uint32_t indices_cnt, num_components, component_type;
-				get_data(prim_buf_idx.ib_idx, reinterpret_cast<const uint8**>(&indices_data), &indices_cnt, &num_components, &component_type);
-				ASSERT_M(component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, "Indices are not 16-bit unsigned ints!")
-				ASSERT_M(indices_cnt % 3 == 0, "Num indices is not a multiply of 3!")
+	mesh_optimizer::Settings optimizer_settings;
+
+	// cpu: first size everything so the buffers are allocated once, then fill in (and optionally optimize)
+	// all primitives in parallel, each into its own range
+	struct PrimitiveLoadJob {
+		PrimitiveBufferIndex prim_buf_idx;
+		uint32_t offset_num_vertices;
+		uint32_t num_vertices;
+		uint32_t offset_num_indices;
+		uint32_t num_indices;
+		std::vector<Mesh::Meshlet> meshlets;
+	};
+	std::vector<PrimitiveLoadJob> jobs;
+	{
+		uint32_t total_vertices = vertex_buffer_cpu.size();
+		uint32_t total_indices = index_buffer_cpu.size();
+		std::unordered_set<PrimitiveBufferIndex> seen;
+		for (auto& mesh : model.meshes) {
+			for (auto& prim : mesh.primitives) {
+				PrimitiveBufferIndex prim_buf_idx = primitive_buffer_indices(prim);
+				if (cpu_buffer_indices_map.contains(prim_buf_idx) || seen.contains(prim_buf_idx)) continue;
+				seen.insert(prim_buf_idx);
+
+				uint32_t num_vertices = model.accessors[prim_buf_idx.vb_idx.position_acc_idx].count;
+				uint32_t num_indices = model.accessors[prim_buf_idx.ib_idx].count;
+				ASSERT_M(num_indices % 3 == 0, "Num indices is not a multiply of 3!")
+				jobs.push_back({
+					.prim_buf_idx = prim_buf_idx,
+					.offset_num_vertices = total_vertices,
+					.num_vertices = num_vertices,
+					.offset_num_indices = total_indices,
+					.num_indices = num_indices,
+					.meshlets = {}
+				});
+				total_vertices += num_vertices;
+				total_indices += num_indices;
+			}
+		}
+		vertex_buffer_cpu.resize(total_vertices);
+		index_buffer_cpu.resize(total_indices);
+	}
 
-				for (auto i = 0; i < indices_cnt; i++) {
-					index_buffer_cpu.push_back(indices_data[i]);
-				}
+	myn::WorkerPool::shared().parallel_for(jobs.size(), [&](uint32_t job_index) {
+		auto& job = jobs[job_index];
+
+		// vertices
+		const vec3* positions;
+		const vec3* normals;
+		const vec4* tangents;
+		const vec2* uvs;
+		uint32_t positions_cnt, normals_cnt, tangents_cnt, uvs_cnt;
+		// TODO: can check for data types for safety (now assuming correct #components; all floats)
+		get_data(job.prim_buf_idx.vb_idx.position_acc_idx, reinterpret_cast<const uint8_t**>(&positions), &positions_cnt);
+		get_data(job.prim_buf_idx.vb_idx.normal_acc_idx, reinterpret_cast<const uint8_t**>(&normals), &normals_cnt);
+		get_data(job.prim_buf_idx.vb_idx.tangent_acc_idx, reinterpret_cast<const uint8_t**>(&tangents), &tangents_cnt);
+		get_data(job.prim_buf_idx.vb_idx.uv_acc_idx, reinterpret_cast<const uint8_t**>(&uvs), &uvs_cnt);
+
+		EXPECT_M(positions_cnt == normals_cnt && normals_cnt == tangents_cnt && tangents_cnt == uvs_cnt, true,
+				 "Mesh prims should have the same number of each attribute!");
+
+		Vertex* vertices = &vertex_buffer_cpu[job.offset_num_vertices];
+		for (uint32_t i = 0; i < job.num_vertices; i++) {
+			vertices[i].position = positions[i];
+			vertices[i].normal = normals[i];
+			vertices[i].tangent = tangents[i];
+			vertices[i].uv = uvs[i];
+		}
 
-				Mesh::CpuDataAccessor cpu_accessor = {
-					.vertices = &vertex_buffer_cpu,
-					.num_vertices = static_cast<uint32_t>(vertex_buffer_cpu.size() - offset_num_vertices),
-					.offset_num_vertices = offset_num_vertices,
-					.faces = &index_buffer_cpu,
-					.num_indices = static_cast<uint32_t>(index_buffer_cpu.size() - offset_num_indices),
-					.offset_num_indices = offset_num_indices
-				};
-				cpu_buffer_indices_map[prim_buf_idx] = cpu_accessor;
-			}
+		// faces
+		const uint8_t* indices_data;
+		uint32_t indices_cnt, num_components, component_type;
+		get_data(job.prim_buf_idx.ib_idx, &indices_data, &indices_cnt, &num_components, &component_type);
+		VERTEX_INDEX_TYPE* indices = &index_buffer_cpu[job.offset_num_indices];
+		copy_indices(indices_data, indices_cnt, component_type, indices);
+
+		// reorder for the post-transform cache & split into meshlets; doesn't change what's drawn
+		if (optimize_meshes) {
+			job.meshlets = mesh_optimizer::optimize(vertices, job.num_vertices, indices, job.num_indices, optimizer_settings);
 		}
+	});
+
+	for (auto& job : jobs) {
+		uint32_t offset_num_meshlets = meshlet_buffer_cpu.size();
+		meshlet_buffer_cpu.insert(meshlet_buffer_cpu.end(), job.meshlets.begin(), job.meshlets.end());
+
+		Mesh::CpuDataAccessor cpu_accessor = {
+			.vertices = nullptr,
+			.num_vertices = job.num_vertices,
+			.offset_num_vertices = job.offset_num_vertices,
+			.faces = nullptr,
+			.num_indices = job.num_indices,
+			.offset_num_indices = job.offset_num_indices,
+			.meshlets = nullptr,
+			.num_meshlets = static_cast<uint32_t>(job.meshlets.size()),
+			.offset_num_meshlets = offset_num_meshlets
+		};
+		cpu_buffer_indices_map[job.prim_buf_idx] = cpu_accessor;
 	}
+	// only now that the buffers are done growing (this includes accessors from earlier calls)
+	for (auto& p : cpu_buffer_indices_map) {
+		p.second.vertices = vertex_buffer_cpu.data();
+		p.second.faces = index_buffer_cpu.data();
+		p.second.meshlets = meshlet_buffer_cpu.data();
+	}
+}
 
 #if GRAPHICS_DISPLAY
-	// also load gpu resources:
-	if (gpu_buffer_indices_map && vbo && ibo) {
-
-		vk::create_vertex_buffer(
-			vertex_buffer_cpu.data(), vertex_buffer_cpu.size(), sizeof(Vertex), *vbo);
-		vk::create_index_buffer(
-			index_buffer_cpu.data(), index_buffer_cpu.size(), sizeof(VERTEX_INDEX_TYPE), *ibo);
-
-		for (auto& p : cpu_buffer_indices_map) {
-			Mesh::GpuDataAccessor gpu_accessor = {
-				.vertexBuffer = vbo,
-				.vertexBufferOffsetBytes = p.second.offset_num_vertices * sizeof(Vertex),
-				.indexBuffer = ibo,
-				.indexBufferOffsetBytes = p.second.offset_num_indices * sizeof(VERTEX_INDEX_TYPE)
-			};
-			(*gpu_buffer_indices_map)[p.first] = gpu_accessor;
-		}
+// where each primitive lives in the combined buffers
+void make_gpu_accessors(
+	const std::unordered_map<PrimitiveBufferIndex, Mesh::CpuDataAccessor>& cpu_buffer_indices_map,
+	std::unordered_map<PrimitiveBufferIndex, Mesh::GpuDataAccessor>& gpu_buffer_indices_map,
+	VmaBuffer& vbo,
+	VmaBuffer& ibo)
+{
+	for (auto& p : cpu_buffer_indices_map) {
+		Mesh::GpuDataAccessor gpu_accessor = {
+			.vertexBuffer = &vbo,
+			.vertexBufferOffsetBytes = p.second.offset_num_vertices * sizeof(Vertex),
+			.indexBuffer = &ibo,
+			.indexBufferOffsetBytes = p.second.offset_num_indices * sizeof(VERTEX_INDEX_TYPE)
+		};
+		gpu_buffer_indices_map[p.first] = gpu_accessor;
 	}
-#endif
 }
 
+void create_mesh_gpu_buffers(
+	const std::unordered_map<PrimitiveBufferIndex, Mesh::CpuDataAccessor>& cpu_buffer_indices_map,
+	std::span<const Vertex> vertex_buffer_cpu,
+	std::span<const VERTEX_INDEX_TYPE> index_buffer_cpu,
+	std::unordered_map<PrimitiveBufferIndex, Mesh::GpuDataAccessor>& gpu_buffer_indices_map,
+	VmaBuffer& vbo,
+	VmaBuffer& ibo)
+{
+	vk::create_vertex_buffer(
+		vertex_buffer_cpu.data(), vertex_buffer_cpu.size(), sizeof(Vertex), vbo);
+	vk::create_index_buffer(
+		index_buffer_cpu.data(), index_buffer_cpu.size(), sizeof(VERTEX_INDEX_TYPE), ibo);
+
+	make_gpu_accessors(cpu_buffer_indices_map, gpu_buffer_indices_map, vbo, ibo);
+}
+#endif
+
 // load from glTF data
 std::vector<Mesh*> load_gltf_meshes(
 	const std::string& node_name,
@@ -379,203 +509,879 @@ std::vector<Mesh*> load_gltf_meshes(
 	return output;
 }
 
-SceneAsset::SceneAsset(
-	SceneObject* outer_root,
-	const std::string &relative_path)
-: Asset(relative_path, nullptr)
+//////////////////////// scene source & cache ////////////////////////
+
+namespace
 {
-	load_action_internal = [this, outer_root, relative_path]() {
+struct ImageSource {
+	std::string name;
+	int num_channels = 4;
+	int channel_depth = 8;
+	int srgb = 0;
+	std::string placeholder = "_white";
+	std::vector<std::string> material_users;
+	// the image is in one of these forms:
+	std::vector<uint8_t> encoded; // straight from the glTF file
+	const uint8_t* mapped_encoded = nullptr; // same, inside the mapped cache file
+	uint64_t mapped_encoded_size = 0;
+	std::shared_ptr<myn::MappedFile> cache_file; // keeps mapped_encoded valid
+	std::vector<uint8_t> pixels; // decoded
+	uint64_t content_hash = 0; // of the encoded image, so it's the same whether it came from glTF or the cache
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
 
-		// cleanup first, if necessary
-		if (outer_root) outer_root->try_remove_child(asset_root);
-#if GRAPHICS_DISPLAY
-		Vulkan::Instance->waitDeviceIdle();
-#endif
-		release_resources();
-		delete asset_root;
+}// anonymous namespace
 
-		tinygltf::Model model;
-		tinygltf::TinyGLTF loader;
-		loader.SetPreserveImageChannels(false);
-		std::string err;
-		std::string warn;
+// the config values a SceneSource depends on. Read on the main thread, so the background prepare never touches Config
+struct SceneSourceOptions {
+	bool use_cache = false;
+	bool optimize_meshes = false;
+	bool collapse_tree = false;
+
+	static SceneSourceOptions from_config() {
+		return {
+			.use_cache = (bool)Config->lookup<int>("SceneCache"),
+			.optimize_meshes = (bool)Config->lookup<int>("OptimizeMeshes"),
+			.collapse_tree = (bool)Config->lookup<int>("Debug.CollapseSceneTree"),
+		};
+	}
+};
 
-		//bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, absolute_path);
-		bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, ROOT_DIR"/" + relative_path);
+// everything the scene objects get built from; filled in either from the glTF file or from the scene cache
+struct SceneSource {
+	tinygltf::Model model; // from the cache, only meshes, cameras and lights are filled in
+	std::vector<GltfMaterialInfo> materials;
+	std::vector<std::shared_ptr<ImageSource>> images;
+	std::unordered_map<PrimitiveBufferIndex, Mesh::CpuDataAccessor> cpu_buffer_indices;
+	SceneNodeIntermediate* tree = nullptr;
+	CombinedMeshBuffers buffers;
+	uint64_t buffers_hash = 0;
+
+	SceneSource() = default;
+	SceneSource(const SceneSource&) = delete;
+	~SceneSource() { clear(); }
+
+	void clear() {
+		model = tinygltf::Model();
+		materials.clear();
+		images.clear();
+		cpu_buffer_indices.clear();
+		delete tree;
+		tree = nullptr;
+		buffers.clear();
+		buffers_hash = 0;
+	}
+};
 
-		if (!warn.empty()) WARN("[TinyGLTF] %s", warn.c_str())
-		if (!err.empty()) ERR("[TinyGLTF] %s", err.c_str())
-		if (!ret) ERR("[TinyGLTF] Failed to parse glTF")
+namespace
+{
 
-		//====================
+GltfMaterialInfo convert_material(const tinygltf::Material& mat, const std::vector<std::string>& texture_names)
+{
+	int albedo_idx = mat.pbrMetallicRoughness.baseColorTexture.index;
+	auto albedo = albedo_idx >= 0 ? texture_names[albedo_idx] : "_white";
 
-#if GRAPHICS_DISPLAY
-		// image (texture), material
+	int normal_idx = mat.normalTexture.index;
+	auto normal = normal_idx >= 0 ? texture_names[normal_idx] : "_defaultNormal";
 
-		struct ImageInfo {
-			ImageFormat format;
-			Texture2D* texture;
-		};
-		std::vector<ImageInfo> image_infos(model.images.size());
+	int mr_idx = mat.pbrMetallicRoughness.metallicRoughnessTexture.index;
+	auto orm = mr_idx >= 0 ? texture_names[mr_idx] : "_white";
 
-		// fill in format for now but defer actual creation till after mesh loading
-		for (int i = 0; i < model.images.size(); i++)
-		{
-			auto& img = model.images[i];
-			image_infos[i].format = { img.component, img.bits, 0 };
+	int ao_idx = mat.occlusionTexture.index;
+	auto ao = ao_idx >= 0 ? texture_names[ao_idx] : "_white";
+
+	int emissive_idx = mat.emissiveTexture.index;
+	auto emissiveTexName = emissive_idx >= 0 ? texture_names[emissive_idx] : "_black";
+
+	auto bc = mat.pbrMetallicRoughness.baseColorFactor;
+	auto baseColorFactor = glm::vec4(bc[0], bc[1], bc[2], bc[3]);
+	glm::vec4 strengths = {
+		(float)mat.occlusionTexture.strength,
+		(float)mat.pbrMetallicRoughness.roughnessFactor,
+		(float)mat.pbrMetallicRoughness.metallicFactor,
+		(float)mat.normalTexture.scale
+	};
+	// gets multiplied by emissiveStrength, and then clamped to (1, 1, 1)...
+	// basically just don't use emissive strength in blender :/
+	auto em = mat.emissiveFactor;
+	glm::vec3 emissiveFactor = glm::vec3(em[0], em[1], em[2]);
+
+	// blend mode
+	BlendMode blendMode = BM_OpaqueOrClip;
+	if (mat.alphaMode == "BLEND") blendMode = BM_AlphaBlend;
+
+	// clip threshold
+	float clipThreshold = mat.alphaMode == "OPAQUE" ? -1.0f : (float)mat.alphaCutoff;
+
+	GltfMaterialInfo info = {
+		._version = 0,
+		.type = MaterialType::MT_Surface,
+		.name = mat.name,
+		.albedoTexName = albedo,
+		.normalTexName = normal,
+		.ormTexName = orm,
+		.aoTexName = ao,
+		.emissiveTexName = emissiveTexName,
+		.BaseColorFactor = baseColorFactor,
+		.EmissiveFactor = emissiveFactor,
+		.OcclusionRoughnessMetallicNormalStrengths = strengths,
+		.doubleSided = mat.doubleSided,
+		.blendMode = blendMode,
+		.clipThreshold = clipThreshold,
+		.volumeDensity = 0,
+		.volumeColor = glm::vec4(0, 0, 0, 0),
+	};
+
+	// and in case it's a volume material...
+	tinygltf::Value isVolume;
+	tinygltf::Value volumeColor;
+	tinygltf::Value volumeDensity;
+	if (findMaterialProperty(mat, "_is_volume", isVolume) &&
+		findMaterialProperty(mat, "_volume_color", volumeColor) &&
+		findMaterialProperty(mat, "_volume_density", volumeDensity))
+	{
+		info.type = MaterialType::MT_Volume;
+		info.volumeColor = glm::vec4(
+			volumeColor.Get(0).GetNumberAsDouble(),
+			volumeColor.Get(1).GetNumberAsDouble(),
+			volumeColor.Get(2).GetNumberAsDouble(),
+			volumeColor.Get(3).GetNumberAsDouble());
+		info.volumeDensity = (float)volumeDensity.GetNumberAsDouble();
+	}
+	return info;
+}
+
+// everything but the version
+uint64_t hash_material(const GltfMaterialInfo& info)
+{
+	uint64_t h = AssetGraph::HASH_SEED;
+	for (auto str : { &info.name, &info.albedoTexName, &info.normalTexName, &info.ormTexName, &info.aoTexName, &info.emissiveTexName }) {
+		h = AssetGraph::hash(*str, h);
+	}
+	auto hash_value = [&h](const auto& value) { h = AssetGraph::hash(&value, sizeof(value), h); };
+	hash_value(info.type);
+	hash_value(info.BaseColorFactor);
+	hash_value(info.EmissiveFactor);
+	hash_value(info.OcclusionRoughnessMetallicNormalStrengths);
+	hash_value(info.doubleSided);
+	hash_value(info.blendMode);
+	hash_value(info.clipThreshold);
+	hash_value(info.volumeDensity);
+	hash_value(info.volumeColor);
+	return h;
+}
+
+void load_gltf_source(const std::string& path, const SceneSourceOptions& options, SceneSource& source)
+{
+	auto& model = source.model;
+	tinygltf::TinyGLTF loader;
+	loader.SetPreserveImageChannels(false);
+	loader.SetImageLoader(defer_image_decoding, nullptr);
+	std::string err;
+	std::string warn;
+
+	//bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, absolute_path);
+	bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, path);
+
+	if (!warn.empty()) WARN("[TinyGLTF] %s", warn.c_str())
+	if (!err.empty()) ERR("[TinyGLTF] %s", err.c_str())
+	if (!ret) ERR("[TinyGLTF] Failed to parse glTF")
+
+	// materials
+	std::vector<std::string> texture_names(model.textures.size());
+	for (int i = 0; i < model.textures.size(); i++) {
+		texture_names[i] = model.images[model.textures[i].source].name;
+	}
+	for (auto& mat : model.materials) {
+		source.materials.push_back(convert_material(mat, texture_names));
+	}
+
+#if GRAPHICS_DISPLAY
+	// images
+	for (auto& img : model.images) {
+		auto image = std::make_shared<ImageSource>();
+		image->name = img.name;
+		image->num_channels = img.component;
+		image->channel_depth = img.bits;
+		image->width = img.width;
+		image->height = img.height;
+		// still encoded, see defer_image_decoding
+		image->encoded = std::move(img.image);
+		image->content_hash = AssetGraph::hash(image->encoded);
+		source.images.push_back(image);
+	}
+	// mark albedo and emissive textures as sRGB, and note which materials sample each image
+	auto use_image = [&](int tex_idx, const tinygltf::Material& mat) -> ImageSource* {
+		if (tex_idx < 0) return nullptr;
+		auto& image = source.images[model.textures[tex_idx].source];
+		image->material_users.push_back(mat.name);
+		return image.get();
+	};
+	for (auto& mat : model.materials)
+	{
+		if (auto image = use_image(mat.pbrMetallicRoughness.baseColorTexture.index, mat)) {
+			image->srgb = 1;
 		}
-		// mark albedo and emissive textures as sRGB
-		for (int i = 0; i < model.materials.size(); i++)
-		{
-			auto& mat = model.materials[i];
-			int albedo_tex_idx = mat.pbrMetallicRoughness.baseColorTexture.index;
-			if (albedo_tex_idx >= 0) {
-				int albedo_img_idx = model.textures[albedo_tex_idx].source;
-				image_infos[albedo_img_idx].format.SRGB = 1;
-			}
-			int emissive_tex_idx = mat.emissiveTexture.index;
-			if (emissive_tex_idx >= 0) {
-				int emissive_img_idx = model.textures[emissive_tex_idx].source;
-				image_infos[emissive_img_idx].format.SRGB = 1;
-			}
+		if (auto image = use_image(mat.emissiveTexture.index, mat)) {
+			image->srgb = 1;
+			image->placeholder = "_black";
 		}
-		// actually create the textures
-		for (int i = 0; i < model.images.size(); i++)
-		{
-			auto& img = model.images[i];
-			auto tex = new Texture2D(
-				img.name,
-				img.image.data(),
-				img.width, img.height,
-				image_infos[i].format);
-			image_infos[i].texture = tex;
-			asset_textures.push_back(tex);
+		if (auto image = use_image(mat.normalTexture.index, mat)) {
+			image->placeholder = "_defaultNormal";
 		}
+		use_image(mat.pbrMetallicRoughness.metallicRoughnessTexture.index, mat);
+		use_image(mat.occlusionTexture.index, mat);
+	}
 #endif
 
-		// materials
-		std::vector<std::string> texture_names(model.textures.size());
-		for (int i = 0; i < model.textures.size(); i++) {
-			texture_names[i] = model.images[model.textures[i].source].name;
+	// mesh buffers
+	auto& buffers = source.buffers;
+	load_mesh_buffers(
+		model,
+		source.cpu_buffer_indices,
+		buffers.owned_vertices,
+		buffers.owned_indices,
+		buffers.owned_meshlets,
+		options.optimize_meshes);
+	buffers.use_owned();
+	model.buffers.clear(); // everything in there got copied out already
+
+	// camera, mesh
+	source.tree = loadSceneTree(model.nodes);
+
+	{// light
+		std::unordered_map<std::string, SceneNodeIntermediate*> nodes_map;
+		source.tree->foreach([&nodes_map](SceneNodeIntermediate* node) { nodes_map[node->name] = node; });
+		for (int i = 0; i < model.lights.size(); i++) {
+			auto& light_name = model.lights[i].name;
+			if (nodes_map.contains(light_name)) {
+				nodes_map[light_name]->light_idx = i;
+			}
+		}
+	}
+
+	if (options.collapse_tree) collapseSceneTree(source.tree);
+}
+
+#if GRAPHICS_DISPLAY
+bool is_encoded(const ImageSource& image)
+{
+	return !image.encoded.empty() || image.mapped_encoded;
+}
+
+// decodes the image into out_pixels and drops the encoded version
+bool decode_image(ImageSource& image, std::vector<uint8_t>& out_pixels)
+{
+	bool success = image.mapped_encoded ?
+		decode_image(image.mapped_encoded, image.mapped_encoded_size, image.channel_depth, out_pixels, image.width, image.height) :
+		decode_image(image.encoded.data(), image.encoded.size(), image.channel_depth, out_pixels, image.width, image.height);
+	image.encoded = {};
+	image.mapped_encoded = nullptr;
+	image.mapped_encoded_size = 0;
+	image.cache_file = nullptr;
+	return success;
+}
+
+// decodes whatever images are still encoded, in parallel
+void decode_images(std::vector<std::shared_ptr<ImageSource>>& images)
+{
+	myn::WorkerPool::shared().parallel_for(images.size(), [&](uint32_t i) {
+		auto& image = *images[i];
+		if (!is_encoded(image)) return;
+		PROFILE_SCOPE("decode " + image.name)
+		if (!decode_image(image, image.pixels)) {
+			WARN("failed to decode image '%s'", image.name.c_str())
 		}
+	});
+}
 
-		std::vector<std::string> material_names(model.materials.size());
-		for (int i = 0; i < model.materials.size(); i++) {
-			auto& mat = model.materials[i];
-			material_names[i] = mat.name;
+// moves the decoded pixels out of the image, decoding first if needed
+bool take_image_pixels(ImageSource& image, std::vector<uint8_t>& out_pixels)
+{
+	if (is_encoded(image)) return decode_image(image, out_pixels);
+	out_pixels = std::move(image.pixels);
+	return !out_pixels.empty();
+}
 
-			// create mat info and add it to the mapping
+// whether changed textures get cooked (see cook_image); read on the main thread
+bool should_cook_textures()
+{
+	return Config->lookup<int>("CookTextures") && Vulkan::Instance->textureCompressionBC;
+}
 
-			int albedo_idx = mat.pbrMetallicRoughness.baseColorTexture.index;
-			auto albedo = albedo_idx >= 0 ? texture_names[albedo_idx] : "_white";
+// block compressed version of the image with a full mip chain, from the texture cache if it was cooked before (then
+// nothing needs decoding). Only call if should_cook_textures()
+std::shared_ptr<texture_cook::CookedTexture> cook_image(ImageSource& image)
+{
+	auto format = texture_cook::format_for(image.srgb, image.placeholder == "_defaultNormal");
+	auto key = texture_cook::cache_key(image.content_hash, format);
+	if (auto cooked = texture_cook::load_cached(key)) return cooked;
+
+	std::vector<uint8_t> pixels;
+	if (!take_image_pixels(image, pixels)) return nullptr;
+	// (runs in a background job, so the encoding stays on this thread: see WorkerPool::parallel_for)
+	auto cooked = image.channel_depth == 16 ?
+		texture_cook::cook(reinterpret_cast<const uint16_t*>(pixels.data()), image.width, image.height, format) :
+		texture_cook::cook(pixels.data(), image.width, image.height, format);
+	if (!texture_cook::save_cached(key, *cooked)) {
+		WARN("failed to write the cooked texture '%s' to the texture cache", image.name.c_str())
+		return cooked;
+	}
+	// the mapped copy doesn't need to stay in memory (texture streaming only reads the mips it needs)
+	auto mapped = texture_cook::load_cached(key);
+	return mapped ? mapped : cooked;
+}
+#endif
 
-			int normal_idx = mat.normalTexture.index;
-			auto normal = normal_idx >= 0 ? texture_names[normal_idx] : "_defaultNormal";
+//-------- binary scene cache --------
+// a versioned dump of a loaded SceneSource (+ combined buffers), stored next to the .glb and memory-mapped when read.
+// The combined buffers are used in place from the mapping; images are kept encoded, so they're decoded (or found in the
+// texture cache) in the background like when loading from glTF.
+// Builds with and without images each have their own file (see scene_cache_path).
+// Any change to the file layout below should bump SCENE_CACHE_VERSION.
 
-			int mr_idx = mat.pbrMetallicRoughness.metallicRoughnessTexture.index;
-			auto orm = mr_idx >= 0 ? texture_names[mr_idx] : "_white";
+#define SCENE_CACHE_MAGIC 0x4e43534e // "NSCN"
+#define SCENE_CACHE_VERSION 3
 
-			int ao_idx = mat.occlusionTexture.index;
-			auto ao = ao_idx >= 0 ? texture_names[ao_idx] : "_white";
+enum SceneCacheOptions : uint32_t {
+	SCO_OptimizedMeshes = 1 << 0,
+	SCO_CollapsedTree = 1 << 1,
+	SCO_HasImages = 1 << 2, // only written by builds that display textures
+};
 
-			int emissive_idx = mat.emissiveTexture.index;
-			auto emissiveTexName = emissive_idx >= 0 ? texture_names[emissive_idx] : "_black";
+std::string scene_cache_path(const std::string& source_path, bool has_images)
+{
+	return source_path + (has_images ? ".cache" : ".noimages.cache");
+}
 
-			auto bc = mat.pbrMetallicRoughness.baseColorFactor;
-			auto baseColorFactor = glm::vec4(bc[0], bc[1], bc[2], bc[3]);
-			glm::vec4 strengths = {
-				(float)mat.occlusionTexture.strength,
-				(float)mat.pbrMetallicRoughness.roughnessFactor,
-				(float)mat.pbrMetallicRoughness.metallicFactor,
-				(float)mat.normalTexture.scale
-			};
-			// gets multiplied by emissiveStrength, and then clamped to (1, 1, 1)...
-			// basically just don't use emissive strength in blender :/
-			auto em = mat.emissiveFactor;
-			glm::vec3 emissiveFactor = glm::vec3(em[0], em[1], em[2]);
-
-			// blend mode
-			BlendMode blendMode = BM_OpaqueOrClip;
-			if (mat.alphaMode == "BLEND") blendMode = BM_AlphaBlend;
-
-			// clip threshold
-			float clipThreshold = mat.alphaMode == "OPAQUE" ? -1.0f : (float)mat.alphaCutoff;
-
-			GltfMaterialInfo info = {
-				._version = 0,
-				.type = MaterialType::MT_Surface,
-				.name = mat.name,
-				.albedoTexName = albedo,
-				.normalTexName = normal,
-				.ormTexName = orm,
-				.aoTexName = ao,
-				.emissiveTexName = emissiveTexName,
-				.BaseColorFactor = baseColorFactor,
-				.EmissiveFactor = emissiveFactor,
-				.OcclusionRoughnessMetallicNormalStrengths = strengths,
-				.doubleSided = mat.doubleSided,
-				.blendMode = blendMode,
-				.clipThreshold = clipThreshold,
-				.volumeDensity = 0,
-				.volumeColor = glm::vec4(0, 0, 0, 0),
-			};
+struct SceneCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_size;
+	int64_t source_write_time;
+	uint32_t options;
+	uint32_t vertex_size;
+	uint32_t index_size;
+	uint32_t meshlet_size;
+};
 
-			// and in case it's a volume material...
-			tinygltf::Value isVolume;
-			tinygltf::Value volumeColor;
-			tinygltf::Value volumeDensity;
-			if (findMaterialProperty(mat, "_is_volume", isVolume) &&
-				findMaterialProperty(mat, "_volume_color", volumeColor) &&
-				findMaterialProperty(mat, "_volume_density", volumeDensity))
-			{
-				info.type = MaterialType::MT_Volume;
-				info.volumeColor = glm::vec4(
-					volumeColor.Get(0).GetNumberAsDouble(),
-					volumeColor.Get(1).GetNumberAsDouble(),
-					volumeColor.Get(2).GetNumberAsDouble(),
-					volumeColor.Get(3).GetNumberAsDouble());
-				info.volumeDensity = (float)volumeDensity.GetNumberAsDouble();
+struct PrimitiveRecord {
+	PrimitiveBufferIndex key;
+	uint32_t num_vertices;
+	uint32_t offset_num_vertices;
+	uint32_t num_indices;
+	uint32_t offset_num_indices;
+	uint32_t num_meshlets;
+	uint32_t offset_num_meshlets;
+};
+
+SceneCacheHeader make_cache_header(const std::string& source_path, const SceneSourceOptions& options, bool has_images)
+{
+	std::error_code ec;
+	SceneCacheHeader header = {
+		.magic = SCENE_CACHE_MAGIC,
+		.version = SCENE_CACHE_VERSION,
+		.source_size = std::filesystem::file_size(source_path, ec),
+		.source_write_time = std::filesystem::last_write_time(source_path, ec).time_since_epoch().count(),
+		.options = 0,
+		.vertex_size = sizeof(Vertex),
+		.index_size = sizeof(VERTEX_INDEX_TYPE),
+		.meshlet_size = sizeof(Mesh::Meshlet),
+	};
+	if (options.optimize_meshes) header.options |= SCO_OptimizedMeshes;
+	if (options.collapse_tree) header.options |= SCO_CollapsedTree;
+	if (has_images) header.options |= SCO_HasImages;
+	return header;
+}
+
+void write_node(myn::BinaryWriter& writer, const SceneNodeIntermediate* node)
+{
+	writer.write_string(node->name);
+	writer.write(node->transformation);
+	writer.write(node->light_idx);
+	writer.write(node->mesh_idx);
+	writer.write(node->camera_idx);
+	writer.write((uint32_t)node->children.size());
+	for (auto child : node->children) write_node(writer, child);
+}
+
+SceneNodeIntermediate* read_node(myn::BinaryReader& reader, SceneNodeIntermediate* parent)
+{
+	auto node = new SceneNodeIntermediate();
+	node->name = reader.read_string();
+	node->transformation = reader.read<glm::mat4>();
+	node->light_idx = reader.read<int>();
+	node->mesh_idx = reader.read<int>();
+	node->camera_idx = reader.read<int>();
+	if (parent) node->attach_to(parent);
+	auto num_children = reader.read<uint32_t>();
+	for (uint32_t i = 0; i < num_children && reader.ok(); i++) read_node(reader, node);
+	return node;
+}
+
+void write_material(myn::BinaryWriter& writer, const GltfMaterialInfo& info)
+{
+	writer.write(info.type);
+	writer.write_string(info.name);
+	writer.write_string(info.albedoTexName);
+	writer.write_string(info.normalTexName);
+	writer.write_string(info.ormTexName);
+	writer.write_string(info.aoTexName);
+	writer.write_string(info.emissiveTexName);
+	writer.write(info.BaseColorFactor);
+	writer.write(info.EmissiveFactor);
+	writer.write(info.OcclusionRoughnessMetallicNormalStrengths);
+	writer.write(info.doubleSided);
+	writer.write(info.blendMode);
+	writer.write(info.clipThreshold);
+	writer.write(info.volumeDensity);
+	writer.write(info.volumeColor);
+}
+
+GltfMaterialInfo read_material(myn::BinaryReader& reader)
+{
+	GltfMaterialInfo info = {};
+	info._version = 0;
+	info.type = reader.read<MaterialType>();
+	info.name = reader.read_string();
+	info.albedoTexName = reader.read_string();
+	info.normalTexName = reader.read_string();
+	info.ormTexName = reader.read_string();
+	info.aoTexName = reader.read_string();
+	info.emissiveTexName = reader.read_string();
+	info.BaseColorFactor = reader.read<glm::vec4>();
+	info.EmissiveFactor = reader.read<glm::vec3>();
+	info.OcclusionRoughnessMetallicNormalStrengths = reader.read<glm::vec4>();
+	info.doubleSided = reader.read<int>();
+	info.blendMode = reader.read<BlendMode>();
+	info.clipThreshold = reader.read<float>();
+	info.volumeDensity = reader.read<float>();
+	info.volumeColor = reader.read<glm::vec4>();
+	return info;
+}
+
+const char* attribute_names[] = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0" };
+
+bool write_scene_cache(
+	const std::string& cache_path,
+	const std::string& source_path,
+	const SceneSourceOptions& options,
+	const SceneSource& source)
+{
+	TIMER_BEGIN
+	myn::BinaryWriter writer;
+	writer.write(make_cache_header(source_path, options, GRAPHICS_DISPLAY));
+
+	// buffers
+	writer.write_array(source.buffers.vertices.data(), source.buffers.vertices.size());
+	writer.write_array(source.buffers.indices.data(), source.buffers.indices.size());
+	writer.write_array(source.buffers.meshlets.data(), source.buffers.meshlets.size());
+	std::vector<PrimitiveRecord> primitives;
+	for (auto& p : source.cpu_buffer_indices) {
+		primitives.push_back({
+			.key = p.first,
+			.num_vertices = p.second.num_vertices,
+			.offset_num_vertices = p.second.offset_num_vertices,
+			.num_indices = p.second.num_indices,
+			.offset_num_indices = p.second.offset_num_indices,
+			.num_meshlets = p.second.num_meshlets,
+			.offset_num_meshlets = p.second.offset_num_meshlets
+		});
+	}
+	writer.write_vector(primitives);
+
+	// meshes
+	auto& model = source.model;
+	writer.write((uint32_t)model.meshes.size());
+	for (auto& mesh : model.meshes) {
+		writer.write_string(mesh.name);
+		writer.write((uint32_t)mesh.primitives.size());
+		for (auto& prim : mesh.primitives) {
+			writer.write(prim.mode);
+			writer.write(prim.material);
+			writer.write(prim.indices);
+			for (auto attribute : attribute_names) {
+				auto it = prim.attributes.find(attribute);
+				writer.write(it != prim.attributes.end() ? it->second : -1);
 			}
-			GltfMaterialInfo::add(info);
 		}
+	}
 
-		//====================
+	// cameras, lights
+	writer.write((uint32_t)model.cameras.size());
+	for (auto& camera : model.cameras) {
+		writer.write_string(camera.name);
+		writer.write_string(camera.type);
+		writer.write(camera.perspective.aspectRatio);
+		writer.write(camera.perspective.yfov);
+		writer.write(camera.perspective.znear);
+		writer.write(camera.perspective.zfar);
+	}
+	writer.write((uint32_t)model.lights.size());
+	for (auto& light : model.lights) {
+		writer.write_string(light.name);
+		writer.write_string(light.type);
+		writer.write_vector(light.color);
+		writer.write(light.intensity);
+	}
 
-		std::unordered_map<PrimitiveBufferIndex, Mesh::CpuDataAccessor> cpu_buffer_indices;
+	// materials, hierarchy
+	writer.write((uint32_t)source.materials.size());
+	for (auto& info : source.materials) write_material(writer, info);
+	write_node(writer, source.tree);
+
+	// images last, so readers that don't need them can stop early
 #if GRAPHICS_DISPLAY
-		std::unordered_map<PrimitiveBufferIndex, Mesh::GpuDataAccessor> gpu_buffer_indices;
+	writer.write((uint32_t)source.images.size());
+	for (auto& image : source.images) {
+		writer.write_string(image->name);
+		writer.write(image->num_channels);
+		writer.write(image->channel_depth);
+		writer.write(image->srgb);
+		writer.write_string(image->placeholder);
+		writer.write((uint32_t)image->material_users.size());
+		for (auto& user : image->material_users) writer.write_string(user);
+		writer.write(image->content_hash);
+		writer.write(image->width);
+		writer.write(image->height);
+		writer.write_vector(image->encoded);
+	}
 #endif
-		load_mesh_buffers(
-			model,
-			cpu_buffer_indices,
-			combined_vertices,
-			combined_indices
+
+	bool success = writer.save(cache_path);
+	TIMER_END(write_time)
+	if (success) {
+		LOG("wrote scene cache '%s' (%.1f MB, %.3fs)", cache_path.c_str(), writer.size() / (1024.0f * 1024.0f), write_time)
+	}
+	return success;
+}
+
+bool read_scene_cache(
+	const std::string& cache_path,
+	const std::string& source_path,
+	const SceneSourceOptions& options,
+	SceneSource& source)
+{
+	auto file = std::make_shared<myn::MappedFile>(cache_path);
+	if (!file->is_open()) return false;
+	myn::BinaryReader reader(file->data(), file->size());
+
+	auto header = reader.read<SceneCacheHeader>();
+	auto expected = make_cache_header(source_path, options, GRAPHICS_DISPLAY);
+	if (!reader.ok() ||
+		header.magic != expected.magic ||
+		header.version != expected.version ||
+		header.source_size != expected.source_size ||
+		header.source_write_time != expected.source_write_time ||
+		header.options != expected.options ||
+		header.vertex_size != expected.vertex_size ||
+		header.index_size != expected.index_size ||
+		header.meshlet_size != expected.meshlet_size)
+	{
+		LOG("scene cache '%s' is out of date, rebuilding..", cache_path.c_str())
+		return false;
+	}
+
+	// buffers: used in place
+	auto& buffers = source.buffers;
+	uint64_t count = 0;
+	auto vertices = reader.read_array<Vertex>(count);
+	buffers.vertices = { vertices, count };
+	auto indices = reader.read_array<VERTEX_INDEX_TYPE>(count);
+	buffers.indices = { indices, count };
+	auto meshlets = reader.read_array<Mesh::Meshlet>(count);
+	buffers.meshlets = { meshlets, count };
+	buffers.mapping = file;
+	uint64_t num_primitives = 0;
+	auto primitives = reader.read_array<PrimitiveRecord>(num_primitives);
+	for (uint64_t i = 0; i < num_primitives; i++) {
+		auto& p = primitives[i];
+		source.cpu_buffer_indices[p.key] = {
+			.vertices = vertices,
+			.num_vertices = p.num_vertices,
+			.offset_num_vertices = p.offset_num_vertices,
+			.faces = indices,
+			.num_indices = p.num_indices,
+			.offset_num_indices = p.offset_num_indices,
+			.meshlets = meshlets,
+			.num_meshlets = p.num_meshlets,
+			.offset_num_meshlets = p.offset_num_meshlets
+		};
+	}
+
+	// meshes
+	auto& model = source.model;
+	model.meshes.resize(reader.read<uint32_t>());
+	for (auto& mesh : model.meshes) {
+		mesh.name = reader.read_string();
+		mesh.primitives.resize(reader.read<uint32_t>());
+		for (auto& prim : mesh.primitives) {
+			prim.mode = reader.read<int>();
+			prim.material = reader.read<int>();
+			prim.indices = reader.read<int>();
+			for (auto attribute : attribute_names) {
+				int accessor = reader.read<int>();
+				if (accessor >= 0) prim.attributes[attribute] = accessor;
+			}
+		}
+	}
+
+	// cameras, lights
+	model.cameras.resize(reader.read<uint32_t>());
+	for (auto& camera : model.cameras) {
+		camera.name = reader.read_string();
+		camera.type = reader.read_string();
+		camera.perspective.aspectRatio = reader.read<double>();
+		camera.perspective.yfov = reader.read<double>();
+		camera.perspective.znear = reader.read<double>();
+		camera.perspective.zfar = reader.read<double>();
+	}
+	model.lights.resize(reader.read<uint32_t>());
+	for (auto& light : model.lights) {
+		light.name = reader.read_string();
+		light.type = reader.read_string();
+		reader.read_vector(light.color);
+		light.intensity = reader.read<double>();
+	}
+
+	// materials, hierarchy
+	source.materials.resize(reader.read<uint32_t>());
+	for (auto& info : source.materials) info = read_material(reader);
+	source.tree = read_node(reader, nullptr);
+
+#if GRAPHICS_DISPLAY
+	// images: still encoded, in the mapping
+	source.images.resize(reader.read<uint32_t>());
+	for (auto& image : source.images) {
+		image = std::make_shared<ImageSource>();
+		image->name = reader.read_string();
+		image->num_channels = reader.read<int>();
+		image->channel_depth = reader.read<int>();
+		image->srgb = reader.read<int>();
+		image->placeholder = reader.read_string();
+		image->material_users.resize(reader.read<uint32_t>());
+		for (auto& user : image->material_users) user = reader.read_string();
+		image->content_hash = reader.read<uint64_t>();
+		image->width = reader.read<uint32_t>();
+		image->height = reader.read<uint32_t>();
+		image->mapped_encoded = reader.read_array<uint8_t>(image->mapped_encoded_size);
+		image->cache_file = file;
+	}
+#endif
+
+	if (!reader.ok()) {
+		WARN("scene cache '%s' is truncated, rebuilding..", cache_path.c_str())
+		source.clear();
+		return false;
+	}
+	LOG("loaded scene from cache '%s'", cache_path.c_str())
+	return true;
+}
+}// anonymous namespace
+
+SceneAsset::SceneAsset(
+	SceneObject* outer_root,
+	const std::string &relative_path)
+: Asset(relative_path, nullptr)
+{
+	// cpu only: parsing, decoding and reading the cache. Doesn't touch the currently loaded scene
+	prepare_action_internal = [this, relative_path]() -> std::function<void()> {
+		return [this, relative_path, options = SceneSourceOptions::from_config()]() {
+			std::string source_path = ROOT_DIR"/" + relative_path;
+			std::string cache_path = scene_cache_path(source_path, GRAPHICS_DISPLAY);
+
+			auto source = std::make_unique<SceneSource>();
+			if (!options.use_cache || !read_scene_cache(cache_path, source_path, options, *source))
+			{
+				source->clear();
+				load_gltf_source(source_path, options, *source);
+				if (options.use_cache) write_scene_cache(cache_path, source_path, options, *source);
+			}
+			auto& buffers = source->buffers;
+			source->buffers_hash = AssetGraph::hash(buffers.vertices.data(), buffers.vertices.size_bytes());
+			source->buffers_hash = AssetGraph::hash(buffers.indices.data(), buffers.indices.size_bytes(), source->buffers_hash);
+			source->buffers_hash = AssetGraph::hash(buffers.meshlets.data(), buffers.meshlets.size_bytes(), source->buffers_hash);
+			pending_source = std::move(source);
+		};
+	};
+
+	load_action_internal = [this, outer_root, relative_path]() {
+
+		// cleanup first, if necessary. Textures, materials and mesh buffers are only re-created if they changed (see AssetGraph)
+		if (outer_root) outer_root->try_remove_child(asset_root);
 #if GRAPHICS_DISPLAY
-			, &gpu_buffer_indices,
-			&combined_vertex_buffer,
-			&combined_index_buffer
+		Vulkan::Instance->waitDeviceIdle();
+		cancel_texture_streaming();
 #endif
-		);
+		delete asset_root;
+
+		// normally prepare_action_internal already ran in the background (see Asset::update_watched)
+		if (!pending_source) prepare_action_internal()();
+		std::unique_ptr<SceneSource> source_ptr = std::move(pending_source);
+		auto& source = *source_ptr;
+		// the accessors keep pointing at the same data, which now belongs to this asset
+		combined_buffers = std::move(source.buffers);
+		auto& model = source.model;
 
 		//====================
 
-		// camera, mesh
-		auto tree = loadSceneTree(model.nodes);
+#if GRAPHICS_DISPLAY
+		// image (texture)
+
+		std::vector<std::shared_ptr<ImageSource>> changed_images;
+		std::unordered_set<std::string> image_names;
+		for (auto& image : source.images)
+		{
+			image_names.insert(image->name);
+			auto node = "texture:" + image->name;
+			AssetGraph::update(node, AssetGraph::hash(&image->srgb, sizeof(image->srgb), image->content_hash));
+			auto it = asset_textures.find(image->name);
+			// (not created yet also happens if it was still streaming when this reload started)
+			if (!AssetGraph::consume_changed(node) && it != asset_textures.end()) continue;
+			delete_texture(image->name);
+			changed_images.push_back(image);
+		}
+		for (auto it = asset_textures.begin(); it != asset_textures.end();)
+		{
+			if (image_names.contains(it->first)) {
+				it++;
+				continue;
+			}
+			AssetGraph::remove("texture:" + it->first);
+			texture_streaming::remove(it->first);
+			delete it->second;
+			it = asset_textures.erase(it);
+		}
+		if (!source.images.empty()) {
+			LOG("%d of %d textures in '%s' changed", (int)changed_images.size(), (int)source.images.size(), relative_path.c_str())
+		}
 
-		{// light
-			std::unordered_map<std::string, SceneNodeIntermediate*> nodes_map;
-			tree->foreach([&nodes_map](SceneNodeIntermediate* node) { nodes_map[node->name] = node; });
-			for (int i = 0; i < model.lights.size(); i++) {
-				auto& light_name = model.lights[i].name;
-				if (nodes_map.contains(light_name)) {
-					nodes_map[light_name]->light_idx = i;
+		// cooked textures can be streamed: then they start out with only their small mips (see TextureStreaming.h)
+		bool stream_textures = Config->lookup<int>("TextureStreaming");
+		bool cook_textures = should_cook_textures();
+		streaming_cancelled = std::make_shared<std::atomic<bool>>(false);
+		auto make_upload = [this](const ImageSource& image) {
+			return Texture2D::PendingUpload {
+				.name = image.name,
+				.pixels = {},
+				.cooked = nullptr,
+				.width = 0,
+				.height = 0,
+				.format = { image.num_channels, image.channel_depth, image.srgb },
+				.cancelled = streaming_cancelled,
+				.onCreated = [this, name = image.name, users = image.material_users](Texture2D* tex) {
+					on_texture_created(name, users, tex);
+				}
+			};
+		};
+
+		if (Config->lookup<int>("AsyncTextureLoading"))
+		{
+			// materials sample placeholders until the real textures are uploaded, a few per frame (Texture2D::uploadPendingTextures)
+			for (auto& image : changed_images)
+			{
+				Texture::addPlaceholder(image->name, image->placeholder);
+
+				myn::JobQueue::background().push([image, stream_textures, cook_textures, upload = make_upload(*image)]() mutable {
+					if (*upload.cancelled) return;
+					PROFILE_SCOPE("load texture " + image->name)
+					if (cook_textures) upload.cooked = cook_image(*image);
+					if (!upload.cooked && !take_image_pixels(*image, upload.pixels)) {
+						WARN("failed to decode image '%s'", image->name.c_str())
+						return;
+					}
+					upload.width = image->width;
+					upload.height = image->height;
+					if (*upload.cancelled) return;
+					if (upload.cooked && stream_textures) texture_streaming::add(std::move(upload));
+					else Texture2D::enqueueUpload(std::move(upload));
+				});
+			}
+		}
+		else
+		{
+			// cooked textures are done first: with a cache hit they never need decoding
+			std::vector<std::shared_ptr<ImageSource>> uncooked_images;
+			for (auto& image : changed_images)
+			{
+				if (auto cooked = cook_textures ? cook_image(*image) : nullptr) {
+					if (stream_textures) {
+						Texture::addPlaceholder(image->name, image->placeholder);
+						auto upload = make_upload(*image);
+						upload.cooked = cooked;
+						texture_streaming::add(std::move(upload));
+					} else {
+						asset_textures[image->name] = new Texture2D(image->name, *cooked);
+					}
+				} else {
+					uncooked_images.push_back(image);
 				}
 			}
+			decode_images(uncooked_images);
+			// actually create the textures
+			for (auto& image : uncooked_images)
+			{
+				if (image->pixels.empty()) {
+					Texture::addPlaceholder(image->name, image->placeholder);
+					continue;
+				}
+				auto tex = new Texture2D(
+					image->name,
+					image->pixels.data(),
+					image->width, image->height,
+					{ image->num_channels, image->channel_depth, image->srgb });
+				asset_textures[image->name] = tex;
+			}
+		}
+#endif
+
+		// materials: only changed ones (or ones whose textures changed) get a new version, which is what makes
+		// the renderers re-create them
+		std::vector<std::string> material_names(source.materials.size());
+		for (int i = 0; i < source.materials.size(); i++) {
+			auto& info = source.materials[i];
+			material_names[i] = info.name;
+			auto node = "material:" + info.name;
+			std::vector<std::string> textures;
+			for (auto tex_name : { &info.albedoTexName, &info.normalTexName, &info.ormTexName, &info.aoTexName, &info.emissiveTexName }) {
+				if (!tex_name->starts_with("_")) textures.push_back("texture:" + *tex_name);
+			}
+			AssetGraph::set_dependencies(node, textures);
+			AssetGraph::update(node, hash_material(info));
+			if (AssetGraph::consume_changed(node)) GltfMaterialInfo::add(info);
+		}
+
+		//====================
+
+		auto& cpu_buffer_indices = source.cpu_buffer_indices;
+#if GRAPHICS_DISPLAY
+		std::unordered_map<PrimitiveBufferIndex, Mesh::GpuDataAccessor> gpu_buffer_indices;
+		auto buffers_node = relative_path + ":mesh buffers";
+		AssetGraph::update(buffers_node, source.buffers_hash);
+		if (AssetGraph::consume_changed(buffers_node) || !combined_vertex_buffer.isValid())
+		{
+			if (combined_vertex_buffer.isValid()) combined_vertex_buffer.release();
+			if (combined_index_buffer.isValid()) combined_index_buffer.release();
+			create_mesh_gpu_buffers(
+				cpu_buffer_indices,
+				combined_buffers.vertices,
+				combined_buffers.indices,
+				gpu_buffer_indices,
+				combined_vertex_buffer,
+				combined_index_buffer);
+		}
+		else
+		{
+			LOG("mesh buffers of '%s' didn't change, keeping them", relative_path.c_str())
+			make_gpu_accessors(cpu_buffer_indices, gpu_buffer_indices, combined_vertex_buffer, combined_index_buffer);
 		}
+#endif
 
-		if (Config->lookup<int>("Debug.CollapseSceneTree")) collapseSceneTree(tree);
+		//====================
 
 		// actually construct the scene tree
+		auto tree = source.tree;
 
 		std::unordered_map<SceneNodeIntermediate*, SceneObject*> nodeToDrawable;
 		std::queue<SceneNodeIntermediate*> nodesQueue;
@@ -663,25 +1469,62 @@ SceneAsset::SceneAsset(
 		asset_root->ui_default_open = true;
 #endif
 		if (outer_root) outer_root->add_child(asset_root);
-
-		delete tree;
 	};
 
 	reload();
 }
 
+SceneAsset::~SceneAsset() = default;
+
+#if GRAPHICS_DISPLAY
+void SceneAsset::cancel_texture_streaming()
+{
+	if (streaming_cancelled) {
+		// drop textures that are still being decoded or waiting for upload. Nothing needs to wait for the jobs: they only
+		// hold on to their own image, and their uploads are skipped on the main thread once they see the flag
+		*streaming_cancelled = true;
+		streaming_cancelled = nullptr;
+	}
+}
+
+void SceneAsset::on_texture_created(const std::string& name, const std::vector<std::string>& material_users, Texture2D* tex)
+{
+	auto& slot = asset_textures[name];
+	if (auto old_tex = slot) {
+		// the texture this one was re-created from (streamed ones change resolution in place), which frames in flight
+		// may still sample
+		Vulkan::Instance->destroyAfterFramesInFlight([old_tex]() { delete old_tex; });
+	}
+	slot = tex;
+	// materials with a new version get re-created by the renderers, which makes them sample the new texture
+	for (auto& mat_name : material_users) {
+		if (auto mat_info = GltfMaterialInfo::get(mat_name)) mat_info->_version++;
+	}
+}
+
+void SceneAsset::delete_texture(const std::string& name)
+{
+	texture_streaming::remove(name);
+	auto it = asset_textures.find(name);
+	if (it == asset_textures.end()) return;
+	delete it->second;
+	asset_textures.erase(it);
+}
+#endif
+
 void SceneAsset::release_resources()
 {
 #if GRAPHICS_DISPLAY
-	for (auto tex : asset_textures) {
-		delete tex;
+	cancel_texture_streaming();
+	for (auto& p : asset_textures) {
+		texture_streaming::remove(p.first);
+		delete p.second;
 	}
 	asset_textures.clear();
 
-	combined_vertices.clear();
-	combined_indices.clear();
-	combined_vertex_buffer.release();
-	combined_index_buffer.release();
+	combined_buffers.clear();
+	if (combined_vertex_buffer.isValid()) combined_vertex_buffer.release();
+	if (combined_index_buffer.isValid()) combined_index_buffer.release();
 #endif
 	Asset::release_resources();
 }
@@ -703,6 +1546,7 @@ MeshAsset::MeshAsset(const std::string &relative_path, const std::string &alias)
 		tinygltf::Model model;
 		tinygltf::TinyGLTF loader;
 		loader.SetPreserveImageChannels(false);
+		loader.SetImageLoader(defer_image_decoding, nullptr);
 		std::string err;
 		std::string warn;
 
@@ -720,14 +1564,18 @@ MeshAsset::MeshAsset(const std::string &relative_path, const std::string &alias)
 			model,
 			cpu_buffer_indices,
 			combined_vertices,
-			combined_indices
+			combined_indices,
+			combined_meshlets,
+			Config->lookup<int>("OptimizeMeshes"));
 #if GRAPHICS_DISPLAY
-			, &gpu_buffer_indices,
-			&combined_vertex_buffer,
-			&combined_index_buffer
+		create_mesh_gpu_buffers(
+			cpu_buffer_indices,
+			combined_vertices,
+			combined_indices,
+			gpu_buffer_indices,
+			combined_vertex_buffer,
+			combined_index_buffer);
 #endif
-		);
-
 
 		for (auto & in_mesh : model.meshes) {
 
@@ -767,6 +1615,7 @@ void MeshAsset::release_resources()
 
 	combined_vertices.clear();
 	combined_indices.clear();
+	combined_meshlets.clear();
 #if GRAPHICS_DISPLAY
 	combined_vertex_buffer.release();
 	combined_index_buffer.release();
@@ -4,15 +4,42 @@
 
 #pragma once
 
+#include <memory>
+#include <atomic>
 #include "Asset.h"
 #include "Render/Mesh.h"
 #if GRAPHICS_DISPLAY
 #include "Render/Vulkan/Buffer.h"
 #endif
 #include <vector>
+#include <span>
 
 class SceneObject;
 class Texture2D;
+struct SceneSource;
+namespace myn { class MappedFile; }
+
+// every primitive's vertices, indices and meshlets, in one buffer each (the meshes' cpu accessors point into them).
+// Owned when parsed from the glTF file, or read in place from the memory-mapped scene cache. Moving it keeps the data
+// where it is, so the accessors stay valid
+struct CombinedMeshBuffers {
+	std::span<const Vertex> vertices;
+	std::span<const VERTEX_INDEX_TYPE> indices;
+	std::span<const Mesh::Meshlet> meshlets;
+
+	std::vector<Vertex> owned_vertices;
+	std::vector<VERTEX_INDEX_TYPE> owned_indices;
+	std::vector<Mesh::Meshlet> owned_meshlets;
+	std::shared_ptr<myn::MappedFile> mapping;
+
+	// once the owned vectors are filled in
+	void use_owned() {
+		vertices = owned_vertices;
+		indices = owned_indices;
+		meshlets = owned_meshlets;
+	}
+	void clear() { *this = CombinedMeshBuffers(); }
+};
 
 /*
  * Currently offline rendering doesn't load textures because managing textures sounds like a pain
@@ -26,6 +53,8 @@ public:
 		SceneObject* outer_root,
 		const std::string& relative_path);
 
+	~SceneAsset() override;
+
 	SceneObject* get_root() { return asset_root; }
 
 	void release_resources() override;
@@ -34,11 +63,19 @@ private:
 
 	SceneObject* asset_root = nullptr;
 
-	std::vector<Vertex> combined_vertices;
-	std::vector<VERTEX_INDEX_TYPE> combined_indices;
+	// filled in by prepare_action_internal's job, consumed by load_action_internal (Asset makes sure the job is done by then)
+	std::unique_ptr<SceneSource> pending_source;
+
+	CombinedMeshBuffers combined_buffers;
 
 #if GRAPHICS_DISPLAY
-	std::vector<Texture2D*> asset_textures;
+	void cancel_texture_streaming();
+	// (re-)places a texture, once its first version is uploaded (streamed textures change resolution in place)
+	void on_texture_created(const std::string& name, const std::vector<std::string>& material_users, Texture2D* tex);
+	void delete_texture(const std::string& name);
+
+	std::unordered_map<std::string, Texture2D*> asset_textures; // by name
+	std::shared_ptr<std::atomic<bool>> streaming_cancelled;
 	VmaBuffer combined_vertex_buffer;
 	VmaBuffer combined_index_buffer;
 #endif
@@ -59,6 +96,7 @@ private:
 
 	std::vector<Vertex> combined_vertices;
 	std::vector<VERTEX_INDEX_TYPE> combined_indices;
+	std::vector<Mesh::Meshlet> combined_meshlets;
 
 #if GRAPHICS_DISPLAY
 	VmaBuffer combined_vertex_buffer;
@@ -0,0 +1,339 @@
+#include "Utils/myn/Log.h"
+#include "Utils/myn/BlockCompression.h"
+#include "Render/TextureCook.h"
+#include "Assets/AssetGraph.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Checks for the block compressors (BlockCompression.h) and the texture cook (TextureCook.h): blocks are decoded as
+ * the format specs describe (not with the encoders' own helpers) and compared against the source, for solid, gradient
+ * and partial edge blocks. Also round trips a cooked texture through the on-disk cache. Returns non-zero if any of
+ * them fails.
+ */
+
+using namespace myn;
+
+namespace {
+
+bool check(bool passed, const char* what) {
+	LOG("%s%s", what, passed ? "" : " FAILED")
+	return passed;
+}
+
+//-------- reference decoders --------
+
+constexpr int WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// reads a block's bits, least significant first
+struct BitReader {
+	const uint8_t* block;
+	uint32_t pos = 0;
+	uint32_t read(uint32_t numBits) {
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < numBits; i++, pos++) value |= uint32_t((block[pos / 8] >> (pos % 8)) & 1) << i;
+		return value;
+	}
+};
+
+// 16 rgba8 texels. Only mode 6 is handled, anything else decodes to magenta so it fails the error bounds
+void decodeBc7(const uint8_t* block, uint8_t out[16][4]) {
+	BitReader bits{ block };
+	uint32_t mode = 0;
+	while (mode < 8 && bits.read(1) == 0) mode++;
+	if (mode != 6) {
+		for (int i = 0; i < 16; i++) { out[i][0] = 255; out[i][1] = 0; out[i][2] = 255; out[i][3] = 255; }
+		return;
+	}
+	uint32_t endpoints[2][4];
+	for (int c = 0; c < 4; c++) {
+		endpoints[0][c] = bits.read(7) << 1;
+		endpoints[1][c] = bits.read(7) << 1;
+	}
+	uint32_t p0 = bits.read(1), p1 = bits.read(1);
+	for (int c = 0; c < 4; c++) {
+		endpoints[0][c] |= p0;
+		endpoints[1][c] |= p1;
+	}
+	for (int i = 0; i < 16; i++) {
+		uint32_t index = bits.read(i == 0 ? 3 : 4);
+		for (int c = 0; c < 4; c++) {
+			out[i][c] = uint8_t(((64 - WEIGHTS4[index]) * endpoints[0][c] + WEIGHTS4[index] * endpoints[1][c] + 32) >> 6);
+		}
+	}
+}
+
+// 16 unorm values of one BC4 block, in [0, 255]
+void decodeBc4(const uint8_t* block, float out[16]) {
+	float red0 = block[0], red1 = block[1];
+	float palette[8] = { red0, red1 };
+	if (red0 > red1) {
+		for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * red0 + (i - 1) * red1) / 7.0f;
+	} else {
+		for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * red0 + (i - 1) * red1) / 5.0f;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++) indices |= uint64_t(block[2 + i]) << (8 * i);
+	for (int i = 0; i < 16; i++) out[i] = palette[(indices >> (3 * i)) & 7];
+}
+
+void decodeBc5(const uint8_t* block, float out[16][2]) {
+	float red[16], green[16];
+	decodeBc4(block, red);
+	decodeBc4(block + 8, green);
+	for (int i = 0; i < 16; i++) { out[i][0] = red[i]; out[i][1] = green[i]; }
+}
+
+// 16 rgb texels. Only mode 11 (unsigned) is handled, anything else decodes to -1
+void decodeBc6h(const uint8_t* block, float out[16][3]) {
+	BitReader bits{ block };
+	if (bits.read(5) != 0x03) {
+		for (int i = 0; i < 16; i++) out[i][0] = out[i][1] = out[i][2] = -1;
+		return;
+	}
+	uint32_t endpoints[2][3];
+	for (int e = 0; e < 2; e++) {
+		for (int c = 0; c < 3; c++) {
+			uint32_t q = bits.read(10);
+			endpoints[e][c] = q == 0 ? 0 : q == 1023 ? 0xffff : ((q << 16) + 0x8000) >> 10;
+		}
+	}
+	for (int i = 0; i < 16; i++) {
+		uint32_t index = bits.read(i == 0 ? 3 : 4);
+		for (int c = 0; c < 3; c++) {
+			uint32_t interpolated = ((64 - WEIGHTS4[index]) * endpoints[0][c] + WEIGHTS4[index] * endpoints[1][c] + 32) >> 6;
+			out[i][c] = glm::unpackHalf1x16(uint16_t((interpolated * 31) >> 6));
+		}
+	}
+}
+
+// decodes a whole image of blocks with decodeBlock(block, texels[16][C]) into width x height x C floats
+template<int C, typename T, typename DecodeBlock>
+std::vector<float> decodeImage(const uint8_t* blocks, uint32_t width, uint32_t height, DecodeBlock decodeBlock) {
+	std::vector<float> result(size_t(width) * height * C);
+	uint32_t blocksX = (width + 3) / 4;
+	for (uint32_t by = 0; by < (height + 3) / 4; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			T texels[16][C];
+			decodeBlock(blocks + (size_t(by) * blocksX + bx) * bc::BLOCK_SIZE_BYTES, texels);
+			for (uint32_t i = 0; i < 16; i++) {
+				uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+				if (x >= width || y >= height) continue;
+				for (int c = 0; c < C; c++) result[(size_t(y) * width + x) * C + c] = float(texels[i][c]);
+			}
+		}
+	}
+	return result;
+}
+
+//-------- test images --------
+
+struct Error {
+	float max = 0;
+	float rms = 0;
+};
+
+// decoded has C channels per texel, source 4
+template<int C, typename T>
+Error measure(const std::vector<float>& decoded, const std::vector<T>& source) {
+	Error error;
+	double sum = 0;
+	size_t texels = decoded.size() / C;
+	for (size_t i = 0; i < texels; i++) {
+		for (int c = 0; c < C; c++) {
+			float d = std::abs(decoded[i * C + c] - float(source[i * 4 + c]));
+			error.max = std::max(error.max, d);
+			sum += double(d) * d;
+		}
+	}
+	error.rms = float(std::sqrt(sum / double(decoded.size())));
+	return error;
+}
+
+std::string describe(const char* what, Error error) {
+	return std::string(what) + ": max error " + std::to_string(error.max) + ", rms " + std::to_string(error.rms);
+}
+
+std::vector<uint8_t> solidImage(uint32_t width, uint32_t height, const uint8_t color[4]) {
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	for (size_t i = 0; i < pixels.size(); i++) pixels[i] = color[i % 4];
+	return pixels;
+}
+
+// all channels ramp along the same diagonal, at different rates (some down): every block's colors lie on a line
+// through rgba space, which is what a single subset can represent
+std::vector<uint8_t> gradientImage(uint32_t width, uint32_t height) {
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			float s = float(x * 8 + y * 5) / float((width - 1) * 8 + (height - 1) * 5);
+			uint8_t* p = &pixels[(size_t(y) * width + x) * 4];
+			p[0] = uint8_t(std::lround(10 + s * 240));
+			p[1] = uint8_t(std::lround(200 - s * 120));
+			p[2] = uint8_t(std::lround(s * 180));
+			p[3] = uint8_t(std::lround(255 - s * 80));
+		}
+	}
+	return pixels;
+}
+
+//-------- checks --------
+
+bool checkBc7() {
+	bool ok = true;
+	auto decode = [](const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+		std::vector<uint8_t> blocks(bc::compressed_size(width, height));
+		bc::encode_bc7(pixels.data(), width, height, blocks.data());
+		return decodeImage<4, uint8_t>(blocks.data(), width, height, decodeBc7);
+	};
+
+	// the p bit is shared by all channels of an endpoint, so a color with odd and even channels can be one off
+	bool solidClose = true;
+	const uint8_t colors[][4] = { { 0, 0, 0, 0 }, { 255, 255, 255, 255 }, { 17, 128, 201, 77 }, { 254, 1, 99, 255 } };
+	for (auto& color : colors) {
+		auto pixels = solidImage(8, 4, color);
+		solidClose &= measure<4>(decode(pixels, 8, 4), pixels).max <= 1;
+	}
+	ok &= check(solidClose, "bc7 solid blocks: at most one off");
+
+	auto gradient = gradientImage(16, 16);
+	Error error = measure<4>(decode(gradient, 16, 16), gradient);
+	ok &= check(error.max <= 4 && error.rms <= 1.5f, describe("bc7 gradient", error).c_str());
+
+	// 10x7: the last column and row of blocks are partly outside the image
+	auto partial = gradientImage(10, 7);
+	error = measure<4>(decode(partial, 10, 7), partial);
+	ok &= check(error.max <= 4 && error.rms <= 1.5f, describe("bc7 partial edge blocks", error).c_str());
+	return ok;
+}
+
+bool checkBc5() {
+	bool ok = true;
+	auto decode = [](const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+		std::vector<uint8_t> blocks(bc::compressed_size(width, height));
+		bc::encode_bc5(pixels.data(), width, height, blocks.data());
+		return decodeImage<2, float>(blocks.data(), width, height, decodeBc5);
+	};
+
+	const uint8_t color[4] = { 128, 200, 255, 255 };
+	auto solid = solidImage(4, 8, color);
+	ok &= check(measure<2>(decode(solid, 4, 8), solid).max == 0, "bc5 solid blocks: exact");
+
+	// 8 evenly spaced values per block: at most half a palette step off (red spans up to 92 in a block of the 10x7
+	// image, 48 in the 16x16 one)
+	auto gradient = gradientImage(16, 16);
+	Error error = measure<2>(decode(gradient, 16, 16), gradient);
+	ok &= check(error.max <= 4 && error.rms <= 2, describe("bc5 gradient", error).c_str());
+
+	auto partial = gradientImage(10, 7);
+	error = measure<2>(decode(partial, 10, 7), partial);
+	ok &= check(error.max <= 7 && error.rms <= 3, describe("bc5 partial edge blocks", error).c_str());
+	return ok;
+}
+
+bool checkBc6h() {
+	bool ok = true;
+	auto decode = [](const std::vector<float>& pixels, uint32_t width, uint32_t height) {
+		std::vector<uint8_t> blocks(bc::compressed_size(width, height));
+		bc::encode_bc6h(pixels.data(), width, height, blocks.data());
+		return decodeImage<3, float>(blocks.data(), width, height, decodeBc6h);
+	};
+	// error relative to the source value: 10 bit endpoints cover the whole half range, so the steps between them are
+	// about 1/32 of a power of two
+	auto relativeError = [](const std::vector<float>& decoded, const std::vector<float>& source) {
+		float worst = 0;
+		for (size_t i = 0; i < decoded.size() / 3; i++) {
+			for (int c = 0; c < 3; c++) {
+				float expected = std::max(0.0f, source[i * 4 + c]);
+				worst = std::max(worst, std::abs(decoded[i * 3 + c] - expected) / std::max(expected, 1e-3f));
+			}
+		}
+		return worst;
+	};
+
+	bool solidClose = true;
+	for (float value : { 0.0f, 0.18f, 1.0f, 37.5f, 6000.0f }) {
+		std::vector<float> pixels(4 * 4 * 4, value);
+		auto decoded = decode(pixels, 4, 4);
+		solidClose &= value == 0 ? *std::max_element(decoded.begin(), decoded.end()) == 0 : relativeError(decoded, pixels) <= 0.04f;
+	}
+	ok &= check(solidClose, "bc6h solid blocks: within a quantization step");
+
+	std::vector<float> negative(4 * 4 * 4, -2.0f);
+	auto decoded = decode(negative, 4, 4);
+	ok &= check(*std::max_element(decoded.begin(), decoded.end()) == 0, "bc6h negative values: clamped to 0");
+
+	// exponential ramps along the same diagonal, over 8x8 and over 7x5 where edge blocks are partial. Half floats are
+	// about logarithmic, so every block's colors lie on a line through the space the hardware interpolates in
+	for (auto [width, height] : { std::pair(8u, 8u), std::pair(7u, 5u) }) {
+		std::vector<float> pixels(size_t(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				float* p = &pixels[(size_t(y) * width + x) * 4];
+				float s = float(x) + float(y) * 0.5f;
+				p[0] = 0.25f * std::exp2(s * 0.5f);
+				p[1] = 4.0f * std::exp2(s * -0.3f);
+				p[2] = 1.5f;
+				p[3] = 1;
+			}
+		}
+		float error = relativeError(decode(pixels, width, height), pixels);
+		std::string what = std::string(width == 8 ? "bc6h gradient" : "bc6h partial edge blocks") + ": relative error " + std::to_string(error);
+		ok &= check(error <= 0.1f, what.c_str());
+	}
+	return ok;
+}
+
+bool checkCookAndCache() {
+	bool ok = true;
+	const uint32_t width = 13, height = 9;
+	auto pixels = gradientImage(width, height);
+	auto cooked = texture_cook::cook(pixels.data(), width, height, texture_cook::F_BC7_UNORM);
+
+	bool mipsOk = cooked->mips.size() == 4 && cooked->mips[1].width == 6 && cooked->mips[1].height == 4 &&
+		cooked->mips[3].width == 1 && cooked->mips[3].height == 1;
+	for (auto& mip : cooked->mips) mipsOk &= mip.size == bc::compressed_size(mip.width, mip.height);
+	mipsOk &= cooked->mips.back().offset + cooked->mips.back().size == cooked->size();
+	ok &= check(mipsOk, "cook: mip chain down to 1x1, blocks of each mip back to back");
+
+	Error error = measure<4>(decodeImage<4, uint8_t>(cooked->data(), width, height, decodeBc7), pixels);
+	ok &= check(error.max <= 4 && error.rms <= 1.5f, "cook: mip 0 decodes to the source");
+
+	uint64_t key = texture_cook::cache_key(AssetGraph::hash(pixels), cooked->format);
+	ok &= check(texture_cook::save_cached(key, *cooked), "cache: saved");
+	auto loaded = texture_cook::load_cached(key);
+	bool same = loaded && loaded->format == cooked->format && loaded->width == width && loaded->height == height &&
+		loaded->mips.size() == cooked->mips.size() && loaded->size() == cooked->size() &&
+		std::equal(cooked->data(), cooked->data() + cooked->size(), loaded->data());
+	for (size_t i = 0; same && i < cooked->mips.size(); i++) {
+		same &= loaded->mips[i].width == cooked->mips[i].width && loaded->mips[i].height == cooked->mips[i].height &&
+			loaded->mips[i].offset == cooked->mips[i].offset && loaded->mips[i].size == cooked->mips[i].size;
+	}
+	ok &= check(same, "cache: loads back the same texture");
+	ok &= check(loaded && loaded->mapped_data != nullptr && loaded->bytes.empty(), "cache: read in place from the mapped file");
+	loaded.reset();
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.tex", (unsigned long long)key);
+	std::remove((ROOT_DIR"/texture_cache/" + std::string(name)).c_str());
+	ok &= check(texture_cook::load_cached(key) == nullptr, "cache: missing entry loads nothing");
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = checkBc7();
+	ok &= checkBc5();
+	ok &= checkBc6h();
+	ok &= checkCookAndCache();
+	LOG("%s", ok ? "all passed" : "block compression check FAILED")
+	return ok ? 0 : 1;
+}
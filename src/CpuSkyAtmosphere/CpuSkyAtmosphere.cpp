@@ -2,11 +2,20 @@
 #include "Utils/myn/Misc.h"
 #include "Utils/myn/Log.h"
 #include "Utils/myn/Timer.h"
+#include "Utils/myn/Profiler.h"
+#include "Utils/myn/FastMath.h"
 
 using namespace glm;
 
 namespace myn::sky {
 
+// precision switch for the transcendental calls in the kernels
+#if CPUSKY_FAST_MATH
+namespace skymath = myn::fast;
+#else
+namespace skymath = glm;
+#endif
+
 struct AtmosphereSample {
 	vec3 rayleighScattering;
 	vec3 mieScattering;
@@ -35,7 +44,7 @@ vec3 uvToViewDir_longlat(vec2 uv) {
 }
 
 vec2 viewDirToUv_longlat(vec3 dir) {
-	float phi = atan2(dir.y, dir.x); // todo: atan or atan2?
+	float phi = skymath::atan(dir.y, dir.x); // todo: atan or atan2?
 	float theta = asin(dir.z);
 	vec2 uv = vec2(-phi * ONE_OVER_TWO_PI + 0.5f, -theta * ONE_OVER_PI + 0.5f);
 	return uv;
@@ -120,17 +129,17 @@ vec2 SkyViewLutParamsToUv(vec3 cameraPosES, vec3 dir2sun, vec3 viewDir, float bo
 
 	float Vhorizon = sqrt(viewHeight * viewHeight - bottomRadius * bottomRadius);
 	float CosBeta = Vhorizon / viewHeight;				// GroundToHorizonCos
-	float Beta = acos(CosBeta);
+	float Beta = skymath::acos(CosBeta);
 	float ZenithHorizonAngle = PI - Beta;
 
 	if (!intersectGround) {
-		float coord = acos(viewZenithCosine) / ZenithHorizonAngle;
+		float coord = skymath::acos(viewZenithCosine) / ZenithHorizonAngle;
 		coord = 1.0f - coord;
 		coord = sqrt(coord);
 		coord = 1.0f - coord;
 		uv.y = coord * 0.5f;
 	} else {
-		float coord = (acos(viewZenithCosine) - ZenithHorizonAngle) / Beta;
+		float coord = (skymath::acos(viewZenithCosine) - ZenithHorizonAngle) / Beta;
 		coord = sqrt(coord);
 		uv.y = coord * 0.5f + 0.5f;
 	}
@@ -163,7 +172,7 @@ void UvToSkyViewLutParams(
 
 	float Vhorizon = sqrt(viewHeight * viewHeight - bottomRadius * bottomRadius);
 	float CosBeta = Vhorizon / viewHeight;				// GroundToHorizonCos
-	float Beta = acos(CosBeta);
+	float Beta = skymath::acos(CosBeta);
 	float ZenithHorizonAngle = PI - Beta;
 
 	float viewZenithCosine;
@@ -247,8 +256,8 @@ float computeHgPhase(float g, float cosTheta) {
 AtmosphereSample sampleAtmosphere(AtmosphereProfile atmosphere, float heightFromGroundKM) {
 	heightFromGroundKM = max(0.0f, heightFromGroundKM); // if underground, clamp to ground.
 
-	float rayleighDensity = exp(-heightFromGroundKM * 0.125f);
-	float mieDensity = exp(-heightFromGroundKM * 0.833f);
+	float rayleighDensity = skymath::exp(-heightFromGroundKM * 0.125f);
+	float mieDensity = skymath::exp(-heightFromGroundKM * 0.833f);
 	float distToMeanOzoneHeight = abs(heightFromGroundKM - atmosphere.ozoneMeanHeight);
 	float halfOzoneLayerWidth = atmosphere.ozoneLayerWidth * 0.5f;
 	float ozoneDensity = max(0.0f, halfOzoneLayerWidth - distToMeanOzoneHeight) / halfOzoneLayerWidth;
@@ -290,7 +299,7 @@ vec3 computeTransmittanceToSun(AtmosphereProfile atmosphere, float viewHeight, f
 		cumOpticalDepth += segmentOpticalDepth;
 	}
 
-	return exp(-cumOpticalDepth);
+	return skymath::exp(-cumOpticalDepth);
 }
 
 vec3 sampleTransmittanceToSun(const CpuTexture *transmittanceLut, float bottomRadius, float topRadius, float viewHeight, float viewZenithCosine) {
@@ -299,6 +308,15 @@ vec3 sampleTransmittanceToSun(const CpuTexture *transmittanceLut, float bottomRa
 	return vec3(texel.r, texel.g, texel.b);
 }
 
+vec3 sampleMultiScatteredLuminance(const CpuTexture *multiScatteredLut, const AtmosphereProfile &atmosphere, float viewHeight, float sunZenithCosine) {
+	vec2 uv = clamp(vec2(
+		sunZenithCosine * 0.5f + 0.5f,
+		(viewHeight - atmosphere.bottomRadius) / (atmosphere.topRadius - atmosphere.bottomRadius)), vec2(0), vec2(1));
+	uv = vec2(toSubUv(uv.x, multiScatteredLut->getWidth()), toSubUv(uv.y, multiScatteredLut->getHeight()));
+	vec4 texel = multiScatteredLut->sampleBilinear(uv, CpuTexture::WM_Clamp);
+	return vec3(texel.r, texel.g, texel.b);
+}
+
 vec2 computeRaymarchAtmosphereMinMaxT(vec3 startPosES, vec3 raymarchDir, vec3 earthCenterES, float bottomRadius, float topRadius) {
 	// get the range to raymarch through
 	const float tBottom = raySphereIntersectNearest(startPosES, raymarchDir, earthCenterES, bottomRadius);
@@ -354,6 +372,7 @@ vec2 computeRaymarchAtmosphereMinMaxT(vec3 startPosES, vec3 raymarchDir, vec3 ea
 vec3 computeSkyAtmosphere(
 	AtmosphereProfile atmosphere,
 	const CpuTexture* transmittanceLut,
+	const CpuTexture* multiScatteredLut,
 	vec3 cameraPosES,
 	vec3 viewDir,
 	vec3 dir2sun,
@@ -435,11 +454,18 @@ vec3 computeSkyAtmosphere(
 			float tEarth = raySphereIntersectNearest(samplePosES, dir2sun, earthCenterES, atmosphere.bottomRadius);
 			float sunVisibility = tEarth >= 0 ? 0 : 1;
 
-			// todo: add multiscattered light contribution here
-			vec3 sunContrib = sunLuminance * sunVisibility * transmittanceToSun * phaseTimesScattering;
+			vec3 multiScatteredLuminance = vec3(0);
+			if (multiScatteredLut) {
+				multiScatteredLuminance = sampleMultiScatteredLuminance(
+					multiScatteredLut, atmosphere, viewHeight, dot(samplePosES, dir2sun) / viewHeight);
+			}
+
+			vec3 sunContrib = sunLuminance * (
+				sunVisibility * transmittanceToSun * phaseTimesScattering +
+				multiScatteredLuminance * atmosphereSample.scattering);
 
 			vec3 segmentOpticalDepth = (atmosphereSample.scattering + atmosphereSample.absorption) * dt;
-			vec3 segmentTransmittance = exp(-segmentOpticalDepth);
+			vec3 segmentTransmittance = skymath::exp(-segmentOpticalDepth);
 
 			// analytical solution to the integral along view ray segment (see sample code)
 			L += sunContribThroughput * (sunContrib - sunContrib * segmentTransmittance) /
@@ -466,6 +492,119 @@ void TransmittanceLutSim::runSim() {
 	});
 }
 
+#define MULTISCATTERING_SQRT_NUM_DIRS 8
+#define MULTISCATTERING_NUM_SAMPLES 20
+
+// luminance reaching posES from direction -dir after exactly one more scattering event (with unit sun illuminance),
+// and the fraction of light that'd get scattered again along the way (f_ms in the paper)
+void integrateMultiScattering(
+	const AtmosphereProfile &atmosphere,
+	const CpuTexture* transmittanceLut,
+	vec3 posES,
+	vec3 dir,
+	vec3 dir2sun,
+	vec3 &outL,
+	vec3 &outFms)
+{
+	outL = vec3(0);
+	outFms = vec3(0);
+
+	vec3 earthCenterES = vec3(0, 0, 0);
+	vec2 tMinMax = computeRaymarchAtmosphereMinMaxT(posES, dir, earthCenterES, atmosphere.bottomRadius, atmosphere.topRadius);
+	if (tMinMax.x < 0 || tMinMax.y < 0) return;
+
+	vec3 raymarchStartPosES = posES + tMinMax.x * dir;
+	float tMax = tMinMax.y - tMinMax.x;
+
+	const float uniformPhase = 1.0f / (4.0f * PI);
+	const float numSamplesF = MULTISCATTERING_NUM_SAMPLES;
+	const float sampleSegmentT = 0.3f;
+	float t = 0;
+	vec3 throughput = vec3(1, 1, 1);
+
+	for (float i = 0; i < numSamplesF; i += 1.0f) {
+		float newT = tMax * ((i + sampleSegmentT) / numSamplesF);
+		float dt = newT - t;
+		t = newT;
+		vec3 samplePosES = raymarchStartPosES + t * dir;
+		float viewHeight = length(samplePosES);
+
+		AtmosphereSample s = sampleAtmosphere(atmosphere, viewHeight - atmosphere.bottomRadius);
+		vec3 extinction = s.scattering + s.absorption;
+		vec3 segmentTransmittance = skymath::exp(-extinction * dt);
+
+		vec3 transmittanceToSun = sampleTransmittanceToSun(
+			transmittanceLut,
+			atmosphere.bottomRadius,
+			atmosphere.topRadius,
+			viewHeight,
+			dot(samplePosES, dir2sun) / viewHeight);
+		float tEarth = raySphereIntersectNearest(samplePosES, dir2sun, earthCenterES, atmosphere.bottomRadius);
+		float sunVisibility = tEarth >= 0 ? 0 : 1;
+
+		// same analytical integration over the segment as in computeSkyAtmosphere
+		vec3 S = sunVisibility * transmittanceToSun * s.scattering * uniformPhase;
+		outL += throughput * (S - S * segmentTransmittance) / extinction;
+		outFms += throughput * (s.scattering - s.scattering * segmentTransmittance) / extinction;
+
+		throughput *= segmentTransmittance;
+	}
+
+	// sunlight bounced off the (lambertian) ground
+	float tBottom = raySphereIntersectNearest(posES, dir, earthCenterES, atmosphere.bottomRadius);
+	if (tBottom >= 0) {
+		vec3 groundPosES = posES + tBottom * dir;
+		vec3 groundNormal = normalize(groundPosES);
+		vec3 transmittanceToSun = sampleTransmittanceToSun(
+			transmittanceLut,
+			atmosphere.bottomRadius,
+			atmosphere.topRadius,
+			length(groundPosES),
+			dot(groundNormal, dir2sun));
+		outL += throughput * transmittanceToSun * max(0.0f, dot(groundNormal, dir2sun)) * atmosphere.groundAlbedo * ONE_OVER_PI;
+	}
+}
+
+void MultiScatteredLutSim::runSim() {
+	auto texdim = uvec2(output->getWidth(), output->getHeight());
+	dispatchShader([&](uint32_t x, uint32_t y) {
+		vec2 uv = vec2(float(x + 0.5f) / texdim.x, float(y + 0.5f) / texdim.y);
+		uv = vec2(fromSubUv(uv.x, texdim.x), fromSubUv(uv.y, texdim.y));
+
+		float sunZenithCosine = uv.x * 2.0f - 1.0f;
+		float viewHeight = mix(atmosphere.bottomRadius, atmosphere.topRadius, uv.y);
+		// keep strictly inside the atmosphere, otherwise rays start exactly on the boundary
+		viewHeight = clamp(viewHeight, atmosphere.bottomRadius + 0.01f, atmosphere.topRadius - 0.01f);
+		vec3 posES = vec3(0, 0, viewHeight);
+		vec3 dir2sun = normalize(vec3(sqrt(max(0.0f, 1.0f - sunZenithCosine * sunZenithCosine)), 0, sunZenithCosine));
+
+		// integrate over the sphere of directions (uniformly distributed)
+		vec3 L2 = vec3(0);
+		vec3 fms = vec3(0);
+		const int sqrtNumDirs = MULTISCATTERING_SQRT_NUM_DIRS;
+		for (int i = 0; i < sqrtNumDirs; i++) {
+			for (int j = 0; j < sqrtNumDirs; j++) {
+				float theta = TWO_PI * (i + 0.5f) / sqrtNumDirs;
+				float cosPhi = 1.0f - 2.0f * (j + 0.5f) / sqrtNumDirs;
+				float sinPhi = sqrt(max(0.0f, 1.0f - cosPhi * cosPhi));
+				vec3 dir = vec3(cos(theta) * sinPhi, sin(theta) * sinPhi, cosPhi);
+
+				vec3 L, f;
+				integrateMultiScattering(atmosphere, transmittanceLut, posES, dir, dir2sun, L, f);
+				L2 += L;
+				fms += f;
+			}
+		}
+		float oneOverNumDirs = 1.0f / float(sqrtNumDirs * sqrtNumDirs);
+		L2 *= oneOverNumDirs;
+		fms *= oneOverNumDirs;
+
+		// sum of all higher orders: L2 * (1 + fms + fms^2 + ...)
+		vec3 psi = L2 / (1.0f - fms);
+		return vec4(psi, 1);
+	});
+}
+
 void SkyAtmosphereSim::runSim() {
 	auto texdim = uvec2(output->getWidth(), output->getHeight());
 
@@ -500,14 +639,20 @@ void sky::SkyAtmospherePostProcess::runSim() {
 	ASSERT(skyTextureRaw != nullptr && output != nullptr)
 	ASSERT(skyTextureRaw != output)
 	auto texdim = uvec2(output->getWidth(), output->getHeight());
-	dispatchShader([&](uint32_t x, uint32_t y) {
-		vec2 uv = vec2(float(x + 0.5f) / texdim.x, float(y + 0.5f) / texdim.y);
-		auto raw = skyTextureRaw->sampleBilinear(uv, CpuTexture::WM_Clamp);
+	dispatchShaderBatched<8>([&](uint32_t x, uint32_t y, vec4 (&out)[8]) {
+		vec2 uvs[8];
+		for (uint32_t i = 0; i < 8; i++) {
+			uvs[i] = vec2(float(x + i + 0.5f) / texdim.x, float(y + 0.5f) / texdim.y);
+		}
+		vec4 raw[8];
+		skyTextureRaw->sampleBilinear(uvs, raw, 8, CpuTexture::WM_Clamp);
 		vec3 white_point = vec3(1.08241, 0.96756, 0.95003);
-		vec3 base = 1.0f - exp(-vec3(raw.x, raw.y, raw.z) / white_point * renderingParams.exposure);
 		vec3 exponent = vec3(1.0f / 2.2f);
-		vec3 res = pow(base, exponent);
-		return vec4(res, 1.0f);
+		for (uint32_t i = 0; i < 8; i++) {
+			vec3 base = 1.0f - skymath::exp(-vec3(raw[i].x, raw[i].y, raw[i].z) / white_point * renderingParams.exposure);
+			vec3 res = pow(base, exponent);
+			out[i] = vec4(res, 1.0f);
+		}
 	});
 }
 
@@ -525,7 +670,7 @@ void sky::SkyViewLutSim::runSim() {
 			cameraPosESProxy, viewDirProxy, dir2sunProxy);
 
 		vec3 L = computeSkyAtmosphere(
-			renderingParams->atmosphere, transmittanceLut,
+			renderingParams->atmosphere, transmittanceLut, multiScatteredLut,
 			cameraPosESProxy,
 			viewDirProxy,
 			dir2sunProxy,
@@ -581,26 +726,61 @@ CpuSkyAtmosphere::CpuSkyAtmosphere() {
 }
 
 void CpuSkyAtmosphere::updateLuts() {
-	transmittanceLut = CpuTexture(256, 64);
-	{
-		TIMER_BEGIN
-		TransmittanceLutSim transmittanceSim(&transmittanceLut);
-		transmittanceSim.atmosphere = renderingParams.atmosphere;
-		transmittanceSim.runSim();
-		TIMER_END(tTransmittance)
-		LOG("transmittance lut: %.3fs", tTransmittance)
+	bool atmosphereChanged = !transmittanceLutInputs.has_value() || *transmittanceLutInputs != renderingParams.atmosphere;
+	if (atmosphereChanged) {
+		// lookup tables: rgb only, tiled so bilinear fetches stay within few cache lines
+		transmittanceLut = CpuTexture(256, 64, CpuTexture::F_RGB32F, CpuTexture::L_Tiled);
+		{
+			PROFILE_SCOPE("sky transmittance lut")
+			TIMER_BEGIN
+			TransmittanceLutSim transmittanceSim(&transmittanceLut);
+			transmittanceSim.atmosphere = renderingParams.atmosphere;
+			transmittanceSim.runSim();
+			TIMER_END(tTransmittance)
+			LOG("transmittance lut: %.3fs", tTransmittance)
+		}
+
+#if CPUSKY_MULTISCATTERING
+		multiScatteredLut = CpuTexture(32, 32, CpuTexture::F_RGB32F, CpuTexture::L_Tiled);
+		{
+			PROFILE_SCOPE("sky multiple scattering lut")
+			TIMER_BEGIN
+			MultiScatteredLutSim multiScatteredSim(&multiScatteredLut);
+			multiScatteredSim.transmittanceLut = &transmittanceLut;
+			multiScatteredSim.atmosphere = renderingParams.atmosphere;
+			multiScatteredSim.runSim();
+			TIMER_END(tMultiScattered)
+			LOG("multiple scattering lut: %.3fs", tMultiScattered)
+		}
+#endif
+		transmittanceLutInputs = renderingParams.atmosphere;
 	}
 
 	// sky view lut
-	skyViewLut = CpuTexture(192, 108);
-	{
-		TIMER_BEGIN
-		myn::sky::SkyViewLutSim skyViewSim(&skyViewLut);
-		skyViewSim.transmittanceLut = &transmittanceLut;
-		skyViewSim.renderingParams = &renderingParams;
-		skyViewSim.runSim();
-		TIMER_END(tSkyView)
-		LOG("sky view lut: %.3fs", tSkyView)
+	vec3 cameraPosES = ws2es(renderingParams.cameraPosWS, renderingParams.atmosphere.bottomRadius);
+	SkyViewLutInputs skyViewInputs = {
+		.atmosphere = renderingParams.atmosphere,
+		.viewHeight = length(cameraPosES),
+		.sunZenithCosine = dot(renderingParams.dir2sun, normalize(cameraPosES)),
+		.sunLuminance = renderingParams.sunLuminance,
+		.numSamplesMinMax = renderingParams.skyViewNumSamplesMinMax
+	};
+	if (atmosphereChanged || !skyViewLutInputs.has_value() || *skyViewLutInputs != skyViewInputs) {
+		skyViewLut = CpuTexture(192, 108, CpuTexture::F_RGB32F, CpuTexture::L_Tiled);
+		{
+			PROFILE_SCOPE("sky view lut")
+			TIMER_BEGIN
+			myn::sky::SkyViewLutSim skyViewSim(&skyViewLut);
+			skyViewSim.transmittanceLut = &transmittanceLut;
+#if CPUSKY_MULTISCATTERING
+			skyViewSim.multiScatteredLut = &multiScatteredLut;
+#endif
+			skyViewSim.renderingParams = &renderingParams;
+			skyViewSim.runSim();
+			TIMER_END(tSkyView)
+			LOG("sky view lut: %.3fs", tSkyView)
+		}
+		skyViewLutInputs = skyViewInputs;
 	}
 }
 
@@ -608,6 +788,7 @@ CpuTexture CpuSkyAtmosphere::createSkyTexture(int width, int height) {
 	// compositing
 	CpuTexture skyTextureRaw(width, height);
 	{
+		PROFILE_SCOPE("sky compositing")
 		TIMER_BEGIN
 		myn::sky::SkyAtmosphereSim mainSim(&skyTextureRaw);
 		mainSim.renderingParams = renderingParams;
@@ -621,6 +802,7 @@ CpuTexture CpuSkyAtmosphere::createSkyTexture(int width, int height) {
 	// post-processed sky texture
 	CpuTexture outSkyTexture = CpuTexture(width, height);
 	{
+		PROFILE_SCOPE("sky post processing")
 		TIMER_BEGIN
 		myn::sky::SkyAtmospherePostProcess post(&outSkyTexture);
 		post.skyTextureRaw = &skyTextureRaw; // as read-only shader resource
@@ -8,8 +8,17 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <functional>
+#include <optional>
 #include "Utils/myn/ShaderSimulator.h"
 
+// 2nd+ order scattering from the multiple scattering lut (Hillaire 2020)
+#define CPUSKY_MULTISCATTERING 1
+// polynomial approximations (Utils/myn/FastMath.h) instead of libm for exp/log/acos/atan in the kernels
+// (overridable from the build, see the sky_accuracy test)
+#ifndef CPUSKY_FAST_MATH
+#define CPUSKY_FAST_MATH 1
+#endif
+
 namespace myn::sky {
 
 struct AtmosphereProfile {
@@ -32,6 +41,8 @@ struct AtmosphereProfile {
 	float ozoneLayerWidth;
 
 	glm::vec3 groundAlbedo;
+
+	bool operator==(const AtmosphereProfile&) const = default;
 };
 
 struct SkyAtmosphereRenderingParams {
@@ -51,6 +62,7 @@ public:
 	void runSim() override;
 
 	const CpuTexture* transmittanceLut = nullptr;
+	const CpuTexture* multiScatteredLut = nullptr; // optional
 	const SkyAtmosphereRenderingParams* renderingParams = nullptr;
 };
 
@@ -63,6 +75,16 @@ public:
 	AtmosphereProfile atmosphere;
 };
 
+class MultiScatteredLutSim : public ShaderSimulator {
+public:
+	explicit MultiScatteredLutSim(CpuTexture* outputTexture)
+	: ShaderSimulator(outputTexture) {}
+	void runSim() override;
+
+	const CpuTexture* transmittanceLut = nullptr;
+	AtmosphereProfile atmosphere;
+};
+
 class SkyAtmosphereSim : public ShaderSimulator {
 public:
 	explicit SkyAtmosphereSim(CpuTexture* outputTexture)
@@ -92,6 +114,7 @@ public:
 
 	glm::vec3 sampleSunTransmittance(const glm::vec3& viewDir) const;
 
+	// only rebuilds the luts whose inputs changed since the last update
 	void updateLuts();
 
 	CpuTexture createSkyTexture(int width, int height);
@@ -101,8 +124,23 @@ public:
 private:
 
 	CpuTexture transmittanceLut;
+	CpuTexture multiScatteredLut;
 	CpuTexture skyViewLut;
 
+	// what the luts were last built with:
+	// transmittance & multiple scattering only depend on the atmosphere profile;
+	// sky view additionally depends on camera height and sun zenith angle (not sun azimuth or camera xy)
+	struct SkyViewLutInputs {
+		AtmosphereProfile atmosphere;
+		float viewHeight;
+		float sunZenithCosine;
+		glm::vec3 sunLuminance;
+		glm::vec2 numSamplesMinMax;
+		bool operator==(const SkyViewLutInputs&) const = default;
+	};
+	std::optional<AtmosphereProfile> transmittanceLutInputs;
+	std::optional<SkyViewLutInputs> skyViewLutInputs;
+
 };
 
 }
@@ -0,0 +1,152 @@
+#include "Utils/myn/Log.h"
+#include "Render/Culling.h"
+#include "Render/Mesh.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <random>
+#include <string>
+
+/*
+ * Checks for the cpu visibility tests (Culling.h): the BVH's frustum culling, after building and after refitting,
+ * against testing every box on its own, and the occlusion buffer with a single quad in front of the camera. Returns
+ * non-zero if any of them fails.
+ */
+
+using namespace glm;
+
+namespace {
+
+bool check(bool passed, const char* what) {
+	LOG("%s%s", what, passed ? "" : " FAILED")
+	return passed;
+}
+
+// camera at the origin looking down -z
+mat4 worldToClip() {
+	return perspective(radians(60.0f), 2.0f, 0.1f, 100.0f) * lookAt(vec3(0), vec3(0, 0, -1), vec3(0, 1, 0));
+}
+
+AABB box(vec3 center, float halfSize) {
+	AABB result;
+	result.min = center - vec3(halfSize);
+	result.max = center + vec3(halfSize);
+	return result;
+}
+
+// outside if entirely behind any one plane
+std::vector<uint32_t> bruteForceCull(const FrustumPlanes& frustum, const std::vector<AABB>& boxes) {
+	std::vector<uint32_t> visible;
+	for (uint32_t i = 0; i < boxes.size(); i++) {
+		bool outside = false;
+		for (auto& plane : frustum.planes) {
+			vec3 farthest(plane.x > 0 ? boxes[i].max.x : boxes[i].min.x, plane.y > 0 ? boxes[i].max.y : boxes[i].min.y,
+				plane.z > 0 ? boxes[i].max.z : boxes[i].min.z);
+			outside |= dot(vec3(plane), farthest) + plane.w < 0;
+		}
+		if (!outside) visible.push_back(i);
+	}
+	return visible;
+}
+
+std::vector<uint32_t> bvhCull(const CullingBVH& bvh, const FrustumPlanes& frustum) {
+	std::vector<uint32_t> visible;
+	bvh.cull(frustum, visible);
+	std::sort(visible.begin(), visible.end());
+	return visible;
+}
+
+// scattered all around the camera, so some are inside, some outside and some cross the frustum's planes
+std::vector<AABB> randomBoxes(std::mt19937& rng, uint32_t count) {
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::vector<AABB> boxes;
+	for (uint32_t i = 0; i < count; i++) boxes.push_back(box(vec3(position(rng), position(rng), position(rng)), size(rng)));
+	return boxes;
+}
+
+bool checkBVH() {
+	bool ok = true;
+	std::mt19937 rng(1);
+	FrustumPlanes frustum(worldToClip());
+
+	// above and below CULLING_PARALLEL_MIN_ITEMS
+	for (uint32_t count : { 1u, 3u, 100u, 5000u }) {
+		std::string suffix = " (" + std::to_string(count) + " boxes)";
+		auto boxes = randomBoxes(rng, count);
+		CullingBVH bvh;
+		bvh.build(boxes);
+		ok &= check(bvhCull(bvh, frustum) == bruteForceCull(frustum, boxes), ("build: same as testing each box" + suffix).c_str());
+
+		// everything moves, some in and some out of the frustum
+		std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+		for (auto& b : boxes) {
+			vec3 move(offset(rng), offset(rng), offset(rng));
+			b.min += move;
+			b.max += move;
+		}
+		bvh.refit(boxes);
+		ok &= check(bvhCull(bvh, frustum) == bruteForceCull(frustum, boxes), ("refit: same as testing each box" + suffix).c_str());
+	}
+
+	CullingBVH bvh;
+	bvh.build(randomBoxes(rng, 50));
+	auto boxes = randomBoxes(rng, 70);
+	bvh.refit(boxes);
+	ok &= check(bvh.numItems() == 70 && bvhCull(bvh, frustum) == bruteForceCull(frustum, boxes),
+		"refit with a different number of boxes: rebuilds");
+
+	bvh.build({});
+	ok &= check(bvhCull(bvh, frustum).empty(), "no boxes: nothing visible");
+	return ok;
+}
+
+bool checkOcclusion() {
+	bool ok = true;
+
+	// a 2x2 quad 5 units in front of the camera
+	std::vector<Vertex> vertices = { Vertex(vec3(-1, -1, -5)), Vertex(vec3(1, -1, -5)), Vertex(vec3(1, 1, -5)), Vertex(vec3(-1, 1, -5)) };
+	std::vector<VERTEX_INDEX_TYPE> indices = { 0, 1, 2, 0, 2, 3 };
+	Mesh quad("occluder", "");
+	quad.cpu_data.vertices = vertices.data();
+	quad.cpu_data.num_vertices = vertices.size();
+	quad.cpu_data.faces = indices.data();
+	quad.cpu_data.num_indices = indices.size();
+
+	AABB behind = box(vec3(0, 0, -10), 0.5f);
+	AABB beside = box(vec3(6, 0, -10), 0.5f);
+	AABB inFront = box(vec3(0, 0, -3), 0.5f);
+	AABB partlyCovered = box(vec3(2, 0, -10), 0.5f);
+
+	OcclusionBuffer buffer;
+	ok &= check(buffer.isVisible(behind), "nothing rasterized: everything visible");
+
+	buffer.begin(worldToClip(), 256, 128);
+	buffer.finish();
+	ok &= check(buffer.isVisible(behind), "no occluders: everything visible");
+
+	buffer.begin(worldToClip(), 256, 128);
+	buffer.addOccluder(&quad, mat4(1));
+	buffer.finish();
+	ok &= check(buffer.numOccluderTriangles() == 2, "counts the occluder's triangles");
+	ok &= check(!buffer.isVisible(behind), "box behind the quad: hidden");
+	ok &= check(buffer.isVisible(beside), "box beside the quad: visible");
+	ok &= check(buffer.isVisible(inFront), "box in front of the quad: visible");
+	ok &= check(buffer.isVisible(partlyCovered), "box partly behind the quad: visible");
+
+	// same quad, moved with its object to world transform
+	buffer.begin(worldToClip(), 256, 128);
+	buffer.addOccluder(&quad, translate(mat4(1), vec3(3, 0, 0)));
+	buffer.finish();
+	ok &= check(!buffer.isVisible(beside) && buffer.isVisible(behind), "occluder transform is applied");
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = checkBVH();
+	ok &= checkOcclusion();
+	LOG("%s", ok ? "all passed" : "culling check FAILED")
+	return ok ? 0 : 1;
+}
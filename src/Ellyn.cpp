@@ -8,11 +8,15 @@
 #include "Render/Renderers/RayTracingRenderer.h"
 #include "Render/Renderers/SimpleRenderer.h"
 #include "Render/Texture.h"
+#include "Render/TextureStreaming.h"
 
 #include "Render/Vulkan/VulkanUtils.h"
+#include "Render/Vulkan/PassTimer.h"
+#include "Render/Vulkan/PipelineBuilder.h"
 #include "Utils/DebugUI.h"
 
 #include "Utils/myn/RenderDoc.h"
+#include "Utils/myn/Profiler.h"
 
 #include <SDL2/SDL.h>
 #include <imgui.h>
@@ -24,6 +28,9 @@
 #include "Scene/Probe.h"
 #include "Scene/SkyAtmosphere/SkyAtmosphere.h"
 
+#include <filesystem>
+#include <fstream>
+
 using namespace myn;
 
 #ifdef _WIN32
@@ -44,7 +51,10 @@ namespace
 
 	std::string name;
 
-	SDL_Window* window;
+	// --headless: no window; renders the benchmark (see run_benchmark) and quits
+	bool headless = false;
+
+	SDL_Window* window = nullptr;
 	SDL_GLContext context;
 
 	myn::TimePoint previous_time;
@@ -62,6 +72,9 @@ namespace
 
 	std::vector<Renderer*> renderers{};
 
+	VkDeviceSize texture_upload_budget = 0;
+	VkDeviceSize texture_memory_budget = 0;
+
 }// fileprivate
 
 static void init();
@@ -74,11 +87,17 @@ static void draw();
 
 static void cleanup();
 
+static void run_benchmark();
+
 //////////////////////////////////////////////////////////////////
 
 static void init()
 {
-	vk::init_window("niar - main window", width, height, &window);
+	if (headless) {
+		vk::init_headless(width, height);
+	} else {
+		vk::init_window("niar - main window", width, height, &window);
+	}
 
 	{// shared resources
 		LOG("loading resources (vulkan)...");
@@ -150,6 +169,8 @@ static void init()
 		ui::elem([](){ ImGui::Separator(); }, "Rendering");
 	}
 
+	ui::profilerView(Config->lookup<std::string>("Debug.TraceFile"));
+
 	{// renderers
 		int rtx_enabled = Config->lookup<int>("Debug.RTX");
 		renderers.push_back(SimpleRenderer::get());
@@ -161,6 +182,11 @@ static void init()
 		}
 #endif
 
+		// compile what they're going to draw with up front, on all cores, instead of during their first frame
+		PipelineLibrary::beginWarmup();
+		for (auto renderer : renderers) renderer->warm_up_pipelines();
+		PipelineLibrary::endWarmup();
+
 		auto rendererIndexRef = (int*)&renderer_index;
 		ui::elem([rendererIndexRef, rtx_enabled]()
 		{
@@ -216,20 +242,6 @@ static bool process_input()
 		else if (event.type==SDL_KEYUP &&
 				 event.key.keysym.sym==SDLK_ESCAPE) { quit=true; break; }
 
-		// window gains focus
-		else if (event.type==SDL_WINDOWEVENT && event.window.event==SDL_WINDOWEVENT_FOCUS_GAINED) {
-			if (Config->lookup<int>("Debug.AutoHotReload")) {
-
-				Asset::reload_all();
-
-				// find a camera and set it active
-				Scene::Active->foreach_descendent_bfs([](SceneObject* obj) {
-					auto cam = dynamic_cast<Camera*>(obj);
-					if (cam) Camera::Active = cam;
-				});
-			}
-		}
-
 		// imgui; pass on control to the rest of the app if event.type is not keyup
 		ImGui_ImplSDL2_ProcessEvent(&event);
 
@@ -243,8 +255,9 @@ static bool process_input()
 
 static void update(float elapsed)
 {
+	PROFILE_SCOPE("update")
 	// camera
-	if (Camera::Active &&
+	if (Camera::Active && !headless &&
 		!ImGui::GetIO().WantCaptureMouse &&
 		!ImGui::GetIO().WantCaptureKeyboard)
 	{
@@ -253,6 +266,7 @@ static void update(float elapsed)
 	// scenes (only the active one updates)
 	if (Scene::Active && Scene::Active->enabled()) {
 		Scene::Active->update(elapsed);
+		Scene::Active->update_world_transforms();
 	}
 }
 
@@ -261,13 +275,15 @@ static void update(float elapsed)
 static void draw()
 {
 #if IMGUI
-	ImGui_ImplVulkan_NewFrame();
-	ImGui_ImplSDL2_NewFrame(window);
-	ImGui::NewFrame();
+	if (!headless) {
+		ImGui_ImplVulkan_NewFrame();
+		ImGui_ImplSDL2_NewFrame(window);
+		ImGui::NewFrame();
 
-	if (show_imgui_demo) ImGui::ShowDemoWindow();
+		if (show_imgui_demo) ImGui::ShowDemoWindow();
 
-	ui::drawUI();
+		ui::drawUI();
+	}
 #endif
 
 	// renderer selection and configuration
@@ -285,11 +301,13 @@ static void draw()
 
 	// draw with current renderer
 
+	PROFILE_SCOPE("draw")
 	auto cmdbuf = Vulkan::Instance->beginFrame();
 	{
 		renderer->render(cmdbuf);
 
 #if IMGUI
+		if (!headless)
 		{
 			SCOPED_DRAW_EVENT(cmdbuf, "ImGui UI")
 			ImGui::Render();
@@ -317,19 +335,140 @@ static void cleanup()
 	delete Scene::Active;
 	delete Vulkan::Instance;
 
-	SDL_DestroyWindow(window);
+	if (window) SDL_DestroyWindow(window);
 	SDL_Quit();
 }
 
+/*
+ * Renders WarmupFrames that don't count (for async loading and texture streaming to settle), then Frames more while
+ * the camera turns around once in place, with a fixed time step so every run sees the same frames. Logs the average
+ * cpu frame time and the cpu (recording) and gpu time of each SCOPED_DRAW_EVENT scope, and writes them to ReportFile.
+ * Every CaptureInterval-th measured frame is saved as a png (frames that get captured wait for the gpu, so they don't
+ * count towards the cpu frame time).
+ */
+static void run_benchmark()
+{
+	int selected_renderer = Config->lookup<int>("Benchmark.Renderer");
+	if (selected_renderer < 0 || selected_renderer >= (int)renderers.size()) {
+		WARN("Benchmark.Renderer %d isn't available, using deferred", selected_renderer)
+		selected_renderer = e_renderer::deferred;
+	}
+	renderer_index = e_renderer(selected_renderer);
+
+	uint32_t warmup_frames = Config->lookup<int>("Benchmark.WarmupFrames");
+	uint32_t num_frames = std::max(1, Config->lookup<int>("Benchmark.Frames"));
+	int capture_interval = Config->lookup<int>("Benchmark.CaptureInterval");
+	std::string capture_directory = Config->lookup<std::string>("Benchmark.CaptureDirectory");
+	if (capture_interval > 0) std::filesystem::create_directories(capture_directory);
+	std::string trace_path = Config->lookup<std::string>("Benchmark.TraceFile");
+
+	auto pass_timer = Vulkan::Instance->passTimer;
+	if (!pass_timer) WARN("the device can't do timestamp queries (or reset them from the host): no per pass timings")
+
+	const float time_step = 1.0f / 60.0f;
+	double total_cpu_ms = 0, min_cpu_ms = INF, max_cpu_ms = 0;
+	uint32_t num_timed_frames = 0;
+
+	for (uint32_t i = 0; i < warmup_frames + num_frames; i++)
+	{
+		if (i == warmup_frames) {
+			Vulkan::Instance->waitDeviceIdle();
+			if (pass_timer) {
+				pass_timer->resolveAll();
+				pass_timer->clearTotals();
+			}
+			if (!trace_path.empty()) profiler::start_capture();
+			LOG("benchmark: %u warmup frames done, measuring %u frames at %ux%u", warmup_frames, num_frames, width, height)
+		}
+		bool measured = i >= warmup_frames;
+		uint32_t frame = i - warmup_frames;
+		bool capture = measured && capture_interval > 0 && frame % capture_interval == 0;
+
+		TimePoint frame_start = std::chrono::high_resolution_clock::now();
+		Texture2D::uploadPendingTextures(texture_upload_budget);
+		texture_streaming::update(texture_memory_budget, texture_upload_budget);
+		if (measured && Camera::Active) {
+			Camera::Active->rotate_around_axis(glm::vec3(0, 0, 1), 2.0f * PI / float(num_frames));
+		}
+		update(time_step);
+		if (capture) {
+			char path[32];
+			snprintf(path, sizeof(path), "/frame_%04u.png", frame);
+			Vulkan::Instance->captureFrame(capture_directory + path);
+		}
+		draw();
+		profiler::end_frame();
+
+		if (measured && !capture) {
+			double cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame_start).count();
+			total_cpu_ms += cpu_ms;
+			min_cpu_ms = std::min(min_cpu_ms, cpu_ms);
+			max_cpu_ms = std::max(max_cpu_ms, cpu_ms);
+			num_timed_frames++;
+		}
+	}
+	Vulkan::Instance->waitDeviceIdle();
+	if (pass_timer) pass_timer->resolveAll();
+	if (profiler::is_capturing()) profiler::stop_capture(trace_path);
+
+	// report
+	if (num_timed_frames > 0) {
+		LOG("cpu frame time: avg %.3f ms, min %.3f ms, max %.3f ms",
+			total_cpu_ms / num_timed_frames, min_cpu_ms, max_cpu_ms)
+	}
+	std::string report_path = Config->lookup<std::string>("Benchmark.ReportFile");
+	std::ofstream report;
+	if (!report_path.empty()) {
+		auto report_directory = std::filesystem::path(report_path).parent_path();
+		if (!report_directory.empty()) std::filesystem::create_directories(report_directory);
+		report.open(report_path);
+		report << "pass,cpu_ms,gpu_ms,frames\n";
+		if (num_timed_frames > 0) report << "cpu frame," << total_cpu_ms / num_timed_frames << ",," << num_timed_frames << "\n";
+	}
+	if (pass_timer)
+	{
+		double num_resolved = std::max(1u, pass_timer->getNumFramesResolved());
+		LOG("per frame average over %u frames (cpu: recording time):", pass_timer->getNumFramesResolved())
+		for (auto& pass : pass_timer->getTotals())
+		{
+			LOG("  %-32s cpu %8.3f ms   gpu %8.3f ms", pass.name.c_str(), pass.cpuMs / num_resolved, pass.gpuMs / num_resolved)
+			if (report.is_open()) {
+				report << "\"" << pass.name << "\"," << pass.cpuMs / num_resolved << "," << pass.gpuMs / num_resolved << "," << pass.numFrames << "\n";
+			}
+		}
+	}
+	if (report.is_open()) LOG("wrote timings to %s", report_path.c_str())
+}
+
 int main(int argc, const char * argv[])
 {
 	std::srand(time(nullptr));
+	profiler::set_thread_name("main");
 
 	Config = new ConfigAsset("config/global.ini", false);
 
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--headless") headless = true;
+	}
+	if (headless) {
+		width = Config->lookup<int>("Benchmark.Width");
+		height = Config->lookup<int>("Benchmark.Height");
+	}
+
 	if (Config->lookup<int>("Debug.RenderDoc")) RenderDoc::load("niar");
 
+	texture_upload_budget = VkDeviceSize(Config->lookup<int>("TextureUploadBudgetMB")) * 1024 * 1024;
+	texture_memory_budget = VkDeviceSize(Config->lookup<int>("TextureMemoryBudgetMB")) * 1024 * 1024;
 	init();
+	if (headless) {
+		run_benchmark();
+		cleanup();
+		return 0;
+	}
+	if (Config->lookup<int>("Debug.AutoHotReload")) {
+		Asset::start_watching();
+		PipelineLibrary::startWatchingShaders();
+	}
 
 	while(true)
 	{
@@ -341,10 +480,25 @@ int main(int argc, const char * argv[])
 		bool should_quit = process_input();
 		if (should_quit) break;
 
+		if (Asset::update_watched()) {
+			// find a camera and set it active
+			Scene::Active->foreach_descendent_bfs([](SceneObject* obj) {
+				auto cam = dynamic_cast<Camera*>(obj);
+				if (cam) Camera::Active = cam;
+			});
+		}
+		PipelineLibrary::update();
+
 		myn::RenderDoc::potentiallyStartCapture();
+		{
+			PROFILE_SCOPE("texture uploads")
+			Texture2D::uploadPendingTextures(texture_upload_budget);
+			texture_streaming::update(texture_memory_budget, texture_upload_budget);
+		}
 		update(elapsed);
 		draw();
 		myn::RenderDoc::potentiallyEndCapture();
+		profiler::end_frame();
 	}
 
 	cleanup();
@@ -1,5 +1,6 @@
 #include "BVH.hpp"
 #include <algorithm>
+#include <functional>
 
 #define BVH_THRESHOLD 16
 #define PER_AXIS_GRANULARITY 8
@@ -15,8 +16,13 @@ inline float BVH::surface_area() {
 
 void BVH::extend_primitive(Primitive* prim)
 {
+	if (auto I = dynamic_cast<Instance*>(prim)) {
+		min = glm::min(min, I->min);
+		max = glm::max(max, I->max);
+		return;
+	}
 	Triangle* T = dynamic_cast<Triangle*>(prim);
-	if (!T) return; // currently bvh only supports triangles
+	if (!T) return; // otherwise bvh only supports triangles
 	for (int i=0; i<3; i++) {
 		min = glm::min(min, T->vertices[i]);
 		max = glm::max(max, T->vertices[i]);
@@ -42,6 +48,7 @@ void BVH::expand_bvh()
 	int min_divide_axis = 0;
 
 	auto center = [](Primitive* T_) {
+		if (auto I = dynamic_cast<Instance*>(T_)) return (I->min + I->max) * 0.5f;
 		Triangle* T = dynamic_cast<Triangle*>(T_);
 		return (T->vertices[0] + T->vertices[1] + T->vertices[2]) * (1.0f / 3.0f);
 	};
@@ -56,7 +63,7 @@ void BVH::expand_bvh()
 
 		for (uint32_t j=0; j<primitives_count; j++)
 		{
-			Triangle* T = dynamic_cast<Triangle*>( (*primitives_ptr)[primitives_start + j] );
+			Primitive* T = (*primitives_ptr)[primitives_start + j];
 			if (center(T).x < x_divide) {
 				left_cnt++;
 			} else {
@@ -103,7 +110,7 @@ void BVH::expand_bvh()
 
 		for (uint32_t j=0; j<primitives_count; j++)
 		{
-			auto* T = dynamic_cast<Triangle*>( (*primitives_ptr)[primitives_start + j] );
+			Primitive* T = (*primitives_ptr)[primitives_start + j];
 			if (center(T).y < y_divide) {
 				left_cnt++;
 			} else {
@@ -150,7 +157,7 @@ void BVH::expand_bvh()
 
 		for (uint32_t j=0; j<primitives_count; j++)
 		{
-			Triangle* T = dynamic_cast<Triangle*>( (*primitives_ptr)[primitives_start + j] );
+			Primitive* T = (*primitives_ptr)[primitives_start + j];
 			if (center(T).z < z_divide) {
 				left_cnt++;
 			} else {
@@ -235,6 +242,81 @@ void BVH::expand_bvh()
 	right->expand_bvh();
 }
 
+void BVH::refit()
+{
+	min = vec3(INF);
+	max = vec3(-INF);
+	if (left || right) {
+		left->refit();
+		right->refit();
+		min = glm::min(left->min, right->min);
+		max = glm::max(left->max, right->max);
+	} else {
+		update_extents();
+	}
+}
+
+BVH* BVH::clone(std::vector<Primitive*>* _primitives_ptr) const
+{
+	auto node = new BVH(_primitives_ptr, depth);
+	node->min = min;
+	node->max = max;
+	node->primitives_start = primitives_start;
+	node->primitives_count = primitives_count;
+	if (left) node->left = left->clone(_primitives_ptr);
+	if (right) node->right = right->clone(_primitives_ptr);
+	return node;
+}
+
+void BVH::flatten(std::vector<FlatNode>& out_nodes) const
+{
+	int index = out_nodes.size();
+	out_nodes.push_back({
+		.min = min,
+		.max = max,
+		.primitives_start = primitives_start,
+		.primitives_count = primitives_count,
+		.depth = depth,
+		.left = -1,
+		.right = -1
+	});
+	if (left) {
+		out_nodes[index].left = out_nodes.size();
+		left->flatten(out_nodes);
+	}
+	if (right) {
+		out_nodes[index].right = out_nodes.size();
+		right->flatten(out_nodes);
+	}
+}
+
+BVH* BVH::unflatten(const FlatNode* nodes, uint num_nodes, std::vector<Primitive*>* _primitives_ptr)
+{
+	// children always come after their parent in pre-order, so this can't loop forever
+	std::function<BVH*(uint)> build = [&](uint index) -> BVH* {
+		auto& flat = nodes[index];
+		if (flat.primitives_start + flat.primitives_count > _primitives_ptr->size()) return nullptr;
+		auto node = new BVH(_primitives_ptr, flat.depth);
+		node->min = flat.min;
+		node->max = flat.max;
+		node->primitives_start = flat.primitives_start;
+		node->primitives_count = flat.primitives_count;
+		bool valid = true;
+		if (flat.left >= 0) {
+			valid &= flat.left > int(index) && flat.left < int(num_nodes) && (node->left = build(flat.left));
+		}
+		if (flat.right >= 0) {
+			valid &= flat.right > int(index) && flat.right < int(num_nodes) && (node->right = build(flat.right));
+		}
+		if (!valid) {
+			delete node;
+			return nullptr;
+		}
+		return node;
+	};
+	return num_nodes > 0 ? build(0) : nullptr;
+}
+
 // https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-box-intersection 
 bool BVH::intersect_aabb(const Ray& ray, float& tmin, float& tmax)
 {
@@ -457,4 +539,41 @@ Primitive* BVH::intersect_primitives(Ray& ray, double& t, vec3& n, bool use_bvh)
 		}
 	}
 	return primitive;
-}
\ No newline at end of file
+}
+
+Instance::Instance(const BLAS* _blas, const mat4& o2w)
+{
+	blas = _blas;
+	w2o = inverse(o2w);
+	normal_o2w = transpose(inverse(mat3(o2w)));
+	bsdf = nullptr; // each triangle inside has its own
+
+	// world space bounds: transformed corners of the object space ones
+	min = vec3(INF);
+	max = vec3(-INF);
+	for (int i = 0; i < 8; i++) {
+		vec3 corner = vec3(
+			i & 1 ? blas->bvh->max.x : blas->bvh->min.x,
+			i & 2 ? blas->bvh->max.y : blas->bvh->min.y,
+			i & 4 ? blas->bvh->max.z : blas->bvh->min.z);
+		vec3 corner_world = vec3(o2w * vec4(corner, 1));
+		min = glm::min(min, corner_world);
+		max = glm::max(max, corner_world);
+	}
+}
+
+Primitive* Instance::intersect(Ray& ray, double& t, vec3& normal, bool modify_ray)
+{
+	// direction is left unnormalized so t stays the same in both spaces
+	Ray local_ray = ray;
+	local_ray.o = vec3(w2o * vec4(ray.o, 1));
+	local_ray.d = mat3(w2o) * ray.d;
+
+	vec3 local_normal;
+	Primitive* hit = blas->bvh->intersect_primitives(local_ray, t, local_normal);
+	if (!hit) return nullptr;
+
+	if (modify_ray) ray.tmax = local_ray.tmax;
+	normal = normalize(normal_o2w * local_normal);
+	return hit;
+}
@@ -35,8 +35,54 @@ struct BVH
 	
 	void update_extents();
 	void expand_bvh();
+	// recompute bounds bottom-up after primitives moved, keeping the hierarchy
+	void refit();
+
+	// deep copy of the hierarchy, pointing to another primitives array of the same order
+	BVH* clone(std::vector<Primitive*>* _primitives_ptr) const;
+
+	// pointer-free form of the hierarchy (pre-order), for caching it on disk
+	struct FlatNode {
+		vec3 min;
+		vec3 max;
+		uint primitives_start;
+		uint primitives_count;
+		uint depth;
+		int left; // index into the flat array, -1 if none
+		int right;
+	};
+	void flatten(std::vector<FlatNode>& out_nodes) const;
+	// returns nullptr if the nodes don't form a valid hierarchy over num_primitives
+	static BVH* unflatten(const FlatNode* nodes, uint num_nodes, std::vector<Primitive*>* _primitives_ptr);
 
 	float surface_area();
 	bool intersect_aabb(const Ray& ray, float& tmin, float& tmax);
 	Primitive* intersect_primitives(Ray& ray, double& t, vec3& n, bool use_bvh = true);
+};
+
+// bottom level of the two-level hierarchy: one mesh's triangles in object space, shared by all its instances
+struct BLAS
+{
+	std::vector<Triangle> triangles;
+	std::vector<Primitive*> primitives;
+	BVH* bvh = nullptr;
+	~BLAS() { delete bvh; }
+};
+
+// top level: a transformed reference to a BLAS. Sits in the same primitives array (and bvh) as regular triangles;
+// rays get transformed to object space when they get here
+struct Instance : public Primitive
+{
+	Instance() = default;
+	Instance(const BLAS* _blas, const mat4& o2w);
+
+	const BLAS* blas = nullptr;
+	mat4 w2o;
+	mat3 normal_o2w;
+	// world space bounds
+	vec3 min;
+	vec3 max;
+
+	// returns the hit triangle inside the BLAS (for its bsdf); normal is in world space
+	Primitive* intersect(Ray& ray, double& t, vec3& normal, bool modify_ray) override;
 };
\ No newline at end of file
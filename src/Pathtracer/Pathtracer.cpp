@@ -7,8 +7,12 @@
 #include "Assets/ConfigAsset.hpp"
 #include "Render/Materials/GltfMaterialInfo.h"
 #include "Utils/myn/Sample.h"
+#include "Utils/myn/Threading.h"
+#include "Utils/myn/BinaryFile.h"
+#include "Utils/myn/Profiler.h"
 #include "CpuSkyAtmosphere/CpuSkyAtmosphere.h"
 #include <stack>
+#include <map>
 #include <unordered_map>
 #include <chrono>
 #include <thread>
@@ -81,9 +85,10 @@ Pathtracer::~Pathtracer() {
 	delete subimage_buffers;
 
 	for (auto l : lights) delete l.light;
-	for (auto t : primitives) delete t;
+	for (auto blas : blases) delete blas;
 
 	delete bvh;
+	clear_scene_replicas();
 
 	delete cpuSky;
 
@@ -107,12 +112,11 @@ void Pathtracer::initialize() {
 	});
 #endif
 
-	// scene
-	reload_scene(drawable);
-
 	// define thread work lambda
 	raytrace_task = [this](int tid)
 	{
+		myn::profiler::set_thread_name("pathtracer " + std::to_string(tid));
+		if (cached_config.PinThreads || !scene_replicas.empty()) myn::pin_current_thread(tid);
 		while (true)
 		{
 			// What can cause this line to hit EXEC_BAD_ACCESS?
@@ -176,13 +180,20 @@ void Pathtracer::initialize() {
 	config = new ConfigAsset("config/pathtracer.ini", true, [this](const ConfigAsset* cfg) {
 
 		uint32_t old_num_threads = cached_config.NumThreads;
+		int old_ispc = cached_config.ISPC;
+		int old_instancing = cached_config.Instancing;
+		int old_cache_bvh = cached_config.CacheBVH;
 
 		// read from file
 		cached_config.ISPC = cfg->lookup<int>("ISPC");
 		cached_config.UseBVH = cfg->lookup<int>("UseBVH");
+		cached_config.CacheBVH = cfg->lookup<int>("CacheBVH");
+		cached_config.Instancing = cfg->lookup<int>("Instancing");
 
 		cached_config.Multithreaded = cfg->lookup<int>("Multithreaded");
 		cached_config.NumThreads = cfg->lookup<int>("NumThreads");
+		cached_config.PinThreads = cfg->lookup<int>("PinThreads");
+		cached_config.ReplicatePerNumaNode = cfg->lookup<int>("ReplicatePerNumaNode");
 		cached_config.TileSize = cfg->lookup<int>("TileSize");
 
 		cached_config.UseDirectLight = cfg->lookup<int>("UseDirectLight");
@@ -209,6 +220,17 @@ void Pathtracer::initialize() {
 		clear_tasks_and_threads_wait();
 #endif
 
+		// the scene is first imported once these are known, and again whenever they change what the import produces
+		bool import_changed = cached_config.ISPC != old_ispc ||
+			cached_config.Instancing != old_instancing ||
+			cached_config.CacheBVH != old_cache_bvh;
+		if (!bvh || import_changed) {
+			reload_scene(drawable);
+		} else {
+			// scene copies may need to be (re)created or dropped
+			replicate_scene_per_numa_node();
+		}
+
 		// cpu buffers
 		delete image_buffer;
 		if (subimage_buffers /* not null if it's previously created at least once */) {
@@ -270,10 +292,55 @@ BSDF *Pathtracer::get_or_create_mesh_bsdf(const std::string &materialName)
 	return bsdf;
 }
 
+namespace
+{
+// meshes only get counted while traversing the scene; their triangles are created all at once afterwards
+struct MeshImport {
+	MeshObject* mesh_object;
+	const Vertex* vertices;
+	const VERTEX_INDEX_TYPE* indices;
+	glm::mat4 o2w;
+	BSDF* bsdf;
+	uint32_t first_triangle;
+	uint32_t num_triangles;
+	int first_light; // -1 if not emissive
+	int blas; // -1 if not instanced
+	int instance; // -1 if not instanced
+};
+
+// identical geometry + bsdf
+using MeshKey = std::tuple<const Vertex*, const VERTEX_INDEX_TYPE*, uint32_t, const BSDF*>;
+inline MeshKey mesh_key(const MeshImport& mesh) {
+	return {mesh.vertices, mesh.indices, mesh.num_triangles, mesh.bsdf};
+}
+
+// material versions also get bumped for things the pathtracer doesn't use (ie. textures), so compare the values
+inline bool bsdf_outdated(const BSDF* bsdf, const GltfMaterialInfo* info) {
+	if (!info || info->_version == bsdf->asset_version) return false;
+	if (bsdf->type == BSDF::Diffuse && bsdf->albedo != glm::vec3(info->BaseColorFactor * 0.8f)) return true;
+	return bsdf->get_emission() != info->EmissiveFactor;
+}
+
+inline Triangle load_triangle(const MeshImport& mesh, uint32_t index, const glm::mat4& o2w) {
+	uint32_t i = index * 3;
+	return Triangle(
+		o2w,
+		mesh.vertices[mesh.indices[i]],
+		mesh.vertices[mesh.indices[i + 1]],
+		mesh.vertices[mesh.indices[i + 2]],
+		mesh.bsdf);
+}
+}
+
 void Pathtracer::reload_scene(SceneObject *scene) {
+	PROFILE_SCOPE("pathtracer scene load")
 
 	primitives.clear();
+	for (auto l : lights) delete l.light;
 	lights.clear();
+	for (auto blas : blases) delete blas;
+	blases.clear();
+	instances.clear();
 
 	// also delete BSDF library
 	for (auto& pair : BSDFs) {
@@ -284,9 +351,11 @@ void Pathtracer::reload_scene(SceneObject *scene) {
 	delete bvh;
 	bvh = new BVH(&primitives, 0);
 
+	std::vector<MeshImport> mesh_imports;
+
 	int meshes_count = 0;
-	float light_power_sum = 0;
 	PathtracerDirectionalLight* foundSun = nullptr;
+	bool foundSky = false;
 	scene->foreach_descendent_bfs([&](SceneObject* drawable)
 	{
 		if (auto* mo = dynamic_cast<MeshObject*>(drawable)) {
@@ -295,52 +364,140 @@ void Pathtracer::reload_scene(SceneObject *scene) {
 			mo->bsdf = bsdf;
 			meshes_count++;
 
-			bool emissive = mo->bsdf->is_emissive;
-			for (int i=0; i < mo->mesh->get_num_indices(); i+=3) {
-				// loop and load triangles
-				Vertex v1 = mo->mesh->get_vertices()[mo->mesh->get_indices()[i]];
-				Vertex v2 = mo->mesh->get_vertices()[mo->mesh->get_indices()[i + 1]];
-				Vertex v3 = mo->mesh->get_vertices()[mo->mesh->get_indices()[i + 2]];
-				auto* T = new Triangle(mo->object_to_world(), v1, v2, v3, mo->bsdf);
-				auto* P = static_cast<Primitive*>(T);
-				primitives.push_back(P);
-
-				// also load as light if emissive
-				if (emissive) {
-					auto L = new PathtracerMeshLight(T);
-					float w = L->get_weight();
-					light_power_sum += w;
-					lights.push_back( {static_cast<PathtracerLight*>(L), w} );
-				}
+			MeshImport import = {
+				.mesh_object = mo,
+				.vertices = mo->mesh->get_vertices(),
+				.indices = mo->mesh->get_indices(),
+				.o2w = mo->object_to_world(),
+				.bsdf = bsdf,
+				.first_triangle = 0,
+				.num_triangles = mo->mesh->get_num_indices() / 3,
+				.first_light = -1,
+				.blas = -1,
+				.instance = -1
+			};
+			// also load as lights if emissive; slots are reserved now to keep the order
+			if (bsdf->is_emissive) {
+				import.first_light = lights.size();
+				lights.resize(lights.size() + import.num_triangles);
 			}
+			mesh_imports.push_back(import);
 		}
 		else if (auto* plight = dynamic_cast<PointLight*>(drawable)) {
 			auto L = new PathtracerPointLight(plight->world_position(),
 											  plight->getMultipliedColor() * 4.0f * PI / PBR_WATTS_TO_LUMENS);
-			float w = L->get_weight();
-			light_power_sum += w;
-			lights.push_back( {static_cast<PathtracerLight*>(L), w} );
+			lights.push_back( {static_cast<PathtracerLight*>(L), 0} );
 		}
 		else if (auto* dlight = dynamic_cast<DirectionalLight*>(drawable)) {
 			auto L = new PathtracerDirectionalLight(dlight->getLightDirection(),
 													dlight->getMultipliedColor() / PBR_WATTS_TO_LUMENS);
-			float w = L->get_weight();
-			light_power_sum += w;
-			lights.push_back( {static_cast<PathtracerLight*>(L), w} );
+			lights.push_back( {static_cast<PathtracerLight*>(L), 0} );
 			if (dlight == SkyAtmosphere::getInstance()->getSun()) {
 				foundSun = L;
 			}
 		}
 		else if (auto* sky = dynamic_cast<SkyAtmosphere*>(drawable)) {
 			if (sky->enabled() && sky->getSun()) {
-				cpuSky = new myn::sky::CpuSkyAtmosphere();
+				// keep the previous sky around so its luts only get rebuilt for what actually changed
+				if (!cpuSky) {
+					cpuSky = new myn::sky::CpuSkyAtmosphere();
+					TRACE("created CPU sky")
+				}
 				cpuSky->renderingParams.dir2sun = -sky->getSun()->getLightDirection();
 				cpuSky->renderingParams.cameraPosWS = camera->world_position();
 				cpuSky->updateLuts();
-				TRACE("created CPU sky")
+				foundSky = true;
+			}
+		}
+	});
+
+	if (!foundSky) {
+		delete cpuSky;
+		cpuSky = nullptr;
+	}
+
+	// meshes that show up more than once (and aren't emissive, since mesh lights need world space triangles)
+	// share one BLAS and become instances. The ISPC path only knows about plain triangles.
+	std::vector<const MeshImport*> blas_sources;
+	if (cached_config.Instancing && !cached_config.ISPC) {
+		std::map<MeshKey, uint32_t> uses;
+		for (auto& mesh : mesh_imports) {
+			if (mesh.first_light < 0 && mesh.num_triangles > 0) uses[mesh_key(mesh)]++;
+		}
+		std::map<MeshKey, int> blas_indices;
+		for (auto& mesh : mesh_imports) {
+			auto key = mesh_key(mesh);
+			if (mesh.first_light >= 0 || mesh.num_triangles == 0 || uses[key] < 2) continue;
+			auto it = blas_indices.find(key);
+			if (it == blas_indices.end()) {
+				it = blas_indices.insert({key, (int)blas_sources.size()}).first;
+				blas_sources.push_back(&mesh);
 			}
+			mesh.blas = it->second;
+		}
+	}
+
+	// everything else: world space triangles in one contiguous array
+	std::vector<const MeshImport*> flat_meshes;
+	uint32_t num_triangles = 0;
+	for (auto& mesh : mesh_imports) {
+		if (mesh.blas >= 0) continue;
+		mesh.first_triangle = num_triangles;
+		num_triangles += mesh.num_triangles;
+		flat_meshes.push_back(&mesh);
+	}
+
+	// transformed in parallel, straight from the meshes' (shared) vertex & index buffers
+	triangles = std::vector<Triangle>(num_triangles);
+	const uint32_t triangles_per_job = 4096;
+	uint32_t num_jobs = (num_triangles + triangles_per_job - 1) / triangles_per_job;
+	myn::WorkerPool::shared().parallel_for(num_jobs, [&](uint32_t job) {
+		uint32_t begin = job * triangles_per_job;
+		uint32_t end = std::min(begin + triangles_per_job, num_triangles);
+		// last mesh that starts at or before this job's first triangle
+		auto mesh = std::upper_bound(flat_meshes.begin(), flat_meshes.end(), begin,
+			[](uint32_t t, const MeshImport* m) { return t < m->first_triangle; }) - 1;
+		for (uint32_t t = begin; t < end; t++) {
+			while (t >= (*mesh)->first_triangle + (*mesh)->num_triangles) mesh++;
+			triangles[t] = load_triangle(**mesh, t - (*mesh)->first_triangle, (*mesh)->o2w);
+		}
+	});
+
+	// one BLAS (object space triangles + own bvh) per unique instanced mesh
+	blases.resize(blas_sources.size());
+	myn::WorkerPool::shared().parallel_for(blas_sources.size(), [&](uint32_t i) {
+		PROFILE_SCOPE("BLAS build")
+		auto& mesh = *blas_sources[i];
+		auto blas = new BLAS();
+		blas->triangles.resize(mesh.num_triangles);
+		blas->primitives.resize(mesh.num_triangles);
+		for (uint32_t t = 0; t < mesh.num_triangles; t++) {
+			blas->triangles[t] = load_triangle(mesh, t, glm::mat4(1));
+			blas->primitives[t] = &blas->triangles[t];
 		}
+		blas->bvh = new BVH(&blas->primitives, 0);
+		blas->bvh->primitives_count = mesh.num_triangles;
+		blas->bvh->update_extents();
+		blas->bvh->expand_bvh();
+		blases[i] = blas;
 	});
+	for (auto& mesh : mesh_imports) {
+		if (mesh.blas < 0) continue;
+		mesh.instance = instances.size();
+		instances.emplace_back(blases[mesh.blas], mesh.o2w);
+	}
+
+	// top level: triangles and instances together
+	primitives.resize(triangles.size() + instances.size());
+	for (size_t i = 0; i < triangles.size(); i++) primitives[i] = &triangles[i];
+	for (size_t i = 0; i < instances.size(); i++) primitives[triangles.size() + i] = &instances[i];
+	for (auto& mesh : mesh_imports) {
+		if (mesh.first_light < 0) continue;
+		for (uint32_t i = 0; i < mesh.num_triangles; i++) {
+			auto L = new PathtracerMeshLight(&triangles[mesh.first_triangle + i]);
+			lights[mesh.first_light + i] = {static_cast<PathtracerLight*>(L), 0};
+		}
+	}
 
 	// if sky atmosphere is created, modify sun somewhat:
 	if (cpuSky) {
@@ -348,26 +505,249 @@ void Pathtracer::reload_scene(SceneObject *scene) {
 		foundSun->apply_sky(cpuSky);
 	}
 
-	// post-process light weights (normalize them)
-	for (int i = 0; i < lights.size(); i++) {
-		float normalized_w = lights[i].cumulative_weight / light_power_sum;
-		lights[i].one_over_pdf = 1.0f / normalized_w;
-		if (i == 0) {
-			lights[i].cumulative_weight = normalized_w;
-		} else {
-			lights[i].cumulative_weight = lights[i - 1].cumulative_weight + normalized_w;
-		}
+	update_light_weights();
+
+	scene_meshes.clear();
+	for (auto& mesh : mesh_imports) {
+		scene_meshes.push_back({
+			.mesh_object = mesh.mesh_object,
+			.o2w = mesh.o2w,
+			.first_triangle = mesh.first_triangle,
+			.instance = mesh.instance
+		});
 	}
 
 	bvh->primitives_start = 0;
 	bvh->primitives_count = primitives.size();
-	bvh->update_extents();
-	bvh->expand_bvh();
+	std::string bvh_cache_path = ROOT_DIR"/" + Config->lookup<std::string>("SceneSource") + ".bvhcache";
+	uint64_t bvh_cache_key = cached_config.CacheBVH ? hash_primitives() : 0;
+	if (!cached_config.CacheBVH || !load_bvh_cache(bvh_cache_path, bvh_cache_key)) {
+		PROFILE_SCOPE("BVH build")
+		auto unsorted_primitives = primitives;
+		bvh->update_extents();
+		bvh->expand_bvh();
+		if (cached_config.CacheBVH) save_bvh_cache(bvh_cache_path, bvh_cache_key, unsorted_primitives);
+	}
+
+	replicate_scene_per_numa_node();
 
 	scene_version = get_scene_asset()->get_version();
 
-	TRACE("loaded a scene with %d meshes, %llu triangles, %llu lights",
-		  meshes_count, primitives.size(), lights.size());
+	TRACE("loaded a scene with %d meshes, %zu triangles, %zu instances of %zu meshes, %zu lights",
+		  meshes_count, triangles.size(), instances.size(), blases.size(), lights.size());
+}
+
+void Pathtracer::update_light_weights() {
+	// cumulative distribution over light power (normalized), to pick lights proportionally to it
+	float light_power_sum = 0;
+	for (auto& l : lights) light_power_sum += l.light->get_weight();
+	float cumulative_weight = 0;
+	for (auto& l : lights) {
+		float normalized_w = l.light->get_weight() / light_power_sum;
+		l.one_over_pdf = 1.0f / normalized_w;
+		cumulative_weight += normalized_w;
+		l.cumulative_weight = cumulative_weight;
+	}
+}
+
+bool Pathtracer::scene_changed() const {
+	for (auto& [name, bsdf] : BSDFs) {
+		if (bsdf_outdated(bsdf, GltfMaterialInfo::get(name))) return true;
+	}
+	for (auto& mesh : scene_meshes) {
+		if (mesh.mesh_object->object_to_world() != mesh.o2w) return true;
+	}
+	return false;
+}
+
+bool Pathtracer::update_scene() {
+	bool lights_changed = false;
+	bool moved = false;
+
+	// materials: triangles point to these, so update them in place
+	for (auto& [name, bsdf] : BSDFs) {
+		auto info = GltfMaterialInfo::get(name);
+		if (!bsdf_outdated(bsdf, info)) continue;
+		bool was_emissive = bsdf->is_emissive;
+		if (bsdf->type == BSDF::Diffuse) bsdf->albedo = info->BaseColorFactor * 0.8f;
+		bsdf->set_emission(info->EmissiveFactor);
+		bsdf->asset_version = info->_version;
+		// emissive meshes get imported differently (never instanced, one light per triangle)
+		if (bsdf->is_emissive != was_emissive) return false;
+		lights_changed |= bsdf->is_emissive;
+		TRACE("updated BSDF '%s'", name.c_str())
+	}
+
+	// transforms
+	for (auto& mesh : scene_meshes) {
+		glm::mat4 o2w = mesh.mesh_object->object_to_world();
+		if (o2w == mesh.o2w) continue;
+		mesh.o2w = o2w;
+		moved = true;
+		// mesh lights are weighted by their triangles' area, which scaling changes
+		lights_changed |= mesh.mesh_object->bsdf->is_emissive;
+
+		if (mesh.instance >= 0) {
+			auto& instance = instances[mesh.instance];
+			instance = Instance(instance.blas, o2w);
+			continue;
+		}
+		// not instanced: transform this mesh's triangles again, in place (mesh lights point to them)
+		MeshImport import = {
+			.mesh_object = mesh.mesh_object,
+			.vertices = mesh.mesh_object->mesh->get_vertices(),
+			.indices = mesh.mesh_object->mesh->get_indices(),
+			.o2w = o2w,
+			.bsdf = mesh.mesh_object->bsdf,
+			.first_triangle = mesh.first_triangle,
+			.num_triangles = mesh.mesh_object->mesh->get_num_indices() / 3,
+			.first_light = -1,
+			.blas = -1,
+			.instance = -1
+		};
+		const uint32_t triangles_per_job = 4096;
+		uint32_t num_jobs = (import.num_triangles + triangles_per_job - 1) / triangles_per_job;
+		myn::WorkerPool::shared().parallel_for(num_jobs, [&](uint32_t job) {
+			uint32_t end = std::min((job + 1) * triangles_per_job, import.num_triangles);
+			for (uint32_t t = job * triangles_per_job; t < end; t++) {
+				triangles[import.first_triangle + t] = load_triangle(import, t, o2w);
+			}
+		});
+	}
+
+	// the bvh keeps its structure, only bounds get updated. Gets worse the further things move, but reloading fixes that
+	if (moved) bvh->refit();
+	if (lights_changed) update_light_weights();
+	replicate_scene_per_numa_node();
+	return true;
+}
+
+#define BVH_CACHE_MAGIC 0x48564231 // "1BVH"
+
+uint64_t Pathtracer::hash_primitives() const {
+	// FNV-1a over all (world space) triangle vertices & instance bounds, in scene traversal order
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto hash_floats = [&hash](const float* floats, int count) {
+		auto words = reinterpret_cast<const uint32_t*>(floats);
+		for (int i = 0; i < count; i++) {
+			hash ^= words[i];
+			hash *= 0x100000001b3ull;
+		}
+	};
+	for (auto P : primitives) {
+		if (auto I = dynamic_cast<Instance*>(P)) {
+			// the top level bvh only depends on instance bounds
+			hash_floats(&I->min.x, 3);
+			hash_floats(&I->max.x, 3);
+		} else {
+			hash_floats(&dynamic_cast<Triangle*>(P)->vertices[0].x, 9);
+		}
+	}
+	return hash;
+}
+
+bool Pathtracer::load_bvh_cache(const std::string& path, uint64_t key) {
+	myn::MappedFile file(path);
+	if (!file.is_open()) return false;
+	myn::BinaryReader reader(file.data(), file.size());
+
+	if (reader.read<uint32_t>() != BVH_CACHE_MAGIC ||
+		reader.read<uint32_t>() != sizeof(BVH::FlatNode) ||
+		reader.read<uint64_t>() != key ||
+		reader.read<uint64_t>() != primitives.size())
+	{
+		return false;
+	}
+	uint64_t num_slots = 0;
+	auto permutation = reader.read_array<uint32_t>(num_slots);
+	uint64_t num_nodes = 0;
+	auto nodes = reader.read_array<BVH::FlatNode>(num_nodes);
+	if (!reader.ok() || num_slots != primitives.size()) return false;
+
+	std::vector<Primitive*> sorted_primitives(num_slots);
+	for (uint64_t i = 0; i < num_slots; i++) {
+		if (permutation[i] >= num_slots) return false;
+		sorted_primitives[i] = primitives[permutation[i]];
+	}
+	auto cached_bvh = BVH::unflatten(nodes, num_nodes, &primitives);
+	if (!cached_bvh) return false;
+
+	primitives = std::move(sorted_primitives);
+	delete bvh;
+	bvh = cached_bvh;
+	TRACE("loaded bvh from '%s' (%llu nodes)", path.c_str(), (unsigned long long)num_nodes)
+	return true;
+}
+
+void Pathtracer::save_bvh_cache(const std::string& path, uint64_t key, const std::vector<Primitive*>& unsorted_primitives) const {
+	std::unordered_map<Primitive*, uint32_t> original_index;
+	for (uint32_t i = 0; i < unsorted_primitives.size(); i++) original_index[unsorted_primitives[i]] = i;
+	std::vector<uint32_t> permutation(primitives.size());
+	for (uint32_t i = 0; i < primitives.size(); i++) permutation[i] = original_index[primitives[i]];
+
+	std::vector<BVH::FlatNode> nodes;
+	bvh->flatten(nodes);
+
+	myn::BinaryWriter writer;
+	writer.write((uint32_t)BVH_CACHE_MAGIC);
+	writer.write((uint32_t)sizeof(BVH::FlatNode));
+	writer.write(key);
+	writer.write((uint64_t)primitives.size());
+	writer.write_vector(permutation);
+	writer.write_vector(nodes);
+	if (writer.save(path)) {
+		TRACE("saved bvh to '%s' (%zu nodes)", path.c_str(), nodes.size())
+	}
+}
+
+void Pathtracer::replicate_scene_per_numa_node() {
+
+	clear_scene_replicas();
+
+	uint32_t num_nodes = myn::cpu_topology().num_nodes();
+	if (!cached_config.ReplicatePerNumaNode || num_nodes < 2 || !bvh) return;
+
+	PROFILE_SCOPE("replicate scene per NUMA node")
+	TIMER_BEGIN
+	scene_replicas.resize(num_nodes);
+	std::vector<std::thread> replicate_threads;
+	for (uint32_t node = 0; node < num_nodes; node++) {
+		replicate_threads.emplace_back([this, node]() {
+			// allocate and fill from a thread running on the target node, so pages get first-touched there
+			myn::pin_current_thread_to_node(node);
+			auto replica = new SceneReplica();
+			replica->triangles = triangles;
+			replica->instances = instances;
+			replica->primitives.resize(primitives.size());
+			for (size_t i = 0; i < primitives.size(); i++) {
+				// same order as the original, which the bvh refers to
+				if (auto T = dynamic_cast<Triangle*>(primitives[i])) {
+					replica->primitives[i] = &replica->triangles[T - triangles.data()];
+				} else {
+					replica->primitives[i] = &replica->instances[static_cast<Instance*>(primitives[i]) - instances.data()];
+				}
+			}
+			replica->bvh = bvh->clone(&replica->primitives);
+			scene_replicas[node] = replica;
+		});
+	}
+	for (auto& t : replicate_threads) t.join();
+	TIMER_END(duration)
+
+	TRACE("replicated scene to %u NUMA nodes (took %f seconds)", num_nodes, duration)
+}
+
+void Pathtracer::clear_scene_replicas() {
+	for (auto replica : scene_replicas) {
+		delete replica->bvh;
+		delete replica;
+	}
+	scene_replicas.clear();
+}
+
+BVH* Pathtracer::local_bvh() {
+	if (scene_replicas.empty()) return bvh;
+	return scene_replicas[myn::current_thread_numa_node()]->bvh;
 }
 
 void Pathtracer::reset() {
@@ -500,6 +880,13 @@ void Pathtracer::render(VkCommandBuffer cmdbuf)
 		reload_scene(drawable);
 		reset();
 	}
+	else if (scene_changed()) {
+		// small edits (transforms, materials): no need to rebuild everything
+		clear_tasks_and_threads_begin();
+		clear_tasks_and_threads_wait();
+		if (!update_scene()) reload_scene(drawable);
+		reset();
+	}
 
 	// update
 	if (cached_config.Multithreaded && !cached_config.ISPC) // multithreaded c++
@@ -62,8 +62,12 @@ private:
 	struct {
 		int ISPC = 0;
 		int UseBVH = 1;
+		int CacheBVH = 1;
+		int Instancing = 1;
 		int Multithreaded = 0; // initially 0 so if set to >0 by config file, will create the threads
 		int NumThreads = 0;
+		int PinThreads = 0;
+		int ReplicatePerNumaNode = 0;
 		int TileSize = 16;
 		int UseDirectLight = 1;
 		int DirectLightSamples = 2;
@@ -94,7 +98,11 @@ private:
 	uint32_t rendered_tiles;
 
 	// scene
-	std::vector<Primitive*> primitives;
+	std::vector<Triangle> triangles; // storage for all primitives, in scene traversal order
+	std::vector<Primitive*> primitives; // points into triangles & instances, in bvh order
+	// meshes that show up more than once: triangles are stored once per unique mesh, in object space
+	std::vector<BLAS*> blases;
+	std::vector<Instance> instances;
 	struct LightAndWeight {
 		PathtracerLight* light;
 		float cumulative_weight;
@@ -108,6 +116,36 @@ private:
 	myn::sky::CpuSkyAtmosphere* cpuSky = nullptr;
 	BVH* bvh = nullptr;
 	void reload_scene(SceneObject *scene);
+	void update_light_weights();
+
+	// what each mesh got imported with, so small edits can be applied without a full reload_scene
+	struct SceneMesh {
+		MeshObject* mesh_object;
+		glm::mat4 o2w;
+		uint32_t first_triangle; // into triangles, if not instanced
+		int instance; // into instances, -1 if not instanced
+	};
+	std::vector<SceneMesh> scene_meshes;
+	bool scene_changed() const;
+	// moved meshes get re-transformed (or their instance updated) and the bvh refit; edited materials are updated in place.
+	// Returns false if the change needs a full reload (a material became emissive or stopped being so)
+	bool update_scene();
+
+	// per-NUMA-node copies of triangles and bvh, so each worker traverses memory local to its node
+	struct SceneReplica {
+		std::vector<Triangle> triangles;
+		std::vector<Instance> instances; // still refer to the shared BLASes
+		std::vector<Primitive*> primitives;
+		BVH* bvh = nullptr;
+	};
+	std::vector<SceneReplica*> scene_replicas;
+	// the built bvh + primitive order gets saved next to the scene file, and reused if the triangles didn't change
+	uint64_t hash_primitives() const;
+	bool load_bvh_cache(const std::string& path, uint64_t key);
+	void save_bvh_cache(const std::string& path, uint64_t key, const std::vector<Primitive*>& unsorted_primitives) const;
+	void replicate_scene_per_numa_node();
+	void clear_scene_replicas();
+	BVH* local_bvh();
 	uint32_t scene_version = 0;
 
 	ISPC_Data* ispc_data = nullptr;
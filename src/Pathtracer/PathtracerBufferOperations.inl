@@ -179,6 +179,7 @@ vec3 gamma_correct(vec3 in) {
 }
 
 void Pathtracer::raytrace_tile(uint32_t tid, uint32_t tile_index) {
+	PROFILE_SCOPE("pathtracer tile")
 	uint32_t X = tile_index % tiles_X;
 	uint32_t Y = tile_index / tiles_X;
 
@@ -263,13 +264,15 @@ void Pathtracer::upload_rows(uint32_t begin, uint32_t rows)
 
 void Pathtracer::upload_tile(uint32_t subbuf_index, uint32_t begin_x, uint32_t begin_y, uint32_t w, uint32_t h)
 {
+	PROFILE_SCOPE("pathtracer tile upload")
 	unsigned char* buffer = subimage_buffers[subbuf_index];
 	vk::uploadPixelsToImage(
 		buffer,
 		begin_x, begin_y,
 		w, h,
 		NUM_CHANNELS *SIZE_PER_CHANNEL,
-		window_surface->resource
+		window_surface->resource,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL // the rest was uploaded in reset()
 	);
 }
 
@@ -334,6 +337,7 @@ void Pathtracer::raytrace_scene_to_buf() {
 				tasks.enqueue(i);
 			}
 			std::function<void(int)> raytrace_task = [&](int tid){
+				if (cached_config.PinThreads || !scene_replicas.empty()) myn::pin_current_thread(tid);
 				uint task_begin;
 				while (tasks.dequeue(task_begin))
 				{
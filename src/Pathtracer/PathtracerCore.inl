@@ -209,7 +209,7 @@ void Pathtracer::trace_ray(RayTask& task, int ray_depth, bool debug) {
 
 	// info of closest hit
 	double t; vec3 n;
-	Primitive* primitive = bvh->intersect_primitives(ray, t, n, cached_config.UseBVH);
+	Primitive* primitive = local_bvh()->intersect_primitives(ray, t, n, cached_config.UseBVH);
 
 	if (primitive) { // intersected with at least 1 primitive (has valid t, n, bsdf)
 
@@ -259,7 +259,7 @@ void Pathtracer::trace_ray(RayTask& task, int ray_depth, bool debug) {
 					double tmp_t;
 					vec3 tmp_n;
 					bool in_shadow =
-						bvh->intersect_primitives(ray_to_light, tmp_t, tmp_n, cached_config.UseBVH) != nullptr;
+						local_bvh()->intersect_primitives(ray_to_light, tmp_t, tmp_n, cached_config.UseBVH) != nullptr;
 					if (!in_shadow) {
 						wi_world = ray_to_light.d;
 						wi_hemi = w2h * wi_world;
@@ -34,6 +34,8 @@ struct Primitive {
 
 struct Triangle : public Primitive {
 
+	Triangle() = default;
+
 	// bsdf gets passed in from mesh, and will be cleaned up by mesh as well.
 	Triangle(const glm::mat4& o2w, const Vertex& v1, const Vertex& v2, const Vertex& v3, BSDF* _bsdf);
 
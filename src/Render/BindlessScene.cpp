@@ -0,0 +1,353 @@
+#include "BindlessScene.h"
+#include "Render/RenderList.h"
+#include "Render/Mesh.h"
+#include "Render/Texture.h"
+#include "Render/Materials/GltfMaterial.h"
+#include "Render/Vulkan/Vulkan.hpp"
+#include "Render/Vulkan/VulkanUtils.h"
+#include "Render/Vulkan/PipelineBuilder.h"
+#include "Render/Vulkan/SamplerCache.h"
+#include "Scene/MeshObject.h"
+#include "Utils/myn/Log.h"
+#include <algorithm>
+
+#define BINDLESS_BINDING_MATERIALS 0
+#define BINDLESS_BINDING_DRAWS 1
+#define BINDLESS_BINDING_TEXTURES 2
+
+BindlessScene::BindlessScene(
+	VkRenderPass compatibleRenderPass,
+	uint32_t compatibleSubpass,
+	const DescriptorSetLayout &frameGlobalSetLayout)
+	: compatibleRenderPass(compatibleRenderPass),
+	  compatibleSubpass(compatibleSubpass),
+	  frameGlobalSetLayout(frameGlobalSetLayout)
+{
+	auto vk = Vulkan::Instance;
+	ASSERT(vk->bindlessSupported)
+	maxMaterials = std::min<uint32_t>(BINDLESS_MAX_MATERIALS, vk->maxBindlessTextures / 4);
+	uint32_t maxTextures = maxMaterials * 4;
+
+	setLayout.addBinding(BINDLESS_BINDING_MATERIALS, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	setLayout.addBinding(BINDLESS_BINDING_DRAWS, VK_SHADER_STAGE_VERTEX_BIT, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	// only the slots of registered materials are ever written, and they change while older frames are still in flight
+	setLayout.addBinding(BINDLESS_BINDING_TEXTURES, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		maxTextures, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+	uint32_t numSets = vk->getMaxFramesInFlight();
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * numSets },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxTextures * numSets }
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets = numSets,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	EXPECT(vkCreateDescriptorPool(vk->device, &poolInfo, nullptr, &descriptorPool), VK_SUCCESS)
+
+	std::vector<VkDescriptorSetLayout> layouts(numSets, setLayout.getLayout());
+	VkDescriptorSetAllocateInfo allocInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = descriptorPool,
+		.descriptorSetCount = numSets,
+		.pSetLayouts = layouts.data()
+	};
+	descriptorSets.resize(numSets);
+	EXPECT(vkAllocateDescriptorSets(vk->device, &allocInfo, descriptorSets.data()), VK_SUCCESS)
+	imageVersions.resize(numSets, std::vector<std::array<uint32_t, 4>>(maxMaterials));
+
+	materialBuffer = VmaBuffer({&vk->memoryAllocator,
+							   sizeof(MaterialData) * maxMaterials,
+							   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							   VMA_MEMORY_USAGE_CPU_TO_GPU,
+							   "Bindless material buffer"});
+	for (auto set : descriptorSets)
+	{
+		VkDescriptorBufferInfo bufferInfo = {
+			.buffer = materialBuffer.getBufferInstance(),
+			.offset = 0,
+			.range = VK_WHOLE_SIZE
+		};
+		VkWriteDescriptorSet descriptorWrite = {
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = set,
+			.dstBinding = BINDLESS_BINDING_MATERIALS,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &bufferInfo
+		};
+		vkUpdateDescriptorSets(vk->device, 1, &descriptorWrite, 0, nullptr);
+	}
+
+	materialData.resize(maxMaterials, MaterialData{});
+	// handed out from the back, so lowest first
+	for (uint32_t i = maxMaterials; i > 0; i--) freeMaterialIndices.push_back(i - 1);
+
+	reserveDraws(256);
+}
+
+BindlessScene::~BindlessScene()
+{
+	auto vk = Vulkan::Instance;
+	materialBuffer.release();
+	drawBuffer.release();
+	indirectBuffer.release();
+	vkDestroyDescriptorPool(vk->device, descriptorPool, nullptr);
+}
+
+bool BindlessScene::addMaterial(const GltfMaterial *material)
+{
+	if (freeMaterialIndices.empty()) {
+		WARN("too many materials for bindless drawing (max %u), '%s' gets drawn one by one", maxMaterials, material->name.c_str())
+		return false;
+	}
+	uint32_t index = freeMaterialIndices.back();
+	freeMaterialIndices.pop_back();
+	materialIndices[material] = index;
+
+	// the buffer is a single stride, so it's written from the start (other materials' entries get what they already hold)
+	auto& params = material->getMaterialParams();
+	materialData[index] = {
+		.BaseColorFactor = params.BaseColorFactor,
+		.OcclusionRoughnessMetallicNormalStrengths = params.OcclusionRoughnessMetallicNormalStrengths,
+		.EmissiveFactorClipThreshold = params.EmissiveFactorClipThreshold,
+		._pad0 = params._pad0
+	};
+	materialBuffer.writeData(materialData.data(), (index + 1) * sizeof(MaterialData));
+
+	for (uint32_t i = 0; i < descriptorSets.size(); i++) writeTextures(i, index, material);
+	return true;
+}
+
+void BindlessScene::writeTextures(uint32_t setIndex, uint32_t index, const GltfMaterial *material)
+{
+	auto samplerInfo = SamplerCache::defaultInfo();
+	VkSampler sampler = SamplerCache::get(samplerInfo);
+	VkDescriptorImageInfo imageInfos[4];
+	auto& textures = material->getTextures();
+	for (uint32_t k = 0; k < 4; k++) {
+		imageInfos[k] = {
+			.sampler = sampler,
+			.imageView = textures[k]->imageView,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+		imageVersions[setIndex][index][k] = textures[k]->getImageVersion();
+	}
+	VkWriteDescriptorSet descriptorWrite = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = descriptorSets[setIndex],
+		.dstBinding = BINDLESS_BINDING_TEXTURES,
+		.dstArrayElement = index * 4,
+		.descriptorCount = 4,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = imageInfos
+	};
+	vkUpdateDescriptorSets(Vulkan::Instance->device, 1, &descriptorWrite, 0, nullptr);
+}
+
+void BindlessScene::removeMaterial(const GltfMaterial *material)
+{
+	auto iter = materialIndices.find(material);
+	if (iter == materialIndices.end()) return;
+	pendingFrees.push_back({ .index = iter->second, .frame = frameCounter });
+	materialIndices.erase(iter);
+}
+
+void BindlessScene::reserveDraws(uint32_t numDraws)
+{
+	if (numDraws <= drawCapacity) return;
+	auto vk = Vulkan::Instance;
+
+	uint32_t newCapacity = std::max(drawCapacity, 1u);
+	while (newCapacity < numDraws) newCapacity *= 2;
+
+	if (drawCapacity > 0)
+	{
+		vk->waitDeviceIdle();
+		drawBuffer.release();
+		indirectBuffer.release();
+	}
+	drawCapacity = newCapacity;
+
+	drawBuffer = VmaBuffer({&vk->memoryAllocator,
+						   sizeof(DrawData) * drawCapacity,
+						   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+						   VMA_MEMORY_USAGE_CPU_TO_GPU,
+						   "Bindless draw buffer",
+						   vk->getMaxFramesInFlight()});
+	indirectBuffer = VmaBuffer({&vk->memoryAllocator,
+							   sizeof(VkDrawIndexedIndirectCommand) * drawCapacity,
+							   VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+							   VMA_MEMORY_USAGE_CPU_TO_GPU,
+							   "Bindless indirect buffer",
+							   vk->getMaxFramesInFlight()});
+
+	for (uint32_t i = 0; i < descriptorSets.size(); i++)
+	{
+		VkDescriptorBufferInfo bufferInfo = {
+			.buffer = drawBuffer.getBufferInstance(i),
+			.offset = 0,
+			.range = VK_WHOLE_SIZE
+		};
+		VkWriteDescriptorSet descriptorWrite = {
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = descriptorSets[i],
+			.dstBinding = BINDLESS_BINDING_DRAWS,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &bufferInfo
+		};
+		vkUpdateDescriptorSets(vk->device, 1, &descriptorWrite, 0, nullptr);
+	}
+}
+
+void BindlessScene::update(const RenderList &renderList)
+{
+	auto vk = Vulkan::Instance;
+
+	// slots removed at least a full round of frames in flight ago can't be in use anymore
+	frameCounter++;
+	auto freedEnd = std::partition(pendingFrees.begin(), pendingFrees.end(), [&](const PendingFree& pending) {
+		return pending.frame + vk->getMaxFramesInFlight() >= frameCounter;
+	});
+	for (auto it = freedEnd; it != pendingFrees.end(); it++) freeMaterialIndices.push_back(it->index);
+	pendingFrees.erase(freedEnd, pendingFrees.end());
+
+	// this frame's set isn't in use anymore: catch up with the textures that swapped their image since it last was
+	uint32_t setIndex = vk->getCurrentFrameIndex();
+	for (auto& [material, index] : materialIndices)
+	{
+		auto& textures = material->getTextures();
+		auto& versions = imageVersions[setIndex][index];
+		for (uint32_t k = 0; k < 4; k++) {
+			if (versions[k] != textures[k]->getImageVersion()) {
+				writeTextures(setIndex, index, material);
+				break;
+			}
+		}
+	}
+
+	// group by what can't change within one indirect draw; within a batch, draws stay in the order they were sorted in
+	fallbackDraws.clear();
+	for (auto& batch : batches) batch.draws.clear();
+	for (uint32_t i = 0; i < renderList.opaqueDraws.size(); i++)
+	{
+		auto& record = renderList.records[renderList.opaqueDraws[i]];
+		auto material = static_cast<const GltfMaterial*>(renderList.materialSlots[record.materialSlot].material);
+		if (!materialIndices.contains(material)) {
+			fallbackDraws.push_back(renderList.opaqueDraws[i]);
+			continue;
+		}
+		auto& gpuData = record.meshObject->mesh->gpu_data;
+		bool doubleSided = material->isDoubleSided();
+		VkBuffer vertexBuffer = gpuData.vertexBuffer->getBufferInstance();
+		VkBuffer indexBuffer = gpuData.indexBuffer->getBufferInstance();
+
+		auto batch = std::find_if(batches.begin(), batches.end(), [&](const Batch& b) {
+			return b.doubleSided == doubleSided && b.vertexBuffer == vertexBuffer && b.indexBuffer == indexBuffer;
+		});
+		if (batch == batches.end()) {
+			batch = batches.insert(batches.end(), Batch{
+				.doubleSided = doubleSided, .vertexBuffer = vertexBuffer, .indexBuffer = indexBuffer });
+		}
+		batch->draws.push_back(i);
+	}
+	std::erase_if(batches, [](const Batch& batch) { return batch.draws.empty(); });
+
+	uint32_t numDraws = renderList.opaqueDraws.size() - fallbackDraws.size();
+	reserveDraws(numDraws);
+	drawData.resize(numDraws);
+	commands.resize(numDraws);
+	uint32_t drawIndex = 0;
+	for (auto& batch : batches)
+	{
+		batch.firstDraw = drawIndex;
+		for (auto i : batch.draws)
+		{
+			auto& record = renderList.records[renderList.opaqueDraws[i]];
+			auto material = static_cast<const GltfMaterial*>(renderList.materialSlots[record.materialSlot].material);
+			auto mesh = record.meshObject->mesh;
+			drawData[drawIndex] = {
+				.ModelMatrix = record.meshObject->object_to_world(),
+				.MaterialIndex = materialIndices.at(material)
+			};
+			commands[drawIndex] = {
+				.indexCount = mesh->get_num_indices(),
+				.instanceCount = 1,
+				.firstIndex = uint32_t(mesh->gpu_data.indexBufferOffsetBytes / sizeof(VERTEX_INDEX_TYPE)),
+				.vertexOffset = int32_t(mesh->gpu_data.vertexBufferOffsetBytes / sizeof(Vertex)),
+				.firstInstance = drawIndex // how the shaders find their DrawData
+			};
+			drawIndex++;
+		}
+	}
+
+	uint32_t frame = vk->getCurrentFrameIndex();
+	if (numDraws > 0) {
+		drawBuffer.writeData(drawData.data(), numDraws * sizeof(DrawData), frame);
+		indirectBuffer.writeData(commands.data(), numDraws * sizeof(VkDrawIndexedIndirectCommand), frame);
+	}
+}
+
+VkPipeline BindlessScene::getPipeline(bool doubleSided)
+{
+	auto& pipeline = pipelines[doubleSided ? 1 : 0];
+	if (pipeline == VK_NULL_HANDLE)
+	{
+		auto vk = Vulkan::Instance;
+
+		GraphicsPipelineBuilder pipelineBuilder{};
+		pipelineBuilder.vertPath = "spirv/geometry_bindless.vert.spv";
+		pipelineBuilder.fragPath = "spirv/geometry_bindless.frag.spv";
+		pipelineBuilder.pipelineState.setExtent(vk->swapChainExtent.width, vk->swapChainExtent.height);
+		pipelineBuilder.pipelineState.rasterizationInfo.cullMode = doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+		pipelineBuilder.compatibleRenderPass = compatibleRenderPass;
+		pipelineBuilder.compatibleSubpass = compatibleSubpass;
+
+		pipelineBuilder.useDescriptorSetLayout(DSET_FRAMEGLOBAL, frameGlobalSetLayout);
+		pipelineBuilder.useDescriptorSetLayout(DSET_DYNAMIC, setLayout);
+
+		// same outputs as the regular geometry pass: the 4 G-buffers
+		auto blendInfo = pipelineBuilder.pipelineState.colorBlendAttachmentInfo;
+		const VkPipelineColorBlendAttachmentState blendInfoArray[4] = {blendInfo, blendInfo, blendInfo, blendInfo};
+		pipelineBuilder.pipelineState.colorBlendInfo.attachmentCount = 4;
+		pipelineBuilder.pipelineState.colorBlendInfo.pAttachments = blendInfoArray;
+
+		// both variants end up with the same layout
+		pipelineBuilder.build(pipeline, pipelineLayout);
+	}
+	return pipeline;
+}
+
+void BindlessScene::draw(VkCommandBuffer cmdbuf)
+{
+	if (batches.empty()) return;
+	uint32_t frame = Vulkan::Instance->getCurrentFrameIndex();
+
+	getPipeline(false);
+	vkCmdBindDescriptorSets(
+		cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, DSET_DYNAMIC, 1, &descriptorSets[frame], 0, nullptr);
+
+	VkPipeline lastPipeline = VK_NULL_HANDLE;
+	for (auto& batch : batches)
+	{
+		VkPipeline pipeline = getPipeline(batch.doubleSided);
+		if (pipeline != lastPipeline) {
+			vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			lastPipeline = pipeline;
+		}
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(cmdbuf, 0, 1, &batch.vertexBuffer, &offset);
+		vkCmdBindIndexBuffer(cmdbuf, batch.indexBuffer, 0, VK_INDEX_TYPE);
+		vkCmdDrawIndexedIndirect(
+			cmdbuf,
+			indirectBuffer.getBufferInstance(frame),
+			batch.firstDraw * sizeof(VkDrawIndexedIndirectCommand),
+			batch.draws.size(),
+			sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
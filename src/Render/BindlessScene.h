@@ -0,0 +1,112 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <unordered_map>
+#include <vector>
+#include "Render/Vulkan/Buffer.h"
+#include "Render/Vulkan/DescriptorSet.h"
+
+class GltfMaterial;
+class RenderList;
+
+#define BINDLESS_MAX_MATERIALS 1024 // 4 textures each
+
+/*
+ * Opaque gltf draws without per-draw binding: every registered material's parameters go in one storage buffer and its
+ * textures in one big sampler array (material i uses textures 4i to 4i + 3), so a single descriptor set (bound at
+ * DSET_DYNAMIC) serves all of them. Each frame, update() writes the visible draws' transforms and material indices to
+ * a storage buffer and their VkDrawIndexedIndirectCommand-s to an indirect buffer; draw() then issues one
+ * vkCmdDrawIndexedIndirect per batch of draws sharing cull mode and vertex / index buffers (there's one of each per
+ * scene asset). The shaders find their draw through gl_InstanceIndex (firstInstance is the draw's index).
+ * Needs the features checked for in Vulkan::bindlessSupported.
+ */
+class BindlessScene
+{
+public:
+	// pipelines are made for the given subpass, with frameGlobalSetLayout at DSET_FRAMEGLOBAL
+	BindlessScene(VkRenderPass compatibleRenderPass, uint32_t compatibleSubpass, const DescriptorSetLayout& frameGlobalSetLayout);
+	~BindlessScene();
+
+	// materials have to be registered before any draw using them shows up in update(), and removed before they're
+	// deleted. A removed material's slot is only given out again once the frames in flight that may use it are done.
+	// Returns false if all slots are taken: the material's draws are then left to the caller (see getFallbackDraws)
+	bool addMaterial(const GltfMaterial* material);
+	void removeMaterial(const GltfMaterial* material);
+
+	// fills this frame's draw and indirect buffers from renderList.opaqueDraws
+	void update(const RenderList& renderList);
+
+	// this frame's opaque draws (indices into renderList.records, in draw order) whose material has no slot, so update()
+	// left them out; they have to be drawn one by one
+	const std::vector<uint32_t>& getFallbackDraws() const { return fallbackDraws; }
+
+	// within the compatible subpass, with the frame globals already bound
+	void draw(VkCommandBuffer cmdbuf);
+
+	void warmUpPipelines() { getPipeline(false); getPipeline(true); }
+
+	uint32_t getNumMaterials() const { return uint32_t(materialIndices.size()); }
+	uint32_t getNumBatches() const { return uint32_t(batches.size()); }
+
+private:
+	struct MaterialData {
+		glm::vec4 BaseColorFactor;
+		glm::vec4 OcclusionRoughnessMetallicNormalStrengths;
+		glm::vec4 EmissiveFactorClipThreshold;
+		glm::vec4 _pad0;
+	};
+	struct DrawData {
+		glm::mat4 ModelMatrix;
+		uint32_t MaterialIndex;
+		uint32_t _pad0[3];
+	};
+	struct Batch {
+		bool doubleSided;
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+		uint32_t firstDraw = 0;
+		std::vector<uint32_t> draws; // indices into renderList.opaqueDraws
+	};
+
+	VkPipeline getPipeline(bool doubleSided);
+	// points a set's 4 texture slots of the material at index to its textures' current images
+	void writeTextures(uint32_t setIndex, uint32_t index, const GltfMaterial* material);
+	// (re-)creates the per-frame buffers (waiting for the device to be idle) so they hold at least numDraws
+	void reserveDraws(uint32_t numDraws);
+
+	VkRenderPass compatibleRenderPass;
+	uint32_t compatibleSubpass;
+	DescriptorSetLayout frameGlobalSetLayout;
+
+	DescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> descriptorSets; // one per frame in flight, since the draw buffers are
+	// per set and material index: the Texture2D::getImageVersion() its texture slots point to
+	std::vector<std::vector<std::array<uint32_t, 4>>> imageVersions;
+
+	VkPipeline pipelines[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE }; // back face culled, double sided
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+
+	uint32_t maxMaterials;
+	std::vector<MaterialData> materialData; // what's in materialBuffer
+	VmaBuffer materialBuffer;
+	std::unordered_map<const GltfMaterial*, uint32_t> materialIndices;
+	std::vector<uint32_t> freeMaterialIndices;
+	struct PendingFree {
+		uint32_t index;
+		uint64_t frame; // free once frameCounter gets past this
+	};
+	std::vector<PendingFree> pendingFrees;
+	uint64_t frameCounter = 0;
+
+	uint32_t drawCapacity = 0;
+	VmaBuffer drawBuffer; // DrawData, an instance per frame in flight
+	VmaBuffer indirectBuffer; // VkDrawIndexedIndirectCommand, an instance per frame in flight
+
+	// the current frame's
+	std::vector<Batch> batches;
+	std::vector<DrawData> drawData;
+	std::vector<VkDrawIndexedIndirectCommand> commands;
+	std::vector<uint32_t> fallbackDraws;
+};
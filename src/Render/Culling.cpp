@@ -0,0 +1,413 @@
+#include "Culling.h"
+#include "Render/Mesh.h"
+#include "Utils/myn/Threading.h"
+#include <algorithm>
+#include <cmath>
+
+#define LEAF_BIT 0x80000000u
+#define EMPTY 0xffffffffu
+// below this many items, frustum culling isn't worth a parallel dispatch
+#define CULLING_PARALLEL_MIN_ITEMS 2048
+// rows of the occlusion buffer rasterized by one job
+#define OCCLUSION_BAND_HEIGHT 16
+// occluder vertices snap to 1/256 pixel; triangles reaching further off screen than this (in pixels) are skipped so the
+// fixed point math can't overflow
+#define OCCLUSION_SUBPIXELS 256
+#define OCCLUSION_MAX_COORD 1048576.0f
+
+using namespace glm;
+
+namespace
+{
+	vec3 centroid(const AABB& box) { return (box.min + box.max) * 0.5f; }
+}
+
+//-------- frustum --------
+
+FrustumPlanes::FrustumPlanes(const mat4 &worldToClip)
+{
+	vec4 rows[4];
+	for (int i = 0; i < 4; i++) rows[i] = vec4(worldToClip[0][i], worldToClip[1][i], worldToClip[2][i], worldToClip[3][i]);
+	planes[0] = rows[3] + rows[0]; // left
+	planes[1] = rows[3] - rows[0]; // right
+	planes[2] = rows[3] + rows[1]; // bottom
+	planes[3] = rows[3] - rows[1]; // top
+	planes[4] = rows[3] + rows[2]; // near
+	planes[5] = rows[3] - rows[2]; // far
+	for (auto& plane : planes) plane /= length(vec3(plane));
+}
+
+//-------- bvh --------
+
+void CullingBVH::build(const std::vector<AABB> &boxes)
+{
+	nodes.clear();
+	itemCount = boxes.size();
+	if (boxes.empty()) return;
+	std::vector<uint32_t> items(boxes.size());
+	for (uint32_t i = 0; i < items.size(); i++) items[i] = i;
+	buildNode(items.data(), items.size(), boxes);
+}
+
+void CullingBVH::setLane(Node &node, uint32_t lane, const AABB &box)
+{
+	node.minX[lane] = box.min.x; node.minY[lane] = box.min.y; node.minZ[lane] = box.min.z;
+	node.maxX[lane] = box.max.x; node.maxY[lane] = box.max.y; node.maxZ[lane] = box.max.z;
+}
+
+uint32_t CullingBVH::buildNode(uint32_t *items, uint32_t count, const std::vector<AABB> &boxes)
+{
+	// split in half by centroid along the longest axis, twice, for up to 4 groups
+	auto split = [&](uint32_t begin, uint32_t end) {
+		AABB bounds;
+		for (uint32_t i = begin; i < end; i++) bounds.add_point(centroid(boxes[items[i]]));
+		vec3 extent = bounds.max - bounds.min;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		uint32_t mid = (begin + end) / 2;
+		std::nth_element(items + begin, items + mid, items + end, [&](uint32_t a, uint32_t b) {
+			return centroid(boxes[a])[axis] < centroid(boxes[b])[axis];
+		});
+		return mid;
+	};
+	uint32_t bounds[5];
+	uint32_t numGroups;
+	if (count <= 4) {
+		for (uint32_t i = 0; i <= count; i++) bounds[i] = i;
+		numGroups = count;
+	} else {
+		uint32_t mid = split(0, count);
+		bounds[0] = 0;
+		bounds[1] = split(0, mid);
+		bounds[2] = mid;
+		bounds[3] = split(mid, count);
+		bounds[4] = count;
+		numGroups = 4;
+	}
+
+	uint32_t nodeIndex = nodes.size();
+	nodes.emplace_back();
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		if (lane >= numGroups) {
+			setLane(nodes[nodeIndex], lane, AABB());
+			nodes[nodeIndex].children[lane] = EMPTY;
+			continue;
+		}
+		uint32_t begin = bounds[lane], end = bounds[lane + 1];
+		AABB groupBounds;
+		for (uint32_t i = begin; i < end; i++) groupBounds.merge(boxes[items[i]]);
+		// (nodes can get reallocated while building the child)
+		uint32_t child = end - begin == 1 ? items[begin] | LEAF_BIT : buildNode(items + begin, end - begin, boxes);
+		setLane(nodes[nodeIndex], lane, groupBounds);
+		nodes[nodeIndex].children[lane] = child;
+	}
+	return nodeIndex;
+}
+
+void CullingBVH::refit(const std::vector<AABB> &boxes)
+{
+	if (boxes.size() != itemCount) {
+		build(boxes);
+		return;
+	}
+	// children come after their parents
+	for (size_t n = nodes.size(); n-- > 0;)
+	{
+		auto& node = nodes[n];
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			uint32_t child = node.children[lane];
+			if (child == EMPTY) continue;
+			if (child & LEAF_BIT) {
+				setLane(node, lane, boxes[child & ~LEAF_BIT]);
+				continue;
+			}
+			auto& childNode = nodes[child];
+			AABB bounds;
+			for (uint32_t i = 0; i < 4; i++) {
+				if (childNode.children[i] == EMPTY) continue;
+				bounds.add_point(vec3(childNode.minX[i], childNode.minY[i], childNode.minZ[i]));
+				bounds.add_point(vec3(childNode.maxX[i], childNode.maxY[i], childNode.maxZ[i]));
+			}
+			setLane(node, lane, bounds);
+		}
+	}
+}
+
+void CullingBVH::testNode(const Node &node, const FrustumPlanes &frustum, uint32_t &inside, uint32_t &outside) const
+{
+	bool laneInside[4] = { true, true, true, true };
+	bool laneOutside[4] = { false, false, false, false };
+	for (auto& plane : frustum.planes)
+	{
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			// corners furthest along / against the plane's normal
+			float farX = plane.x > 0 ? node.maxX[lane] : node.minX[lane];
+			float farY = plane.y > 0 ? node.maxY[lane] : node.minY[lane];
+			float farZ = plane.z > 0 ? node.maxZ[lane] : node.minZ[lane];
+			float nearX = plane.x > 0 ? node.minX[lane] : node.maxX[lane];
+			float nearY = plane.y > 0 ? node.minY[lane] : node.maxY[lane];
+			float nearZ = plane.z > 0 ? node.minZ[lane] : node.maxZ[lane];
+			laneOutside[lane] |= plane.x * farX + plane.y * farY + plane.z * farZ + plane.w < 0;
+			laneInside[lane] &= plane.x * nearX + plane.y * nearY + plane.z * nearZ + plane.w >= 0;
+		}
+	}
+	inside = outside = 0;
+	for (uint32_t lane = 0; lane < 4; lane++) {
+		if (node.children[lane] == EMPTY || laneOutside[lane]) outside |= 1u << lane;
+		else if (laneInside[lane]) inside |= 1u << lane;
+	}
+}
+
+void CullingBVH::appendAll(uint32_t child, std::vector<uint32_t> &visible) const
+{
+	if (child & LEAF_BIT) {
+		visible.push_back(child & ~LEAF_BIT);
+		return;
+	}
+	for (uint32_t grandchild : nodes[child].children) {
+		if (grandchild != EMPTY) appendAll(grandchild, visible);
+	}
+}
+
+void CullingBVH::cullNode(uint32_t nodeIndex, const FrustumPlanes &frustum, std::vector<uint32_t> &visible) const
+{
+	uint32_t stack[64];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = nodeIndex;
+	while (stackSize > 0)
+	{
+		auto& node = nodes[stack[--stackSize]];
+		uint32_t inside, outside;
+		testNode(node, frustum, inside, outside);
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			uint32_t child = node.children[lane];
+			if (outside & (1u << lane)) continue;
+			if ((inside & (1u << lane)) || (child & LEAF_BIT)) appendAll(child, visible);
+			else stack[stackSize++] = child;
+		}
+	}
+}
+
+void CullingBVH::cull(const FrustumPlanes &frustum, std::vector<uint32_t> &visible) const
+{
+	if (nodes.empty()) return;
+	if (itemCount < CULLING_PARALLEL_MIN_ITEMS) {
+		cullNode(0, frustum, visible);
+		return;
+	}
+
+	// open up the top of the tree until there are enough subtrees to spread over the workers
+	uint32_t wanted = myn::WorkerPool::shared().num_threads() * 4 + 4;
+	std::vector<uint32_t> subtrees = { 0 };
+	size_t head = 0;
+	while (head < subtrees.size() && subtrees.size() - head < wanted)
+	{
+		auto& node = nodes[subtrees[head++]];
+		uint32_t inside, outside;
+		testNode(node, frustum, inside, outside);
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			uint32_t child = node.children[lane];
+			if (outside & (1u << lane)) continue;
+			if ((inside & (1u << lane)) || (child & LEAF_BIT)) appendAll(child, visible);
+			else subtrees.push_back(child);
+		}
+	}
+	subtrees.erase(subtrees.begin(), subtrees.begin() + head);
+
+	std::vector<std::vector<uint32_t>> results(subtrees.size());
+	myn::WorkerPool::shared().parallel_for(subtrees.size(), [&](uint32_t i) {
+		cullNode(subtrees[i], frustum, results[i]);
+	});
+	for (auto& result : results) visible.insert(visible.end(), result.begin(), result.end());
+}
+
+//-------- occlusion --------
+
+void OcclusionBuffer::begin(const mat4 &inWorldToClip, uint32_t inWidth, uint32_t inHeight)
+{
+	worldToClip = inWorldToClip;
+	width = inWidth;
+	height = inHeight;
+	occluders.clear();
+	numTriangles = 0;
+
+	levels.clear();
+	for (uint32_t w = width, h = height;; w = (w + 1) / 2, h = (h + 1) / 2) {
+		levels.push_back({ w, h, std::vector<float>(size_t(w) * h, 0.0f) });
+		if (w == 1 && h == 1) break;
+	}
+}
+
+void OcclusionBuffer::addOccluder(const Mesh *mesh, const mat4 &objectToWorld)
+{
+	occluders.push_back({ mesh, worldToClip * objectToWorld });
+	numTriangles += mesh->get_num_indices() / 3;
+}
+
+void OcclusionBuffer::setupTriangles(const Occluder &occluder, std::vector<Triangle> &triangles) const
+{
+	auto vertices = occluder.mesh->get_vertices();
+	auto indices = occluder.mesh->get_indices();
+	std::vector<vec4> clip(occluder.mesh->get_num_vertices());
+	for (uint32_t i = 0; i < clip.size(); i++) clip[i] = occluder.objectToClip * vec4(vertices[i].position, 1);
+
+	for (uint32_t i = 0; i + 2 < occluder.mesh->get_num_indices(); i += 3)
+	{
+		vec4 c[3] = { clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]] };
+		// anything crossing the near plane is skipped rather than clipped: occluders are optional
+		bool crossesNear = false;
+		for (auto& v : c) crossesNear |= v.w <= 0 || v.z < -v.w;
+		if (crossesNear) continue;
+		if ((c[0].x > c[0].w && c[1].x > c[1].w && c[2].x > c[2].w) ||
+			(c[0].x < -c[0].w && c[1].x < -c[1].w && c[2].x < -c[2].w) ||
+			(c[0].y > c[0].w && c[1].y > c[1].w && c[2].y > c[2].w) ||
+			(c[0].y < -c[0].w && c[1].y < -c[1].w && c[2].y < -c[2].w)) continue;
+
+		vec2 s[3];
+		float d[3];
+		int64_t x[3], y[3];
+		bool tooFar = false;
+		for (int k = 0; k < 3; k++) {
+			s[k] = (vec2(c[k]) / c[k].w * 0.5f + 0.5f) * vec2(width, height);
+			d[k] = 1.0f / c[k].w;
+			tooFar |= std::abs(s[k].x) > OCCLUSION_MAX_COORD || std::abs(s[k].y) > OCCLUSION_MAX_COORD;
+			x[k] = std::llround(s[k].x * OCCLUSION_SUBPIXELS);
+			y[k] = std::llround(s[k].y * OCCLUSION_SUBPIXELS);
+		}
+		if (tooFar) continue;
+		int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		if (area == 0) continue;
+		// both windings count, so open meshes seen from behind still occlude
+		if (area < 0) {
+			std::swap(s[1], s[2]);
+			std::swap(d[1], d[2]);
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			area = -area;
+		}
+
+		Triangle triangle;
+		for (int k = 0; k < 3; k++) {
+			// edge from vertex k to k + 1; positive on the side of the third vertex
+			int next = (k + 1) % 3;
+			triangle.edgeA[k] = -(y[next] - y[k]);
+			triangle.edgeB[k] = x[next] - x[k];
+			triangle.edgeC[k] = -(triangle.edgeA[k] * x[k] + triangle.edgeB[k] * y[k]);
+		}
+		// barycentric weight of vertex k is the edge across from it over the area
+		double toPixels = double(OCCLUSION_SUBPIXELS) / double(area);
+		float ddx = float((triangle.edgeA[1] * double(d[0]) + triangle.edgeA[2] * double(d[1]) + triangle.edgeA[0] * double(d[2])) * toPixels);
+		float ddy = float((triangle.edgeB[1] * double(d[0]) + triangle.edgeB[2] * double(d[1]) + triangle.edgeB[0] * double(d[2])) * toPixels);
+		triangle.depth = vec3(ddx, ddy, d[0] - ddx * s[0].x - ddy * s[0].y);
+		triangle.minX = std::max(0, int(std::floor(std::min({ s[0].x, s[1].x, s[2].x }))));
+		triangle.minY = std::max(0, int(std::floor(std::min({ s[0].y, s[1].y, s[2].y }))));
+		triangle.maxX = std::min(int(width) - 1, int(std::ceil(std::max({ s[0].x, s[1].x, s[2].x }))));
+		triangle.maxY = std::min(int(height) - 1, int(std::ceil(std::max({ s[0].y, s[1].y, s[2].y }))));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) continue;
+		triangles.push_back(triangle);
+	}
+}
+
+void OcclusionBuffer::rasterizeBand(uint32_t band, const std::vector<std::vector<Triangle>> &triangles)
+{
+	int bandMinY = band * OCCLUSION_BAND_HEIGHT;
+	int bandMaxY = std::min(int(height), bandMinY + OCCLUSION_BAND_HEIGHT) - 1;
+	auto& depth = levels[0].depth;
+	for (auto& occluderTriangles : triangles)
+	{
+		for (auto& triangle : occluderTriangles)
+		{
+			int minY = std::max(bandMinY, triangle.minY);
+			int maxY = std::min(bandMaxY, triangle.maxY);
+			// pixels whose centers are covered, at the farthest depth within them
+			float depthMargin = 0.5f * (std::abs(triangle.depth.x) + std::abs(triangle.depth.y));
+			for (int py = minY; py <= maxY; py++)
+			{
+				int64_t subY = int64_t(py) * OCCLUSION_SUBPIXELS + OCCLUSION_SUBPIXELS / 2;
+				int64_t subX = int64_t(triangle.minX) * OCCLUSION_SUBPIXELS + OCCLUSION_SUBPIXELS / 2;
+				int64_t e[3];
+				for (int k = 0; k < 3; k++) e[k] = triangle.edgeA[k] * subX + triangle.edgeB[k] * subY + triangle.edgeC[k];
+				for (int px = triangle.minX; px <= triangle.maxX; px++)
+				{
+					if (e[0] >= 0 && e[1] >= 0 && e[2] >= 0) {
+						float d = triangle.depth.x * (float(px) + 0.5f) + triangle.depth.y * (float(py) + 0.5f) + triangle.depth.z - depthMargin;
+						auto& texel = depth[size_t(py) * width + px];
+						texel = std::max(texel, d);
+					}
+					for (int k = 0; k < 3; k++) e[k] += triangle.edgeA[k] * OCCLUSION_SUBPIXELS;
+				}
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::finish()
+{
+	if (levels.empty()) return;
+	auto& pool = myn::WorkerPool::shared();
+
+	std::vector<std::vector<Triangle>> triangles(occluders.size());
+	pool.parallel_for(occluders.size(), [&](uint32_t i) {
+		setupTriangles(occluders[i], triangles[i]);
+	});
+	pool.parallel_for((height + OCCLUSION_BAND_HEIGHT - 1) / OCCLUSION_BAND_HEIGHT, [&](uint32_t band) {
+		rasterizeBand(band, triangles);
+	});
+
+	for (size_t l = 1; l < levels.size(); l++)
+	{
+		auto& src = levels[l - 1];
+		auto& dst = levels[l];
+		for (uint32_t y = 0; y < dst.height; y++) {
+			for (uint32_t x = 0; x < dst.width; x++) {
+				float farthest = INF;
+				for (uint32_t sy = y * 2; sy < std::min(y * 2 + 2, src.height); sy++) {
+					for (uint32_t sx = x * 2; sx < std::min(x * 2 + 2, src.width); sx++) {
+						farthest = std::min(farthest, src.depth[size_t(sy) * src.width + sx]);
+					}
+				}
+				dst.depth[size_t(y) * dst.width + x] = farthest;
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::isVisible(const AABB &box) const
+{
+	if (levels.empty()) return true;
+
+	vec2 screenMin(INF), screenMax(-INF);
+	float nearest = 0; // largest 1 / w of the box
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+		vec4 c = worldToClip * vec4(corner, 1);
+		if (c.w <= 0 || c.z < -c.w) return true; // reaches past the near plane
+		vec2 s = (vec2(c) / c.w * 0.5f + 0.5f) * vec2(width, height);
+		screenMin = min(screenMin, s);
+		screenMax = max(screenMax, s);
+		nearest = std::max(nearest, 1.0f / c.w);
+	}
+	if (screenMax.x < 0 || screenMax.y < 0 || screenMin.x >= float(width) || screenMin.y >= float(height)) return true;
+	int x0 = std::max(0, int(std::floor(screenMin.x)));
+	int y0 = std::max(0, int(std::floor(screenMin.y)));
+	int x1 = std::min(int(width) - 1, int(std::floor(screenMax.x)));
+	int y1 = std::min(int(height) - 1, int(std::floor(screenMax.y)));
+
+	// coarsest level where the box still only touches a few texels
+	uint32_t level = 0;
+	uint32_t size = std::max(x1 - x0, y1 - y0) + 1;
+	while (level + 1 < levels.size() && (size >> level) > 2) level++;
+
+	auto& l = levels[level];
+	for (int y = y0 >> level; y <= (y1 >> level); y++) {
+		for (int x = x0 >> level; x <= (x1 >> level); x++) {
+			if (l.depth[size_t(y) * l.width + x] <= nearest) return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Scene/AABB.hpp"
+
+struct Mesh;
+
+/*
+ * CPU visibility tests for the render list: a 4 wide BVH over world space boxes that gets frustum culled (in parallel
+ * for big scenes), and a small software depth buffer of large occluders with a hierarchical Z test on top. Boxes only
+ * get culled when they're entirely outside the frustum or behind occluders. Nothing here touches the gpu.
+ */
+
+// inward facing planes (xyz: normal, w: offset) of a world to clip matrix, with glm::perspective's [-1, 1] depth
+struct FrustumPlanes {
+	explicit FrustumPlanes(const glm::mat4& worldToClip);
+	glm::vec4 planes[6];
+};
+
+class CullingBVH
+{
+public:
+	// boxes[i] belongs to item i
+	void build(const std::vector<AABB>& boxes);
+
+	// keeps the tree as is and only updates its bounds (boxes has to have as many items as when it was built)
+	void refit(const std::vector<AABB>& boxes);
+
+	// appends the items whose boxes are at least partially inside, in no particular order
+	void cull(const FrustumPlanes& frustum, std::vector<uint32_t>& visible) const;
+
+	uint32_t numItems() const { return itemCount; }
+
+private:
+	// children are tested 4 at a time, with their bounds laid out per axis so the loops over them vectorize
+	struct Node {
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		uint32_t children[4]; // node index, item index | LEAF_BIT, or EMPTY
+	};
+
+	uint32_t buildNode(uint32_t* items, uint32_t count, const std::vector<AABB>& boxes);
+	void setLane(Node& node, uint32_t lane, const AABB& box);
+	// bit i of inside/outside: lane i is entirely inside/outside the frustum
+	void testNode(const Node& node, const FrustumPlanes& frustum, uint32_t& inside, uint32_t& outside) const;
+	void cullNode(uint32_t nodeIndex, const FrustumPlanes& frustum, std::vector<uint32_t>& visible) const;
+	void appendAll(uint32_t child, std::vector<uint32_t>& visible) const;
+
+	std::vector<Node> nodes; // parents before children
+	uint32_t itemCount = 0;
+};
+
+class OcclusionBuffer
+{
+public:
+	// clears the buffer and drops last frame's occluders
+	void begin(const glm::mat4& worldToClip, uint32_t width, uint32_t height);
+
+	// the mesh's triangles get rasterized by finish(); closed or not, they hide everything behind them
+	void addOccluder(const Mesh* mesh, const glm::mat4& objectToWorld);
+
+	// rasterizes the occluders (in horizontal bands, in parallel) and builds the depth pyramid
+	void finish();
+
+	// false if the box is entirely behind occluders (at the buffer's resolution: it can't see through gaps narrower
+	// than a pixel)
+	bool isVisible(const AABB& box) const;
+
+	uint32_t numOccluderTriangles() const { return numTriangles; }
+
+private:
+	struct Occluder {
+		const Mesh* mesh;
+		glm::mat4 objectToClip;
+	};
+
+	// screen space edge functions (inside where all are >= 0) and depth plane of a triangle. Edges are in fixed point,
+	// so edges shared by two triangles come out exactly the same and leave no cracks
+	struct Triangle {
+		int64_t edgeA[3], edgeB[3], edgeC[3]; // a * x + b * y + c, in subpixels
+		glm::vec3 depth; // 1 / w = a * x + b * y + c, in pixels
+		int minX, minY, maxX, maxY;
+	};
+
+	void setupTriangles(const Occluder& occluder, std::vector<Triangle>& triangles) const;
+	void rasterizeBand(uint32_t band, const std::vector<std::vector<Triangle>>& triangles);
+
+	glm::mat4 worldToClip = glm::mat4(1);
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<Occluder> occluders;
+	uint32_t numTriangles = 0;
+
+	// level 0 is the depth buffer; every level stores the farthest (smallest) 1 / w of its 2x2 texels below
+	struct Level {
+		uint32_t width, height;
+		std::vector<float> depth;
+	};
+	std::vector<Level> levels;
+};
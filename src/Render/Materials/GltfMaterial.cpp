@@ -11,19 +11,39 @@
 
 void GltfMaterial::setParameters(VkCommandBuffer cmdbuf, SceneObject *drawable)
 {
-	// per-material-instance renderingParams (static)
-	materialParamsBuffer.writeData(&materialParams, sizeof(materialParams));
+	setParameters(cmdbuf, drawable, allocateInstances(1));
+}
 
+void GltfMaterial::setParameters(VkCommandBuffer cmdbuf, SceneObject *drawable, uint32_t instance)
+{
 	// per-object renderingParams (dynamic)
-	uniforms = {
+	Uniforms uniforms = {
 		.ModelMatrix = drawable->object_to_world(),
 	};
-	uniformBuffer.writeData(&uniforms, 0, 0, instanceCounter);
+	uniformBuffer.writeData(&uniforms, sizeof(uniforms), 0, instance);
 
-	uint32_t offset = uniformBuffer.strideSize * instanceCounter;
-	dynamicSet.bind(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, DSET_DYNAMIC, getPipeline().layout, 0, 1, &offset);
+	uint32_t offset = uniformBuffer.strideSize * instance;
+	dynamicSet.bind(
+		cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, DSET_DYNAMIC, getPipeline().layout,
+		Vulkan::Instance->getCurrentFrameIndex(), 1, &offset);
+}
 
-	instanceCounter++;
+void GltfMaterial::updateTextureDescriptors()
+{
+	// the frames in flight may still use the other instances (and the images they point to)
+	uint32_t frameIndex = Vulkan::Instance->getCurrentFrameIndex();
+	auto& versions = imageVersions[frameIndex];
+	for (uint32_t k = 0; k < textures.size(); k++)
+	{
+		if (versions[k] == textures[k]->getImageVersion()) continue;
+		dynamicSet.pointInstanceToImageView(frameIndex, textures[k]->imageView, 2 + k, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		versions[k] = textures[k]->getImageVersion();
+	}
+}
+
+uint32_t GltfMaterial::allocateInstances(uint32_t count)
+{
+	return instanceCounter.fetch_add(count);
 }
 
 void GltfMaterial::usePipeline(VkCommandBuffer cmdbuf)
@@ -44,7 +64,7 @@ GltfMaterial::GltfMaterial(const GltfMaterialInfo &info)
 	this->name = info.name;
 	LOG("loading material '%s'..", name.c_str())
 	VkDeviceSize alignment = Vulkan::Instance->minUniformBufferOffsetAlignment;
-	uint32_t numBlocks = (sizeof(uniforms) + alignment - 1) / alignment;
+	uint32_t numBlocks = (sizeof(Uniforms) + alignment - 1) / alignment;
 
 	// TODO: dynamically get numStrides (num instances of that material)
 	std::string bufferName = "Material uniform buffer (" + info.name + ")";
@@ -71,13 +91,17 @@ GltfMaterial::GltfMaterial(const GltfMaterialInfo &info)
 		dynamicSetLayout.addBinding(3, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 		dynamicSetLayout.addBinding(4, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 		dynamicSetLayout.addBinding(5, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-		dynamicSet = DescriptorSet(dynamicSetLayout); // this commits the bindings
+		// an instance per frame in flight, so textures can change their image while older frames still sample the previous one
+		dynamicSet = DescriptorSet(dynamicSetLayout, Vulkan::Instance->getMaxFramesInFlight()); // this commits the bindings
 
 		// assign actual values to them
 		auto albedo = Texture::get<Texture2D>(info.albedoTexName);
 		auto normal = Texture::get<Texture2D>(info.normalTexName);
 		auto orm = Texture::get<Texture2D>(info.ormTexName);
 		auto emissive = Texture::get<Texture2D>(info.emissiveTexName);
+		textures = { albedo, normal, orm, emissive };
+		imageVersions.assign(Vulkan::Instance->getMaxFramesInFlight(), {
+			albedo->getImageVersion(), normal->getImageVersion(), orm->getImageVersion(), emissive->getImageVersion() });
 
 		materialParams.BaseColorFactor = info.BaseColorFactor;
 		materialParams.OcclusionRoughnessMetallicNormalStrengths = info.OcclusionRoughnessMetallicNormalStrengths;
@@ -87,6 +111,8 @@ GltfMaterial::GltfMaterial(const GltfMaterialInfo &info)
 			info.EmissiveFactor.b,
 			info.clipThreshold);
 		materialParams._pad0 = glm::vec4();
+		// per-material-instance renderingParams (static)
+		materialParamsBuffer.writeData(&materialParams, sizeof(materialParams));
 
 		dynamicSet.pointToBuffer(uniformBuffer, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 		dynamicSet.pointToBuffer(materialParamsBuffer, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
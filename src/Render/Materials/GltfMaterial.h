@@ -1,6 +1,8 @@
 #pragma once
 #include "Material.h"
 #include "GltfMaterialInfo.h"
+#include <array>
+#include <atomic>
 
 class Texture2D;
 
@@ -11,16 +13,34 @@ class GltfMaterial : public Material
 {
 public:
 	void setParameters(VkCommandBuffer cmdbuf, SceneObject* drawable) override;
+	void setParameters(VkCommandBuffer cmdbuf, SceneObject* drawable, uint32_t instance) override;
 	void usePipeline(VkCommandBuffer cmdbuf) override;
 	~GltfMaterial() override;
 
 	virtual void markPipelineDirty() = 0;
 
 	void resetInstanceCounter() override;
+	uint32_t allocateInstances(uint32_t count) override;
 
 	uint32_t getVersion() const { return cachedMaterialInfo._version; }
 
 	bool isOpaque() const { return cachedMaterialInfo.blendMode == BM_OpaqueOrClip; }
+	bool isDoubleSided() const { return cachedMaterialInfo.doubleSided; }
+
+	// static (per-material-instance)
+	struct MaterialParams {
+		glm::vec4 BaseColorFactor;
+		glm::vec4 OcclusionRoughnessMetallicNormalStrengths;
+		glm::vec4 EmissiveFactorClipThreshold;
+		glm::vec4 _pad0;
+	};
+	const MaterialParams& getMaterialParams() const { return materialParams; }
+	// albedo, normal, orm, emissive (in the order of the bindings)
+	const std::array<Texture2D*, 4>& getTextures() const { return textures; }
+
+	// main thread, before this frame's draws are recorded: re-points this frame's descriptors to the textures that
+	// changed their image since (see Texture2D::replaceMips)
+	void updateTextureDescriptors();
 
 protected:
 	explicit GltfMaterial(const GltfMaterialInfo& info);
@@ -32,21 +52,18 @@ protected:
 private:
 
 	// dynamic (per-object)
-	struct {
+	struct Uniforms {
 		glm::mat4 ModelMatrix;
-	} uniforms;
+	};
 	VmaBuffer uniformBuffer;
 
-	// static (per-material-instance)
-	struct {
-		glm::vec4 BaseColorFactor;
-		glm::vec4 OcclusionRoughnessMetallicNormalStrengths;
-		glm::vec4 EmissiveFactorClipThreshold;
-		glm::vec4 _pad0;
-	} materialParams;
+	MaterialParams materialParams;
 	VmaBuffer materialParamsBuffer;
+	std::array<Texture2D*, 4> textures;
+	// what each dynamicSet instance (one per frame in flight) points to, as Texture2D::getImageVersion()
+	std::vector<std::array<uint32_t, 4>> imageVersions;
 
-	uint32_t instanceCounter = 0;
+	std::atomic<uint32_t> instanceCounter = 0;
 };
 
 class PbrGltfMaterial : public GltfMaterial
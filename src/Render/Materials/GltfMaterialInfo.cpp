@@ -35,3 +35,8 @@ GltfMaterialInfo *GltfMaterialInfo::get(const std::string &materialName)
 	}
 	return &iter->second;
 }
+
+void GltfMaterialInfo::forEach(const std::function<void(const GltfMaterialInfo&)>& fn)
+{
+	for (auto& p : gltfMaterialInfos) fn(p.second);
+}
@@ -3,6 +3,7 @@
 //
 #pragma once
 
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <glm/glm.hpp>
@@ -39,4 +40,5 @@ struct GltfMaterialInfo {
 
 	static void add(GltfMaterialInfo& info);
 	static GltfMaterialInfo* get(const std::string& materialName);
+	static void forEach(const std::function<void(const GltfMaterialInfo&)>& fn);
 };
@@ -29,6 +29,8 @@ public:
 	std::string name;
 
 	virtual void setParameters(VkCommandBuffer cmdbuf, SceneObject* drawable) {};
+	// same, with a per-object slot that was reserved with allocateInstances (for recording on several threads)
+	virtual void setParameters(VkCommandBuffer cmdbuf, SceneObject* drawable, uint32_t /*instance*/) { setParameters(cmdbuf, drawable); }
 	virtual void usePipeline(VkCommandBuffer cmdbuf) = 0;
 
 	virtual ~Material() = default;
@@ -37,4 +39,7 @@ public:
 
 	// materials with dynamic uniform buffers should implement this
 	virtual void resetInstanceCounter() {}
+
+	// reserves count consecutive per-object slots and returns the first one; thread safe
+	virtual uint32_t allocateInstances(uint32_t /*count*/) { return 0; }
 };
@@ -36,7 +36,7 @@ Mesh::Mesh(const std::string &in_name,
 
 const Vertex *Mesh::get_vertices() const
 {
-	return &(*cpu_data.vertices)[cpu_data.offset_num_vertices];
+	return cpu_data.vertices + cpu_data.offset_num_vertices;
 }
 
 uint32_t Mesh::get_num_vertices() const
@@ -46,10 +46,21 @@ uint32_t Mesh::get_num_vertices() const
 
 const VERTEX_INDEX_TYPE *Mesh::get_indices() const
 {
-	return &(*cpu_data.faces)[cpu_data.offset_num_indices];
+	return cpu_data.faces + cpu_data.offset_num_indices;
 }
 
 uint32_t Mesh::get_num_indices() const
 {
 	return cpu_data.num_indices;
 }
+
+const Mesh::Meshlet *Mesh::get_meshlets() const
+{
+	if (cpu_data.meshlets == nullptr) return nullptr;
+	return cpu_data.meshlets + cpu_data.offset_num_meshlets;
+}
+
+uint32_t Mesh::get_num_meshlets() const
+{
+	return cpu_data.num_meshlets;
+}
@@ -18,8 +18,8 @@ namespace tinygltf
 	struct Model;
 }
 
-#define VERTEX_INDEX_TYPE uint16_t
-#define VK_INDEX_TYPE VK_INDEX_TYPE_UINT16
+#define VERTEX_INDEX_TYPE uint32_t
+#define VK_INDEX_TYPE VK_INDEX_TYPE_UINT32
 
 struct Mesh {
 public:
@@ -30,13 +30,25 @@ public:
 
 	~Mesh() = default;
 
+	// a contiguous run of triangles within the mesh's index range, small enough to stay in the post-transform cache
+	struct Meshlet {
+		uint32_t offset_num_indices; // relative to the mesh's first index
+		uint32_t num_indices;
+		AABB bounds; // object space
+	};
+
+	// the mesh's range within its asset's combined buffers (which may be read in place from a memory-mapped cache)
 	struct CpuDataAccessor {
-		const std::vector<Vertex>* vertices;
+		const Vertex* vertices; // start of the combined buffer
 		uint32_t num_vertices;
 		uint32_t offset_num_vertices;
-		const std::vector<VERTEX_INDEX_TYPE>* faces;
+		const VERTEX_INDEX_TYPE* faces;
 		uint32_t num_indices;
 		uint32_t offset_num_indices;
+		// only filled in if meshes were optimized at load time (see OptimizeMeshes in global.ini)
+		const Meshlet* meshlets;
+		uint32_t num_meshlets;
+		uint32_t offset_num_meshlets;
 	};
 
 #if GRAPHICS_DISPLAY
@@ -59,6 +71,9 @@ public:
 	[[nodiscard]] const VERTEX_INDEX_TYPE* get_indices() const;
 	[[nodiscard]] uint32_t get_num_indices() const;
 
+	[[nodiscard]] const Meshlet* get_meshlets() const;
+	[[nodiscard]] uint32_t get_num_meshlets() const;
+
 	std::string materialName;
 
 	CpuDataAccessor cpu_data{};
@@ -0,0 +1,258 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace glm;
+
+namespace
+{
+	constexpr uint32_t CACHE_SIZE = 32;
+	constexpr uint32_t MAX_VALENCE = 32;
+
+	struct ScoreTables {
+		float cache[CACHE_SIZE];
+		float valence[MAX_VALENCE];
+		ScoreTables() {
+			// the 3 most recent vertices get a fixed score so the very last triangle's verts aren't favored too much
+			for (uint32_t i = 0; i < CACHE_SIZE; i++) {
+				cache[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / float(CACHE_SIZE - 3), 1.5f);
+			}
+			// boost vertices with few triangles left so they get finished off instead of lingering
+			valence[0] = 0;
+			for (uint32_t i = 1; i < MAX_VALENCE; i++) {
+				valence[i] = 2.0f * std::pow(float(i), -0.5f);
+			}
+		}
+	};
+
+	const ScoreTables& score_tables() {
+		static ScoreTables tables;
+		return tables;
+	}
+
+	float vertex_score(int32_t cache_pos, uint32_t remaining_triangles) {
+		if (remaining_triangles == 0) return -1.0f;
+		auto& tables = score_tables();
+		float score = cache_pos >= 0 ? tables.cache[cache_pos] : 0.0f;
+		return score + tables.valence[std::min(remaining_triangles, MAX_VALENCE - 1)];
+	}
+}
+
+namespace mesh_optimizer
+{
+	void optimize_vertex_cache(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices) {
+		uint32_t num_triangles = num_indices / 3;
+		if (num_triangles == 0) return;
+
+		// vertex -> triangles adjacency, packed
+		std::vector<uint32_t> remaining(num_vertices, 0);
+		for (uint32_t i = 0; i < num_indices; i++) remaining[indices[i]]++;
+		std::vector<uint32_t> adjacency_offset(num_vertices + 1, 0);
+		for (uint32_t v = 0; v < num_vertices; v++) adjacency_offset[v + 1] = adjacency_offset[v] + remaining[v];
+		std::vector<uint32_t> adjacency(num_indices);
+		{
+			std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+			for (uint32_t i = 0; i < num_indices; i++) adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<int32_t> cache_pos(num_vertices, -1);
+		std::vector<float> v_score(num_vertices);
+		for (uint32_t v = 0; v < num_vertices; v++) v_score[v] = vertex_score(-1, remaining[v]);
+
+		std::vector<float> t_score(num_triangles);
+		std::vector<bool> emitted(num_triangles, false);
+		int64_t best = 0;
+		for (uint32_t t = 0; t < num_triangles; t++) {
+			t_score[t] = v_score[indices[3*t]] + v_score[indices[3*t+1]] + v_score[indices[3*t+2]];
+			if (t_score[t] > t_score[best]) best = t;
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(num_indices);
+		uint32_t cache[CACHE_SIZE + 3];
+		uint32_t cache_count = 0;
+		uint32_t scan_cursor = 0;
+
+		while (output.size() < num_indices) {
+			if (best < 0) {
+				// nothing in the cache has triangles left: continue from the next triangle in input order
+				while (emitted[scan_cursor]) scan_cursor++;
+				best = scan_cursor;
+			}
+			emitted[best] = true;
+
+			uint32_t tri[3] = { indices[3*best], indices[3*best+1], indices[3*best+2] };
+			for (auto v : tri) {
+				output.push_back(v);
+				// remove the triangle from this vertex's adjacency
+				uint32_t begin = adjacency_offset[v];
+				uint32_t end = begin + remaining[v];
+				for (uint32_t i = begin; i < end; i++) {
+					if (adjacency[i] == best) {
+						std::swap(adjacency[i], adjacency[end - 1]);
+						remaining[v]--;
+						break;
+					}
+				}
+			}
+
+			// LRU update: this triangle's verts go to the front
+			uint32_t new_cache[CACHE_SIZE + 3];
+			uint32_t new_count = 0;
+			for (auto v : tri) {
+				if (std::find(new_cache, new_cache + new_count, v) == new_cache + new_count) new_cache[new_count++] = v;
+			}
+			for (uint32_t i = 0; i < cache_count; i++) {
+				uint32_t v = cache[i];
+				if (v != tri[0] && v != tri[1] && v != tri[2]) new_cache[new_count++] = v;
+			}
+
+			// rescore everything that was touched, including the verts that just got evicted
+			for (uint32_t i = 0; i < new_count; i++) {
+				uint32_t v = new_cache[i];
+				cache_pos[v] = i < CACHE_SIZE ? int32_t(i) : -1;
+				v_score[v] = vertex_score(cache_pos[v], remaining[v]);
+			}
+			best = -1;
+			float best_score = -1.0f;
+			for (uint32_t i = 0; i < new_count; i++) {
+				uint32_t v = new_cache[i];
+				for (uint32_t j = adjacency_offset[v]; j < adjacency_offset[v] + remaining[v]; j++) {
+					uint32_t t = adjacency[j];
+					t_score[t] = v_score[indices[3*t]] + v_score[indices[3*t+1]] + v_score[indices[3*t+2]];
+					if (t_score[t] > best_score) {
+						best_score = t_score[t];
+						best = t;
+					}
+				}
+			}
+
+			cache_count = std::min(new_count, CACHE_SIZE);
+			std::copy(new_cache, new_cache + cache_count, cache);
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	std::vector<Mesh::Meshlet> build_meshlets(
+		const Vertex* vertices, const uint32_t* indices, uint32_t num_indices, const Settings& settings)
+	{
+		std::vector<Mesh::Meshlet> meshlets;
+		if (num_indices == 0) return meshlets;
+
+		uint32_t max_index = *std::max_element(indices, indices + num_indices);
+		// which meshlet (+1) last referenced each vertex; avoids clearing a set per meshlet
+		std::vector<uint32_t> stamp(max_index + 1, 0);
+
+		Mesh::Meshlet current = { .offset_num_indices = 0, .num_indices = 0, .bounds = {} };
+		uint32_t current_vertices = 0;
+		for (uint32_t i = 0; i < num_indices; i += 3) {
+			uint32_t id = meshlets.size() + 1;
+			uint32_t new_vertices = 0;
+			for (uint32_t k = 0; k < 3; k++) {
+				if (stamp[indices[i+k]] != id) new_vertices++;
+			}
+			if (current.num_indices > 0 && (
+				current_vertices + new_vertices > settings.max_meshlet_vertices ||
+				current.num_indices / 3 + 1 > settings.max_meshlet_triangles))
+			{
+				meshlets.push_back(current);
+				current = { .offset_num_indices = i, .num_indices = 0, .bounds = {} };
+				current_vertices = 0;
+				id++;
+			}
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[i+k];
+				if (stamp[v] != id) {
+					stamp[v] = id;
+					current_vertices++;
+					current.bounds.add_point(vertices[v].position);
+				}
+			}
+			current.num_indices += 3;
+		}
+		meshlets.push_back(current);
+		return meshlets;
+	}
+
+	void optimize_overdraw(
+		const Vertex* vertices, uint32_t* indices, uint32_t num_indices, std::vector<Mesh::Meshlet>& meshlets)
+	{
+		if (meshlets.size() <= 1) return;
+
+		// area weighted centroid and normal per meshlet
+		std::vector<vec3> centroids(meshlets.size());
+		std::vector<vec3> normals(meshlets.size());
+		vec3 mesh_centroid(0);
+		float mesh_area = 0;
+		for (uint32_t m = 0; m < meshlets.size(); m++) {
+			vec3 centroid(0);
+			vec3 normal(0);
+			float area = 0;
+			for (uint32_t i = meshlets[m].offset_num_indices; i < meshlets[m].offset_num_indices + meshlets[m].num_indices; i += 3) {
+				vec3 p0 = vertices[indices[i]].position;
+				vec3 p1 = vertices[indices[i+1]].position;
+				vec3 p2 = vertices[indices[i+2]].position;
+				vec3 n = cross(p1 - p0, p2 - p0);
+				float a = length(n);
+				centroid += (p0 + p1 + p2) * (a / 3.0f);
+				normal += n;
+				area += a;
+			}
+			mesh_centroid += centroid;
+			mesh_area += area;
+			centroids[m] = area > 0 ? centroid / area : vertices[indices[meshlets[m].offset_num_indices]].position;
+			normals[m] = length(normal) > 0 ? normalize(normal) : vec3(0);
+		}
+		if (mesh_area > 0) mesh_centroid /= mesh_area;
+
+		std::vector<float> sort_keys(meshlets.size());
+		for (uint32_t m = 0; m < meshlets.size(); m++) {
+			sort_keys[m] = dot(centroids[m] - mesh_centroid, normals[m]);
+		}
+		std::vector<uint32_t> order(meshlets.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+		std::vector<uint32_t> reordered_indices(num_indices);
+		std::vector<Mesh::Meshlet> reordered_meshlets(meshlets.size());
+		uint32_t offset = 0;
+		for (uint32_t m = 0; m < order.size(); m++) {
+			auto& src = meshlets[order[m]];
+			std::copy(indices + src.offset_num_indices, indices + src.offset_num_indices + src.num_indices, &reordered_indices[offset]);
+			reordered_meshlets[m] = src;
+			reordered_meshlets[m].offset_num_indices = offset;
+			offset += src.num_indices;
+		}
+		std::copy(reordered_indices.begin(), reordered_indices.end(), indices);
+		meshlets = std::move(reordered_meshlets);
+	}
+
+	void optimize_vertex_fetch(Vertex* vertices, uint32_t num_vertices, uint32_t* indices, uint32_t num_indices) {
+		std::vector<uint32_t> remap(num_vertices, ~0u);
+		uint32_t next = 0;
+		for (uint32_t i = 0; i < num_indices; i++) {
+			uint32_t& r = remap[indices[i]];
+			if (r == ~0u) r = next++;
+			indices[i] = r;
+		}
+		// unreferenced vertices go to the end
+		for (auto& r : remap) {
+			if (r == ~0u) r = next++;
+		}
+		std::vector<Vertex> reordered(num_vertices);
+		for (uint32_t v = 0; v < num_vertices; v++) reordered[remap[v]] = vertices[v];
+		std::copy(reordered.begin(), reordered.end(), vertices);
+	}
+
+	std::vector<Mesh::Meshlet> optimize(
+		Vertex* vertices, uint32_t num_vertices, uint32_t* indices, uint32_t num_indices, const Settings& settings)
+	{
+		optimize_vertex_cache(indices, num_indices, num_vertices);
+		auto meshlets = build_meshlets(vertices, indices, num_indices, settings);
+		optimize_overdraw(vertices, indices, num_indices, meshlets);
+		// only renumbers vertices, so the meshlets stay valid
+		optimize_vertex_fetch(vertices, num_vertices, indices, num_indices);
+		return meshlets;
+	}
+}
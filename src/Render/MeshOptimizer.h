@@ -0,0 +1,34 @@
+#pragma once
+#include "Render/Mesh.h"
+#include <vector>
+
+/*
+ * Load-time index/vertex reordering for better GPU efficiency. Everything here works on one primitive
+ * at a time, with primitive-local indices (0 .. num_vertices).
+ */
+namespace mesh_optimizer
+{
+	struct Settings {
+		uint32_t max_meshlet_vertices = 64;
+		uint32_t max_meshlet_triangles = 124;
+	};
+
+	// reorder triangles for post-transform vertex cache hits (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+	void optimize_vertex_cache(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices);
+
+	// cut the (cache optimized) triangle stream into meshlets, in place
+	std::vector<Mesh::Meshlet> build_meshlets(
+		const Vertex* vertices, const uint32_t* indices, uint32_t num_indices, const Settings& settings);
+
+	// reorder meshlets so the ones facing away from the mesh center draw first, which tends to make
+	// closer, outward-facing surfaces occlude the rest (Sander et al. 2007). Rewrites indices and meshlet offsets.
+	void optimize_overdraw(
+		const Vertex* vertices, uint32_t* indices, uint32_t num_indices, std::vector<Mesh::Meshlet>& meshlets);
+
+	// renumber vertices in order of first use so vertex fetches walk memory linearly
+	void optimize_vertex_fetch(Vertex* vertices, uint32_t num_vertices, uint32_t* indices, uint32_t num_indices);
+
+	// all of the above, in order
+	std::vector<Mesh::Meshlet> optimize(
+		Vertex* vertices, uint32_t num_vertices, uint32_t* indices, uint32_t num_indices, const Settings& settings);
+}
@@ -0,0 +1,358 @@
+#include "RenderGraph.h"
+#include "Utils/myn/Log.h"
+#include <algorithm>
+
+namespace
+{
+	struct UsageInfo {
+		VkImageLayout layout;
+		VkPipelineStageFlags stages;
+		VkAccessFlags reads;
+		VkAccessFlags writes;
+		VkImageUsageFlags imageUsage;
+		bool readsContents;
+		bool attachment;
+	};
+
+	UsageInfo usageInfo(RenderGraph::Usage usage)
+	{
+		constexpr VkPipelineStageFlags depthStages =
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		switch (usage) {
+			case RenderGraph::ColorAttachment:
+			case RenderGraph::ColorAttachmentLoad:
+				return {
+					.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					.reads = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+					.writes = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+					.readsContents = usage == RenderGraph::ColorAttachmentLoad,
+					.attachment = true
+				};
+			case RenderGraph::DepthAttachment:
+			case RenderGraph::DepthAttachmentLoad:
+				return {
+					.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					.stages = depthStages,
+					.reads = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+					.writes = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					.imageUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+					.readsContents = usage == RenderGraph::DepthAttachmentLoad,
+					.attachment = true
+				};
+			case RenderGraph::InputAttachment:
+				return {
+					.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					.reads = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+					.writes = 0,
+					.imageUsage = VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
+					.readsContents = true,
+					.attachment = true
+				};
+			case RenderGraph::Sampled:
+				return {
+					.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					.reads = VK_ACCESS_SHADER_READ_BIT,
+					.writes = 0,
+					.imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT,
+					.readsContents = true,
+					.attachment = false
+				};
+			case RenderGraph::TransferSrc:
+				return {
+					.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					.stages = VK_PIPELINE_STAGE_TRANSFER_BIT,
+					.reads = VK_ACCESS_TRANSFER_READ_BIT,
+					.writes = 0,
+					.imageUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+					.readsContents = true,
+					.attachment = false
+				};
+		}
+		ERR("unknown render graph usage %d", usage)
+		return {};
+	}
+
+	// everything a pass does with an image, together
+	struct UseInfo {
+		VkImageLayout firstLayout;
+		VkImageLayout lastLayout;
+		VkPipelineStageFlags stages = 0;
+		VkAccessFlags reads = 0;
+		VkAccessFlags writes = 0;
+		VkImageUsageFlags imageUsage = 0;
+		bool readsContents; // needs what was there before the pass
+		bool attachmentOnly = true;
+	};
+
+	UseInfo combine(const RenderGraph::Use& use)
+	{
+		ASSERT(!use.usages.empty())
+		UseInfo info = {
+			.firstLayout = usageInfo(use.usages.front()).layout,
+			.lastLayout = usageInfo(use.usages.back()).layout,
+			.readsContents = usageInfo(use.usages.front()).readsContents
+		};
+		for (auto usage : use.usages) {
+			auto usage_info = usageInfo(usage);
+			info.stages |= usage_info.stages;
+			info.reads |= usage_info.reads;
+			info.writes |= usage_info.writes;
+			info.imageUsage |= usage_info.imageUsage;
+			info.attachmentOnly = info.attachmentOnly && usage_info.attachment;
+		}
+		return info;
+	}
+
+	const RenderGraph::Use* findUse(const std::vector<RenderGraph::Use>& uses, RenderGraph::Handle image)
+	{
+		for (auto& use : uses) {
+			if (use.image == image) return &use;
+		}
+		return nullptr;
+	}
+}
+
+bool RenderGraph::ImageDesc::operator==(const ImageDesc &other) const
+{
+	return name == other.name && format == other.format && extent.width == other.extent.width &&
+		extent.height == other.extent.height && aspect == other.aspect;
+}
+
+void RenderGraph::reset()
+{
+	images.clear();
+	passes.clear();
+	schedule.clear();
+	slots.clear();
+}
+
+RenderGraph::Handle RenderGraph::createImage(const ImageDesc &desc)
+{
+	images.push_back({ .desc = desc });
+	return Handle(images.size() - 1);
+}
+
+void RenderGraph::addPass(
+	const std::string &name,
+	const std::vector<Use> &uses,
+	const std::function<void(VkCommandBuffer)> &record,
+	bool hasSideEffects)
+{
+	passes.push_back({
+		.name = name,
+		.uses = uses,
+		.record = record,
+		.hasSideEffects = hasSideEffects
+	});
+}
+
+void RenderGraph::compile()
+{
+	// walking back from the passes with side effects: whoever last wrote what a needed pass reads is needed too
+	std::vector<bool> needed(passes.size(), false);
+	for (uint32_t p = passes.size(); p-- > 0;)
+	{
+		if (passes[p].hasSideEffects) needed[p] = true;
+		if (!needed[p]) continue;
+		for (auto& use : passes[p].uses)
+		{
+			if (!combine(use).readsContents) continue;
+			for (uint32_t writer = p; writer-- > 0;) {
+				auto writerUse = findUse(passes[writer].uses, use.image);
+				if (writerUse && combine(*writerUse).writes) {
+					needed[writer] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	schedule.clear();
+	for (uint32_t p = 0; p < passes.size(); p++) {
+		if (needed[p]) schedule.push_back(p);
+	}
+
+	std::vector<uint32_t> numPasses(images.size(), 0);
+	for (auto& image : images) {
+		image.usage = 0;
+		image.passLocal = true;
+	}
+	for (uint32_t s = 0; s < schedule.size(); s++)
+	{
+		for (auto& use : passes[schedule[s]].uses)
+		{
+			auto& image = images[use.image];
+			auto info = combine(use);
+			if (image.usage == 0) image.firstUse = s;
+			image.lastUse = s;
+			image.usage |= info.imageUsage;
+			image.passLocal = image.passLocal && info.attachmentOnly && !info.readsContents;
+			numPasses[use.image]++;
+		}
+	}
+	for (uint32_t i = 0; i < images.size(); i++)
+	{
+		auto& image = images[i];
+		image.passLocal = image.passLocal && numPasses[i] == 1;
+		if (image.passLocal) image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+}
+
+void RenderGraph::assignMemory(const std::vector<MemoryRequirements> &requirements, bool separatePassLocal)
+{
+	ASSERT(requirements.size() == images.size())
+
+	// biggest first, each into the first slot it doesn't overlap anything in (and can share a memory type with)
+	std::vector<Handle> order;
+	for (Handle h = 0; h < images.size(); h++) {
+		if (images[h].usage) order.push_back(h);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](Handle a, Handle b) {
+		return requirements[a].size > requirements[b].size;
+	});
+
+	slots.clear();
+	for (auto h : order)
+	{
+		auto& image = images[h];
+		auto& imageRequirements = requirements[h];
+		if (separatePassLocal && image.passLocal) {
+			image.slot = uint32_t(slots.size());
+			slots.push_back({ .requirements = imageRequirements, .images = { h }, .lazilyAllocated = true });
+			continue;
+		}
+
+		uint32_t s = 0;
+		for (; s < slots.size(); s++)
+		{
+			auto& slot = slots[s];
+			if (slot.lazilyAllocated || !(slot.requirements.memoryTypeBits & imageRequirements.memoryTypeBits)) continue;
+			bool overlaps = std::any_of(slot.images.begin(), slot.images.end(), [&](Handle other) {
+				return images[other].firstUse <= image.lastUse && image.firstUse <= images[other].lastUse;
+			});
+			if (!overlaps) break;
+		}
+		if (s == slots.size()) {
+			slots.push_back({ .requirements = imageRequirements });
+		} else {
+			auto& slotRequirements = slots[s].requirements;
+			slotRequirements.size = std::max(slotRequirements.size, imageRequirements.size);
+			slotRequirements.alignment = std::max(slotRequirements.alignment, imageRequirements.alignment);
+			slotRequirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+		}
+		slots[s].images.push_back(h);
+		image.slot = s;
+	}
+
+	// barriers: an image is tracked from one use to the next within the frame. Before its first use, whatever is in
+	// its memory is garbage, but whoever used that memory last (another image sharing it, or the image itself in the
+	// previous frame, submitted earlier on the same queue) has to be done with it
+	struct State {
+		VkImageLayout layout;
+		VkPipelineStageFlags stages;
+		VkAccessFlags writes;
+	};
+	std::vector<State> states(images.size());
+	for (auto& pass : passes) pass.barriers.clear();
+
+	for (uint32_t s = 0; s < schedule.size(); s++)
+	{
+		auto& pass = passes[schedule[s]];
+		for (auto& use : pass.uses)
+		{
+			auto& image = images[use.image];
+			auto info = combine(use);
+			Barrier barrier = {
+				.image = use.image,
+				.newLayout = info.firstLayout,
+				.dstStages = info.stages,
+				.dstAccess = info.reads | info.writes
+			};
+
+			if (s == image.firstUse)
+			{
+				if (info.readsContents) {
+					WARN("render graph: pass '%s' reads '%s' before anything wrote it", pass.name.c_str(), image.desc.name.c_str())
+				}
+				// the memory's last use before this one, or if there's none, its last use in the frame
+				auto& slotImages = slots[image.slot].images;
+				Handle previous = use.image;
+				for (auto other : slotImages) {
+					uint32_t lastUse = images[other].lastUse;
+					if (lastUse < image.firstUse && (images[previous].lastUse >= image.firstUse || lastUse > images[previous].lastUse)) {
+						previous = other;
+					}
+				}
+				if (images[previous].lastUse >= image.firstUse) {
+					for (auto other : slotImages) {
+						if (images[other].lastUse > images[previous].lastUse) previous = other;
+					}
+				}
+				auto previousInfo = combine(*findUse(passes[schedule[images[previous].lastUse]].uses, previous));
+				barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				barrier.srcStages = previousInfo.stages;
+				barrier.srcAccess = previousInfo.writes;
+			}
+			else
+			{
+				auto& state = states[use.image];
+				// reads after reads in the same layout don't need anything (but a later write has to wait for all of them)
+				if (state.writes == 0 && info.writes == 0 &&
+					state.layout == info.firstLayout && info.firstLayout == info.lastLayout) {
+					state.stages |= info.stages;
+					continue;
+				}
+				barrier.oldLayout = state.layout;
+				barrier.srcStages = state.stages;
+				barrier.srcAccess = state.writes;
+			}
+			pass.barriers.push_back(barrier);
+			states[use.image] = { info.lastLayout, info.stages, info.writes };
+		}
+	}
+}
+
+void RenderGraph::execute(VkCommandBuffer cmdbuf, const std::function<VkImage(Handle)> &getImage) const
+{
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	for (auto p : schedule)
+	{
+		auto& pass = passes[p];
+		// all of a pass' barriers in one go
+		if (!pass.barriers.empty())
+		{
+			imageBarriers.clear();
+			VkPipelineStageFlags srcStages = 0;
+			VkPipelineStageFlags dstStages = 0;
+			for (auto& barrier : pass.barriers)
+			{
+				imageBarriers.push_back({
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.srcAccessMask = barrier.srcAccess,
+					.dstAccessMask = barrier.dstAccess,
+					.oldLayout = barrier.oldLayout,
+					.newLayout = barrier.newLayout,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = getImage(barrier.image),
+					.subresourceRange = { images[barrier.image].desc.aspect, 0, 1, 0, 1 }
+				});
+				srcStages |= barrier.srcStages;
+				dstStages |= barrier.dstStages;
+			}
+			vkCmdPipelineBarrier(
+				cmdbuf,
+				srcStages,
+				dstStages,
+				0,
+				0, nullptr,
+				0, nullptr,
+				uint32_t(imageBarriers.size()), imageBarriers.data());
+		}
+		pass.record(cmdbuf);
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * A frame's passes, declared with the images they read and write. compile() drops passes nothing visible depends on
+ * and works out each image's lifetime and usage flags; assignMemory() then lets images that are never alive at the
+ * same time share memory, and works out the barriers (layout transitions included) that go in front of each pass.
+ * Neither touches the device, so a graph can be compiled and checked without one; TransientImagePool makes the actual
+ * images and execute() records the passes.
+ *
+ * Images are transient: their contents don't survive from one frame to the next. An image used by a single pass, only
+ * as an attachment, never needs to leave the tile memory of a tiler and is reported as pass local (it gets
+ * VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, and its render pass should store it with DONT_CARE).
+ */
+class RenderGraph
+{
+public:
+	using Handle = uint32_t;
+
+	struct ImageDesc {
+		std::string name;
+		VkFormat format;
+		VkExtent2D extent;
+		VkImageAspectFlags aspect;
+		bool operator==(const ImageDesc& other) const;
+	};
+
+	// what a pass does with an image. Each usage has one layout, so a render pass' initialLayout has to be that of the
+	// image's first usage in the pass and its finalLayout that of the last one (the graph takes it from there)
+	enum Usage {
+		ColorAttachment,			// cleared or fully overwritten
+		ColorAttachmentLoad,		// loads what's there
+		DepthAttachment,			// cleared
+		DepthAttachmentLoad,		// loads what's there
+		InputAttachment,
+		Sampled,					// in fragment shaders
+		TransferSrc,
+	};
+
+	struct Use {
+		Handle image;
+		std::vector<Usage> usages; // in the order they happen within the pass (e.g. subpasses)
+	};
+
+	struct Barrier {
+		Handle image;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		VkPipelineStageFlags srcStages;
+		VkPipelineStageFlags dstStages;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+	};
+
+	struct MemoryRequirements {
+		VkDeviceSize size = 0;
+		VkDeviceSize alignment = 1;
+		uint32_t memoryTypeBits = 0;
+	};
+
+	// every image of a slot is bound at offset 0 of the same allocation
+	struct MemorySlot {
+		MemoryRequirements requirements; // big enough for all of them, of a type they can all use
+		std::vector<Handle> images;
+		bool lazilyAllocated = false; // holds a single pass local image
+	};
+
+	// forgets everything to declare the next frame. Handles are given out in order, so a frame declared the same way
+	// as the last one ends up with the same ones
+	void reset();
+
+	Handle createImage(const ImageDesc& desc);
+
+	// passes run in the order they're added. Passes with side effects (e.g. presenting) are never culled
+	void addPass(
+		const std::string& name,
+		const std::vector<Use>& uses,
+		const std::function<void(VkCommandBuffer cmdbuf)>& record,
+		bool hasSideEffects = false);
+
+	void compile();
+
+	// after compile(), with the requirements of images created with getImageUsage() (indexed by handle; culled images
+	// are ignored). If separatePassLocal, pass local images each get their own lazily allocated slot instead of being
+	// aliased with others
+	void assignMemory(const std::vector<MemoryRequirements>& requirements, bool separatePassLocal);
+
+	// after assignMemory(): the scheduled passes with their barriers in front of them
+	void execute(VkCommandBuffer cmdbuf, const std::function<VkImage(Handle)>& getImage) const;
+
+	uint32_t getNumImages() const { return uint32_t(images.size()); }
+	const ImageDesc& getImageDesc(Handle image) const { return images[image].desc; }
+	// 0 if the image isn't used by any scheduled pass
+	VkImageUsageFlags getImageUsage(Handle image) const { return images[image].usage; }
+	bool isPassLocal(Handle image) const { return images[image].passLocal; }
+	// first and last position in the schedule the image is used at
+	uint32_t getFirstUse(Handle image) const { return images[image].firstUse; }
+	uint32_t getLastUse(Handle image) const { return images[image].lastUse; }
+
+	// indices of the passes that survived culling, in order
+	const std::vector<uint32_t>& getSchedule() const { return schedule; }
+	const std::string& getPassName(uint32_t pass) const { return passes[pass].name; }
+	const std::vector<Barrier>& getBarriers(uint32_t pass) const { return passes[pass].barriers; }
+
+	const std::vector<MemorySlot>& getMemorySlots() const { return slots; }
+
+private:
+	struct Image {
+		ImageDesc desc;
+		VkImageUsageFlags usage = 0;
+		bool passLocal = false;
+		// first and last position in the schedule it's used at
+		uint32_t firstUse = 0;
+		uint32_t lastUse = 0;
+		uint32_t slot = 0;
+	};
+	struct Pass {
+		std::string name;
+		std::vector<Use> uses;
+		std::function<void(VkCommandBuffer)> record;
+		bool hasSideEffects;
+		std::vector<Barrier> barriers;
+	};
+
+	std::vector<Image> images;
+	std::vector<Pass> passes;
+	std::vector<uint32_t> schedule;
+	std::vector<MemorySlot> slots;
+};
@@ -0,0 +1,240 @@
+#include "RenderList.h"
+#include "Scene/MeshObject.h"
+#include "Scene/Probe.h"
+#include "Scene/Light.hpp"
+#include "Scene/SkyAtmosphere/SkyAtmosphere.h"
+#include "Scene/Camera.hpp"
+#include "Render/Mesh.h"
+#include "Render/Materials/GltfMaterial.h"
+#include "Utils/myn/Threading.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#define OCCLUSION_BUFFER_WIDTH 256
+// meshes only occlude if their bounding sphere's radius covers at least this much of half the screen height,
+#define OCCLUDER_MIN_SCREEN_SIZE 0.1f
+// and then only as many of them as fit in this many triangles, biggest first
+#define OCCLUDER_TRIANGLE_BUDGET 65536
+// boxes tested against the occlusion buffer by one job
+#define OCCLUSION_TEST_BATCH 256
+
+namespace
+{
+	// float bits reordered so that comparing them as unsigned ints gives the same order (negative ones included)
+	uint32_t sortableDepth(float depth)
+	{
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	// LSD radix sort of keys (and values along with them), 8 bits per pass. Digits that are the same for all keys
+	// (typically the pass and pipeline bits) skip their pass.
+	void radixSort(
+		std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+		std::vector<uint64_t>& tmpKeys, std::vector<uint32_t>& tmpValues)
+	{
+		size_t n = keys.size();
+		if (n < 2) return;
+		tmpKeys.resize(n);
+		tmpValues.resize(n);
+
+		uint32_t counts[8][256] = {};
+		for (auto key : keys) {
+			for (uint32_t d = 0; d < 8; d++) counts[d][(key >> (d * 8)) & 0xff]++;
+		}
+
+		for (uint32_t d = 0; d < 8; d++)
+		{
+			uint32_t shift = d * 8;
+			if (counts[d][(keys[0] >> shift) & 0xff] == n) continue;
+
+			uint32_t offsets[256];
+			uint32_t sum = 0;
+			for (uint32_t i = 0; i < 256; i++) {
+				offsets[i] = sum;
+				sum += counts[d][i];
+			}
+			for (size_t i = 0; i < n; i++) {
+				uint32_t dst = offsets[(keys[i] >> shift) & 0xff]++;
+				tmpKeys[dst] = keys[i];
+				tmpValues[dst] = values[i];
+			}
+			keys.swap(tmpKeys);
+			values.swap(tmpValues);
+		}
+	}
+}
+
+void RenderList::extract(SceneObject *root)
+{
+	extractedRoot = root;
+	extractedVersion = SceneObject::hierarchy_version;
+	bvhOutdated = true;
+
+	records.clear();
+	probes.clear();
+	pointLights.clear();
+	directionalLights.clear();
+	sky = nullptr;
+
+	// slots are only ever added to, so materials that were already fetched stay valid across extractions
+	std::unordered_map<std::string, uint32_t> slotIndices;
+	for (uint32_t i = 0; i < materialSlots.size(); i++) slotIndices[materialSlots[i].name] = i;
+
+	// breadth first like SceneObject::foreach_descendent_bfs, skipping disabled subtrees
+	std::vector<SceneObject*> queue = { root };
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		auto node = queue[head];
+		if (!node->enabled()) continue;
+		queue.insert(queue.end(), node->children.begin(), node->children.end());
+
+		if (auto mo = dynamic_cast<MeshObject*>(node))
+		{
+			auto& materialName = mo->mesh->materialName;
+			auto it = slotIndices.find(materialName);
+			if (it == slotIndices.end()) {
+				auto info = GltfMaterialInfo::get(materialName);
+				if (!info) continue;
+				it = slotIndices.emplace(materialName, (uint32_t)materialSlots.size()).first;
+				materialSlots.push_back({ .name = materialName, .info = info });
+			}
+			records.push_back({ .meshObject = mo, .materialSlot = it->second });
+		}
+		else if (auto probe = dynamic_cast<Probe*>(node)) probes.push_back(probe);
+		else if (auto pointLight = dynamic_cast<PointLight*>(node)) pointLights.push_back(pointLight);
+		else if (auto directionalLight = dynamic_cast<DirectionalLight*>(node)) directionalLights.push_back(directionalLight);
+		else if (auto castSky = dynamic_cast<SkyAtmosphere*>(node)) sky = castSky;
+	}
+}
+
+void RenderList::cull(Camera *camera)
+{
+	stats = {};
+	visible.resize(records.size());
+	std::iota(visible.begin(), visible.end(), 0);
+	glm::mat4 worldToClip = camera->world_to_clip();
+
+	// objects only know their local bounds: move them to where the objects (and their ancestors) are now
+	worldBoxes.resize(records.size());
+	for (uint32_t i = 0; i < records.size(); i++) worldBoxes[i] = records[i].meshObject->world_aabb();
+
+	if (frustumCulling)
+	{
+		if (bvhOutdated) {
+			bvh.build(worldBoxes);
+			bvhOutdated = false;
+		} else {
+			bvh.refit(worldBoxes);
+		}
+		visible.clear();
+		bvh.cull(FrustumPlanes(worldToClip), visible);
+		stats.frustumCulled = records.size() - visible.size();
+	}
+
+	if (occlusionCulling)
+	{
+		// occluders: the biggest opaque meshes on screen
+		std::vector<std::pair<float, uint32_t>> candidates;
+		glm::vec3 cameraPosition = camera->world_position();
+		float tanHalfFov = std::tan(camera->fov * 0.5f);
+		for (auto i : visible)
+		{
+			auto& record = records[i];
+			if (!materialSlots[record.materialSlot].occluder || record.meshObject->mesh->get_num_vertices() == 0) continue;
+			auto& box = worldBoxes[i];
+			float radius = glm::length(box.max - box.min) * 0.5f;
+			float distance = glm::length((box.min + box.max) * 0.5f - cameraPosition);
+			float size = distance <= radius ? INF : radius / (distance * tanHalfFov);
+			if (size >= OCCLUDER_MIN_SCREEN_SIZE) candidates.push_back({ size, i });
+		}
+		if (candidates.empty()) return;
+		std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+		uint32_t height = std::max(1u, uint32_t(OCCLUSION_BUFFER_WIDTH / camera->aspect_ratio));
+		occlusionBuffer.begin(worldToClip, OCCLUSION_BUFFER_WIDTH, height);
+		for (auto& candidate : candidates)
+		{
+			auto mo = records[candidate.second].meshObject;
+			if (occlusionBuffer.numOccluderTriangles() + mo->mesh->get_num_indices() / 3 > OCCLUDER_TRIANGLE_BUDGET) continue;
+			occlusionBuffer.addOccluder(mo->mesh, mo->object_to_world());
+			stats.occluders++;
+		}
+		occlusionBuffer.finish();
+		stats.occluderTriangles = occlusionBuffer.numOccluderTriangles();
+
+		std::vector<uint8_t> occluded(visible.size());
+		myn::WorkerPool::shared().parallel_for((visible.size() + OCCLUSION_TEST_BATCH - 1) / OCCLUSION_TEST_BATCH, [&](uint32_t batch) {
+			size_t end = std::min(visible.size(), size_t(batch + 1) * OCCLUSION_TEST_BATCH);
+			for (size_t j = size_t(batch) * OCCLUSION_TEST_BATCH; j < end; j++) {
+				occluded[j] = !occlusionBuffer.isVisible(worldBoxes[visible[j]]);
+			}
+		});
+		size_t numVisible = 0;
+		for (size_t j = 0; j < visible.size(); j++) {
+			if (!occluded[j]) visible[numVisible++] = visible[j];
+		}
+		stats.occlusionCulled = visible.size() - numVisible;
+		visible.resize(numVisible);
+	}
+}
+
+void RenderList::update(
+	SceneObject *root,
+	Camera *camera,
+	const std::function<Material*(const std::string&)> &getOrCreateMaterial)
+{
+	if (root != extractedRoot || SceneObject::hierarchy_version != extractedVersion) extract(root);
+
+	// materials (usually a lot fewer than draws)
+	std::vector<VkPipeline> pipelines;
+	std::vector<uint64_t> slotPipelines(materialSlots.size());
+	for (uint32_t i = 0; i < materialSlots.size(); i++)
+	{
+		auto& slot = materialSlots[i];
+		if (!slot.material || slot.version != slot.info->_version) {
+			slot.material = getOrCreateMaterial(slot.name);
+			slot.version = slot.info->_version;
+			auto gltfMaterial = dynamic_cast<GltfMaterial*>(slot.material);
+			slot.opaque = !gltfMaterial || gltfMaterial->isOpaque();
+			slot.occluder = slot.opaque && slot.info->type == MT_Surface && slot.info->clipThreshold < 0;
+		}
+		auto pipeline = slot.material->getPipeline().pipeline;
+		auto it = std::find(pipelines.begin(), pipelines.end(), pipeline);
+		slotPipelines[i] = it - pipelines.begin();
+		if (it == pipelines.end()) pipelines.push_back(pipeline);
+	}
+
+	cull(camera);
+
+	// keys: [pass:2][pipeline:14][material:16][depth:32] for opaque draws (depth front to back),
+	// [pass:2][inverted depth:32][pipeline:14][material:16] for translucent ones (back to front)
+	glm::vec3 cameraPosition = camera->world_position();
+	glm::vec3 viewDir = camera->forward();
+	size_t n = visible.size();
+	keys.resize(n);
+	order.resize(n);
+	for (uint32_t j = 0; j < n; j++)
+	{
+		uint32_t i = visible[j];
+		auto& record = records[i];
+		uint64_t depth = sortableDepth(glm::dot(record.meshObject->world_position() - cameraPosition, viewDir));
+		uint64_t pipeline = slotPipelines[record.materialSlot] & 0x3fff;
+		uint64_t material = record.materialSlot & 0xffff;
+		if (materialSlots[record.materialSlot].opaque) {
+			keys[j] = (pipeline << 48) | (material << 32) | depth;
+		} else {
+			keys[j] = (uint64_t(1) << 62) | ((~depth & 0xffffffffull) << 30) | (pipeline << 16) | material;
+		}
+		order[j] = i;
+	}
+	radixSort(keys, order, tmpKeys, tmpOrder);
+
+	size_t numOpaque = std::find_if(keys.begin(), keys.end(), [](uint64_t key) { return (key >> 62) != 0; }) - keys.begin();
+	opaqueDraws.assign(order.begin(), order.begin() + numOpaque);
+	translucentDraws.assign(order.begin() + numOpaque, order.end());
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+#include "Render/Culling.h"
+
+class SceneObject;
+struct Camera;
+class MeshObject;
+class Material;
+class Probe;
+class PointLight;
+class DirectionalLight;
+class SkyAtmosphere;
+struct GltfMaterialInfo;
+
+/*
+ * What a renderer draws, kept between frames in flat arrays: the scene tree only gets walked again when its hierarchy
+ * changed (see SceneObject::hierarchy_version). Every frame, draws are culled against the camera's frustum and a few big
+ * occluders (see Culling.h), then each remaining one gets a 64 bit key (pass, pipeline, material, depth) and they're
+ * radix sorted by it.
+ */
+class RenderList
+{
+public:
+	// one per distinct material name in the scene
+	struct MaterialSlot {
+		std::string name;
+		GltfMaterialInfo* info;
+		Material* material = nullptr; // re-fetched whenever info gets a new version
+		uint32_t version = 0;
+		bool opaque = true;
+		bool occluder = false; // opaque without alpha clipping: hides whatever is behind it
+	};
+
+	// one per MeshObject; the mesh and the (cached) world transform come from the object itself
+	struct DrawRecord {
+		MeshObject* meshObject;
+		uint32_t materialSlot;
+	};
+
+	// re-extracts the scene if needed, refreshes outdated materials (with getOrCreateMaterial), culls, then sorts the
+	// visible draws: opaque ones by pipeline, material, then front to back; translucent ones back to front
+	void update(
+		SceneObject* root,
+		Camera* camera,
+		const std::function<Material*(const std::string&)>& getOrCreateMaterial);
+
+	bool frustumCulling = true;
+	bool occlusionCulling = true;
+
+	std::vector<MaterialSlot> materialSlots;
+	std::vector<DrawRecord> records;
+	// world space bounds of each record, as of the last update()
+	std::vector<AABB> worldBoxes;
+
+	// indices into records, in draw order
+	std::vector<uint32_t> opaqueDraws;
+	std::vector<uint32_t> translucentDraws;
+
+	// last update()
+	struct {
+		uint32_t frustumCulled;
+		uint32_t occlusionCulled;
+		uint32_t occluders;
+		uint32_t occluderTriangles;
+	} stats = {};
+
+	std::vector<Probe*> probes;
+	std::vector<PointLight*> pointLights;
+	std::vector<DirectionalLight*> directionalLights;
+	SkyAtmosphere* sky = nullptr;
+
+private:
+	void extract(SceneObject* root);
+	void cull(Camera* camera);
+
+	SceneObject* extractedRoot = nullptr;
+	uint64_t extractedVersion = 0;
+
+	CullingBVH bvh;
+	bool bvhOutdated = true;
+	OcclusionBuffer occlusionBuffer;
+
+	// scratch, kept around to avoid allocating every frame
+	std::vector<uint32_t> visible;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint64_t> tmpKeys;
+	std::vector<uint32_t> tmpOrder;
+};
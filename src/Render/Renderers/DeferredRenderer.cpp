@@ -1,6 +1,8 @@
 #include "DeferredRenderer.h"
 #include "Render/Vulkan/RenderPassBuilder.h"
 #include "Render/Texture.h"
+#include "Render/TextureStreaming.h"
+#include "Render/BindlessScene.h"
 #include "Render/Mesh.h"
 #include "Scene/MeshObject.h"
 #include "Scene/Probe.h"
@@ -52,7 +54,7 @@ public:
 
 private:
 
-	explicit PostProcessing(DeferredRenderer* renderer, Texture2D* sceneColor, Texture2D* sceneDepth)
+	explicit PostProcessing(DeferredRenderer* renderer)
 	{
 		this->renderer = renderer;
 		name = "Post Processing";
@@ -64,10 +66,13 @@ private:
 		dynamicSetLayout.addBinding(0, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 		dynamicSetLayout.addBinding(1, VK_SHADER_STAGE_FRAGMENT_BIT, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 		dynamicSet = DescriptorSet(dynamicSetLayout);
+	}
 
-		// assign values
-		dynamicSet.pointToImageView(sceneColor->imageView, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-		dynamicSet.pointToImageView(sceneDepth->imageView, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	// whenever the render graph's images change
+	void setInputs(VkImageView sceneColor, VkImageView sceneDepth)
+	{
+		dynamicSet.pointToImageView(sceneColor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		dynamicSet.pointToImageView(sceneDepth, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 	}
 
 	VkRenderPass postProcessPass;
@@ -127,79 +132,25 @@ private:
 DeferredRenderer::DeferredRenderer()
 {
 	renderExtent = Vulkan::Instance->swapChainExtent;
-	{// images
-		ImageCreator GPositionCreator(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			"GPosition");
-
-		ImageCreator GNormalCreator(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			"GNormal");
-
-		ImageCreator GColorCreator(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			"GColor");
-
-		ImageCreator GORMCreator(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			"GORM");
-
-		ImageCreator sceneColorCreator(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			"sceneColor");
-
-		ImageCreator sceneDepthCreator(
-			VK_FORMAT_D32_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_IMAGE_ASPECT_DEPTH_BIT,
-			"sceneDepth");
-
-		ImageCreator postProcessedCreator(
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			{renderExtent.width, renderExtent.height, 1},
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			"postProcessed");
-
-		GPosition = new Texture2D(GPositionCreator);
-		GNormal = new Texture2D(GNormalCreator);
-		GColor = new Texture2D(GColorCreator);
-		GORM = new Texture2D(GORMCreator);
-		sceneColor = new Texture2D(sceneColorCreator);
-		sceneDepth = new Texture2D(sceneDepthCreator);
-		postProcessed = new Texture2D(postProcessedCreator);
-	}
-
+	renderList.frustumCulling = Config->lookup<int>("FrustumCulling");
+	renderList.occlusionCulling = Config->lookup<int>("OcclusionCulling");
+	parallelRecording = Config->lookup<int>("ParallelCommandRecording");
 	{// main pass
 		RenderPassBuilder passBuilder;
 
+		// initial and final layouts are the ones the render graph expects (see render()). The G-buffers don't outlive
+		// the pass, so they're never stored
 		// GPosition
 		passBuilder.colorAttachments.push_back(
 			{
 				.format = VK_FORMAT_R16G16B16A16_SFLOAT,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
 				.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+				.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-				.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+				.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			});
 		// GNormal
 		passBuilder.colorAttachments.push_back(
@@ -207,11 +158,11 @@ DeferredRenderer::DeferredRenderer()
 				.format = VK_FORMAT_R16G16B16A16_SFLOAT,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
 				.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+				.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-				.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+				.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			});
 		// GColor
 		passBuilder.colorAttachments.push_back(
@@ -219,11 +170,11 @@ DeferredRenderer::DeferredRenderer()
 				.format = VK_FORMAT_R16G16B16A16_SFLOAT,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
 				.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+				.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-				.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+				.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			});
 		// GORM
 		passBuilder.colorAttachments.push_back(
@@ -231,11 +182,11 @@ DeferredRenderer::DeferredRenderer()
 				.format = VK_FORMAT_R16G16B16A16_SFLOAT,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
 				.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+				.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-				.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+				.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			});
 		// sceneColor
 		passBuilder.colorAttachments.push_back(
@@ -246,8 +197,8 @@ DeferredRenderer::DeferredRenderer()
 				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-				.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+				.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
 			});
 		// sceneDepth
 		passBuilder.useDepthAttachment = true;
@@ -258,8 +209,8 @@ DeferredRenderer::DeferredRenderer()
 			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
 		};
 
 		// base pass
@@ -317,8 +268,7 @@ DeferredRenderer::DeferredRenderer()
 			.pDepthStencilAttachment = &depthAttachmentReference
 		});
 
-		// dependencies
-		// TODO: any dependency w external needed?
+		// dependencies (on what comes before and after the render pass, they're the render graph's barriers)
 		passBuilder.dependencies.push_back({
 			.srcSubpass = DEFERRED_SUBPASS_GEOMETRY,
 			.dstSubpass = DEFERRED_SUBPASS_LIGHTING,
@@ -360,8 +310,8 @@ DeferredRenderer::DeferredRenderer()
 			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+			.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
 		});
 
 		passBuilder.useDepthAttachment = true;
@@ -369,11 +319,11 @@ DeferredRenderer::DeferredRenderer()
 			.format = VK_FORMAT_D32_SFLOAT,
 			.samples = VK_SAMPLE_COUNT_1_BIT,
 			.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+			.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE, // nothing reads it afterwards
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 			.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
 		};
 
 		VkAttachmentReference colorAttachmentRef = {
@@ -410,49 +360,6 @@ DeferredRenderer::DeferredRenderer()
 		postProcessPass = passBuilder.build(Vulkan::Instance);
 	}
 
-	{// framebuffer
-		VkImageView attachments[] = {
-			GPosition->imageView,
-			GNormal->imageView,
-			GColor->imageView,
-			GORM->imageView,
-			sceneColor->imageView,
-			sceneDepth->imageView
-		};
-		VkFramebufferCreateInfo framebufferInfo = {
-			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-			.renderPass = mainPass, // the render pass it needs to be compatible with
-			.attachmentCount = 6,
-			.pAttachments = attachments, // a pointer to an array of VkImageView handles, each of which will be used as the corresponding attachment in a render pass instance.
-			.width = renderExtent.width,
-			.height = renderExtent.height,
-			.layers = 1
-		};
-		EXPECT(vkCreateFramebuffer(
-			Vulkan::Instance->device,
-			&framebufferInfo,
-			nullptr,
-			&framebuffer), VK_SUCCESS)
-	}
-
-	{// also framebuffer for postprocessing
-		VkImageView attachments[2] = { postProcessed->imageView, sceneDepth->imageView };
-		VkFramebufferCreateInfo frameBufferInfo = {
-			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-			.renderPass = postProcessPass,
-			.attachmentCount = 2,
-			.pAttachments = attachments,
-			.width = renderExtent.width,
-			.height = renderExtent.height,
-			.layers = 1
-		};
-		EXPECT(vkCreateFramebuffer(
-			Vulkan::Instance->device,
-			&frameBufferInfo,
-			nullptr,
-			&postProcessFramebuffer), VK_SUCCESS)
-	}
-
 	{// frame-global descriptor set
 
 		viewInfoUbo = VmaBuffer({&Vulkan::Instance->memoryAllocator,
@@ -484,10 +391,7 @@ DeferredRenderer::DeferredRenderer()
 		frameGlobalDescriptorSet = DescriptorSet(frameGlobalSetLayout);
 
 		frameGlobalDescriptorSet.pointToBuffer(viewInfoUbo, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-		frameGlobalDescriptorSet.pointToImageView(GPosition->imageView, 1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
-		frameGlobalDescriptorSet.pointToImageView(GNormal->imageView, 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
-		frameGlobalDescriptorSet.pointToImageView(GColor->imageView, 3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
-		frameGlobalDescriptorSet.pointToImageView(GORM->imageView, 4, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+		// 1-4 are the G-buffers, see updateGraphImageViews()
 		frameGlobalDescriptorSet.pointToBuffer(pointLightsBuffer, 5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 		frameGlobalDescriptorSet.pointToBuffer(directionalLightsBuffer, 6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 		bool loadedEnvironmentMap = Config->lookup<int>("LoadEnvironmentMap");
@@ -504,7 +408,14 @@ DeferredRenderer::DeferredRenderer()
 	viewInfo.ToneMappingOption = 1;
 
 	deferredLighting = new DeferredLighting(this);
-	postProcessing = new PostProcessing(this, sceneColor, sceneDepth);
+	postProcessing = new PostProcessing(this);
+
+	if (Vulkan::Instance->bindlessSupported) {
+		bindlessScene = new BindlessScene(mainPass, DEFERRED_SUBPASS_GEOMETRY, frameGlobalDescriptorSet.getLayout());
+		bindlessDrawing = Config->lookup<int>("BindlessDrawing");
+	} else if (Config->lookup<int>("BindlessDrawing")) {
+		WARN("Bindless drawing isn't supported by this device, drawing one by one instead")
+	}
 
 	{// debug draw stuff
 #if 0 // example debug points
@@ -549,11 +460,7 @@ DeferredRenderer::~DeferredRenderer()
 
 	delete deferredLighting;
 	delete postProcessing;
-
-	std::vector<Texture2D*> images = {
-		GPosition, GNormal, GColor, GORM, sceneColor, sceneDepth, postProcessed
-	};
-	for (auto image : images) delete image;
+	delete bindlessScene;
 
 	delete debugPoints;
 	delete debugLines;
@@ -561,6 +468,62 @@ DeferredRenderer::~DeferredRenderer()
 	for (const auto& p : materials) delete p.second;
 }
 
+void DeferredRenderer::updateGraphImageViews()
+{
+	auto vk = Vulkan::Instance;
+	vkDestroyFramebuffer(vk->device, framebuffer, nullptr);
+	vkDestroyFramebuffer(vk->device, postProcessFramebuffer, nullptr);
+
+	{// framebuffer
+		VkImageView attachments[] = {
+			graphImages.getImageView(GPosition),
+			graphImages.getImageView(GNormal),
+			graphImages.getImageView(GColor),
+			graphImages.getImageView(GORM),
+			graphImages.getImageView(sceneColor),
+			graphImages.getImageView(sceneDepth)
+		};
+		VkFramebufferCreateInfo framebufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = mainPass, // the render pass it needs to be compatible with
+			.attachmentCount = 6,
+			.pAttachments = attachments, // a pointer to an array of VkImageView handles, each of which will be used as the corresponding attachment in a render pass instance.
+			.width = renderExtent.width,
+			.height = renderExtent.height,
+			.layers = 1
+		};
+		EXPECT(vkCreateFramebuffer(
+			Vulkan::Instance->device,
+			&framebufferInfo,
+			nullptr,
+			&framebuffer), VK_SUCCESS)
+	}
+
+	{// also framebuffer for postprocessing
+		VkImageView attachments[2] = { graphImages.getImageView(postProcessed), graphImages.getImageView(sceneDepth) };
+		VkFramebufferCreateInfo frameBufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = postProcessPass,
+			.attachmentCount = 2,
+			.pAttachments = attachments,
+			.width = renderExtent.width,
+			.height = renderExtent.height,
+			.layers = 1
+		};
+		EXPECT(vkCreateFramebuffer(
+			Vulkan::Instance->device,
+			&frameBufferInfo,
+			nullptr,
+			&postProcessFramebuffer), VK_SUCCESS)
+	}
+
+	frameGlobalDescriptorSet.pointToImageView(graphImages.getImageView(GPosition), 1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+	frameGlobalDescriptorSet.pointToImageView(graphImages.getImageView(GNormal), 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+	frameGlobalDescriptorSet.pointToImageView(graphImages.getImageView(GColor), 3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+	frameGlobalDescriptorSet.pointToImageView(graphImages.getImageView(GORM), 4, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+	postProcessing->setInputs(graphImages.getImageView(sceneColor), graphImages.getImageView(sceneDepth));
+}
+
 void DeferredRenderer::updateUniformBuffers()
 {
 	viewInfo.ViewMatrix = camera->world_to_object();
@@ -573,32 +536,26 @@ void DeferredRenderer::updateUniformBuffers()
 	viewInfo.AspectRatio = camera->aspect_ratio;
 	viewInfo.HalfVFovRadians = camera->fov * 0.5f;
 
+	// convert whatever unit (cd, lx, nt) to watt:
+	// from blender, PBR_WATTS_TO_LUMENS = 683 // so lumen to watt is 1.0f/683
+	// the last div by 2*PI is converting irradiance to radiance (???)
+	// todo: rename the "getMultipliedColor" interface altogether
 	int numPointLights = 0;
+	for (auto L : renderList.pointLights)
+	{
+		if (numPointLights == MAX_LIGHTS_PER_PASS) break;
+		pointLights.Data[numPointLights].position = L->world_position();
+		pointLights.Data[numPointLights].color = L->getLuminousIntensityCd();
+		numPointLights++;
+	}
 	int numDirectionalLights = 0;
-	drawable->foreach_descendent_bfs([this, &numPointLights, &numDirectionalLights](SceneObject* child){
-		// convert whatever unit (cd, lx, nt) to watt:
-		// from blender, PBR_WATTS_TO_LUMENS = 683 // so lumen to watt is 1.0f/683
-		// the last div by 2*PI is converting irradiance to radiance (???)
-		// todo: rename the "getMultipliedColor" interface altogether
-		if (child->enabled()) {
-			if (auto L = dynamic_cast<PointLight*>(child))
-			{
-				if (numPointLights < MAX_LIGHTS_PER_PASS) {
-					pointLights.Data[numPointLights].position = L->world_position();
-					pointLights.Data[numPointLights].color = L->getLuminousIntensityCd();
-					numPointLights++;
-				}
-			}
-			else if (auto L = dynamic_cast<DirectionalLight*>(child))
-			{
-				if (numDirectionalLights < MAX_LIGHTS_PER_PASS) {
-					directionalLights.Data[numDirectionalLights].direction = L->getLightDirection();
-					directionalLights.Data[numDirectionalLights].color = L->getIrradianceLx();
-					numDirectionalLights++;
-				}
-			}
-		}
-	});
+	for (auto L : renderList.directionalLights)
+	{
+		if (numDirectionalLights == MAX_LIGHTS_PER_PASS) break;
+		directionalLights.Data[numDirectionalLights].direction = L->getLightDirection();
+		directionalLights.Data[numDirectionalLights].color = L->getIrradianceLx();
+		numDirectionalLights++;
+	}
 	viewInfo.NumPointLights = numPointLights;
 	viewInfo.NumDirectionalLights = numDirectionalLights;
 
@@ -618,72 +575,90 @@ void DeferredRenderer::updateUniformBuffers()
 
 void DeferredRenderer::render(VkCommandBuffer cmdbuf)
 {
-	// reset material instance counters
+	// reset material instance counters; textures may have streamed in a different resolution
 	for (auto it : materials) {
 		it.second->resetInstanceCounter();
+		it.second->updateTextureDescriptors();
 	}
 
+	// objects gathering, culling and sorting (the scene only gets walked again if it changed)
+	renderList.update(drawable, camera, [this](const std::string& materialName) {
+		return getOrCreateMeshMaterial(materialName);
+	});
+
 	updateUniformBuffers();
 
-	// here the layout is for just so it gets ANY compatible layout
-	frameGlobalDescriptorSet.bind(
-		cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS,DSET_FRAMEGLOBAL, deferredLighting->getPipeline().layout);
+	if (bindlessDrawing) bindlessScene->update(renderList);
 
-	// objects gathering and sorting
-	std::vector<MeshObject*> opaqueMeshes;
-	std::vector<MeshObject*> translucentMeshes;
-	std::vector<Probe*> probes;
-	SkyAtmosphere* sky = nullptr;
+	// the frame's passes: images only live as long as they're used, and share memory with others when they can.
+	// Declared before anything gets recorded, since the descriptors pointing to the images change when they do
 	{
-		// gather
-		drawable->foreach_descendent_bfs([&](SceneObject* child) {
-			// meshes
-			if (auto mo = dynamic_cast<MeshObject*>(child)) {
-				if (auto mat = dynamic_cast<GltfMaterial*>(getOrCreateMeshMaterial(mo->mesh->materialName))) {
-					if (mat->isOpaque()) { // opaque
-						opaqueMeshes.push_back(mo);
-					} else { // translucent
-						translucentMeshes.push_back(mo);
-					}
-				}
-			} else if (auto probe = dynamic_cast<Probe*>(child)) {
-				// probes
-				probes.push_back(probe);
-			} else {
-				// sky
-				auto castSky = dynamic_cast<SkyAtmosphere*>(child);
-				if (castSky) sky = castSky;
-			}
-		}, [](SceneObject *obj){ return obj->enabled(); });
-
-		// opaque objects sorting
-		auto materialSortFn = [this](MeshObject* a, MeshObject* b) {
-			auto aMaterial = dynamic_cast<GltfMaterial*>(getOrCreateMeshMaterial(a->mesh->materialName));
-			auto bMaterial = dynamic_cast<GltfMaterial*>(getOrCreateMeshMaterial(b->mesh->materialName));
-			auto aPipeline = aMaterial->getPipeline();
-			auto bPipeline = bMaterial->getPipeline();
-			if (aPipeline != bPipeline) { // different pipeline -> sort by pipeline
-				return aPipeline < bPipeline;
-			} else { // same pipeline -> compare material name
-				return aMaterial->name < bMaterial->name;
-			}
+		renderGraph.reset();
+		auto imageDesc = [this](const char* name, VkFormat format, VkImageAspectFlags aspect) {
+			return RenderGraph::ImageDesc{ .name = name, .format = format, .extent = renderExtent, .aspect = aspect };
 		};
-		std::sort(opaqueMeshes.begin(), opaqueMeshes.end(), materialSortFn);
+		GPosition = renderGraph.createImage(imageDesc("GPosition", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+		GNormal = renderGraph.createImage(imageDesc("GNormal", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+		GColor = renderGraph.createImage(imageDesc("GColor", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+		GORM = renderGraph.createImage(imageDesc("GORM", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+		sceneColor = renderGraph.createImage(imageDesc("sceneColor", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+		sceneDepth = renderGraph.createImage(imageDesc("sceneDepth", VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT));
+		postProcessed = renderGraph.createImage(imageDesc("postProcessed", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+
+		renderGraph.addPass("Scene", {
+			{GPosition, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+			{GNormal, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+			{GColor, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+			{GORM, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+			{sceneColor, {RenderGraph::ColorAttachment}},
+			{sceneDepth, {RenderGraph::DepthAttachment}}
+		}, [this](VkCommandBuffer cmdbuf) { recordMainPass(cmdbuf); });
+
+		renderGraph.addPass("Post processing", {
+			{sceneColor, {RenderGraph::Sampled}},
+			{sceneDepth, {RenderGraph::Sampled, RenderGraph::DepthAttachmentLoad}},
+			{postProcessed, {RenderGraph::ColorAttachment}}
+		}, [this](VkCommandBuffer cmdbuf) { recordPostProcessPass(cmdbuf); });
+
+		renderGraph.addPass("Present", {
+			{postProcessed, {RenderGraph::TransferSrc}}
+		}, [this](VkCommandBuffer cmdbuf) {
+			SCOPED_DRAW_EVENT(cmdbuf, "Present")
+			vk::blitToScreen(
+				cmdbuf,
+				graphImages.getImage(postProcessed),
+				{0, 0, 0},
+				{(int32_t)renderExtent.width, (int32_t)renderExtent.height, 1});
+		}, true);
+
+		renderGraph.compile();
+		if (graphImages.realize(renderGraph)) updateGraphImageViews();
+	}
 
-		// translucent objects sorting
-		auto distToCameraSortFn = [this](MeshObject* a, MeshObject* b) {
-			auto distToCamA = glm::dot(a->world_position() - viewInfo.CameraPosition, viewInfo.ViewDir);
-			auto distToCamB = glm::dot(b->world_position() - viewInfo.CameraPosition, viewInfo.ViewDir);
-			return distToCamA >= distToCamB;
-		};
-		std::sort(translucentMeshes.begin(), translucentMeshes.end(), distToCameraSortFn);
+	// here the layout is for just so it gets ANY compatible layout
+	frameGlobalDescriptorSet.bind(
+		cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS,DSET_FRAMEGLOBAL, deferredLighting->getPipeline().layout);
+
+	// texture streaming feedback
+	for (auto draws : { &renderList.opaqueDraws, &renderList.translucentDraws }) {
+		for (auto drawIndex : *draws) {
+			auto& record = renderList.records[drawIndex];
+			auto& box = renderList.worldBoxes[drawIndex];
+			texture_streaming::report_material(*renderList.materialSlots[record.materialSlot].info, texture_streaming::screen_footprint(
+				box.min, box.max, viewInfo.CameraPosition, viewInfo.HalfVFovRadians, float(renderExtent.height)));
+		}
 	}
 
 	// TODO: find a better place to put this
-	if (sky) {
-		sky->updateAndComposite();
+	if (renderList.sky) {
+		renderList.sky->updateAndComposite();
 	}
 
+	renderGraph.execute(cmdbuf, [this](RenderGraph::Handle image) { return graphImages.getImage(image); });
+}
+
+void DeferredRenderer::recordMainPass(VkCommandBuffer cmdbuf)
+{
 	VkClearValue clearColor = {0, 0, 0, 0};
 	VkClearValue clearDepth;
 	clearDepth.depthStencil.depth = 1.f;
@@ -697,32 +672,62 @@ void DeferredRenderer::render(VkCommandBuffer cmdbuf)
 		.clearValueCount = 6,
 		.pClearValues = clearValues
 	};
-	vkCmdBeginRenderPass(cmdbuf, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// (there's nothing left to spread across threads when drawing bindless)
+	bool useSecondaries = parallelRecording && !bindlessDrawing;
+	vkCmdBeginRenderPass(cmdbuf, &passInfo, useSecondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 	{
-		SCOPED_DRAW_EVENT(cmdbuf, "Opaque base pass")
-		// deferred base pass: draw the meshes with materials
-		Material* last_material = nullptr;
-		MaterialPipeline last_pipeline = {};
-		for (auto mo : opaqueMeshes)
-		{
-			auto mat = getOrCreateMeshMaterial(mo->mesh->materialName);//mo->get_material();
-			auto pipeline = mat->getPipeline();
+		// deferred base pass: draw the meshes with materials (draws are indices into renderList.records)
+		auto recordOpaqueDraws = [this](VkCommandBuffer cmdbuf, const std::vector<uint32_t>& draws, uint32_t begin, uint32_t end) {
+			auto materialOf = [&](uint32_t i) {
+				return renderList.materialSlots[renderList.records[draws[i]].materialSlot].material;
+			};
+			Material* last_material = nullptr;
+			MaterialPipeline last_pipeline = {};
+			uint32_t instance = 0;
+			for (uint32_t i = begin; i < end; i++)
+			{
+				auto mo = renderList.records[draws[i]].meshObject;
+				auto mat = materialOf(i);
+				auto pipeline = mat->getPipeline();
+
+				// pipeline changed: re-bind
+				if (pipeline != last_pipeline) {
+					mat->usePipeline(cmdbuf);
+					last_pipeline = pipeline;
+				}
 
-			// pipeline changed: re-bind; re-set frame globals if necessary
-			if (pipeline != last_pipeline) {
-				mat->usePipeline(cmdbuf);
-				last_pipeline = pipeline;
-			}
+				// material changed: reserve its per-object slots for the whole run of draws (they're sorted by material)
+				if (mat != last_material) {
+					uint32_t runEnd = i + 1;
+					while (runEnd < end && materialOf(runEnd) == mat) runEnd++;
+					instance = mat->allocateInstances(runEnd - i);
+					last_material = mat;
+				}
 
-			// material changed
-			if (mat != last_material) {
-				last_material = mat;
+				mat->setParameters(cmdbuf, mo, instance++);
+				mo->draw(cmdbuf);
 			}
+		};
 
-			mat->setParameters(cmdbuf, mo);
-			mo->draw(cmdbuf);
+		if (bindlessDrawing) {
+			SCOPED_DRAW_EVENT(cmdbuf, "Opaque base pass (bindless)")
+			bindlessScene->draw(cmdbuf);
+			// materials that didn't get a bindless slot
+			auto& fallbackDraws = bindlessScene->getFallbackDraws();
+			recordOpaqueDraws(cmdbuf, fallbackDraws, 0, fallbackDraws.size());
+		} else if (useSecondaries) {
+			opaqueCommandBuffers.record(cmdbuf, mainPass, 0, framebuffer, renderList.opaqueDraws.size(),
+				[&](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+					SCOPED_DRAW_EVENT(secondary, "Opaque base pass")
+					// secondary command buffers don't inherit bound descriptor sets
+					frameGlobalDescriptorSet.bind(
+						secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, DSET_FRAMEGLOBAL, deferredLighting->getPipeline().layout);
+					recordOpaqueDraws(secondary, renderList.opaqueDraws, begin, end);
+				});
+		} else {
+			SCOPED_DRAW_EVENT(cmdbuf, "Opaque base pass")
+			recordOpaqueDraws(cmdbuf, renderList.opaqueDraws, 0, renderList.opaqueDraws.size());
 		}
-
 	}
 
 	{
@@ -741,7 +746,7 @@ void DeferredRenderer::render(VkCommandBuffer cmdbuf)
 		vkCmdNextSubpass(cmdbuf, VK_SUBPASS_CONTENTS_INLINE);
 		bool firstInstance = true;
 		auto mat = Probe::get_material();
-		for (auto probe : probes) // TODO: material (pipeline) sorting, etc.
+		for (auto probe : renderList.probes) // TODO: material (pipeline) sorting, etc.
 		{
 			if (firstInstance) {
 				mat->resetInstanceCounter();
@@ -758,8 +763,10 @@ void DeferredRenderer::render(VkCommandBuffer cmdbuf)
 		vkCmdNextSubpass(cmdbuf, VK_SUBPASS_CONTENTS_INLINE);
 		Material* last_material = nullptr;
 		MaterialPipeline last_pipeline = {};
-		for (auto mo : translucentMeshes) {
-			auto mat = getOrCreateMeshMaterial(mo->mesh->materialName);//mo->get_material();
+		for (auto drawIndex : renderList.translucentDraws) {
+			auto& record = renderList.records[drawIndex];
+			auto mo = record.meshObject;
+			auto mat = renderList.materialSlots[record.materialSlot].material;
 			auto pipeline = mat->getPipeline();
 
 			// pipeline changed: re-bind; re-set frame globals if necessary
@@ -778,38 +785,32 @@ void DeferredRenderer::render(VkCommandBuffer cmdbuf)
 		}
 	}
 	vkCmdEndRenderPass(cmdbuf);
+}
 
+void DeferredRenderer::recordPostProcessPass(VkCommandBuffer cmdbuf)
+{
+	VkRenderPassBeginInfo passInfo = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+		.renderPass = postProcessPass,
+		.framebuffer = postProcessFramebuffer,
+		.renderArea = { .offset = {0, 0}, .extent = renderExtent },
+		.clearValueCount = 0,
+		.pClearValues = nullptr
+	};
+	vkCmdBeginRenderPass(cmdbuf, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 	{
-		SCOPED_DRAW_EVENT(cmdbuf, "Post Processing & Present")
-		VkRenderPassBeginInfo passInfo = {
-			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-			.renderPass = postProcessPass,
-			.framebuffer = postProcessFramebuffer,
-			.renderArea = renderArea,
-			.clearValueCount = 0,
-			.pClearValues = nullptr
-		};
-		vkCmdBeginRenderPass(cmdbuf, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
-		{
-			SCOPED_DRAW_EVENT(cmdbuf, "Post processing")
-			postProcessing->usePipeline(cmdbuf);
-			vk::drawFullscreenTriangle(cmdbuf);
-			vkCmdNextSubpass(cmdbuf, VK_SUBPASS_CONTENTS_INLINE);
-		}
-		{
-			if (drawDebug) {
-				SCOPED_DRAW_EVENT(cmdbuf, "Debug draw")
-				if (debugLines) debugLines->bindAndDraw(cmdbuf);
-				if (debugPoints) debugPoints->bindAndDraw(cmdbuf);
-			}
-			vkCmdEndRenderPass(cmdbuf);
+		SCOPED_DRAW_EVENT(cmdbuf, "Post processing")
+		postProcessing->usePipeline(cmdbuf);
+		vk::drawFullscreenTriangle(cmdbuf);
+		vkCmdNextSubpass(cmdbuf, VK_SUBPASS_CONTENTS_INLINE);
+	}
+	{
+		if (drawDebug) {
+			SCOPED_DRAW_EVENT(cmdbuf, "Debug draw")
+			if (debugLines) debugLines->bindAndDraw(cmdbuf);
+			if (debugPoints) debugPoints->bindAndDraw(cmdbuf);
 		}
-
-		vk::blitToScreen(
-			cmdbuf,
-			postProcessed->resource.image,
-			{0, 0, 0},
-			{(int32_t)renderExtent.width, (int32_t)renderExtent.height, 1});
+		vkCmdEndRenderPass(cmdbuf);
 	}
 }
 
@@ -843,7 +844,9 @@ Material* DeferredRenderer::getOrCreateMeshMaterial(const std::string &materialN
 		} else {
 			// obsolete; delete and create a new one below
 			pooled_mat->markPipelineDirty();
-			delete pooled_mat;
+			if (bindlessScene) bindlessScene->removeMaterial(pooled_mat);
+			// (its descriptors and buffers may still be used by frames in flight)
+			Vulkan::Instance->destroyAfterFramesInFlight([pooled_mat]() { delete pooled_mat; });
 		}
 	}
 
@@ -851,6 +854,7 @@ Material* DeferredRenderer::getOrCreateMeshMaterial(const std::string &materialN
 	GltfMaterial* newMaterial;
 	if (info->blendMode == BM_OpaqueOrClip) {
 		newMaterial = new PbrGltfMaterial(*info);
+		if (bindlessScene) bindlessScene->addMaterial(newMaterial);
 	} else {
 		newMaterial = new PbrTranslucentGltfMaterial(*info);
 	}
@@ -859,6 +863,18 @@ Material* DeferredRenderer::getOrCreateMeshMaterial(const std::string &materialN
 	return newMaterial;
 }
 
+void DeferredRenderer::warm_up_pipelines()
+{
+	deferredLighting->getPipeline();
+	postProcessing->getPipeline();
+	Probe::get_material()->getPipeline();
+	if (bindlessScene) bindlessScene->warmUpPipelines();
+	// the scene's materials only make a couple different pipelines between them, but they get created here too
+	GltfMaterialInfo::forEach([this](const GltfMaterialInfo& info) {
+		getOrCreateMeshMaterial(info.name)->getPipeline();
+	});
+}
+
 void DeferredRenderer::draw_config_ui() {
 	ImGui::SliderFloat("", &viewInfo.Exposure, -25, 25, "exposure comp: %.3f");
 	ImGui::Combo(
@@ -866,4 +882,19 @@ void DeferredRenderer::draw_config_ui() {
 		&viewInfo.ToneMappingOption,
 		"Off\0Reinhard2\0ACES\0\0");
 	ImGui::Checkbox("draw debug", &drawDebug);
+	ImGui::Checkbox("frustum culling", &renderList.frustumCulling);
+	ImGui::Checkbox("occlusion culling", &renderList.occlusionCulling);
+	ImGui::Checkbox("parallel command recording", &parallelRecording);
+	if (bindlessScene) {
+		ImGui::Checkbox("bindless drawing", &bindlessDrawing);
+		if (bindlessDrawing) {
+			ImGui::Text("bindless: %u materials, %u indirect draws", bindlessScene->getNumMaterials(), bindlessScene->getNumBatches());
+		}
+	}
+	ImGui::Text("draws: %u / %u (%u outside frustum, %u occluded)",
+		uint32_t(renderList.opaqueDraws.size() + renderList.translucentDraws.size()), uint32_t(renderList.records.size()),
+		renderList.stats.frustumCulled, renderList.stats.occlusionCulled);
+	ImGui::Text("occluders: %u (%u triangles)", renderList.stats.occluders, renderList.stats.occluderTriangles);
+	ImGui::Text("render targets: %.1f MB (%.1f MB if they didn't share memory)",
+		double(graphImages.getAllocatedSize()) / (1024 * 1024), double(graphImages.getUnaliasedSize()) / (1024 * 1024));
 }
@@ -2,8 +2,12 @@
 
 #include "Renderer.h"
 #include "Render/Vulkan/DescriptorSet.h"
+#include "Render/RenderList.h"
+#include "Render/Vulkan/SecondaryCommandBuffers.h"
+#include "Render/RenderGraph.h"
+#include "Render/Vulkan/TransientImagePool.h"
 
-class Texture2D;
+class BindlessScene;
 class DebugPoints;
 class DebugLines;
 class DeferredLighting;
@@ -76,6 +80,8 @@ public:
 
 	void draw_config_ui() override;
 
+	void warm_up_pipelines() override;
+
 	static DeferredRenderer* get();
 
 private:
@@ -85,26 +91,46 @@ private:
 
 	bool drawDebug = true;
 
-	VkFramebuffer framebuffer;
-	VkFramebuffer postProcessFramebuffer;
+	// base pass draws get recorded on the worker pool (see SecondaryCommandBuffers)
+	bool parallelRecording = true;
+	SecondaryCommandBuffers opaqueCommandBuffers;
+
+	// opaque draws as a few indirect draws with all materials bound at once (see BindlessScene); null if the device
+	// can't do it. Translucent draws always go one by one
+	BindlessScene* bindlessScene = nullptr;
+	bool bindlessDrawing = false;
+
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	VkFramebuffer postProcessFramebuffer = VK_NULL_HANDLE;
 
 	VmaBuffer viewInfoUbo;
 
 	VkExtent2D renderExtent;
 
-	Texture2D* GPosition;
+	// declared again every frame (see render()); the images stay as long as the declaration doesn't change
+	RenderGraph renderGraph;
+	TransientImagePool graphImages;
+
+	RenderGraph::Handle GPosition;
+
+	RenderGraph::Handle GNormal;
+
+	RenderGraph::Handle GColor;
+
+	RenderGraph::Handle GORM;
 
-	Texture2D* GNormal;
+	RenderGraph::Handle sceneColor;
 
-	Texture2D* GColor;
+	RenderGraph::Handle sceneDepth;
 
-	Texture2D* GORM;
+	RenderGraph::Handle postProcessed;
 
-	Texture2D* sceneColor;
+	// re-creates the framebuffers and re-points the descriptors after graphImages changed
+	void updateGraphImageViews();
 
-	Texture2D* sceneDepth;
+	void recordMainPass(VkCommandBuffer cmdbuf);
 
-	Texture2D* postProcessed;
+	void recordPostProcessPass(VkCommandBuffer cmdbuf);
 
 	// specific to this renderer
 
@@ -136,6 +162,7 @@ private:
 
 	// mesh materials
 
+	RenderList renderList;
 	std::unordered_map<std::string, GltfMaterial*> materials;
 	Material* getOrCreateMeshMaterial(const std::string& materialName);
 };
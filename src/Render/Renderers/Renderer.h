@@ -25,6 +25,9 @@ public:
 
 	virtual void draw_config_ui() {}
 
+	// builds the pipelines it's going to need ahead of its first frame (see PipelineLibrary::beginWarmup)
+	virtual void warm_up_pipelines() {}
+
 	virtual void render(VkCommandBuffer cmdbuf) = 0;
 #else
 	virtual void render_to_file(const std::string& output_path_rel_to_bin) = 0;
@@ -9,6 +9,7 @@
 #include "Render/Vulkan/VulkanUtils.h"
 #include "SimpleRenderer.h"
 #include "Render/Texture.h"
+#include "Render/TextureStreaming.h"
 #include "Render/DebugDraw.h"
 
 SimpleRenderer::SimpleRenderer()
@@ -165,10 +166,11 @@ void SimpleRenderer::updateViewInfoUbo()
 
 void SimpleRenderer::render(VkCommandBuffer cmdbuf)
 {
-	// reset material instance counters
+	// reset material instance counters; textures may have streamed in a different resolution
 	for (auto it : materials)
 	{
 		it.second->resetInstanceCounter();
+		it.second->updateTextureDescriptors();
 	}
 
 	// prepare frameglobals
@@ -232,6 +234,12 @@ void SimpleRenderer::render(VkCommandBuffer cmdbuf)
 				mat->setParameters(cmdbuf, mo);
 				mo->draw(cmdbuf);
 				instance_ctr++;
+
+				if (auto info = GltfMaterialInfo::get(mo->mesh->materialName)) {
+					auto box = mo->world_aabb();
+					texture_streaming::report_material(*info, texture_streaming::screen_footprint(
+						box.min, box.max, viewInfo.CameraPosition, camera->fov * 0.5f, float(renderExtent.height)));
+				}
 			}
 		}
 		{
@@ -270,7 +278,7 @@ Material *SimpleRenderer::getOrCreateMeshMaterial(const std::string &materialNam
 		else {
 			// pooled material is obsolete; delete it.
 			pooled_mat->markPipelineDirty();
-			delete pooled_mat;
+			Vulkan::Instance->destroyAfterFramesInFlight([pooled_mat]() { delete pooled_mat; });
 		}
 	}
 
@@ -1,14 +1,31 @@
 #include "Texture.h"
 #include <stb_image/stb_image.h>
 #include "Render/Vulkan/VulkanUtils.h"
+#include "Render/TextureCook.h"
+#include <mutex>
+#include <deque>
+#include <cmath>
 
 std::unordered_map<std::string, Texture *> Texture::texturePool;
 
+namespace
+{
+	std::mutex pendingUploadsMutex;
+	std::deque<Texture2D::PendingUpload> pendingUploads;
+}
+
 Texture::~Texture()
 {
 	vmaDestroyImage(Vulkan::Instance->memoryAllocator, resource.image, resource.allocation);
 }
 
+void Texture::addPlaceholder(const std::string &name, const std::string &placeholderName)
+{
+	auto it = texturePool.find(placeholderName);
+	EXPECT_M(it != texturePool.end(), true, "placeholder texture '%s' isn't in the pool", placeholderName.c_str())
+	texturePool[name] = it->second;
+}
+
 //--------
 
 void createTexture2DFromPixelData(
@@ -216,6 +233,118 @@ Texture2D::Texture2D(const std::string &name, uint8_t *data, uint32_t width, uin
 	NAME_OBJECT(VK_OBJECT_TYPE_IMAGE_VIEW, imageView, name + "_defaultView")
 }
 
+Texture2D::Texture2D(const std::string &name, const texture_cook::CookedTexture &cooked)
+{
+	LOG("loading texture '%s' (compressed)..", name.c_str())
+	createCookedImage(name, cooked);
+	texturePool[name] = this;
+}
+
+void Texture2D::replaceMips(const std::string &name, const texture_cook::CookedTexture &cooked)
+{
+	auto oldResource = resource;
+	auto oldImageView = imageView;
+	createCookedImage(name, cooked);
+	imageVersion++;
+	Vulkan::Instance->destroyAfterFramesInFlight([oldResource, oldImageView]() {
+		vkDestroyImageView(Vulkan::Instance->device, oldImageView, nullptr);
+		vmaDestroyImage(Vulkan::Instance->memoryAllocator, oldResource.image, oldResource.allocation);
+	});
+}
+
+void Texture2D::createCookedImage(const std::string &name, const texture_cook::CookedTexture &cooked)
+{
+	switch (cooked.format)
+	{
+		case texture_cook::F_BC7_UNORM: imageFormat = VK_FORMAT_BC7_UNORM_BLOCK; break;
+		case texture_cook::F_BC7_SRGB: imageFormat = VK_FORMAT_BC7_SRGB_BLOCK; break;
+		case texture_cook::F_BC5_UNORM: imageFormat = VK_FORMAT_BC5_UNORM_BLOCK; break;
+		case texture_cook::F_BC6H_UFLOAT: imageFormat = VK_FORMAT_BC6H_UFLOAT_BLOCK; break;
+	}
+	width = cooked.width;
+	height = cooked.height;
+	auto numMips = static_cast<uint32_t>(cooked.mips.size());
+
+	VkImageCreateInfo imgInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = imageFormat,
+		.extent = {width, height, 1},
+		.mipLevels = numMips,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+	};
+	VmaAllocationCreateInfo imgAllocInfo = {
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY
+	};
+	vmaCreateImage(Vulkan::Instance->memoryAllocator, &imgInfo, &imgAllocInfo, &resource.image, &resource.allocation, nullptr);
+
+	std::vector<VkDeviceSize> mipOffsets(numMips);
+	std::vector<VkExtent2D> mipExtents(numMips);
+	for (uint32_t i = 0; i < numMips; i++)
+	{
+		mipOffsets[i] = cooked.mips[i].offset;
+		mipExtents[i] = {cooked.mips[i].width, cooked.mips[i].height};
+	}
+	vk::uploadMipsToImage(cooked.data(), cooked.size(), mipOffsets, mipExtents, resource);
+
+	VkImageViewCreateInfo viewInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.flags = 0,
+		.image = resource.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = imageFormat,
+		.components = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = numMips,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	EXPECT(vkCreateImageView(Vulkan::Instance->device, &viewInfo, nullptr, &imageView), VK_SUCCESS)
+
+	NAME_OBJECT(VK_OBJECT_TYPE_IMAGE, resource.image, name)
+	NAME_OBJECT(VK_OBJECT_TYPE_IMAGE_VIEW, imageView, name + "_defaultView")
+}
+
+void Texture2D::enqueueUpload(PendingUpload &&upload)
+{
+	std::lock_guard<std::mutex> lock(pendingUploadsMutex);
+	pendingUploads.push_back(std::move(upload));
+}
+
+uint32_t Texture2D::uploadPendingTextures(VkDeviceSize budgetBytes)
+{
+	std::vector<PendingUpload> uploads;
+	{
+		std::lock_guard<std::mutex> lock(pendingUploadsMutex);
+		VkDeviceSize totalBytes = 0;
+		while (!pendingUploads.empty() && (uploads.empty() || totalBytes < budgetBytes)) {
+			auto& upload = pendingUploads.front();
+			if (!upload.cancelled || !*upload.cancelled) {
+				totalBytes += upload.cooked ? upload.cooked->size() : upload.pixels.size();
+				uploads.push_back(std::move(upload));
+			}
+			pendingUploads.pop_front();
+		}
+	}
+	if (uploads.empty()) return 0;
+
+	// the copies go through the staging ring, ahead of the next frame; whatever these replace is retired by their
+	// owners once the frames in flight are done with it (see SceneAsset::on_texture_created)
+	for (auto& upload : uploads) {
+		auto tex = upload.cooked ?
+			new Texture2D(upload.name, *upload.cooked) :
+			new Texture2D(upload.name, upload.pixels.data(), upload.width, upload.height, upload.format);
+		if (upload.onCreated) upload.onCreated(tex);
+	}
+	return uploads.size();
+}
+
 Texture2D::~Texture2D()
 {
 	vkDestroyImageView(Vulkan::Instance->device, imageView, nullptr);
@@ -1,9 +1,15 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
 #include "Render/Vulkan/Vulkan.hpp"
 #include "Render/Vulkan/ImageCreator.h"
 
+namespace texture_cook { struct CookedTexture; }
+
 struct ImageFormat {
 	int numChannels;
 	int channelDepth;
@@ -26,6 +32,9 @@ public:
 	}
 	virtual ~Texture();
 
+	// make 'name' resolve to an already pooled texture until a texture with that name is actually created
+	static void addPlaceholder(const std::string &name, const std::string &placeholderName);
+
 	VmaAllocatedImage resource;
 
 protected:
@@ -56,20 +65,54 @@ public:
 		bool generateMips = true
 		);
 
+	// block compressed, with its whole mip chain (see TextureCook.h) (POOLED)
+	explicit Texture2D(
+		const std::string &name,
+		const texture_cook::CookedTexture &cooked);
+
 	// allocate programmatically (NOT POOLED)
 	explicit Texture2D(ImageCreator &imageCreator);
 
 	uint32_t getWidth() const { return width; }
 	uint32_t getHeight() const { return height; }
 
+	// (cooked textures only) swaps in another part of the same mip chain, keeping this object so everything pointing to
+	// it stays valid. The old image and view are destroyed once the frames in flight are done with them: descriptors
+	// holding imageView have to be re-written before their next use, whenever getImageVersion() changes
+	void replaceMips(const std::string &name, const texture_cook::CookedTexture &cooked);
+	uint32_t getImageVersion() const { return imageVersion; }
+
 	~Texture2D() override;
 
 	static void createDefaultTextures(); // (POOLED)
 
+	// pixels decoded (or cooked) off the main thread, waiting to become a (POOLED) texture
+	struct PendingUpload {
+		std::string name;
+		std::vector<uint8_t> pixels;
+		std::shared_ptr<texture_cook::CookedTexture> cooked; // if set, used instead of pixels
+		uint32_t width;
+		uint32_t height;
+		ImageFormat format;
+		std::shared_ptr<std::atomic<bool>> cancelled; // skipped if set by the time it's uploaded
+		std::function<void(Texture2D*)> onCreated;
+	};
+
+	// can be called from any thread
+	static void enqueueUpload(PendingUpload &&upload);
+
+	// main thread only. Creates queued textures until budgetBytes of pixel (or block) data went through (at least one per call).
+	// Doesn't wait for the gpu: the uploads land before the next frame is submitted
+	static uint32_t uploadPendingTextures(VkDeviceSize budgetBytes);
+
 protected:
 	uint32_t width;
 	uint32_t height;
+	uint32_t imageVersion = 0;
 
 	Texture2D() = default;
 
+private:
+	void createCookedImage(const std::string &name, const texture_cook::CookedTexture &cooked);
+
 };
\ No newline at end of file
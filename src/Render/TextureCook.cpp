@@ -0,0 +1,233 @@
+#include "TextureCook.h"
+#include "Assets/AssetGraph.h"
+#include "Utils/myn/BlockCompression.h"
+#include "Utils/myn/BinaryFile.h"
+#include "Utils/myn/Threading.h"
+#include "Utils/myn/Log.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+
+using namespace glm;
+
+#define TEXTURE_CACHE_MAGIC 0x5845544e // "NTEX"
+// bump when the mip filter or the encoders change; part of the cache key
+#define TEXTURE_COOK_VERSION 2
+
+namespace
+{
+	float srgb_to_linear(float c) {
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linear_to_srgb(float c) {
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// half resolution (rounded down, at least 1) with a separable [1 3 3 1] / 8 filter and clamped edges: less
+	// aliasing than a 2x2 box, and odd sizes don't shift the image
+	std::vector<vec4> downsample(const std::vector<vec4>& src, uint32_t width, uint32_t height)
+	{
+		uint32_t out_width = std::max(1u, width / 2);
+		uint32_t out_height = std::max(1u, height / 2);
+		auto filter = [](const vec4* row, uint32_t size, uint32_t stride, uint32_t out_size, uint32_t i) -> vec4 {
+			if (size == 1) return row[0];
+			// source span of output texel i is [2i, 2i + 2) scaled to the source size
+			float center = (float(i) + 0.5f) * float(size) / float(out_size) - 0.5f;
+			int base = int(std::floor(center)) - 1;
+			constexpr float weights[4] = { 1, 3, 3, 1 };
+			vec4 sum(0);
+			for (int k = 0; k < 4; k++) {
+				int s = std::clamp(base + k, 0, int(size) - 1);
+				sum += row[size_t(s) * stride] * weights[k];
+			}
+			return sum / 8.0f;
+		};
+
+		std::vector<vec4> horizontal(size_t(out_width) * height);
+		myn::WorkerPool::shared().parallel_for(height, [&](uint32_t y) {
+			for (uint32_t x = 0; x < out_width; x++) {
+				horizontal[size_t(y) * out_width + x] = filter(&src[size_t(y) * width], width, 1, out_width, x);
+			}
+		});
+		std::vector<vec4> result(size_t(out_width) * out_height);
+		myn::WorkerPool::shared().parallel_for(out_height, [&](uint32_t y) {
+			for (uint32_t x = 0; x < out_width; x++) {
+				result[size_t(y) * out_width + x] = filter(&horizontal[x], height, out_width, out_height, y);
+			}
+		});
+		return result;
+	}
+
+	// blocks are encoded in strips of 4 rows, in parallel
+	template<typename T>
+	void encode_mip(
+		const T* pixels, uint32_t width, uint32_t height, uint8_t* out_blocks,
+		void (*encode)(const T*, uint32_t, uint32_t, uint8_t*))
+	{
+		uint32_t strips = (height + 3) / 4;
+		size_t strip_size = myn::bc::compressed_size(width, 4);
+		myn::WorkerPool::shared().parallel_for(strips, [&](uint32_t s) {
+			uint32_t rows = std::min(4u, height - s * 4);
+			encode(pixels + size_t(s) * 4 * width * 4, width, rows, out_blocks + s * strip_size);
+		});
+	}
+
+	// runs the filter over the whole chain in float, calling store(texels, width, height, out_blocks) for each mip
+	template<typename Store>
+	std::shared_ptr<texture_cook::CookedTexture> build_mips(
+		texture_cook::Format format, std::vector<vec4> level, uint32_t width, uint32_t height, Store store)
+	{
+		auto cooked = std::make_shared<texture_cook::CookedTexture>();
+		cooked->format = format;
+		cooked->width = width;
+		cooked->height = height;
+
+		uint64_t total_size = 0;
+		for (uint32_t w = width, h = height;; w = std::max(1u, w / 2), h = std::max(1u, h / 2)) {
+			uint64_t size = myn::bc::compressed_size(w, h);
+			cooked->mips.push_back({ .width = w, .height = h, .offset = total_size, .size = size });
+			total_size += size;
+			if (w == 1 && h == 1) break;
+		}
+		cooked->bytes.resize(total_size);
+
+		for (uint32_t i = 0; i < cooked->mips.size(); i++) {
+			auto& mip = cooked->mips[i];
+			if (i > 0) level = downsample(level, cooked->mips[i - 1].width, cooked->mips[i - 1].height);
+			store(level, mip.width, mip.height, cooked->bytes.data() + mip.offset);
+		}
+		return cooked;
+	}
+
+	template<typename T>
+	std::shared_ptr<texture_cook::CookedTexture> cook_unorm(
+		const T* rgba, uint32_t width, uint32_t height, texture_cook::Format format)
+	{
+		bool srgb = format == texture_cook::F_BC7_SRGB;
+		bool normal_map = format == texture_cook::F_BC5_UNORM;
+
+		// filter in linear space, and normals as vectors
+		constexpr float max_value = float(std::numeric_limits<T>::max());
+		std::vector<vec4> level(size_t(width) * height);
+		myn::WorkerPool::shared().parallel_for(height, [&](uint32_t y) {
+			for (uint32_t x = 0; x < width; x++) {
+				size_t i = size_t(y) * width + x;
+				vec4 c = vec4(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3]) / max_value;
+				if (srgb) c = vec4(srgb_to_linear(c.r), srgb_to_linear(c.g), srgb_to_linear(c.b), c.a);
+				if (normal_map) c = vec4(vec3(c) * 2.0f - 1.0f, c.a);
+				level[i] = c;
+			}
+		});
+
+		std::vector<uint8_t> pixels;
+		return build_mips(format, std::move(level), width, height, [&](const std::vector<vec4>& texels, uint32_t w, uint32_t h, uint8_t* out) {
+			pixels.resize(size_t(w) * h * 4);
+			for (size_t i = 0; i < size_t(w) * h; i++) {
+				vec4 c = texels[i];
+				if (srgb) c = vec4(linear_to_srgb(c.r), linear_to_srgb(c.g), linear_to_srgb(c.b), c.a);
+				if (normal_map) {
+					// averaging shortens normals; the shader reconstructs z from xy assuming unit length
+					vec3 n = length(vec3(c)) > 1e-6f ? normalize(vec3(c)) : vec3(0, 0, 1);
+					c = vec4(n * 0.5f + 0.5f, c.a);
+				}
+				for (int k = 0; k < 4; k++) pixels[i * 4 + k] = uint8_t(std::clamp(c[k] * 255.0f + 0.5f, 0.0f, 255.0f));
+			}
+			encode_mip<uint8_t>(pixels.data(), w, h, out, normal_map ? myn::bc::encode_bc5 : myn::bc::encode_bc7);
+		});
+	}
+
+	std::string cache_path(uint64_t key) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.tex", (unsigned long long)key);
+		return ROOT_DIR"/texture_cache/" + std::string(name);
+	}
+}
+
+namespace texture_cook
+{
+	Format format_for(bool srgb, bool normal_map) {
+		if (normal_map) return F_BC5_UNORM;
+		return srgb ? F_BC7_SRGB : F_BC7_UNORM;
+	}
+
+	std::shared_ptr<CookedTexture> cook(const uint8_t* rgba, uint32_t width, uint32_t height, Format format)
+	{
+		return cook_unorm(rgba, width, height, format);
+	}
+
+	std::shared_ptr<CookedTexture> cook(const uint16_t* rgba, uint32_t width, uint32_t height, Format format)
+	{
+		return cook_unorm(rgba, width, height, format);
+	}
+
+	std::shared_ptr<CookedTexture> cook_hdr(const float* rgba, uint32_t width, uint32_t height)
+	{
+		std::vector<vec4> level(size_t(width) * height);
+		memcpy(level.data(), rgba, level.size() * sizeof(vec4));
+		return build_mips(F_BC6H_UFLOAT, std::move(level), width, height, [&](const std::vector<vec4>& texels, uint32_t w, uint32_t h, uint8_t* out) {
+			encode_mip<float>(&texels[0].x, w, h, out, myn::bc::encode_bc6h);
+		});
+	}
+
+	std::shared_ptr<CookedTexture> mip_tail(const CookedTexture& texture, uint32_t first_mip)
+	{
+		auto tail = std::make_shared<CookedTexture>();
+		tail->format = texture.format;
+		tail->width = texture.mips[first_mip].width;
+		tail->height = texture.mips[first_mip].height;
+		uint64_t base = texture.mips[first_mip].offset;
+		for (uint32_t i = first_mip; i < texture.mips.size(); i++) {
+			auto mip = texture.mips[i];
+			mip.offset -= base;
+			tail->mips.push_back(mip);
+		}
+		tail->bytes.assign(texture.data() + base, texture.data() + texture.size());
+		return tail;
+	}
+
+	uint64_t cache_key(uint64_t content_hash, Format format)
+	{
+		uint32_t params[2] = { TEXTURE_COOK_VERSION, format };
+		return AssetGraph::hash(params, sizeof(params), content_hash);
+	}
+
+	std::shared_ptr<CookedTexture> load_cached(uint64_t key)
+	{
+		auto file = std::make_shared<myn::MappedFile>(cache_path(key));
+		if (!file->is_open()) return nullptr;
+
+		myn::BinaryReader reader(file->data(), file->size());
+		if (reader.read<uint32_t>() != TEXTURE_CACHE_MAGIC) return nullptr;
+		auto cooked = std::make_shared<CookedTexture>();
+		cooked->format = reader.read<Format>();
+		cooked->width = reader.read<uint32_t>();
+		cooked->height = reader.read<uint32_t>();
+		reader.read_vector(cooked->mips);
+		cooked->mapped_data = reader.read_array<uint8_t>(cooked->mapped_size);
+		cooked->cache_file = file;
+		if (!reader.ok() || cooked->mips.empty() || cooked->mips.back().offset + cooked->mips.back().size > cooked->mapped_size) {
+			WARN("texture cache entry '%s' is broken, cooking again..", cache_path(key).c_str())
+			return nullptr;
+		}
+		return cooked;
+	}
+
+	bool save_cached(uint64_t key, const CookedTexture& texture)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(ROOT_DIR"/texture_cache", ec);
+
+		myn::BinaryWriter writer;
+		writer.write<uint32_t>(TEXTURE_CACHE_MAGIC);
+		writer.write(texture.format);
+		writer.write(texture.width);
+		writer.write(texture.height);
+		writer.write_vector(texture.mips);
+		writer.write_array(texture.data(), texture.size());
+		return writer.save(cache_path(key));
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace myn { class MappedFile; }
+
+/*
+ * Load-time (cached) texture preprocessing: mip chains generated on the cpu, then block compressed, so the runtime
+ * only has to copy them into an image. Nothing here touches the gpu.
+ */
+namespace texture_cook
+{
+	enum Format : uint32_t {
+		F_BC7_UNORM,
+		F_BC7_SRGB,
+		F_BC5_UNORM, // tangent space normals: xy only, z gets reconstructed when sampling
+		F_BC6H_UFLOAT,
+	};
+
+	struct Mip {
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset; // into the texture's data
+		uint64_t size;
+	};
+
+	struct CookedTexture {
+		Format format;
+		uint32_t width;
+		uint32_t height;
+		std::vector<Mip> mips;
+
+		const uint8_t* data() const { return mapped_data ? mapped_data : bytes.data(); }
+		uint64_t size() const { return mapped_data ? mapped_size : bytes.size(); }
+
+		// either owns its data, or points into the mapped cache file
+		std::vector<uint8_t> bytes;
+		const uint8_t* mapped_data = nullptr;
+		uint64_t mapped_size = 0;
+		std::shared_ptr<myn::MappedFile> cache_file;
+	};
+
+	// which format an 8 bit rgba image ends up in
+	Format format_for(bool srgb, bool normal_map);
+
+	// 8 or 16 bit rgba -> BC7 / BC5 (F_BC5_UNORM expects tangent space normals in rgb). The mips are filtered at the
+	// source's precision.
+	// Parallel over the shared WorkerPool, except when called from a JobQueue job (then it runs on that thread only)
+	std::shared_ptr<CookedTexture> cook(const uint8_t* rgba, uint32_t width, uint32_t height, Format format);
+	std::shared_ptr<CookedTexture> cook(const uint16_t* rgba, uint32_t width, uint32_t height, Format format);
+
+	// rgba32f -> BC6H (alpha is dropped)
+	std::shared_ptr<CookedTexture> cook_hdr(const float* rgba, uint32_t width, uint32_t height);
+
+	// copy of mips [first_mip, end) as a texture of its own (for uploading only part of the chain). Reading from a
+	// mapped texture is what pulls its pages in from disk, so this is the part to run off the main thread
+	std::shared_ptr<CookedTexture> mip_tail(const CookedTexture& texture, uint32_t first_mip);
+
+	// the cache is content-addressed: the key covers the source image, the target format and the cook version,
+	// so nothing ever needs invalidating (old entries can just be deleted)
+	uint64_t cache_key(uint64_t content_hash, Format format);
+	std::shared_ptr<CookedTexture> load_cached(uint64_t key);
+	bool save_cached(uint64_t key, const CookedTexture& texture);
+}
@@ -0,0 +1,208 @@
+#include "TextureStreaming.h"
+#include "TextureCook.h"
+#include "Render/Materials/GltfMaterialInfo.h"
+#include "Utils/myn/Threading.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+// mips up to this size (longer side, in texels) are always resident
+#define STREAMING_TAIL_SIZE 64
+// textures that weren't reported for this many frames drop back to their tail
+#define STREAMING_EVICT_FRAMES 120
+#define STREAMING_MAX_LOADS_IN_FLIGHT 4
+
+namespace
+{
+	struct StreamedTexture {
+		uint64_t id; // so loads that finish after the texture was removed (or re-added) can be told apart
+		std::shared_ptr<texture_cook::CookedTexture> cooked;
+		std::function<void(Texture2D*)> onCreated;
+		Texture2D* texture = nullptr; // owned by whoever onCreated handed it to
+		uint32_t tail_mip;
+		uint32_t resident_mip;
+		bool loading = false;
+		float footprint = 0;
+		uint64_t last_seen_frame = 0;
+	};
+
+	struct LoadedMips {
+		std::string name;
+		uint64_t id;
+		uint32_t first_mip;
+		std::shared_ptr<texture_cook::CookedTexture> tail;
+	};
+
+	std::unordered_map<std::string, StreamedTexture> streamed;
+	uint64_t frame = 0;
+	uint64_t next_id = 0;
+
+	// filled in from other threads
+	std::mutex incoming_mutex;
+	std::vector<Texture2D::PendingUpload> added;
+	std::vector<LoadedMips> loaded;
+
+	uint64_t tail_bytes(const texture_cook::CookedTexture& cooked, uint32_t first_mip) {
+		return cooked.size() - cooked.mips[first_mip].offset;
+	}
+
+	void swap_in(StreamedTexture& texture, const std::string& name, const texture_cook::CookedTexture& mips, uint32_t first_mip)
+	{
+		texture.resident_mip = first_mip;
+		if (texture.texture) {
+			// same object, new image: materials re-point their descriptors, frames in flight keep the old one
+			texture.texture->replaceMips(name, mips);
+			return;
+		}
+		texture.texture = new Texture2D(name, mips);
+		if (texture.onCreated) texture.onCreated(texture.texture);
+	}
+}
+
+namespace texture_streaming
+{
+	void add(Texture2D::PendingUpload &&upload)
+	{
+		std::lock_guard<std::mutex> lock(incoming_mutex);
+		added.push_back(std::move(upload));
+	}
+
+	void remove(const std::string& name)
+	{
+		streamed.erase(name);
+		std::lock_guard<std::mutex> lock(incoming_mutex);
+		std::erase_if(added, [&](const Texture2D::PendingUpload& upload) { return upload.name == name; });
+	}
+
+	void report_footprint(const std::string& name, float screen_pixels)
+	{
+		auto it = streamed.find(name);
+		if (it == streamed.end()) return;
+		auto& texture = it->second;
+		if (texture.last_seen_frame != frame) {
+			texture.footprint = 0;
+			texture.last_seen_frame = frame;
+		}
+		texture.footprint = std::max(texture.footprint, screen_pixels);
+	}
+
+	void report_material(const GltfMaterialInfo& material, float screen_pixels)
+	{
+		for (auto name : { &material.albedoTexName, &material.normalTexName, &material.ormTexName, &material.aoTexName, &material.emissiveTexName }) {
+			report_footprint(*name, screen_pixels);
+		}
+	}
+
+	void update(VkDeviceSize memory_budget, VkDeviceSize upload_budget)
+	{
+		frame++;
+
+		std::vector<Texture2D::PendingUpload> new_textures;
+		std::vector<LoadedMips> new_mips;
+		{
+			std::lock_guard<std::mutex> lock(incoming_mutex);
+			new_textures.swap(added);
+			// at least one per frame; the rest waits
+			size_t count = 0;
+			VkDeviceSize total_bytes = 0;
+			while (count < loaded.size() && (count == 0 || total_bytes < upload_budget)) {
+				total_bytes += loaded[count].tail->size();
+				count++;
+			}
+			new_mips.assign(std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.begin() + count));
+			loaded.erase(loaded.begin(), loaded.begin() + count);
+		}
+		std::erase_if(new_textures, [](const Texture2D::PendingUpload& upload) { return upload.cancelled && *upload.cancelled; });
+
+		for (auto& upload : new_textures)
+		{
+			auto& cooked = *upload.cooked;
+			uint32_t tail_mip = 0;
+			while (tail_mip + 1 < cooked.mips.size() &&
+				std::max(cooked.mips[tail_mip].width, cooked.mips[tail_mip].height) > STREAMING_TAIL_SIZE) {
+				tail_mip++;
+			}
+			auto& texture = streamed[upload.name];
+			texture = {
+				.id = next_id++,
+				.cooked = upload.cooked,
+				.onCreated = std::move(upload.onCreated),
+				.tail_mip = tail_mip,
+				.resident_mip = tail_mip,
+				.last_seen_frame = frame
+			};
+			swap_in(texture, upload.name, tail_mip == 0 ? cooked : *texture_cook::mip_tail(cooked, tail_mip), tail_mip);
+		}
+		for (auto& mips : new_mips)
+		{
+			auto it = streamed.find(mips.name);
+			if (it == streamed.end() || it->second.id != mips.id) continue;
+			it->second.loading = false;
+			swap_in(it->second, mips.name, *mips.tail, mips.first_mip);
+		}
+
+		// residency
+		std::vector<std::pair<const std::string, StreamedTexture>*> textures;
+		std::vector<ResidencyRequest> requests;
+		VkDeviceSize resident = 0;
+		uint32_t num_loading = 0;
+		for (auto& p : streamed)
+		{
+			auto& texture = p.second;
+			auto& cooked = *texture.cooked;
+			ResidencyRequest request = {
+				.tail_mip = texture.tail_mip,
+				.wanted_mip = texture.tail_mip,
+				.priority = 0
+			};
+			for (auto& mip : cooked.mips) request.mip_sizes.push_back(mip.size);
+			if (frame - texture.last_seen_frame <= STREAMING_EVICT_FRAMES) {
+				auto wanted = mip_for_footprint(cooked.width, cooked.height, texture.footprint, cooked.mips.size());
+				request.wanted_mip = std::min(texture.tail_mip, wanted);
+				request.priority = texture.footprint;
+			}
+			resident += tail_bytes(cooked, texture.resident_mip) - tail_bytes(cooked, texture.tail_mip);
+			if (texture.loading) num_loading++;
+			textures.push_back(&p);
+			requests.push_back(std::move(request));
+		}
+		auto targets = choose_resident_mips(requests, memory_budget);
+
+		// schedule loads: more detail before less, most visible first
+		std::vector<size_t> changes;
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			auto& texture = textures[i]->second;
+			if (texture.loading || targets[i] == texture.resident_mip) continue;
+			// detail that's still on screen stays until the memory is actually needed
+			bool seen = frame - texture.last_seen_frame <= STREAMING_EVICT_FRAMES;
+			if (targets[i] > texture.resident_mip && seen && resident <= memory_budget) continue;
+			changes.push_back(i);
+		}
+		std::sort(changes.begin(), changes.end(), [&](size_t a, size_t b) {
+			bool a_finer = targets[a] < textures[a]->second.resident_mip;
+			bool b_finer = targets[b] < textures[b]->second.resident_mip;
+			if (a_finer != b_finer) return a_finer;
+			return requests[a].priority > requests[b].priority;
+		});
+		for (size_t i : changes)
+		{
+			if (num_loading >= STREAMING_MAX_LOADS_IN_FLIGHT) break;
+			auto& texture = textures[i]->second;
+			texture.loading = true;
+			num_loading++;
+			myn::JobQueue::background().push([name = textures[i]->first, id = texture.id, first_mip = targets[i], cooked = texture.cooked]() {
+				auto tail = texture_cook::mip_tail(*cooked, first_mip);
+				std::lock_guard<std::mutex> lock(incoming_mutex);
+				loaded.push_back({ name, id, first_mip, std::move(tail) });
+			});
+		}
+	}
+
+	VkDeviceSize resident_bytes()
+	{
+		VkDeviceSize total = 0;
+		for (auto& p : streamed) total += tail_bytes(*p.second.cooked, p.second.resident_mip);
+		return total;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Render/Texture.h"
+#include "Render/TextureStreamingPolicy.h"
+
+struct GltfMaterialInfo;
+
+/*
+ * Mip residency for cooked textures (see TextureCook.h). A streamed texture starts out with only its small mips, then
+ * the renderers report how many pixels it covers on screen, and once per frame every texture gets the mips it needs
+ * for that, as far as the memory budget allows (most under-resolved first). Finer mips are read from the mapped
+ * texture cache in the background; a texture changes resolution by swapping in a different part of its mip chain
+ * (Texture2D::replaceMips), without waiting for the gpu. What should be resident is decided in TextureStreamingPolicy.h.
+ * Main thread only, except for add().
+ */
+namespace texture_streaming
+{
+	// upload.cooked has to be set. Can be called from any thread; the texture (its small mips) gets created by the
+	// next update(), unless upload.cancelled is set by then, and handed to onCreated. Later resolution changes happen
+	// in place. The owner has to remove() it before deleting it
+	void add(Texture2D::PendingUpload &&upload);
+
+	// stops streaming a texture (doesn't delete it); also drops it if it's still waiting to be created
+	void remove(const std::string& name);
+
+	// feedback from the renderers, for this frame. Unknown (ie. not streamed) names are ignored
+	void report_footprint(const std::string& name, float screen_pixels);
+	void report_material(const GltfMaterialInfo& material, float screen_pixels);
+
+	// once per frame: creates added textures, swaps in mips that finished loading (until upload_budget bytes went
+	// through) and schedules new loads/evictions to stay within memory_budget bytes
+	void update(VkDeviceSize memory_budget, VkDeviceSize upload_budget);
+
+	// bytes of all streamed textures' resident mips
+	VkDeviceSize resident_bytes();
+}
@@ -0,0 +1,54 @@
+#include "TextureStreamingPolicy.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <tuple>
+
+namespace texture_streaming
+{
+	std::vector<uint32_t> choose_resident_mips(const std::vector<ResidencyRequest>& requests, uint64_t budget_bytes)
+	{
+		std::vector<uint32_t> result(requests.size());
+		uint64_t used = 0;
+
+		// (mips short of what it wants, priority, index): upgrade the most under-resolved texture by one mip at a time
+		using Candidate = std::tuple<uint32_t, float, size_t>;
+		std::priority_queue<Candidate> candidates;
+		for (size_t i = 0; i < requests.size(); i++) {
+			result[i] = requests[i].tail_mip;
+			if (requests[i].wanted_mip < result[i]) candidates.push({ result[i] - requests[i].wanted_mip, requests[i].priority, i });
+		}
+		while (!candidates.empty()) {
+			auto [deficit, priority, i] = candidates.top();
+			candidates.pop();
+			uint64_t cost = requests[i].mip_sizes[result[i] - 1];
+			// finer mips of this texture won't fit either, but smaller upgrades of others still might
+			if (used + cost > budget_bytes) continue;
+			used += cost;
+			result[i]--;
+			if (deficit > 1) candidates.push({ deficit - 1, priority, i });
+		}
+		return result;
+	}
+
+	uint32_t mip_for_footprint(uint32_t width, uint32_t height, float screen_pixels, uint32_t num_mips)
+	{
+		if (num_mips == 0) return 0;
+		if (screen_pixels <= 0) return num_mips - 1;
+		float mip = std::floor(std::log2(float(std::max(width, height)) / screen_pixels));
+		return uint32_t(std::clamp(mip, 0.0f, float(num_mips - 1)));
+	}
+
+	float screen_footprint(
+		const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+		const glm::vec3& camera_position, float half_vfov_radians, float viewport_height)
+	{
+		glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+		float radius = glm::length(bounds_max - bounds_min) * 0.5f;
+		float distance = glm::length(center - camera_position);
+		// camera is inside: could be right up against any part of it
+		if (distance <= radius) return std::numeric_limits<float>::max();
+		return radius / (distance * std::tan(half_vfov_radians)) * viewport_height;
+	}
+}
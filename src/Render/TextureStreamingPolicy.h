@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+ * The cpu only part of texture streaming (see TextureStreaming.h): which mips should be resident, given how large
+ * textures show up on screen and the memory budget.
+ */
+namespace texture_streaming
+{
+	struct ResidencyRequest {
+		std::vector<uint64_t> mip_sizes; // bytes of each mip, finest first
+		uint32_t tail_mip; // this and coarser mips are always resident
+		uint32_t wanted_mip; // what the screen footprint asks for (<= tail_mip)
+		float priority; // screen footprint in pixels; breaks ties between equally under-resolved textures
+	};
+
+	// first resident mip for each request, so that all resident mips together fit into budget_bytes (tails don't count
+	// against it: they're resident regardless). Textures furthest below their wanted mip get upgraded first.
+	std::vector<uint32_t> choose_resident_mips(const std::vector<ResidencyRequest>& requests, uint64_t budget_bytes);
+
+	// finest mip that's still useful for a texture covering about screen_pixels pixels across
+	uint32_t mip_for_footprint(uint32_t width, uint32_t height, float screen_pixels, uint32_t num_mips);
+
+	// approximate size in pixels of a world space box on screen: the projected diameter of its bounding sphere
+	float screen_footprint(
+		const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+		const glm::vec3& camera_position, float half_vfov_radians, float viewport_height);
+}
@@ -26,6 +26,8 @@ public:
 
 	void release();
 
+	bool isValid() const { return allocator != nullptr; }
+
 	VkDeviceSize strideSize = 0;
 	uint32_t numInstances = 0;
 	uint32_t numStrides = 0;
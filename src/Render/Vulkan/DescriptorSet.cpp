@@ -1,4 +1,5 @@
 #include "DescriptorSet.h"
+#include <algorithm>
 #include "Utils/myn/Log.h"
 #include "Render/Vulkan/SamplerCache.h"
 #include "Render/Vulkan/Vulkan.hpp"
@@ -8,6 +9,13 @@
 
 #define LOG_DESCRIPTORSETLAYOUT_CACHE 0
 
+// the only thing that can be chained to a layout's create info here
+static VkDescriptorBindingFlags getBindingFlags(const VkDescriptorSetLayoutCreateInfo &info, uint32_t bindingIndex)
+{
+	auto flagsInfo = (const VkDescriptorSetLayoutBindingFlagsCreateInfo*)info.pNext;
+	return flagsInfo ? flagsInfo->pBindingFlags[bindingIndex] : 0;
+}
+
 bool operator==(const VkDescriptorSetLayoutCreateInfo &info1, const VkDescriptorSetLayoutCreateInfo &info2)
 {
 	if (info1.bindingCount != info2.bindingCount) return false;
@@ -20,6 +28,7 @@ bool operator==(const VkDescriptorSetLayoutCreateInfo &info1, const VkDescriptor
 		if (binding1.descriptorType != binding2.descriptorType) return false;
 		if (binding1.descriptorCount != binding2.descriptorCount) return false;
 		if (binding1.stageFlags != binding2.stageFlags) return false;
+		if (getBindingFlags(info1, i) != getBindingFlags(info2, i)) return false;
 		// not considering pImmutableSamplers yet
 	}
 	return true;
@@ -34,8 +43,15 @@ public:
 		for (auto i = 0; i < inInfo.bindingCount; i++)
 		{
 			bindings.push_back(inInfo.pBindings[i]);
+			bindingFlags.push_back(getBindingFlags(inInfo, i));
 		}
 		info.pBindings = bindings.data();
+		if (inInfo.pNext)
+		{
+			flagsInfo = *(const VkDescriptorSetLayoutBindingFlagsCreateInfo*)inInfo.pNext;
+			flagsInfo.pBindingFlags = bindingFlags.data();
+			info.pNext = &flagsInfo;
+		}
 
 		EXPECT(vkCreateDescriptorSetLayout(Vulkan::Instance->device, &info, nullptr, &layout), VK_SUCCESS)
 		Vulkan::Instance->destructionQueue.emplace_back([this](){
@@ -44,6 +60,8 @@ public:
 	}
 	VkDescriptorSetLayoutCreateInfo info;
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<VkDescriptorBindingFlags> bindingFlags;
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo = {};
 	VkDescriptorSetLayout layout;
 };
 
@@ -93,23 +111,41 @@ VkDescriptorSetLayout DescriptorSetLayoutCache::get(VkDescriptorSetLayoutCreateI
 //================ END descriptor set layout cache =================
 
 void DescriptorSetLayout::addBinding(uint32_t bindingIndex, VkShaderStageFlags shaderStages, VkDescriptorType type)
+{
+	addBinding(bindingIndex, shaderStages, type, 1, 0);
+}
+
+void DescriptorSetLayout::addBinding(
+	uint32_t bindingIndex,
+	VkShaderStageFlags shaderStages,
+	VkDescriptorType type,
+	uint32_t count,
+	VkDescriptorBindingFlags flags)
 {
 	EXPECT_M(layout, VK_NULL_HANDLE, "Should only add bindings before layout is committed")
 	bindings.push_back({
 		.binding = bindingIndex,
 		.descriptorType = type,
-		.descriptorCount = 1,
+		.descriptorCount = count,
 		.stageFlags = shaderStages,
 		.pImmutableSamplers = nullptr,
 	});
+	bindingFlags.push_back(flags);
 }
 
 VkDescriptorSetLayout DescriptorSetLayout::getLayout()
 {
 	if (layout == VK_NULL_HANDLE)
 	{
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+			.pBindingFlags = bindingFlags.data()
+		};
+		bool hasFlags = std::any_of(bindingFlags.begin(), bindingFlags.end(), [](auto flags) { return flags != 0; });
 		VkDescriptorSetLayoutCreateInfo layoutInfo = {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = hasFlags ? &flagsInfo : nullptr,
 			.bindingCount = static_cast<uint32_t>(bindings.size()),
 			.pBindings = bindings.data(),
 		};
@@ -126,14 +162,15 @@ DescriptorSet::DescriptorSet(DescriptorSetLayout &layout, uint32_t numInstances)
 	if (descriptorPool == VK_NULL_HANDLE)
 	{
 		// TODO: make more reliable
+		// (gltf materials take a set per frame in flight, with 4 samplers each)
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 64 },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 64 },
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 64 }
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1024 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4096 }
 		};
 		VkDescriptorPoolCreateInfo poolInfo = {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-			.maxSets = static_cast<uint32_t>(256),
+			.maxSets = static_cast<uint32_t>(1024),
 			.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
 			.pPoolSizes = poolSizes.data()
 		};
@@ -159,12 +196,12 @@ void DescriptorSet::pointToBuffer(const VmaBuffer &buffer, uint32_t binding, VkD
 {
 	uint32_t numInstances = descriptorSets.size();
 	EXPECT(numInstances != 0, true)
-	EXPECT(buffer.numInstances, numInstances)
+	EXPECT(buffer.numInstances == 1 || buffer.numInstances == numInstances, true)
 
 	for (auto i = 0; i < numInstances; i++)
 	{
 		VkDescriptorBufferInfo bufferInfo = {
-			.buffer = buffer.getBufferInstance(i),
+			.buffer = buffer.getBufferInstance(buffer.numInstances == 1 ? 0 : i),
 			.offset = 0,
 			.range = buffer.strideSize
 		};
@@ -190,6 +227,21 @@ void DescriptorSet::pointToImageView(
 	uint32_t binding,
 	VkDescriptorType descriptorType,
 	const VkSamplerCreateInfo* samplerInfoPtr)
+{
+	uint32_t numInstances = descriptorSets.size();
+	EXPECT(numInstances != 0, true)
+	for (auto i = 0; i < numInstances; i++)
+	{
+		pointInstanceToImageView(i, imageView, binding, descriptorType, samplerInfoPtr);
+	}
+}
+
+void DescriptorSet::pointInstanceToImageView(
+	uint32_t instanceId,
+	VkImageView imageView,
+	uint32_t binding,
+	VkDescriptorType descriptorType,
+	const VkSamplerCreateInfo* samplerInfoPtr)
 {
 	// sampling method; pass in something else if default (here) is not desired
 	VkSamplerCreateInfo samplerInfo;
@@ -208,31 +260,26 @@ void DescriptorSet::pointToImageView(
 	};
 	VkSampler sampler = SamplerCache::get(samplerInfo);
 
-	uint32_t numInstances = descriptorSets.size();
-	EXPECT(numInstances != 0, true)
-	for (auto i = 0; i < numInstances; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = sampler,
-			.imageView = imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+	VkDescriptorImageInfo imageInfo = {
+		.sampler = sampler,
+		.imageView = imageView,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
 
-		// "Structure specifying the parameters of a descriptor set write operation"
-		VkWriteDescriptorSet descriptorWrite = {
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = descriptorSets[i],
-			.dstBinding = binding,
-			.dstArrayElement = 0,
-			.descriptorCount = 1,
-			.descriptorType = descriptorType,
-			// actual write data (one of three)
-			.pImageInfo = &imageInfo,
-			.pBufferInfo = nullptr,
-			.pTexelBufferView = nullptr,
-		};
-		vkUpdateDescriptorSets(Vulkan::Instance->device, 1, &descriptorWrite, 0, nullptr);
-	}
+	// "Structure specifying the parameters of a descriptor set write operation"
+	VkWriteDescriptorSet descriptorWrite = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = descriptorSets[instanceId],
+		.dstBinding = binding,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = descriptorType,
+		// actual write data (one of three)
+		.pImageInfo = &imageInfo,
+		.pBufferInfo = nullptr,
+		.pTexelBufferView = nullptr,
+	};
+	vkUpdateDescriptorSets(Vulkan::Instance->device, 1, &descriptorWrite, 0, nullptr);
 }
 
 void DescriptorSet::pointToRWImageView(VkImageView imageView, uint32_t binding)
@@ -12,10 +12,18 @@ class DescriptorSetLayout
 {
 public:
 	void addBinding(uint32_t bindingIndex, VkShaderStageFlags shaderStages, VkDescriptorType type);
+	// an array of count descriptors; flags need the matching descriptor indexing features
+	void addBinding(
+		uint32_t bindingIndex,
+		VkShaderStageFlags shaderStages,
+		VkDescriptorType type,
+		uint32_t count,
+		VkDescriptorBindingFlags flags);
 	VkDescriptorSetLayout getLayout();
 
 private:
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<VkDescriptorBindingFlags> bindingFlags; // one per binding
 	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
 };
 
@@ -28,6 +36,7 @@ public:
 
 	VkDescriptorSet getInstance(uint32_t index = 0) const { return descriptorSets[index]; }
 
+	// a buffer with a single instance is pointed to by all of this set's instances
 	void pointToBuffer(const VmaBuffer &buffer, uint32_t binding, VkDescriptorType descriptorType);
 
 	void pointToImageView(
@@ -36,6 +45,14 @@ public:
 		VkDescriptorType descriptorType,
 		const VkSamplerCreateInfo* samplerInfoPtr = nullptr);
 
+	// only for one instance, ie. one that frames in flight aren't using
+	void pointInstanceToImageView(
+		uint32_t instanceId,
+		VkImageView imageView,
+		uint32_t binding,
+		VkDescriptorType descriptorType,
+		const VkSamplerCreateInfo* samplerInfoPtr = nullptr);
+
 	void pointToRWImageView(VkImageView imageView, uint32_t binding);
 
 	void pointToAccelerationStructure(VkAccelerationStructureKHR accelerationStructure, uint32_t binding);
@@ -0,0 +1,142 @@
+#include "PassTimer.h"
+#include "Utils/myn/Log.h"
+#include "Utils/myn/Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+#define MAX_SCOPES_PER_FRAME 128
+
+PassTimer::PassTimer(VkDevice device, float timestampPeriod, uint32_t framesInFlight) :
+	device(device), msPerTick(double(timestampPeriod) * 1e-6)
+{
+	frames.resize(framesInFlight);
+	VkQueryPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = MAX_SCOPES_PER_FRAME * 2
+	};
+	for (auto& frame : frames) {
+		EXPECT(vkCreateQueryPool(device, &poolInfo, nullptr, &frame.queryPool), VK_SUCCESS)
+		vkResetQueryPool(device, frame.queryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+	}
+}
+
+PassTimer::~PassTimer()
+{
+	for (auto& frame : frames) vkDestroyQueryPool(device, frame.queryPool, nullptr);
+}
+
+void PassTimer::beginFrame(uint32_t frameIndex)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	currentFrame = frameIndex;
+	auto& frame = frames[frameIndex];
+	if (frame.recorded) resolve(frame);
+	vkResetQueryPool(device, frame.queryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+	frame.scopes.clear();
+	frame.recorded = true;
+}
+
+void PassTimer::endFrame()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	frames[currentFrame].submittedNs = myn::profiler::now();
+}
+
+uint32_t PassTimer::beginScope(VkCommandBuffer cmdbuf, const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& frame = frames[currentFrame];
+	if (frame.scopes.size() >= MAX_SCOPES_PER_FRAME) return INVALID_SCOPE;
+
+	auto scope = uint32_t(frame.scopes.size());
+	frame.scopes.push_back({ .name = name, .cpuBegin = std::chrono::high_resolution_clock::now() });
+	vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope * 2);
+	return scope;
+}
+
+void PassTimer::endScope(VkCommandBuffer cmdbuf, uint32_t scope)
+{
+	if (scope == INVALID_SCOPE) return;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& frame = frames[currentFrame];
+	std::chrono::duration<double, std::milli> cpuTime = std::chrono::high_resolution_clock::now() - frame.scopes[scope].cpuBegin;
+	frame.scopes[scope].cpuMs = cpuTime.count();
+	vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, scope * 2 + 1);
+}
+
+void PassTimer::resolveAll()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	// oldest first, so passes keep the order they first showed up in
+	for (uint32_t i = 1; i <= frames.size(); i++)
+	{
+		auto& frame = frames[(currentFrame + i) % frames.size()];
+		if (frame.recorded) resolve(frame);
+		vkResetQueryPool(device, frame.queryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+		frame.scopes.clear();
+		frame.recorded = false;
+	}
+}
+
+void PassTimer::clearTotals()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	totals.clear();
+	numFramesResolved = 0;
+}
+
+void PassTimer::resolve(Frame &frame)
+{
+	auto numQueries = uint32_t(frame.scopes.size()) * 2;
+	if (numQueries == 0) return;
+
+	// {timestamp, availability} per query: scopes that never got recorded or submitted are skipped
+	std::vector<uint64_t> results(numQueries * 2);
+	vkGetQueryPoolResults(device, frame.queryPool, 0, numQueries, results.size() * sizeof(uint64_t), results.data(),
+		2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	uint64_t firstTick = UINT64_MAX;
+	for (uint32_t i = 0; i < frame.scopes.size(); i++) {
+		if (results[i * 4 + 1] && results[i * 4 + 3]) firstTick = std::min(firstTick, results[i * 4]);
+	}
+	std::vector<myn::profiler::Event> events;
+
+	std::vector<bool> seen(totals.size() + frame.scopes.size(), false);
+	for (uint32_t i = 0; i < frame.scopes.size(); i++)
+	{
+		auto& scope = frame.scopes[i];
+		uint64_t* begin = &results[i * 4];
+		uint64_t* end = &results[i * 4 + 2];
+		if (!begin[1] || !end[1]) continue;
+
+		uint32_t t = 0;
+		while (t < totals.size() && totals[t].name != scope.name) t++;
+		if (t == totals.size()) totals.push_back({ .name = scope.name });
+
+		totals[t].cpuMs += scope.cpuMs;
+		totals[t].gpuMs += double(end[0] - begin[0]) * msPerTick;
+		if (!seen[t]) totals[t].numFrames++;
+		seen[t] = true;
+
+		myn::profiler::Event event = {
+			.begin_ns = frame.submittedNs + uint64_t(double(begin[0] - firstTick) * msPerTick * 1e6),
+			.end_ns = frame.submittedNs + uint64_t(double(end[0] - firstTick) * msPerTick * 1e6)
+		};
+		strncpy(event.name, scope.name.c_str(), myn::profiler::MAX_NAME_LENGTH);
+		events.push_back(event);
+	}
+	numFramesResolved++;
+
+	// nesting isn't known from the recording side (secondaries record in parallel), so it's whatever contains what
+	std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+		return a.begin_ns != b.begin_ns ? a.begin_ns < b.begin_ns : a.end_ns > b.end_ns;
+	});
+	std::vector<uint64_t> openEnds;
+	for (auto& event : events) {
+		while (!openEnds.empty() && openEnds.back() <= event.begin_ns) openEnds.pop_back();
+		event.depth = uint32_t(openEnds.size());
+		openEnds.push_back(event.end_ns);
+	}
+	myn::profiler::add_gpu_frame(events);
+}
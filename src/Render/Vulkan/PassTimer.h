@@ -0,0 +1,74 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Utils/myn/Timer.h"
+
+/*
+ * Gpu time (timestamp queries) and cpu recording time of the SCOPED_DRAW_EVENT scopes of each frame, plus the whole
+ * frame. A frame's queries are read back when its frame in flight comes around again (right after its fence was
+ * waited on), so results trail a couple frames behind. Scopes with the same name add up, e.g. the ones of all
+ * secondary command buffers of a pass (their cpu times too, even though they're recorded at the same time).
+ * Each frame read back also goes to the profiler's gpu track, placed on the cpu clock by lining up its first timestamp
+ * with when the frame was submitted (so it's only as early as it could possibly have started).
+ */
+class PassTimer
+{
+public:
+	// queries get reset from the host, so the device needs hostQueryReset
+	PassTimer(VkDevice device, float timestampPeriod, uint32_t framesInFlight);
+	~PassTimer();
+
+	static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+	// reads back what the last frame that used this frame in flight recorded, and resets its queries
+	void beginFrame(uint32_t frameIndex);
+
+	// right after the frame's command buffer was submitted
+	void endFrame();
+
+	// cmdbuf has to be submitted before the next beginFrame() for this frame in flight (ie. it's the frame's command
+	// buffer, one of its secondaries, or an immediate submit). Can be called from several threads
+	uint32_t beginScope(VkCommandBuffer cmdbuf, const std::string &name);
+	void endScope(VkCommandBuffer cmdbuf, uint32_t scope);
+
+	// for the last frames of a run: the device has to be idle
+	void resolveAll();
+
+	struct PassTotal {
+		std::string name;
+		double cpuMs = 0;
+		double gpuMs = 0;
+		uint32_t numFrames = 0; // frames it showed up in
+	};
+
+	// summed over all frames read back since clearTotals(), in the order they first showed up
+	const std::vector<PassTotal>& getTotals() const { return totals; }
+	uint32_t getNumFramesResolved() const { return numFramesResolved; }
+	void clearTotals();
+
+private:
+	struct Scope {
+		std::string name;
+		myn::TimePoint cpuBegin;
+		double cpuMs = 0;
+	};
+	struct Frame {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<Scope> scopes; // scope i uses queries 2i and 2i + 1
+		uint64_t submittedNs = 0; // myn::profiler::now()
+		bool recorded = false;
+	};
+
+	void resolve(Frame &frame);
+
+	VkDevice device;
+	double msPerTick;
+	std::vector<Frame> frames;
+	uint32_t currentFrame = 0;
+	std::mutex mutex;
+
+	std::vector<PassTotal> totals;
+	uint32_t numFramesResolved = 0;
+};
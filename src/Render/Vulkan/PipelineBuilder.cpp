@@ -2,6 +2,15 @@
 #include "Render/Vertex.h"
 #include "Vulkan.hpp"
 #include "ShaderModule.h"
+#include "PipelineCache.h"
+#include "Utils/myn/FileWatcher.h"
+#include "Utils/myn/Log.h"
+#include "Utils/myn/Profiler.h"
+#include "Utils/myn/Threading.h"
+#include "Utils/myn/Timer.h"
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 PipelineState::PipelineState()
 {
@@ -187,30 +196,159 @@ void PipelineState::setExtent(uint32_t width, uint32_t height)
 	scissor.extent = targetExtent;
 }
 
-void GraphicsPipelineBuilder::build(VkPipeline &outPipeline, VkPipelineLayout &outPipelineLayout)
+namespace
 {
-	// shader stages
+	// a deep copy of what a graphics pipeline is created from, to create it again later or on another thread
+	struct GraphicsPipelineRecipe
+	{
+		GraphicsPipelineRecipe(const GraphicsPipelineBuilder &builder, VkPipelineLayout layout);
+
+		// VK_NULL_HANDLE if it failed. Can be called from any thread
+		VkPipeline create(VkShaderModule vertModule, VkShaderModule fragModule) const;
+
+		std::string vertPath;
+		std::string fragPath;
+		PipelineState state; // pointed at the copies below in create()
+		std::vector<VkVertexInputBindingDescription> vertexBindings;
+		std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+		std::vector<VkViewport> viewports;
+		std::vector<VkRect2D> scissors;
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+		std::vector<VkDynamicState> dynamicStates;
+		VkRenderPass renderPass;
+		uint32_t subpass;
+		VkPipelineLayout layout;
+	};
 
-	auto vertModule = ShaderModule::get(vertPath);
-	auto fragModule = ShaderModule::get(fragPath);
+	template<typename T>
+	std::vector<T> copyArray(const T *data, uint32_t count)
+	{
+		return data ? std::vector<T>(data, data + count) : std::vector<T>();
+	}
 
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-		.stage = VK_SHADER_STAGE_VERTEX_BIT,
-		.module = vertModule->module,
-		.pName = "main", // entry point function (should be main for glsl shaders)
-		.pSpecializationInfo = nullptr // for specifying the shader's compile-time constants
+	GraphicsPipelineRecipe::GraphicsPipelineRecipe(const GraphicsPipelineBuilder &builder, VkPipelineLayout layout) :
+		vertPath(builder.vertPath),
+		fragPath(builder.fragPath),
+		state(builder.pipelineState),
+		renderPass(builder.compatibleRenderPass),
+		subpass(builder.compatibleSubpass),
+		layout(layout)
+	{
+		// (still pointing into the builder)
+		vertexBindings = copyArray(state.vertexInputInfo.pVertexBindingDescriptions, state.vertexInputInfo.vertexBindingDescriptionCount);
+		vertexAttributes = copyArray(state.vertexInputInfo.pVertexAttributeDescriptions, state.vertexInputInfo.vertexAttributeDescriptionCount);
+		viewports = copyArray(state.viewportInfo.pViewports, state.viewportInfo.viewportCount);
+		scissors = copyArray(state.viewportInfo.pScissors, state.viewportInfo.scissorCount);
+		blendAttachments = copyArray(state.colorBlendInfo.pAttachments, state.colorBlendInfo.attachmentCount);
+		dynamicStates = copyArray(state.dynamicStateInfo.pDynamicStates, state.dynamicStateInfo.dynamicStateCount);
+	}
+
+	VkPipeline GraphicsPipelineRecipe::create(VkShaderModule vertModule, VkShaderModule fragModule) const
+	{
+		PipelineState pipelineState = state;
+		pipelineState.vertexInputInfo.pVertexBindingDescriptions = vertexBindings.data();
+		pipelineState.vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+		pipelineState.viewportInfo.pViewports = viewports.data();
+		pipelineState.viewportInfo.pScissors = scissors.data();
+		pipelineState.colorBlendInfo.pAttachments = blendAttachments.data();
+		pipelineState.dynamicStateInfo.pDynamicStates = dynamicStates.data();
+
+		// shader stages
+
+		VkPipelineShaderStageCreateInfo vertShaderStageInfo = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_VERTEX_BIT,
+			.module = vertModule,
+			.pName = "main", // entry point function (should be main for glsl shaders)
+			.pSpecializationInfo = nullptr // for specifying the shader's compile-time constants
+		};
+
+		VkPipelineShaderStageCreateInfo fragShaderStageInfo = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = fragModule,
+			.pName = "main", // entry point function (should be main for glsl shaders)
+			.pSpecializationInfo = nullptr // for specifying the shader's compile-time constants
+		};
+
+		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+		// create the fucking pipeline
+		auto pipelineInfo = pipelineState.getPipelineInfoTemplate();
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.layout = layout;
+		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.subpass = subpass;
+
+		VkPipeline pipeline;
+		auto result = vkCreateGraphicsPipelines(Vulkan::Instance->device, PipelineCache::get(), 1, &pipelineInfo, nullptr, &pipeline);
+		if (result != VK_SUCCESS) {
+			WARN("failed to create pipeline (%s, %s): %d", vertPath.c_str(), fragPath.c_str(), result)
+			return VK_NULL_HANDLE;
+		}
+		return pipeline;
+	}
+
+	// the pipeline and its layout get destroyed together at exit
+	void destroyAtExit(VkPipeline pipeline, VkPipelineLayout layout)
+	{
+		// TODO: let whoever owns the pipeline do the cleanup
+		Vulkan::Instance->destructionQueue.emplace_back([pipeline, layout](){
+			vkDestroyPipeline(Vulkan::Instance->device, pipeline, nullptr);
+			if (layout != VK_NULL_HANDLE) vkDestroyPipelineLayout(Vulkan::Instance->device, layout, nullptr);
+		});
+	}
+
+	struct LibraryBuild {
+		std::shared_ptr<const GraphicsPipelineRecipe> recipe;
+		VkPipeline* target;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		// modules to build with; VK_NULL_HANDLE for a stage whose shader is being reloaded
+		VkShaderModule vertModule = VK_NULL_HANDLE;
+		VkShaderModule fragModule = VK_NULL_HANDLE;
 	};
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-		.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-		.module = fragModule->module,
-		.pName = "main", // entry point function (should be main for glsl shaders)
-		.pSpecializationInfo = nullptr // for specifying the shader's compile-time constants
+	// main thread only: by where they were built into
+	std::unordered_map<VkPipeline*, std::shared_ptr<const GraphicsPipelineRecipe>> recipes;
+
+	bool warmingUp = false;
+	std::vector<LibraryBuild> warmupBuilds;
+
+	std::unique_ptr<myn::FileWatcher> shaderWatcher;
+	std::unordered_set<std::string> changedShaders; // not reloaded yet
+	bool reloading = false;
+
+	// filled in by the reload job
+	struct ReloadResult {
+		std::vector<std::pair<std::string, VkShaderModule>> modules;
+		std::vector<LibraryBuild> builds;
 	};
+	std::mutex reloadMutex;
+	std::unique_ptr<ReloadResult> reloadResult;
+
+	void watchShaders(const GraphicsPipelineRecipe &recipe)
+	{
+		shaderWatcher->watch(recipe.vertPath, recipe.vertPath);
+		shaderWatcher->watch(recipe.fragPath, recipe.fragPath);
+	}
+}
+
+void GraphicsPipelineBuilder::build(VkPipeline &outPipeline, VkPipelineLayout &outPipelineLayout)
+{
+	if (warmingUp) {
+		for (auto& pending : warmupBuilds) {
+			if (pending.target != &outPipeline) continue;
+			// already waiting to be compiled
+			outPipelineLayout = pending.recipe->layout;
+			return;
+		}
+	}
 
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+	// shader stages (loaded here so they're ready for whichever thread compiles the pipeline)
+
+	auto vertModule = ShaderModule::get(vertPath);
+	auto fragModule = ShaderModule::get(fragPath);
 
 	// layout
 
@@ -228,20 +366,133 @@ void GraphicsPipelineBuilder::build(VkPipeline &outPipeline, VkPipelineLayout &o
 	};
 	EXPECT(vkCreatePipelineLayout(Vulkan::Instance->device, &pipelineLayoutInfo, nullptr, &outPipelineLayout), VK_SUCCESS)
 
-	// create the fucking pipeline
-	auto pipelineInfo = pipelineState.getPipelineInfoTemplate();
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.layout = outPipelineLayout;
-	pipelineInfo.renderPass = compatibleRenderPass;
-	pipelineInfo.subpass = compatibleSubpass;
+	auto recipe = std::make_shared<const GraphicsPipelineRecipe>(*this, outPipelineLayout);
+	recipes[&outPipeline] = recipe;
+	if (shaderWatcher) watchShaders(*recipe);
 
-	EXPECT(vkCreateGraphicsPipelines(Vulkan::Instance->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &outPipeline), VK_SUCCESS)
+	if (warmingUp) {
+		// compiled at PipelineLibrary::endWarmup()
+		outPipeline = VK_NULL_HANDLE;
+		warmupBuilds.push_back({ .recipe = recipe, .target = &outPipeline });
+		return;
+	}
 
-	// TODO: let whoever owns the pipeline do the cleanup
-	Vulkan::Instance->destructionQueue.emplace_back([outPipeline, outPipelineLayout](){
-		vkDestroyPipeline(Vulkan::Instance->device, outPipeline, nullptr);
-		vkDestroyPipelineLayout(Vulkan::Instance->device, outPipelineLayout, nullptr);
+	outPipeline = recipe->create(vertModule->module, fragModule->module);
+	EXPECT(outPipeline != VK_NULL_HANDLE, true)
+	destroyAtExit(outPipeline, outPipelineLayout);
+}
+
+void PipelineLibrary::beginWarmup()
+{
+	warmingUp = true;
+}
+
+void PipelineLibrary::endWarmup()
+{
+	warmingUp = false;
+	std::vector<LibraryBuild> builds;
+	builds.swap(warmupBuilds);
+	if (builds.empty()) return;
+
+	PROFILE_SCOPE("pipeline warm-up")
+	TIMER_BEGIN
+	for (auto& pending : builds) {
+		pending.vertModule = ShaderModule::get(pending.recipe->vertPath)->module;
+		pending.fragModule = ShaderModule::get(pending.recipe->fragPath)->module;
+	}
+	myn::WorkerPool::shared().parallel_for(builds.size(), [&](uint32_t i) {
+		builds[i].pipeline = builds[i].recipe->create(builds[i].vertModule, builds[i].fragModule);
+	});
+	for (auto& pending : builds) {
+		EXPECT(pending.pipeline != VK_NULL_HANDLE, true)
+		*pending.target = pending.pipeline;
+		destroyAtExit(pending.pipeline, pending.recipe->layout);
+	}
+	TIMER_END(seconds)
+	LOG("compiled %zu pipelines in %.1f ms", builds.size(), seconds * 1000)
+}
+
+void PipelineLibrary::startWatchingShaders()
+{
+	if (shaderWatcher) return;
+	shaderWatcher = std::make_unique<myn::FileWatcher>();
+	for (auto& p : recipes) watchShaders(*p.second);
+}
+
+void PipelineLibrary::update()
+{
+	if (!shaderWatcher) return;
+
+	// swap in what the last reload built
+	std::unique_ptr<ReloadResult> result;
+	{
+		std::lock_guard<std::mutex> lock(reloadMutex);
+		result.swap(reloadResult);
+	}
+	if (result) {
+		reloading = false;
+		for (auto& [path, module] : result->modules) ShaderModule::replace(path, module);
+		uint32_t numSwapped = 0;
+		for (auto& rebuilt : result->builds) {
+			if (rebuilt.pipeline == VK_NULL_HANDLE) continue;
+			// old pipelines may still be used by frames in flight, so they're only destroyed at exit, like this one
+			destroyAtExit(rebuilt.pipeline, VK_NULL_HANDLE);
+			// built into again in the meantime (e.g. after markPipelineDirty()): that one's newer
+			auto it = recipes.find(rebuilt.target);
+			if (it == recipes.end() || it->second != rebuilt.recipe) continue;
+			*rebuilt.target = rebuilt.pipeline;
+			numSwapped++;
+		}
+		LOG("reloaded %zu shaders, swapped in %u pipelines", result->modules.size(), numSwapped)
+	}
+
+	for (auto& path : shaderWatcher->poll_changes()) changedShaders.insert(path);
+	if (reloading || changedShaders.empty()) return;
+
+	// only the pipelines using one of the changed shaders, with the modules their other stage keeps using
+	std::vector<std::string> paths(changedShaders.begin(), changedShaders.end());
+	std::vector<LibraryBuild> builds;
+	for (auto& [target, recipe] : recipes) {
+		bool vertChanged = changedShaders.contains(recipe->vertPath);
+		bool fragChanged = changedShaders.contains(recipe->fragPath);
+		if (!vertChanged && !fragChanged) continue;
+		builds.push_back({
+			.recipe = recipe,
+			.target = target,
+			.vertModule = vertChanged ? VK_NULL_HANDLE : ShaderModule::get(recipe->vertPath)->module,
+			.fragModule = fragChanged ? VK_NULL_HANDLE : ShaderModule::get(recipe->fragPath)->module
+		});
+	}
+	changedShaders.clear();
+
+	reloading = true;
+	myn::JobQueue::background().push([paths, builds]() mutable {
+		PROFILE_SCOPE("reload shaders")
+		auto result = std::make_unique<ReloadResult>();
+		std::unordered_map<std::string, VkShaderModule> modules;
+		for (auto& path : paths) {
+			VkShaderModule module = ShaderModule::load(path);
+			if (module == VK_NULL_HANDLE) {
+				WARN("failed to reload shader '%s', keeping the old one", path.c_str())
+				continue;
+			}
+			modules[path] = module;
+			result->modules.emplace_back(path, module);
+		}
+		for (auto& pending : builds) {
+			if (pending.vertModule == VK_NULL_HANDLE && modules.contains(pending.recipe->vertPath)) {
+				pending.vertModule = modules[pending.recipe->vertPath];
+			}
+			if (pending.fragModule == VK_NULL_HANDLE && modules.contains(pending.recipe->fragPath)) {
+				pending.fragModule = modules[pending.recipe->fragPath];
+			}
+			// (a shader that failed to load leaves its pipelines as they are)
+			if (pending.vertModule == VK_NULL_HANDLE || pending.fragModule == VK_NULL_HANDLE) continue;
+			pending.pipeline = pending.recipe->create(pending.vertModule, pending.fragModule);
+			result->builds.push_back(pending);
+		}
+		std::lock_guard<std::mutex> lock(reloadMutex);
+		reloadResult = std::move(result);
 	});
 }
 
@@ -288,7 +539,7 @@ void ComputePipelineBuilder::build(VkPipeline &outPipeline, VkPipelineLayout &ou
 		.stage = shaderStageInfo,
 		.layout = outPipelineLayout
 	};
-	EXPECT(vkCreateComputePipelines(Vulkan::Instance->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &outPipeline), VK_SUCCESS)
+	EXPECT(vkCreateComputePipelines(Vulkan::Instance->device, PipelineCache::get(), 1, &pipelineInfo, nullptr, &outPipeline), VK_SUCCESS)
 
 	Vulkan::Instance->destructionQueue.emplace_back([outPipeline, outPipelineLayout](){
 		vkDestroyPipeline(Vulkan::Instance->device, outPipeline, nullptr);
@@ -419,7 +670,7 @@ void RayTracingPipelineBuilder::build(VkPipeline &outPipeline, VkPipelineLayout
 		.maxPipelineRayRecursionDepth = 1,
 		.layout = outPipelineLayout
 	};
-	EXPECT(Vulkan::Instance->fn_vkCreateRayTracingPipelinesKHR(Vulkan::Instance->device, {}, {}, 1, &pipelineInfo, nullptr, &outPipeline), VK_SUCCESS)
+	EXPECT(Vulkan::Instance->fn_vkCreateRayTracingPipelinesKHR(Vulkan::Instance->device, {}, PipelineCache::get(), 1, &pipelineInfo, nullptr, &outPipeline), VK_SUCCESS)
 
 	// add to cleanup queue
 	Vulkan::Instance->destructionQueue.emplace_back([outPipeline, outPipelineLayout](){
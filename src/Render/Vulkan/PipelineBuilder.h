@@ -72,6 +72,27 @@ private:
 	std::vector<DescriptorSetLayout> descriptorSetLayouts;
 };
 
+/*
+ * Keeps what each graphics pipeline was built from, by where it was built into (e.g. a material's static
+ * MaterialPipeline), so it can be built again from elsewhere:
+ *  - pipelines built between beginWarmup() and endWarmup() are compiled together on all cores at endWarmup(). Until
+ *    then their handles stay VK_NULL_HANDLE (layouts are made right away), and building into the same place again
+ *    does nothing.
+ *  - once shaders are watched, the pipelines using a shader whose spirv changed get compiled again on a background
+ *    thread, then swapped in by update(). What they were built into has to stay where it is for that.
+ */
+class PipelineLibrary
+{
+public:
+	static void beginWarmup();
+	static void endWarmup();
+
+	static void startWatchingShaders();
+
+	// once per frame on the main thread, before anything gets recorded
+	static void update();
+};
+
 struct ComputePipelineBuilder
 {
 	ComputePipelineBuilder() = default;
@@ -0,0 +1,105 @@
+#include "PipelineCache.h"
+#include "Utils/myn/Log.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+VkDevice PipelineCache::device = VK_NULL_HANDLE;
+VkPipelineCache PipelineCache::cache = VK_NULL_HANDLE;
+std::string PipelineCache::path;
+
+namespace
+{
+	// what all pipeline cache data starts with (VkPipelineCacheHeaderVersionOne)
+	struct CacheHeader {
+		uint32_t headerSize;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+}
+
+void PipelineCache::create(VkDevice inDevice, const VkPhysicalDeviceProperties &properties)
+{
+	device = inDevice;
+
+	char name[2 * VK_UUID_SIZE + 16];
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+		snprintf(name + 2 * i, 3, "%02x", properties.pipelineCacheUUID[i]);
+	}
+	snprintf(name + 2 * VK_UUID_SIZE, 16, "_%08x", properties.driverVersion);
+	path = ROOT_DIR"/pipeline_cache/" + std::string(name) + ".bin";
+
+	// drivers are supposed to reject data that isn't theirs, but not all of them do so gracefully
+	std::vector<char> data;
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (file.is_open()) {
+		data.resize(file.tellg());
+		file.seekg(0);
+		file.read(data.data(), data.size());
+
+		CacheHeader header = {};
+		if (data.size() >= sizeof(header)) memcpy(&header, data.data(), sizeof(header));
+		bool valid = data.size() >= sizeof(header) &&
+			header.headerSize >= sizeof(header) &&
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID &&
+			header.deviceID == properties.deviceID &&
+			memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		if (valid) {
+			LOG("loading pipeline cache '%s' (%.1f KB)..", path.c_str(), data.size() / 1024.0)
+		} else {
+			WARN("pipeline cache '%s' isn't for this device, starting over", path.c_str())
+			data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data.size(),
+		.pInitialData = data.empty() ? nullptr : data.data()
+	};
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+		WARN("failed to create pipeline cache from '%s', starting over", path.c_str())
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		EXPECT(vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache), VK_SUCCESS)
+	}
+}
+
+void PipelineCache::saveAndDestroy()
+{
+	if (cache == VK_NULL_HANDLE) return;
+
+	size_t size = 0;
+	std::vector<char> data;
+	if (vkGetPipelineCacheData(device, cache, &size, nullptr) == VK_SUCCESS && size > 0) {
+		data.resize(size);
+		if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) data.clear();
+	}
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+	if (data.empty()) return;
+
+	// written next to it first, so a run that gets killed halfway doesn't leave a broken file behind
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+	std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			WARN("failed to save pipeline cache to '%s'", tmpPath.c_str())
+			return;
+		}
+		file.write(data.data(), size);
+	}
+	std::filesystem::rename(tmpPath, path, ec);
+	if (ec) {
+		WARN("failed to save pipeline cache to '%s'", path.c_str())
+	} else {
+		LOG("saved pipeline cache '%s' (%.1f KB)", path.c_str(), size / 1024.0)
+	}
+}
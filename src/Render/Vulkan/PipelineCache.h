@@ -0,0 +1,25 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+
+/*
+ * The VkPipelineCache every pipeline gets built with. It's saved to disk when the device goes away and loaded again on
+ * the next run, so pipelines compiled before are (mostly) just looked up. There's one file per device and driver
+ * version (named after the cache UUID and driver version), and its header is checked before the driver sees it.
+ */
+class PipelineCache
+{
+public:
+	// right after the device was created
+	static void create(VkDevice device, const VkPhysicalDeviceProperties& properties);
+
+	// after the pipelines are gone, before the device is
+	static void saveAndDestroy();
+
+	static VkPipelineCache get() { return cache; }
+
+private:
+	static VkDevice device;
+	static VkPipelineCache cache;
+	static std::string path;
+};
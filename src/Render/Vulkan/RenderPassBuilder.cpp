@@ -42,8 +42,8 @@ VkRenderPass RenderPassBuilder::buildDisplayPass(Vulkan* vulkan, VkFormat colorF
 			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, // layout when attachment is loaded
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+			.initialLayout = vulkan->getPresentLayout(), // layout when attachment is loaded
+			.finalLayout = vulkan->getPresentLayout()
 		});
 
 	VkAttachmentReference colorAttachmentRef = {
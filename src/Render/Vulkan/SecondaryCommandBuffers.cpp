@@ -0,0 +1,81 @@
+#include "SecondaryCommandBuffers.h"
+#include "Vulkan.hpp"
+#include "Utils/myn/Threading.h"
+#include <algorithm>
+
+SecondaryCommandBuffers::SecondaryCommandBuffers(uint32_t minDrawsPerChunk) : minDrawsPerChunk(std::max(1u, minDrawsPerChunk))
+{
+	slots.resize(Vulkan::Instance->getMaxFramesInFlight());
+}
+
+SecondaryCommandBuffers::~SecondaryCommandBuffers()
+{
+	for (auto& frameSlots : slots) {
+		for (auto& slot : frameSlots) {
+			vkDestroyCommandPool(Vulkan::Instance->device, slot.pool, nullptr); // also frees its command buffers
+		}
+	}
+}
+
+void SecondaryCommandBuffers::record(
+	VkCommandBuffer primary,
+	VkRenderPass renderPass,
+	uint32_t subpass,
+	VkFramebuffer framebuffer,
+	uint32_t numDraws,
+	const std::function<void(VkCommandBuffer, uint32_t, uint32_t)> &recordRange)
+{
+	if (numDraws == 0) return;
+	auto vk = Vulkan::Instance;
+	auto& pool = myn::WorkerPool::shared();
+
+	// a few chunks per thread so uneven ones still balance out, but not so many that each is just a handful of draws
+	uint32_t numChunks = std::min((numDraws + minDrawsPerChunk - 1) / minDrawsPerChunk, (pool.num_threads() + 1) * 2);
+	uint32_t drawsPerChunk = (numDraws + numChunks - 1) / numChunks;
+	numChunks = (numDraws + drawsPerChunk - 1) / drawsPerChunk;
+
+	// the fence of this frame in flight was waited on in beginFrame, so its command buffers are free to reuse
+	auto& frameSlots = slots[vk->getCurrentFrameIndex()];
+	while (frameSlots.size() < numChunks)
+	{
+		Slot slot;
+		VkCommandPoolCreateInfo poolInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = vk->graphicsQueueFamily,
+		};
+		EXPECT(vkCreateCommandPool(vk->device, &poolInfo, nullptr, &slot.pool), VK_SUCCESS)
+		VkCommandBufferAllocateInfo allocInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = slot.pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1
+		};
+		EXPECT(vkAllocateCommandBuffers(vk->device, &allocInfo, &slot.cmdbuf), VK_SUCCESS)
+		frameSlots.push_back(slot);
+	}
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.renderPass = renderPass,
+		.subpass = subpass,
+		.framebuffer = framebuffer
+	};
+	pool.parallel_for(numChunks, [&](uint32_t chunk) {
+		auto& slot = frameSlots[chunk];
+		EXPECT(vkResetCommandPool(vk->device, slot.pool, 0), VK_SUCCESS)
+		VkCommandBufferBeginInfo beginInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+			.pInheritanceInfo = &inheritanceInfo
+		};
+		EXPECT(vkBeginCommandBuffer(slot.cmdbuf, &beginInfo), VK_SUCCESS)
+		uint32_t begin = chunk * drawsPerChunk;
+		recordRange(slot.cmdbuf, begin, std::min(numDraws, begin + drawsPerChunk));
+		EXPECT(vkEndCommandBuffer(slot.cmdbuf), VK_SUCCESS)
+	});
+
+	std::vector<VkCommandBuffer> cmdbufs(numChunks);
+	for (uint32_t i = 0; i < numChunks; i++) cmdbufs[i] = frameSlots[i].cmdbuf;
+	vkCmdExecuteCommands(primary, numChunks, cmdbufs.data());
+}
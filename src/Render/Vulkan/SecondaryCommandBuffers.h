@@ -0,0 +1,36 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <vector>
+
+/*
+ * Records one subpass worth of draws on the worker pool: the draws are split into consecutive chunks, each chunk goes
+ * into its own secondary command buffer, and they get executed in order so the result is the same as recording inline.
+ * Every chunk slot has its own command pool per frame in flight (vulkan pools can't be used from several threads at
+ * once, and a chunk is only ever recorded by one thread), reset when that frame comes around again.
+ * The subpass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+ */
+class SecondaryCommandBuffers
+{
+public:
+	explicit SecondaryCommandBuffers(uint32_t minDrawsPerChunk = 256);
+	~SecondaryCommandBuffers();
+
+	// recordRange(cmdbuf, begin, end) records draws [begin, end) into a secondary command buffer that inherits
+	// renderPass, subpass and framebuffer. Nothing is inherited besides those: bind pipelines and descriptor sets again
+	void record(
+		VkCommandBuffer primary,
+		VkRenderPass renderPass,
+		uint32_t subpass,
+		VkFramebuffer framebuffer,
+		uint32_t numDraws,
+		const std::function<void(VkCommandBuffer cmdbuf, uint32_t begin, uint32_t end)>& recordRange);
+
+private:
+	struct Slot {
+		VkCommandPool pool = VK_NULL_HANDLE;
+		VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
+	};
+	std::vector<std::vector<Slot>> slots; // [frame in flight][chunk]
+	uint32_t minDrawsPerChunk;
+};
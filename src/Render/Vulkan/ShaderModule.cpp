@@ -1,22 +1,49 @@
 #include "ShaderModule.h"
 #include "Vulkan.hpp"
 #include "VulkanUtils.h"
-#include "Utils/myn/Misc.h"
+#include <fstream>
 
 std::unordered_map<std::string, ShaderModule *> ShaderModule::pool;
 
 ShaderModule::ShaderModule(const std::string &path)
 {
-	auto code = myn::read_file(path);
+	module = load(path);
+	EXPECT_M(module != VK_NULL_HANDLE, true, "failed to load shader '%s'", path.c_str())
+}
+
+VkShaderModule ShaderModule::load(const std::string &path)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) return VK_NULL_HANDLE;
+	size_t size = file.tellg();
+	// spirv is a stream of words; anything else (e.g. a file that's still being written) isn't
+	if (size == 0 || size % sizeof(uint32_t) != 0) return VK_NULL_HANDLE;
+	std::vector<uint32_t> code(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(code.data()), size);
+
 	VkShaderModuleCreateInfo createInfo = {
 		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.codeSize = code.size(),
-		.pCode = reinterpret_cast<const uint32_t *>(code.data())
+		.codeSize = size,
+		.pCode = code.data()
 	};
-	EXPECT(vkCreateShaderModule(Vulkan::Instance->device, &createInfo, nullptr, &module), VK_SUCCESS)
+	VkShaderModule module;
+	if (vkCreateShaderModule(Vulkan::Instance->device, &createInfo, nullptr, &module) != VK_SUCCESS) return VK_NULL_HANDLE;
 
 	std::string formattedName = "Shader '" + path + "'";
 	NAME_OBJECT(VK_OBJECT_TYPE_SHADER_MODULE, module, formattedName)
+	return module;
+}
+
+void ShaderModule::replace(const std::string &path, VkShaderModule module)
+{
+	auto shaderModule = get(path);
+	VkShaderModule oldModule = shaderModule->module;
+	shaderModule->module = module;
+	// (the pooled one's own entry destroys whatever it holds at the time)
+	Vulkan::Instance->destructionQueue.emplace_back([oldModule](){
+		vkDestroyShaderModule(Vulkan::Instance->device, oldModule, nullptr);
+	});
 }
 
 ShaderModule *ShaderModule::get(const std::string &path)
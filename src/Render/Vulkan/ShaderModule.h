@@ -1,5 +1,6 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <string>
 #include <unordered_map>
 
 class ShaderModule
@@ -7,6 +8,13 @@ class ShaderModule
 public:
 	static ShaderModule* get(const std::string &path);
 
+	// a new module from the spirv at path (not pooled), or VK_NULL_HANDLE if it can't be read. Can be called from any thread
+	static VkShaderModule load(const std::string &path);
+
+	// main thread: the module get(path) returns from now on (the old one is kept around until exit, pipelines may still
+	// be getting compiled with it)
+	static void replace(const std::string &path, VkShaderModule module);
+
 	VkShaderModule module;
 private:
 	explicit ShaderModule(const std::string &path);
@@ -0,0 +1,163 @@
+#include "StagingRing.h"
+#include "Utils/myn/Log.h"
+
+StagingRing::StagingRing(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queueFamily, VkDeviceSize capacity) :
+	device(device), allocator(allocator), queue(queue), capacity(capacity)
+{
+	VkBufferCreateInfo bufferInfo = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = capacity,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	VmaAllocationCreateInfo allocCreateInfo = {
+		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+		.usage = VMA_MEMORY_USAGE_CPU_TO_GPU
+	};
+	VmaAllocationInfo allocInfo;
+	EXPECT(vmaCreateBuffer(allocator, &bufferInfo, &allocCreateInfo, &buffer, &allocation, &allocInfo), VK_SUCCESS)
+	mapped = (uint8_t*)allocInfo.pMappedData;
+
+	VkCommandPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = queueFamily
+	};
+	EXPECT(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool), VK_SUCCESS)
+}
+
+StagingRing::~StagingRing()
+{
+	submit();
+	while (!inFlight.empty()) retire(true);
+	for (auto fence : freeFences) vkDestroyFence(device, fence, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr); // also frees its command buffers
+	vmaDestroyBuffer(allocator, buffer, allocation);
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, Allocation &outAllocation)
+{
+	if (size > capacity) return false;
+	retire(false);
+
+	while (true)
+	{
+		// alignment is of the offset within the buffer, and an allocation never wraps around its end
+		VkDeviceSize offset = head % capacity;
+		VkDeviceSize alignedOffset = (offset + alignment - 1) / alignment * alignment;
+		uint64_t start = alignedOffset + size <= capacity ? head + (alignedOffset - offset) : head + (capacity - offset);
+		if (start + size - tail <= capacity)
+		{
+			head = start + size;
+			outAllocation = {
+				.buffer = buffer,
+				.offset = start % capacity,
+				.mapped = mapped + start % capacity
+			};
+			commands(); // the allocation belongs to the batch being recorded from here on
+			return true;
+		}
+
+		// full: whatever is still in use has to be submitted before it can come back
+		submit();
+		retire(true);
+	}
+}
+
+VkCommandBuffer StagingRing::commands()
+{
+	if (recording != VK_NULL_HANDLE) return recording;
+
+	if (freeCommandBuffers.empty())
+	{
+		VkCommandBufferAllocateInfo allocInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		EXPECT(vkAllocateCommandBuffers(device, &allocInfo, &recording), VK_SUCCESS)
+	}
+	else
+	{
+		recording = freeCommandBuffers.back();
+		freeCommandBuffers.pop_back();
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	EXPECT(vkBeginCommandBuffer(recording, &beginInfo), VK_SUCCESS)
+	return recording;
+}
+
+void StagingRing::submit()
+{
+	if (recording == VK_NULL_HANDLE) return;
+
+	// images were already barriered into their layouts by whoever uploaded them; this covers buffers
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT
+	};
+	vkCmdPipelineBarrier(
+		recording,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+	EXPECT(vkEndCommandBuffer(recording), VK_SUCCESS)
+
+	// (no-op for host coherent memory)
+	EXPECT(vmaFlushAllocation(allocator, allocation, 0, VK_WHOLE_SIZE), VK_SUCCESS)
+
+	VkFence fence;
+	if (freeFences.empty())
+	{
+		VkFenceCreateInfo fenceInfo = {
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		};
+		EXPECT(vkCreateFence(device, &fenceInfo, nullptr, &fence), VK_SUCCESS)
+	}
+	else
+	{
+		fence = freeFences.back();
+		freeFences.pop_back();
+	}
+
+	VkSubmitInfo submitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &recording
+	};
+	EXPECT(vkQueueSubmit(queue, 1, &submitInfo, fence), VK_SUCCESS)
+	inFlight.push_back({ .fence = fence, .cmdbuf = recording, .end = head });
+	recording = VK_NULL_HANDLE;
+}
+
+void StagingRing::retire(bool wait)
+{
+	while (!inFlight.empty())
+	{
+		auto batch = inFlight.front();
+		if (wait) {
+			EXPECT(vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX), VK_SUCCESS)
+			wait = false;
+		} else if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS) {
+			break;
+		}
+		EXPECT(vkResetFences(device, 1, &batch.fence), VK_SUCCESS)
+		freeFences.push_back(batch.fence);
+		EXPECT(vkResetCommandBuffer(batch.cmdbuf, 0), VK_SUCCESS)
+		freeCommandBuffers.push_back(batch.cmdbuf);
+		tail = batch.end;
+		inFlight.pop_front();
+	}
+	// nothing in use: start over from the beginning instead of wrapping around some time later
+	if (inFlight.empty() && recording == VK_NULL_HANDLE) head = tail = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <VulkanMemoryAllocator-3.0.1/include/vk_mem_alloc.h>
+#include <deque>
+#include <vector>
+
+/*
+ * One persistently mapped staging buffer that all uploads go through as a ring: data is copied in right away, the copy
+ * commands out of it go into one command buffer that is submitted once per frame (and before anything else gets
+ * submitted, so uploads still land in the order they were made), and the space is reused once that submit's fence
+ * signals. Neither allocating nor submitting waits for the gpu, unless the ring is full.
+ * Main thread only.
+ */
+class StagingRing
+{
+public:
+	// made by Vulkan itself (before Vulkan::Instance is set), so everything it needs is passed in
+	StagingRing(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queueFamily, VkDeviceSize capacity);
+	~StagingRing();
+
+	struct Allocation {
+		VkBuffer buffer;
+		VkDeviceSize offset; // within buffer
+		uint8_t* mapped; // write the data here
+	};
+
+	// size bytes at an offset that's a multiple of alignment; false if they'd never fit
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, Allocation& outAllocation);
+
+	// where to record the copies out of the allocations (begun on first use since the last submit)
+	VkCommandBuffer commands();
+
+	// submits what's been recorded so far (if anything), makes the writes visible to whatever reads them next
+	void submit();
+
+	VkDeviceSize getCapacity() const { return capacity; }
+
+private:
+	struct Batch {
+		VkFence fence;
+		VkCommandBuffer cmdbuf;
+		uint64_t end; // ring position past its last allocation
+	};
+
+	// frees the space of finished batches; with wait, waits for the oldest one first
+	void retire(bool wait);
+
+	VkDevice device;
+	VmaAllocator allocator;
+	VkQueue queue;
+	VkDeviceSize capacity;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	uint8_t* mapped = nullptr;
+
+	// positions keep counting up past the capacity; the buffer offset is position % capacity
+	uint64_t head = 0; // next allocation goes here
+	uint64_t tail = 0; // everything before this is free
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer recording = VK_NULL_HANDLE;
+	std::deque<Batch> inFlight;
+	std::vector<VkCommandBuffer> freeCommandBuffers;
+	std::vector<VkFence> freeFences;
+};
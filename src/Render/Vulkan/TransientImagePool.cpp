@@ -0,0 +1,124 @@
+#include "TransientImagePool.h"
+#include "VulkanUtils.h"
+
+TransientImagePool::~TransientImagePool()
+{
+	release();
+}
+
+void TransientImagePool::release()
+{
+	auto vk = Vulkan::Instance;
+	for (auto& image : images)
+	{
+		if (image.view != VK_NULL_HANDLE) vkDestroyImageView(vk->device, image.view, nullptr);
+		if (image.image != VK_NULL_HANDLE) vkDestroyImage(vk->device, image.image, nullptr);
+	}
+	for (auto allocation : allocations) vmaFreeMemory(vk->memoryAllocator, allocation);
+	images.clear();
+	requirements.clear();
+	allocations.clear();
+	slotImages.clear();
+	allocatedSize = 0;
+	unaliasedSize = 0;
+}
+
+bool TransientImagePool::realize(RenderGraph &graph)
+{
+	auto vk = Vulkan::Instance;
+
+	bool changed = images.size() != graph.getNumImages();
+	for (RenderGraph::Handle h = 0; !changed && h < images.size(); h++) {
+		changed = !(images[h].desc == graph.getImageDesc(h)) || images[h].usage != graph.getImageUsage(h);
+	}
+	if (!changed)
+	{
+		// same images, but their lifetimes can still have changed and with them what shares memory with what
+		graph.assignMemory(requirements, hasLazilyAllocatedMemory);
+		auto& slots = graph.getMemorySlots();
+		bool sameSlots = slots.size() == slotImages.size();
+		for (uint32_t s = 0; sameSlots && s < slots.size(); s++) sameSlots = slots[s].images == slotImages[s];
+		if (sameSlots) return false;
+	}
+
+	if (!images.empty()) vk->waitDeviceIdle();
+	release();
+
+	VmaAllocationCreateInfo lazyAllocInfo = { .usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED };
+	uint32_t lazyMemoryType;
+	hasLazilyAllocatedMemory =
+		vmaFindMemoryTypeIndex(vk->memoryAllocator, UINT32_MAX, &lazyAllocInfo, &lazyMemoryType) == VK_SUCCESS;
+
+	images.resize(graph.getNumImages());
+	requirements.resize(graph.getNumImages());
+	for (RenderGraph::Handle h = 0; h < images.size(); h++)
+	{
+		auto& image = images[h];
+		image.desc = graph.getImageDesc(h);
+		image.usage = graph.getImageUsage(h);
+		if (image.usage == 0) continue; // culled
+
+		VkImageCreateInfo imageInfo = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = image.desc.format,
+			.extent = { image.desc.extent.width, image.desc.extent.height, 1 },
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = image.usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+		};
+		EXPECT(vkCreateImage(vk->device, &imageInfo, nullptr, &image.image), VK_SUCCESS)
+		NAME_OBJECT(VK_OBJECT_TYPE_IMAGE, image.image, image.desc.name)
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(vk->device, image.image, &memoryRequirements);
+		requirements[h] = {
+			.size = memoryRequirements.size,
+			.alignment = memoryRequirements.alignment,
+			.memoryTypeBits = memoryRequirements.memoryTypeBits
+		};
+		unaliasedSize += memoryRequirements.size;
+	}
+
+	graph.assignMemory(requirements, hasLazilyAllocatedMemory);
+
+	for (auto& slot : graph.getMemorySlots())
+	{
+		VkMemoryRequirements memoryRequirements = {
+			.size = slot.requirements.size,
+			.alignment = slot.requirements.alignment,
+			.memoryTypeBits = slot.requirements.memoryTypeBits
+		};
+		VmaAllocationCreateInfo allocInfo = {
+			.usage = slot.lazilyAllocated ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY
+		};
+		VmaAllocation allocation;
+		EXPECT(vmaAllocateMemory(vk->memoryAllocator, &memoryRequirements, &allocInfo, &allocation, nullptr), VK_SUCCESS)
+		allocations.push_back(allocation);
+		allocatedSize += slot.requirements.size;
+
+		for (auto h : slot.images) {
+			EXPECT(vmaBindImageMemory(vk->memoryAllocator, allocation, images[h].image), VK_SUCCESS)
+		}
+		slotImages.push_back(slot.images);
+	}
+
+	for (auto& image : images)
+	{
+		if (image.image == VK_NULL_HANDLE) continue;
+		VkImageViewCreateInfo viewInfo = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = image.image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = image.desc.format,
+			.subresourceRange = { image.desc.aspect, 0, 1, 0, 1 }
+		};
+		EXPECT(vkCreateImageView(vk->device, &viewInfo, nullptr, &image.view), VK_SUCCESS)
+		NAME_OBJECT(VK_OBJECT_TYPE_IMAGE_VIEW, image.view, image.desc.name + "_defaultView")
+	}
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <VulkanMemoryAllocator-3.0.1/include/vk_mem_alloc.h>
+#include <vector>
+#include "Render/RenderGraph.h"
+
+/*
+ * The images of a RenderGraph, placed into the memory slots it assigned (images sharing a slot are bound to the same
+ * allocation). They're kept as long as the graph declares the same images with the same usage, and re-created (after
+ * waiting for the device to be idle) when that changes.
+ * Pass local images go into lazily allocated memory where the device has it, which tilers may never back at all.
+ */
+class TransientImagePool
+{
+public:
+	~TransientImagePool();
+
+	// after graph.compile(): (re-)creates images if needed, and has the graph assign their memory and barriers.
+	// Returns true if the images changed, so whatever refers to their views has to be updated
+	bool realize(RenderGraph& graph);
+
+	VkImage getImage(RenderGraph::Handle image) const { return images[image].image; }
+	VkImageView getImageView(RenderGraph::Handle image) const { return images[image].view; }
+
+	// what the images take up, and what they would without sharing memory
+	VkDeviceSize getAllocatedSize() const { return allocatedSize; }
+	VkDeviceSize getUnaliasedSize() const { return unaliasedSize; }
+
+private:
+	struct Image {
+		RenderGraph::ImageDesc desc;
+		VkImageUsageFlags usage = 0;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+	};
+
+	void release();
+
+	std::vector<Image> images; // by handle
+	std::vector<RenderGraph::MemoryRequirements> requirements;
+	std::vector<VmaAllocation> allocations; // one per memory slot
+	std::vector<std::vector<RenderGraph::Handle>> slotImages; // what got bound to each
+	bool hasLazilyAllocatedMemory = false;
+
+	VkDeviceSize allocatedSize = 0;
+	VkDeviceSize unaliasedSize = 0;
+};
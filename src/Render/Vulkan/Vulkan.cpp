@@ -1,25 +1,38 @@
 #include "Vulkan.hpp"
 #include "PipelineBuilder.h"
 #include "RenderPassBuilder.h"
+#include "StagingRing.h"
+#include "PassTimer.h"
+#include "PipelineCache.h"
+#include "VulkanUtils.h"
 #include "Assets/ConfigAsset.hpp"
 #include <imgui.h>
 #include <backends/imgui_impl_sdl.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
+#include <stb_image/stb_image_write.h>
 
 // #define MYN_VK_VERBOSE
 
-Vulkan::Vulkan(SDL_Window* window) {
+#define STAGING_RING_SIZE (64 * 1024 * 1024)
+
+Vulkan::Vulkan(SDL_Window* window, VkExtent2D offscreenExtent) {
 
     this->window = window;
+	this->offscreenExtent = offscreenExtent;
 
     createInstance();
 	findProxyFunctionPointers();
     #ifdef DEBUG
     setupDebugMessenger();
     #endif
-    createSurface();
+	if (isHeadless()) {
+		surface = VK_NULL_HANDLE;
+		deviceExtensions.clear(); // no swap chain
+	} else {
+		createSurface();
+	}
 
 	if (Config->lookup<int>("Debug.RTX"))
 	{
@@ -30,32 +43,66 @@ Vulkan::Vulkan(SDL_Window* window) {
 
     pickPhysicalDevice();
     createLogicalDevice();
+	PipelineCache::create(device, physicalDeviceProperties);
 	createMemoryAllocator();
-    createSwapChain();
+	if (isHeadless()) createOffscreenTargets();
+	else createSwapChain();
     createImageViews();
 	createCommandPools();
 	createSynchronizationObjects();
+	stagingRing = new StagingRing(device, memoryAllocator, graphicsQueue, graphicsQueueFamily, STAGING_RING_SIZE);
+	if (timestampsSupported) {
+		passTimer = new PassTimer(device, physicalDeviceProperties.limits.timestampPeriod, MAX_FRAME_IN_FLIGHT);
+	}
 	createSwapChainRenderPass();
 	createFramebuffers();
 	createCommandBuffers();
 
 	if (Config->lookup<int>("Debug.RTX")) initRayTracing();
 
+	if (isHeadless()) {
+		// frames start out expecting their image in the layout the previous one left it in
+		immediateSubmit([&](VkCommandBuffer cmdbuf) {
+			for (auto image : swapChainImages) {
+				vk::insertImageBarrier(cmdbuf, image,
+									   {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+									   VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+									   VK_PIPELINE_STAGE_TRANSFER_BIT,
+									   0,
+									   VK_ACCESS_TRANSFER_READ_BIT,
+									   VK_IMAGE_LAYOUT_UNDEFINED,
+									   getPresentLayout());
+			}
+		});
+	}
+
 	initImGui();
 }
 
 Vulkan::~Vulkan() {
 
+	runDeferredDestructions(UINT64_MAX);
+	delete stagingRing;
+	delete passTimer;
+
 	for (int i = destructionQueue.size()-1; i >= 0; i--)
 	{
 		destructionQueue[i]();
 	}
+	PipelineCache::saveAndDestroy();
 
 	if (imguiPool != VK_NULL_HANDLE) {
 		vkDestroyDescriptorPool(device, imguiPool, nullptr);
 		ImGui_ImplVulkan_Shutdown();
 	}
 
+	if (captureBuffer != VK_NULL_HANDLE) vmaDestroyBuffer(memoryAllocator, captureBuffer, captureAllocation);
+	for (size_t i = 0; i < offscreenAllocations.size(); i++) {
+		vkDestroyImageView(device, swapChainImageViews[i], nullptr);
+		vmaDestroyImage(memoryAllocator, swapChainImages[i], offscreenAllocations[i]);
+	}
+	if (isHeadless()) swapChainImageViews.clear();
+
 	vmaDestroyAllocator(memoryAllocator);
 
 	for (int i=0; i<MAX_FRAME_IN_FLIGHT; i++) {
@@ -73,7 +120,7 @@ Vulkan::~Vulkan() {
     for (auto imageView : swapChainImageViews) {
         vkDestroyImageView(device, imageView, nullptr);
     }
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    if (swapChain != VK_NULL_HANDLE) vkDestroySwapchainKHR(device, swapChain, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyDevice(device, nullptr);
     #ifdef DEBUG
@@ -90,9 +137,16 @@ VkCommandBuffer Vulkan::beginFrame()
 	// inFlightFences: no other access when commands are being submitted for operations on this image.
 
 	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	// that was the fence of the frame submitted MAX_FRAME_IN_FLIGHT frames ago; it and everything before it are done
+	if (numSubmittedFrames >= MAX_FRAME_IN_FLIGHT) runDeferredDestructions(numSubmittedFrames - MAX_FRAME_IN_FLIGHT + 1);
 
-	vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &currentImageIndex);
+	if (isHeadless()) {
+		currentImageIndex = currentFrame;
+	} else {
+		vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &currentImageIndex);
+	}
 	auto cmdbuf = getCurrentCommandBuffer();
+	if (passTimer) passTimer->beginFrame(currentFrame);
 
 	// check if a prev frame is using this image
 	if (imagesInFlight[currentImageIndex] != VK_NULL_HANDLE) {
@@ -110,6 +164,7 @@ VkCommandBuffer Vulkan::beginFrame()
 		.pInheritanceInfo = nullptr
 	};
 	EXPECT(vkBeginCommandBuffer(cmdbuf, &beginInfo), VK_SUCCESS)
+	if (passTimer) frameScope = passTimer->beginScope(cmdbuf, "Frame");
 	return cmdbuf;
 }
 
@@ -118,8 +173,13 @@ void Vulkan::endFrame()
 	EXPECT(isFrameStarted, true)
 
 	auto cmdbuf = getCurrentCommandBuffer();
+	if (passTimer) passTimer->endScope(cmdbuf, frameScope);
+	if (!capturePath.empty()) recordCapture(cmdbuf);
 	EXPECT(vkEndCommandBuffer(cmdbuf), VK_SUCCESS)
 
+	// uploads made while recording the frame go first (the whole frame's worth in one submit)
+	stagingRing->submit();
+
 	// submit to queue
 	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
@@ -134,9 +194,23 @@ void Vulkan::endFrame()
 		.signalSemaphoreCount = 1,
 		.pSignalSemaphores = signalSemaphores
 	};
+	if (isHeadless()) {
+		// nothing to acquire from or present to
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.signalSemaphoreCount = 0;
+	}
 
 	vkResetFences(device, 1, &inFlightFences[currentFrame]);
 	EXPECT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]), VK_SUCCESS)
+	numSubmittedFrames++;
+	if (passTimer) passTimer->endFrame();
+
+	if (isHeadless()) {
+		if (!capturePath.empty()) writeCapture();
+		currentFrame = (currentFrame + 1) % MAX_FRAME_IN_FLIGHT;
+		isFrameStarted = false;
+		return;
+	}
 
 	// because it's possible to present to multiple swap chains..
 	VkSwapchainKHR swapChains[] = { swapChain };
@@ -201,6 +275,9 @@ void Vulkan::createMemoryAllocator()
 
 void Vulkan::immediateSubmit(std::function<void(VkCommandBuffer)> &&fn)
 {
+	// anything recorded here may depend on uploads made before it
+	stagingRing->submit();
+
 	VkCommandBufferAllocateInfo allocInfo = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 		.commandPool = shortLivedCommandsPool,
@@ -237,6 +314,104 @@ void Vulkan::immediateSubmit(std::function<void(VkCommandBuffer)> &&fn)
 	vkFreeCommandBuffers(device, shortLivedCommandsPool, 1, &commandBuffer);
 }
 
+void Vulkan::captureFrame(const std::string &path)
+{
+	if (!isHeadless()) {
+		WARN("frame capture only works headless (swap chain images can't be copied from)")
+		return;
+	}
+	capturePath = path;
+}
+
+void Vulkan::recordCapture(VkCommandBuffer cmdbuf)
+{
+	if (captureBuffer == VK_NULL_HANDLE)
+	{
+		VkBufferCreateInfo bufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = VkDeviceSize(swapChainExtent.width) * swapChainExtent.height * 4,
+			.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+		};
+		VmaAllocationCreateInfo allocCreateInfo = {
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_GPU_TO_CPU
+		};
+		VmaAllocationInfo allocInfo;
+		EXPECT(vmaCreateBuffer(memoryAllocator, &bufferInfo, &allocCreateInfo, &captureBuffer, &captureAllocation, &allocInfo), VK_SUCCESS)
+		captureMapped = allocInfo.pMappedData;
+	}
+
+	// the frame's last pass left the image in the present layout
+	auto image = swapChainImages[currentImageIndex];
+	vk::insertImageBarrier(cmdbuf, image,
+						   {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+						   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+						   VK_PIPELINE_STAGE_TRANSFER_BIT,
+						   VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+						   VK_ACCESS_TRANSFER_READ_BIT,
+						   getPresentLayout(),
+						   getPresentLayout());
+	VkBufferImageCopy copyRegion = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+		.imageOffset = {0, 0, 0},
+		.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1}
+	};
+	vkCmdCopyImageToBuffer(cmdbuf, image, getPresentLayout(), captureBuffer, 1, &copyRegion);
+	vk::insertBufferBarrier(cmdbuf, captureBuffer,
+							VK_PIPELINE_STAGE_TRANSFER_BIT,
+							VK_PIPELINE_STAGE_HOST_BIT,
+							VK_ACCESS_TRANSFER_WRITE_BIT,
+							VK_ACCESS_HOST_READ_BIT);
+}
+
+void Vulkan::writeCapture()
+{
+	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	EXPECT(vmaInvalidateAllocation(memoryAllocator, captureAllocation, 0, VK_WHOLE_SIZE), VK_SUCCESS)
+
+	// BGRA -> RGBA
+	uint32_t numPixels = swapChainExtent.width * swapChainExtent.height;
+	std::vector<uint8_t> pixels(numPixels * 4);
+	memcpy(pixels.data(), captureMapped, pixels.size());
+	for (uint32_t i = 0; i < numPixels; i++) std::swap(pixels[i * 4], pixels[i * 4 + 2]);
+
+	if (stbi_write_png(capturePath.c_str(), swapChainExtent.width, swapChainExtent.height, 4, pixels.data(), swapChainExtent.width * 4)) {
+		LOG("captured frame to %s", capturePath.c_str())
+	} else {
+		WARN("failed to write frame capture %s", capturePath.c_str())
+	}
+	capturePath.clear();
+}
+
+void Vulkan::waitDeviceIdle()
+{
+	stagingRing->submit();
+	EXPECT(vkDeviceWaitIdle(device), VK_SUCCESS);
+	if (!isFrameStarted) runDeferredDestructions(numSubmittedFrames);
+}
+
+void Vulkan::destroyAfterFramesInFlight(std::function<void()> &&fn)
+{
+	deferredDestructions.push_back({
+		.numFrames = numSubmittedFrames + (isFrameStarted ? 1 : 0),
+		.fn = std::move(fn)
+	});
+}
+
+void Vulkan::runDeferredDestructions(uint64_t numDoneFrames)
+{
+	// pushed in order, so they're also due in order
+	while (!deferredDestructions.empty() && deferredDestructions.front().numFrames <= numDoneFrames) {
+		auto fn = std::move(deferredDestructions.front().fn);
+		deferredDestructions.pop_front();
+		fn();
+	}
+}
+
 void Vulkan::initImGui()
 {
 	if (imguiPool != VK_NULL_HANDLE)
@@ -269,6 +444,8 @@ void Vulkan::initImGui()
 	EXPECT(vkCreateDescriptorPool(device, &poolInfo, nullptr, &imguiPool), VK_SUCCESS)
 
 	ImGui::CreateContext();
+	// headless: only the context, for code that asks it things; there's nothing to draw the ui to
+	if (isHeadless()) return;
 
 	ImGui_ImplSDL2_InitForVulkan(window);
 
@@ -306,14 +483,17 @@ void Vulkan::createInstance() {
 
     //---- extensions to use with sdl ----
 
-    // get required extensions count
-    uint32_t numSDLRequiredExtensions;
-    EXPECT_M(SDL_Vulkan_GetInstanceExtensions(window, &numSDLRequiredExtensions, nullptr), SDL_TRUE, "%s", SDL_GetError())
-    // get the extensions' names: "VK_KHR_surface", "VK_MVK_macos_surface"
-    std::vector<const char*>enabledExtensions(numSDLRequiredExtensions);
-    EXPECT_M(
-        SDL_Vulkan_GetInstanceExtensions(window, &numSDLRequiredExtensions, enabledExtensions.data()),
-        SDL_TRUE, "%s", SDL_GetError())
+    std::vector<const char*>enabledExtensions;
+    if (!isHeadless()) {
+        // get required extensions count
+        uint32_t numSDLRequiredExtensions;
+        EXPECT_M(SDL_Vulkan_GetInstanceExtensions(window, &numSDLRequiredExtensions, nullptr), SDL_TRUE, "%s", SDL_GetError())
+        // get the extensions' names: "VK_KHR_surface", "VK_MVK_macos_surface"
+        enabledExtensions.resize(numSDLRequiredExtensions);
+        EXPECT_M(
+            SDL_Vulkan_GetInstanceExtensions(window, &numSDLRequiredExtensions, enabledExtensions.data()),
+            SDL_TRUE, "%s", SDL_GetError())
+    }
     #ifdef DEBUG
     enabledExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     #endif
@@ -409,7 +589,12 @@ Vulkan::QueueFamilyIndices Vulkan::findQueueFamilies(VkPhysicalDevice in_device)
 	int i = 0;
 	for (const auto &queueFamily : queueFamilies) {
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(in_device, i, surface, &presentSupport);
+		if (surface != VK_NULL_HANDLE) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(in_device, i, surface, &presentSupport);
+		} else {
+			// headless: "presenting" is copying out of the image, which the graphics queue does
+			presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		}
 		if (presentSupport) {
 			queueFamilyIndices.presentFamily = i;
 		}
@@ -477,13 +662,16 @@ inline bool Vulkan::isDeviceSuitable(VkPhysicalDevice in_device) {
 
 	bool extensionsSupported = checkDeviceExtensionSupport(in_device);
 
-	bool swapChainAdequate = false;
-	if (extensionsSupported) {
+	bool swapChainAdequate = isHeadless();
+	if (extensionsSupported && !isHeadless()) {
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(in_device);
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 	}
 
-	if (properties.deviceType == VkPhysicalDeviceType::VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU//VkPhysicalDeviceType::VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU
+	// headless runs are for benchmarking on whatever the machine has, which can be a cpu implementation like lavapipe
+	bool typeAccepted = properties.deviceType == VkPhysicalDeviceType::VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU || isHeadless();
+
+	if (typeAccepted//VkPhysicalDeviceType::VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU
 		&& queueFamilyIndices.isComplete()
 		&& extensionsSupported
 		&& swapChainAdequate
@@ -507,7 +695,12 @@ void Vulkan::pickPhysicalDevice() {
 	{
 		if (isDeviceSuitable(dvc))
 		{
-			physicalDevice = dvc;
+			// (headless ones can be anything: still rather a discrete gpu, if there is one)
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(dvc, &properties);
+			if (physicalDevice == VK_NULL_HANDLE || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+				physicalDevice = dvc;
+			}
 		}
 	}
 	if (physicalDevice == VK_NULL_HANDLE)
@@ -541,9 +734,15 @@ void Vulkan::createLogicalDevice() {
 	}
 
 	// features
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	textureCompressionBC = supportedFeatures.textureCompressionBC;
 	VkPhysicalDeviceFeatures deviceFeatures {
+		.multiDrawIndirect = supportedFeatures.multiDrawIndirect,
+		.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance,
 		.fillModeNonSolid = 1,
 		.largePoints = 1,
+		.textureCompressionBC = supportedFeatures.textureCompressionBC,
 	};
 
 	// logical device create info
@@ -556,24 +755,62 @@ void Vulkan::createLogicalDevice() {
 		.pEnabledFeatures = &deviceFeatures,
 	};
 
+	// timestamps (for PassTimer) need the graphics queue to support them, and resetting queries from the host
+	VkPhysicalDeviceVulkan12Features supportedFeatures12 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+	};
+	VkPhysicalDeviceFeatures2 supportedFeatures2 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supportedFeatures12,
+	};
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+	timestampsSupported = supportedFeatures12.hostQueryReset &&
+		queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits > 0;
+
+	// bindless drawing
+	bindlessSupported = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance &&
+		supportedFeatures12.runtimeDescriptorArray &&
+		supportedFeatures12.shaderSampledImageArrayNonUniformIndexing &&
+		supportedFeatures12.descriptorBindingPartiallyBound &&
+		supportedFeatures12.descriptorBindingUpdateUnusedWhilePending;
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	// leaving some room for other bindings in the same stage
+	maxBindlessTextures = std::min(
+		deviceProperties.limits.maxPerStageDescriptorSampledImages,
+		deviceProperties.limits.maxDescriptorSetSampledImages);
+	maxBindlessTextures = maxBindlessTextures > 64 ? maxBindlessTextures - 64 : 0;
+	bindlessSupported = bindlessSupported && maxBindlessTextures >= 4; // at least one material
+
+	VkPhysicalDeviceVulkan12Features features12 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		.pNext = nullptr,
+		.shaderSampledImageArrayNonUniformIndexing = bindlessSupported,
+		.descriptorBindingUpdateUnusedWhilePending = bindlessSupported,
+		.descriptorBindingPartiallyBound = bindlessSupported,
+		.runtimeDescriptorArray = bindlessSupported,
+		.hostQueryReset = supportedFeatures12.hostQueryReset,
+	};
+	createInfo.pNext = &features12;
+
+	VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
+		.pNext = &features12,
+		.rayTracingPipeline = VK_TRUE,
+	};
+	VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
+		.pNext = &rtFeatures,
+		.accelerationStructure = VK_TRUE,
+	};
 	if (Config->lookup<int>("Debug.RTX"))
 	{
-		VkPhysicalDeviceVulkan12Features features12 = {
-			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
-			.pNext = nullptr,
-			.hostQueryReset = VK_TRUE,
-			.bufferDeviceAddress = VK_TRUE,
-		};
-		VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtFeatures = {
-			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
-			.pNext = &features12,
-			.rayTracingPipeline = VK_TRUE,
-		};
-		VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures = {
-			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
-			.pNext = &rtFeatures,
-			.accelerationStructure = VK_TRUE,
-		};
+		features12.hostQueryReset = VK_TRUE;
+		features12.bufferDeviceAddress = VK_TRUE;
 		createInfo.pNext = &asFeatures;
 	}
 
@@ -687,6 +924,37 @@ void Vulkan::createSwapChain() {
 	swapChainExtent = extent;
 }
 
+void Vulkan::createOffscreenTargets()
+{
+	// the format windows usually get (see chooseSwapSurfaceFormat), so everything renders the same as it would there
+	swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+	swapChainExtent = offscreenExtent;
+
+	VkImageCreateInfo imageInfo = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = swapChainImageFormat,
+		.extent = {offscreenExtent.width, offscreenExtent.height, 1},
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		// same as the swap chain's, plus copying out for frame captures
+		.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+	};
+	VmaAllocationCreateInfo allocInfo = {
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY
+	};
+
+	// one per frame in flight, like a swap chain with that many images
+	swapChainImages.resize(MAX_FRAME_IN_FLIGHT);
+	offscreenAllocations.resize(MAX_FRAME_IN_FLIGHT);
+	for (int i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+		EXPECT(vmaCreateImage(memoryAllocator, &imageInfo, &allocInfo, &swapChainImages[i], &offscreenAllocations[i], nullptr), VK_SUCCESS)
+		NAME_OBJECT(VK_OBJECT_TYPE_IMAGE, swapChainImages[i], "Offscreen target " + std::to_string(i))
+	}
+}
+
 /*
 void Vulkan::createDepthImageAndView()
 {
@@ -810,6 +1078,7 @@ void Vulkan::createFramebuffers() {
 
 void Vulkan::createCommandPools() {
 	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+	graphicsQueueFamily = queueFamilyIndices.graphicsFamily.value();
 	VkCommandPoolCreateInfo poolInfo = {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
 		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
@@ -7,6 +7,7 @@
 #include <optional>
 #include <VulkanMemoryAllocator-3.0.1/include/vk_mem_alloc.h>
 #include <functional>
+#include <deque>
 #include "Buffer.h"
 #include "Utils/myn/Color.h"
 
@@ -18,6 +19,8 @@ https://gist.github.com/YukiSnowy/dc31f47448ac61dd6aedee18b5d53858
 */
 
 struct SDL_Window;
+class StagingRing;
+class PassTimer;
 
 struct VmaAllocatedImage
 {
@@ -29,7 +32,9 @@ struct Vulkan {
 
 	static Vulkan* Instance;
 
-	Vulkan(SDL_Window* window);
+	// without a window (headless), frames are rendered into offscreenExtent sized images that stand in for the swap
+	// chain, and nothing gets presented
+	Vulkan(SDL_Window* window, VkExtent2D offscreenExtent = {0, 0});
 
 	~Vulkan();
 
@@ -67,13 +72,28 @@ struct Vulkan {
 		return currentFrame;
 	}
 
+	uint32_t getMaxFramesInFlight() const { return MAX_FRAME_IN_FLIGHT; }
+
 	VkRenderPass getSwapChainRenderPass() const { return swapChainRenderPass; }
 
-	void waitDeviceIdle()
+	bool isHeadless() const { return window == nullptr; }
+
+	// what swap chain images are left in at the end of a frame
+	VkImageLayout getPresentLayout() const
 	{
-		EXPECT(vkDeviceWaitIdle(device), VK_SUCCESS);
+		return isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 	}
 
+	// headless only: writes what the current frame ends up presenting to path (png), once it's done in endFrame()
+	void captureFrame(const std::string &path);
+
+	// also submits pending uploads first, so they're done too
+	void waitDeviceIdle();
+
+	// runs fn once the frames that were submitted so far (and the one being recorded, if any) are done on the gpu, so
+	// it can destroy what they use without waiting for the device to idle. Checked at the start of each frame
+	void destroyAfterFramesInFlight(std::function<void()> &&fn);
+
 	VkDevice device;
 	VkFormat swapChainImageFormat;
 	VkFormat swapChainDepthFormat;
@@ -83,9 +103,21 @@ struct Vulkan {
 	uint32_t shaderGroupHandleSize = 0;
 	uint32_t shaderGroupBaseAlignment = 0;
 	uint32_t shaderGroupHandleAlignment = 0;
+	bool textureCompressionBC = false; // BC1-7 formats can be sampled
+	// multi draw indirect with an index of the draw (firstInstance), and big, partially bound arrays of textures indexed
+	// non-uniformly (see BindlessScene.h)
+	bool bindlessSupported = false;
+	uint32_t maxBindlessTextures = 0;
+	uint32_t graphicsQueueFamily = 0;
 
 	VmaAllocator memoryAllocator;
 
+	// uploads record into this; see StagingRing.h
+	StagingRing* stagingRing = nullptr;
+
+	// timings of the SCOPED_DRAW_EVENT scopes; null if the device can't do timestamps
+	PassTimer* passTimer = nullptr;
+
 	std::vector<std::function<void()>> destructionQueue;
 
 private:
@@ -95,6 +127,14 @@ private:
 
 	const int MAX_FRAME_IN_FLIGHT = 2;
 	size_t currentFrame = 0;
+	uint64_t numSubmittedFrames = 0;
+
+	struct DeferredDestruction {
+		uint64_t numFrames; // can run once this many frames are done
+		std::function<void()> fn;
+	};
+	std::deque<DeferredDestruction> deferredDestructions;
+	void runDeferredDestructions(uint64_t numDoneFrames);
 
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphicsFamily;
@@ -122,7 +162,10 @@ private:
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
 
-	VkSwapchainKHR swapChain;
+	bool timestampsSupported = false;
+	uint32_t frameScope = 0; // of passTimer
+
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 	std::vector<VkImageView> swapChainImageViews;
@@ -141,10 +184,19 @@ private:
 
 	VkDescriptorPool imguiPool = VK_NULL_HANDLE;
 
+	// headless: images (and their memory) that take the place of the swap chain's
+	VkExtent2D offscreenExtent;
+	std::vector<VmaAllocation> offscreenAllocations;
+
+	std::string capturePath;
+	VkBuffer captureBuffer = VK_NULL_HANDLE;
+	VmaAllocation captureAllocation = VK_NULL_HANDLE;
+	void* captureMapped = nullptr;
+
 	#ifdef DEBUG
 	const std::vector<const char*> validationLayers = {
 		// NOTE: things that this layer reports seems different from the ones on windows?
-	#ifdef WINOS
+	#if defined(WINOS) || defined(LINUXOS)
 		"VK_LAYER_KHRONOS_validation"
 	#else
 		"MoltenVK"
@@ -183,6 +235,13 @@ private:
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 	void createSwapChain();
 
+	void createOffscreenTargets();
+
+	// records the copy of the current swap chain image into captureBuffer
+	void recordCapture(VkCommandBuffer cmdbuf);
+	// once the frame is done
+	void writeCapture();
+
 	void createImageViews();
 
 	static inline std::vector<char> readFile(const std::string& filename);
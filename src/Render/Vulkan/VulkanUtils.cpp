@@ -2,6 +2,9 @@
 #include <glm/common.hpp>
 #include "VulkanUtils.h"
 #include "Vulkan.hpp"
+#include "StagingRing.h"
+#include "PassTimer.h"
+#include <cstring>
 
 Vulkan* Vulkan::Instance = nullptr;
 
@@ -33,6 +36,12 @@ bool vk::init_window(
 	return true;
 }
 
+void vk::init_headless(int width, int height)
+{
+	if (Vulkan::Instance) return;
+	Vulkan::Instance = new Vulkan(nullptr, {static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+}
+
 void vk::copyBuffer(VkBuffer dstBuffer, VkBuffer srcBuffer, VkDeviceSize size)
 {
 	Vulkan::Instance->immediateSubmit([&](VkCommandBuffer cmdbuf)
@@ -153,7 +162,7 @@ void vk::blitToScreen(VkCommandBuffer cmdbuf, VkImage image, VkOffset3D srcOffse
 						   VK_ACCESS_TRANSFER_WRITE_BIT,
 						   VK_ACCESS_MEMORY_READ_BIT,
 						   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-						   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+						   Vulkan::Instance->getPresentLayout());
 }
 
 void vk::drawFullscreenTriangle(VkCommandBuffer cmdbuf)
@@ -161,6 +170,46 @@ void vk::drawFullscreenTriangle(VkCommandBuffer cmdbuf)
 	vkCmdDraw(cmdbuf, 3, 1, 0, 0);
 }
 
+void vk::stageUpload(
+	const void *data,
+	VkDeviceSize size,
+	VkDeviceSize alignment,
+	const std::function<void(VkCommandBuffer, VkBuffer, VkDeviceSize)> &recordCopy)
+{
+	auto ring = Vulkan::Instance->stagingRing;
+	StagingRing::Allocation staging;
+	if (ring->allocate(size, alignment, staging))
+	{
+		memcpy(staging.mapped, data, size);
+		recordCopy(ring->commands(), staging.buffer, staging.offset);
+		return;
+	}
+
+	// bigger than the whole ring: its own staging buffer and a blocking submit, like it used to be for everything
+	VmaBuffer stagingBuffer({&Vulkan::Instance->memoryAllocator, size,
+							VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU});
+	stagingBuffer.writeData((void*)data, size);
+	Vulkan::Instance->immediateSubmit(
+		[&](VkCommandBuffer cmdbuf)
+		{
+			recordCopy(cmdbuf, stagingBuffer.getBufferInstance(), 0);
+		});
+	stagingBuffer.release();
+}
+
+void vk::uploadToBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size)
+{
+	vk::stageUpload(data, size, 4, [&](VkCommandBuffer cmdbuf, VkBuffer srcBuffer, VkDeviceSize srcOffset)
+	{
+		VkBufferCopy copyRegion = {
+			.srcOffset = srcOffset,
+			.dstOffset = 0,
+			.size = size
+		};
+		vkCmdCopyBuffer(cmdbuf, srcBuffer, dstBuffer, 1, &copyRegion);
+	});
+}
+
 void vk::uploadPixelsToImage(
 	uint8_t *pixels,
 	int32_t offsetX,
@@ -168,24 +217,104 @@ void vk::uploadPixelsToImage(
 	uint32_t extentX,
 	uint32_t extentY,
 	uint32_t pixelSize,
-	VmaAllocatedImage outResource)
+	VmaAllocatedImage outResource,
+	VkImageLayout currentLayout)
 {
 	VkDeviceSize copyRegionSize = extentX * extentY * pixelSize;
-	VmaBuffer stagingBuffer({&Vulkan::Instance->memoryAllocator, copyRegionSize,
-							VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU});
-	stagingBuffer.writeData(pixels, copyRegionSize);
-	Vulkan::Instance->immediateSubmit(
-		[&](VkCommandBuffer cmdbuf)
+	// buffer offsets of image copies have to be multiples of both 4 and the texel size
+	vk::stageUpload(pixels, copyRegionSize, pixelSize * 4, [&](VkCommandBuffer cmdbuf, VkBuffer srcBuffer, VkDeviceSize srcOffset)
+	{
+		// image layout
+		auto transferLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		auto shaderReadLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		// barrier the image into the transfer-receive layout (keeping what's outside the region if it's been written to)
+		bool keepContents = currentLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+		vk::insertImageBarrier(
+			cmdbuf,
+			outResource.image,
+			{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,1},
+			keepContents ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			keepContents ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : 0,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			currentLayout,
+			transferLayout);
+
+		// do the transfer
+		VkBufferImageCopy copyRegion = {
+			.bufferOffset = srcOffset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = 0,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = {offsetX, offsetY, 0},
+			.imageExtent = {extentX, extentY, 1}
+		};
+		vkCmdCopyBufferToImage(
+			cmdbuf,
+			srcBuffer,
+			outResource.image,
+			transferLayout,
+			1,
+			&copyRegion);
+
+		//barrier it again into shader readonly optimal layout
+		vk::insertImageBarrier(
+			cmdbuf,
+			outResource.image,
+			{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,1},
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			transferLayout,
+			shaderReadLayout);
+	});
+}
+
+void vk::uploadMipsToImage(
+	const uint8_t *data,
+	VkDeviceSize dataSize,
+	const std::vector<VkDeviceSize> &mipOffsets,
+	const std::vector<VkExtent2D> &mipExtents,
+	VmaAllocatedImage outResource)
+{
+	auto numMips = static_cast<uint32_t>(mipExtents.size());
+	std::vector<VkBufferImageCopy> copyRegions(numMips);
+	for (uint32_t i = 0; i < numMips; i++)
+	{
+		copyRegions[i] = {
+			.bufferOffset = mipOffsets[i], // offset of the staged data added below
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = {0, 0, 0},
+			.imageExtent = {mipExtents[i].width, mipExtents[i].height, 1}
+		};
+	}
+
+	// 16: the block size of the compressed formats, and a multiple of 4 byte texels
+	vk::stageUpload(data, dataSize, 16, [&](VkCommandBuffer cmdbuf, VkBuffer srcBuffer, VkDeviceSize srcOffset)
 		{
-			// image layout
+			for (auto& region : copyRegions) region.bufferOffset += srcOffset;
+
 			auto transferLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 			auto shaderReadLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-			// barrier the image into the transfer-receive layout
 			vk::insertImageBarrier(
 				cmdbuf,
 				outResource.image,
-				{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,1},
+				{VK_IMAGE_ASPECT_COLOR_BIT, 0, numMips, 0,1},
 				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
 				VK_PIPELINE_STAGE_TRANSFER_BIT,
 				0,
@@ -193,33 +322,18 @@ void vk::uploadPixelsToImage(
 				VK_IMAGE_LAYOUT_UNDEFINED,
 				transferLayout);
 
-			// do the transfer
-			VkBufferImageCopy copyRegion = {
-				.bufferOffset = 0,
-				.bufferRowLength = 0,
-				.bufferImageHeight = 0,
-				.imageSubresource = {
-					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-					.mipLevel = 0,
-					.baseArrayLayer = 0,
-					.layerCount = 1
-				},
-				.imageOffset = {offsetX, offsetY, 0},
-				.imageExtent = {extentX, extentY, 1}
-			};
 			vkCmdCopyBufferToImage(
 				cmdbuf,
-				stagingBuffer.getBufferInstance(),
+				srcBuffer,
 				outResource.image,
 				transferLayout,
-				1,
-				&copyRegion);
+				numMips,
+				copyRegions.data());
 
-			//barrier it again into shader readonly optimal layout
 			vk::insertImageBarrier(
 				cmdbuf,
 				outResource.image,
-				{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,1},
+				{VK_IMAGE_ASPECT_COLOR_BIT, 0, numMips, 0,1},
 				VK_PIPELINE_STAGE_TRANSFER_BIT,
 				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
 				VK_ACCESS_TRANSFER_WRITE_BIT,
@@ -227,25 +341,13 @@ void vk::uploadPixelsToImage(
 				transferLayout,
 				shaderReadLayout);
 		});
-
-	stagingBuffer.release();
 }
 
-void vk::create_vertex_buffer(void *data, uint32_t num_vertices, uint32_t vertex_size, VmaBuffer &vertexBuffer)
+void vk::create_vertex_buffer(const void *data, uint32_t num_vertices, uint32_t vertex_size, VmaBuffer &vertexBuffer)
 {
 	VkDeviceSize bufferSize = vertex_size * num_vertices;
 
-	// create a staging buffer
-	VmaBuffer stagingBuffer({
-		&Vulkan::Instance->memoryAllocator,
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_TO_GPU});
-
-	// copy vertex buffer memory over to staging buffer
-	stagingBuffer.writeData(data, bufferSize);
-
-	// now create the actual vertex buffer
+	// create the actual vertex buffer
 	VkBufferUsageFlags vkUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 	vertexBuffer = VmaBuffer({
 		&Vulkan::Instance->memoryAllocator,
@@ -254,22 +356,14 @@ void vk::create_vertex_buffer(void *data, uint32_t num_vertices, uint32_t vertex
 		VMA_MEMORY_USAGE_GPU_ONLY,
 		"Vertex buffer"});
 
-	// and copy stuff from staging buffer to vertex buffer
-	vk::copyBuffer(vertexBuffer.getBufferInstance(), stagingBuffer.getBufferInstance(), bufferSize);
-	stagingBuffer.release();
+	// and copy stuff into it through the staging ring
+	vk::uploadToBuffer(vertexBuffer.getBufferInstance(), data, bufferSize);
 }
 
-void vk::create_index_buffer(void *data, uint32_t num_indices, uint32_t index_size, VmaBuffer &indexBuffer)
+void vk::create_index_buffer(const void *data, uint32_t num_indices, uint32_t index_size, VmaBuffer &indexBuffer)
 {
 	VkDeviceSize bufferSize = index_size * num_indices;
 
-	// create a staging buffer
-	VmaBuffer stagingBuffer({&Vulkan::Instance->memoryAllocator, bufferSize,
-							 VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU});
-
-	// copy data to staging buffer
-	stagingBuffer.writeData(data, bufferSize);
-
 	// create the actual index buffer
 	VkBufferUsageFlags vkUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 	indexBuffer = VmaBuffer({
@@ -280,9 +374,7 @@ void vk::create_index_buffer(void *data, uint32_t num_indices, uint32_t index_si
 		"Index buffer"
 	});
 
-	// move stuff from staging buffer and destroy staging buffer
-	vk::copyBuffer(indexBuffer.getBufferInstance(), stagingBuffer.getBufferInstance(), bufferSize);
-	stagingBuffer.release();
+	vk::uploadToBuffer(indexBuffer.getBufferInstance(), data, bufferSize);
 }
 
 // took from ImGui
@@ -373,17 +465,25 @@ void vk::generateMips(VmaAllocatedImage image, uint32_t width, uint32_t height)
 		});
 }
 
-ScopedDrawEvent::ScopedDrawEvent(VkCommandBuffer &cmdbuf, const std::string &name, myn::Color color) : cmdbuf(cmdbuf)
+ScopedDrawEvent::ScopedDrawEvent(VkCommandBuffer &cmdbuf, const std::string &name, myn::Color color) : cmdbuf(cmdbuf), cpuScope(name)
 {
+#ifdef WINOS
 	VkDebugUtilsLabelEXT markerInfo {
 		.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
 		.pLabelName = name.c_str(),
 		.color = {color.r, color.g, color.b, color.a}
 	};
 	Vulkan::Instance->fn_vkCmdBeginDebugUtilsLabelEXT(cmdbuf, &markerInfo);
+#endif
+	auto passTimer = Vulkan::Instance->passTimer;
+	timerScope = passTimer && Vulkan::Instance->isFrameInProgress() ?
+		passTimer->beginScope(cmdbuf, name) : PassTimer::INVALID_SCOPE;
 }
 
 ScopedDrawEvent::~ScopedDrawEvent()
 {
+	if (timerScope != PassTimer::INVALID_SCOPE) Vulkan::Instance->passTimer->endScope(cmdbuf, timerScope);
+#ifdef WINOS
 	Vulkan::Instance->fn_vkCmdEndDebugUtilsLabelEXT(cmdbuf);
+#endif
 }
@@ -1,8 +1,10 @@
 #pragma once
 #include <string>
+#include <functional>
 #include <vulkan/vulkan.h>
 #include "Render/Vulkan/Vulkan.hpp"
 #include "Utils/myn/Color.h"
+#include "Utils/myn/Profiler.h"
 
 class SDL_Window;
 
@@ -14,8 +16,23 @@ namespace vk
 		int height,
 		SDL_Window** window);
 
+	// without a window or swap chain: frames go to offscreen images (see Vulkan::isHeadless)
+	void init_headless(int width, int height);
+
 	void copyBuffer(VkBuffer dstBuffer, VkBuffer srcBuffer, VkDeviceSize size);
 
+	// copies data into the staging ring right away and has recordCopy(cmdbuf, srcBuffer, srcOffset) record the copies
+	// out of it, which get submitted along with all other uploads before the current frame (see StagingRing.h).
+	// The data only has to be alive during the call
+	void stageUpload(
+		const void* data,
+		VkDeviceSize size,
+		VkDeviceSize alignment,
+		const std::function<void(VkCommandBuffer cmdbuf, VkBuffer srcBuffer, VkDeviceSize srcOffset)> &recordCopy);
+
+	// to the start of dstBuffer, through the staging ring
+	void uploadToBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size);
+
 	void insertImageBarrier(
 		VkCommandBuffer cmdbuf,
 		VkImage image,
@@ -43,11 +60,22 @@ namespace vk
 		uint32_t extentX,
 		uint32_t extentY,
 		uint32_t pixelSize,
+		VmaAllocatedImage outResource,
+		// UNDEFINED discards the rest of the image; pass SHADER_READ_ONLY_OPTIMAL for updating part of an uploaded one
+		VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	// copies a whole (ie. pre-mipped, compressed) mip chain in one go; mip i is mipSizes[i] bytes at mipOffsets[i]
+	// of data. Leaves all mips in shader read layout
+	void uploadMipsToImage(
+		const uint8_t *data,
+		VkDeviceSize dataSize,
+		const std::vector<VkDeviceSize> &mipOffsets,
+		const std::vector<VkExtent2D> &mipExtents,
 		VmaAllocatedImage outResource);
 
-	void create_vertex_buffer(void* data, uint32_t num_vertices, uint32_t vertex_size, VmaBuffer& vertexBuffer);
+	void create_vertex_buffer(const void* data, uint32_t num_vertices, uint32_t vertex_size, VmaBuffer& vertexBuffer);
 
-	void create_index_buffer(void* data, uint32_t num_indices, uint32_t index_size, VmaBuffer& indexBuffer);
+	void create_index_buffer(const void* data, uint32_t num_indices, uint32_t index_size, VmaBuffer& indexBuffer);
 
 	void generateMips(VmaAllocatedImage image, uint32_t width, uint32_t height);
 
@@ -56,9 +84,12 @@ namespace vk
 	void drawFullscreenTriangle(VkCommandBuffer cmdbuf);
 }
 
+// a debug label (windows only), a cpu scope for the profiler, and a PassTimer scope if it's recorded during a frame
 class ScopedDrawEvent
 {
 	VkCommandBuffer &cmdbuf;
+	myn::profiler::Scope cpuScope;
+	uint32_t timerScope;
 public:
 	ScopedDrawEvent(VkCommandBuffer &cmdbuf, const std::string &name, myn::Color color = {0, 0, 0, 0});
 	~ScopedDrawEvent();
@@ -69,7 +100,7 @@ public:
 #define DEBUG_LABEL(CMDBUF, NAME, ...) Vulkan::Instance->cmdInsertDebugLabel(CMDBUF, NAME, __VA_ARGS__);
 #define NAME_OBJECT(VK_OBJECT_TYPE, OBJECT, NAME) Vulkan::Instance->setObjectName(VK_OBJECT_TYPE, (uint64_t)OBJECT, NAME);
 #else
-#define SCOPED_DRAW_EVENT(CMDBUF, NAME, ...) ;
+#define SCOPED_DRAW_EVENT(CMDBUF, NAME, ...) ScopedDrawEvent __scopedDrawEvent(CMDBUF, NAME, ##__VA_ARGS__);
 #define DEBUG_LABEL(CMDBUF, NAME, ...) ;
 #define NAME_OBJECT(VK_OBJECT_TYPE, OBJECT, NAME) ;
 #endif
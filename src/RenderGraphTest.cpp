@@ -0,0 +1,238 @@
+#include "Utils/myn/Log.h"
+#include "Render/RenderGraph.h"
+#include <string>
+
+/*
+ * Checks for RenderGraph's compilation, on the cpu only: pass culling, image lifetimes and usages, memory aliasing, and
+ * the barriers in front of each pass for the deferred renderer's graph. Returns non-zero if any of them fails.
+ */
+
+namespace {
+
+bool check(bool passed, const char* what) {
+	LOG("%s%s", what, passed ? "" : " FAILED")
+	return passed;
+}
+
+void noRecord(VkCommandBuffer) {}
+
+RenderGraph::Handle colorImage(RenderGraph& graph, const char* name) {
+	return graph.createImage({ name, VK_FORMAT_R16G16B16A16_SFLOAT, {1920, 1080}, VK_IMAGE_ASPECT_COLOR_BIT });
+}
+
+// same size and memory types for all, so any two images that aren't alive at the same time can share memory
+std::vector<RenderGraph::MemoryRequirements> sameRequirements(const RenderGraph& graph) {
+	return std::vector<RenderGraph::MemoryRequirements>(graph.getNumImages(), { 1 << 24, 256, 0x3 });
+}
+
+bool hasBarrier(const RenderGraph& graph, uint32_t pass, const RenderGraph::Barrier& expected) {
+	for (auto& barrier : graph.getBarriers(pass)) {
+		if (barrier.image == expected.image && barrier.oldLayout == expected.oldLayout &&
+			barrier.newLayout == expected.newLayout && barrier.srcStages == expected.srcStages &&
+			barrier.dstStages == expected.dstStages && barrier.srcAccess == expected.srcAccess &&
+			barrier.dstAccess == expected.dstAccess) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool checkCulling() {
+	bool ok = true;
+	RenderGraph graph;
+	auto a = colorImage(graph, "a");
+	auto b = colorImage(graph, "b");
+	auto unused = colorImage(graph, "unused");
+	auto overwritten = colorImage(graph, "overwritten");
+	graph.addPass("write a", {{a, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("a to b", {{a, {RenderGraph::Sampled}}, {b, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("write unused", {{unused, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("write overwritten", {{overwritten, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("clear overwritten", {{overwritten, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("present b", {{b, {RenderGraph::TransferSrc}}, {overwritten, {RenderGraph::Sampled}}}, noRecord, true);
+	graph.compile();
+
+	auto& schedule = graph.getSchedule();
+	ok &= check(schedule == std::vector<uint32_t>({ 0, 1, 4, 5 }), "only passes the side effect depends on are scheduled");
+	ok &= check(graph.getImageUsage(unused) == 0, "images of culled passes aren't used");
+	ok &= check(graph.getImageUsage(b) == (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT),
+		"usage flags of all scheduled uses");
+
+	RenderGraph noSideEffects;
+	auto c = colorImage(noSideEffects, "c");
+	noSideEffects.addPass("write c", {{c, {RenderGraph::ColorAttachment}}}, noRecord);
+	noSideEffects.compile();
+	ok &= check(noSideEffects.getSchedule().empty(), "nothing with side effects: nothing scheduled");
+	return ok;
+}
+
+bool checkLifetimesAndAliasing() {
+	bool ok = true;
+	RenderGraph graph;
+	auto early = colorImage(graph, "early");
+	auto middle = colorImage(graph, "middle");
+	auto late = colorImage(graph, "late");
+	auto longLived = colorImage(graph, "longLived");
+	auto local = colorImage(graph, "local");
+	graph.addPass("0", {{early, {RenderGraph::ColorAttachment}}, {longLived, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("1", {
+		{early, {RenderGraph::Sampled}},
+		{middle, {RenderGraph::ColorAttachment}},
+		{local, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}}
+	}, noRecord);
+	graph.addPass("2", {{middle, {RenderGraph::Sampled}}, {late, {RenderGraph::ColorAttachment}}}, noRecord);
+	graph.addPass("3", {{late, {RenderGraph::TransferSrc}}, {longLived, {RenderGraph::Sampled}}}, noRecord, true);
+	graph.compile();
+
+	ok &= check(graph.getFirstUse(early) == 0 && graph.getLastUse(early) == 1, "lifetime: first to last scheduled use");
+	ok &= check(graph.getFirstUse(longLived) == 0 && graph.getLastUse(longLived) == 3, "lifetime: spans unused passes");
+	ok &= check(graph.isPassLocal(local), "attachment of a single pass: pass local");
+	ok &= check(graph.getImageUsage(local) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, "pass local images are transient");
+	ok &= check(!graph.isPassLocal(early) && !graph.isPassLocal(middle) && !graph.isPassLocal(longLived),
+		"images used by more than one pass aren't pass local");
+
+	RenderGraph sampledOnce;
+	auto sampled = colorImage(sampledOnce, "sampled");
+	sampledOnce.addPass("0", {{sampled, {RenderGraph::ColorAttachment, RenderGraph::Sampled}}}, noRecord, true);
+	sampledOnce.compile();
+	ok &= check(!sampledOnce.isPassLocal(sampled), "sampled within its only pass: not pass local");
+
+	// aliasing
+	graph.assignMemory(sameRequirements(graph), false);
+	auto& slots = graph.getMemorySlots();
+	bool disjoint = true;
+	for (auto& slot : slots) {
+		for (auto i : slot.images) {
+			for (auto j : slot.images) {
+				if (i == j) continue;
+				bool overlap = graph.getFirstUse(i) <= graph.getLastUse(j) && graph.getFirstUse(j) <= graph.getLastUse(i);
+				disjoint &= !overlap;
+			}
+		}
+	}
+	ok &= check(disjoint, "images sharing a slot are never alive at the same time");
+	// early (0-1) and late (2-3) can share, middle (1-2) overlaps both
+	auto slotOf = [&](RenderGraph::Handle image) {
+		for (uint32_t s = 0; s < slots.size(); s++) {
+			for (auto i : slots[s].images) if (i == image) return s;
+		}
+		return uint32_t(~0u);
+	};
+	ok &= check(slotOf(early) == slotOf(late), "non overlapping images share a slot");
+	ok &= check(slots.size() == 4, "as few slots as the most images alive at once");
+
+	// incompatible memory types never share
+	auto requirements = sameRequirements(graph);
+	requirements[late].memoryTypeBits = 0x4;
+	graph.assignMemory(requirements, false);
+	ok &= check(slotOf(early) != slotOf(late), "no memory type in common: separate slots");
+
+	graph.assignMemory(sameRequirements(graph), true);
+	bool localAlone = false;
+	for (auto& slot : slots) {
+		if (slot.lazilyAllocated) localAlone = slot.images == std::vector<RenderGraph::Handle>({ local });
+	}
+	ok &= check(localAlone, "separatePassLocal: pass local image in its own lazily allocated slot");
+	return ok;
+}
+
+// same as DeferredRenderer::render declares it
+bool checkDeferredBarriers() {
+	bool ok = true;
+	RenderGraph graph;
+	auto GPosition = colorImage(graph, "GPosition");
+	auto GNormal = colorImage(graph, "GNormal");
+	auto GColor = colorImage(graph, "GColor");
+	auto GORM = colorImage(graph, "GORM");
+	auto sceneColor = colorImage(graph, "sceneColor");
+	auto sceneDepth = graph.createImage({ "sceneDepth", VK_FORMAT_D32_SFLOAT, {1920, 1080}, VK_IMAGE_ASPECT_DEPTH_BIT });
+	auto postProcessed = colorImage(graph, "postProcessed");
+	graph.addPass("Scene", {
+		{GPosition, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+		{GNormal, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+		{GColor, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+		{GORM, {RenderGraph::ColorAttachment, RenderGraph::InputAttachment}},
+		{sceneColor, {RenderGraph::ColorAttachment}},
+		{sceneDepth, {RenderGraph::DepthAttachment}}
+	}, noRecord);
+	graph.addPass("Post processing", {
+		{sceneColor, {RenderGraph::Sampled}},
+		{sceneDepth, {RenderGraph::Sampled, RenderGraph::DepthAttachmentLoad}},
+		{postProcessed, {RenderGraph::ColorAttachment}}
+	}, noRecord);
+	graph.addPass("Present", {{postProcessed, {RenderGraph::TransferSrc}}}, noRecord, true);
+	graph.compile();
+
+	ok &= check(graph.getSchedule() == std::vector<uint32_t>({ 0, 1, 2 }), "deferred: all passes scheduled");
+	ok &= check(graph.isPassLocal(GPosition) && graph.isPassLocal(GORM), "deferred: gbuffers are pass local");
+	ok &= check(!graph.isPassLocal(sceneColor) && !graph.isPassLocal(sceneDepth), "deferred: scene color & depth aren't");
+
+	graph.assignMemory(sameRequirements(graph), true);
+
+	constexpr VkPipelineStageFlags colorOutput = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	constexpr VkPipelineStageFlags fragment = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	constexpr VkPipelineStageFlags depthTests =
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	constexpr VkAccessFlags colorReadWrite = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	constexpr VkAccessFlags depthReadWrite =
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// Scene: everything starts out undefined, after whatever used its memory last in the previous frame
+	ok &= check(graph.getBarriers(0).size() == 6, "Scene: a barrier per image");
+	ok &= check(hasBarrier(graph, 0, {
+		GPosition, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		colorOutput | fragment, colorOutput | fragment,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, colorReadWrite | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT
+	}), "Scene: gbuffer undefined -> color attachment");
+	ok &= check(hasBarrier(graph, 0, {
+		sceneDepth, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		fragment | depthTests, depthTests,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, depthReadWrite
+	}), "Scene: depth undefined -> depth attachment, after last frame's post processing");
+
+	// Post processing: what Scene wrote becomes readable
+	ok &= check(hasBarrier(graph, 1, {
+		sceneColor, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		colorOutput, fragment,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT
+	}), "Post processing: scene color attachment -> shader read");
+	ok &= check(hasBarrier(graph, 1, {
+		sceneDepth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		depthTests, fragment | depthTests,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | depthReadWrite
+	}), "Post processing: depth attachment -> shader read");
+	bool postTakesOver = false;
+	for (auto& barrier : graph.getBarriers(1)) {
+		postTakesOver |= barrier.image == postProcessed && barrier.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
+			barrier.newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+	ok &= check(postTakesOver, "Post processing: output undefined -> color attachment");
+
+	// Present
+	ok &= check(graph.getBarriers(2).size() == 1 && hasBarrier(graph, 2, {
+		postProcessed, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		colorOutput, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT
+	}), "Present: color attachment -> transfer src");
+
+	// when not kept apart, the post processing output can take over a gbuffer's memory
+	graph.assignMemory(sameRequirements(graph), false);
+	bool waitsForGBuffer = false;
+	for (auto& barrier : graph.getBarriers(1)) {
+		waitsForGBuffer |= barrier.image == postProcessed && barrier.srcStages == (colorOutput | fragment) &&
+			barrier.srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	}
+	ok &= check(waitsForGBuffer, "aliased: post processing output waits for the gbuffer it replaces");
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = checkCulling();
+	ok &= checkLifetimesAndAliasing();
+	ok &= checkDeferredBarriers();
+	LOG("%s", ok ? "all passed" : "render graph check FAILED")
+	return ok ? 0 : 1;
+}
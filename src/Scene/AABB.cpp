@@ -35,6 +35,17 @@ AABB AABB::merge(const AABB& A, const AABB& B) {
 	return res;
 }
 
+AABB AABB::transformed(const mat4& m) const {
+	if (min.x > max.x) return *this; // empty
+	vec3 center = vec3(m * vec4((min + max) * 0.5f, 1));
+	vec3 extent = (max - min) * 0.5f;
+	vec3 new_extent = abs(vec3(m[0])) * extent.x + abs(vec3(m[1])) * extent.y + abs(vec3(m[2])) * extent.z;
+	AABB res;
+	res.min = center - new_extent;
+	res.max = center + new_extent;
+	return res;
+}
+
 std::vector<vec3> AABB::corners() {
 	std::vector<vec3> res(8);
 	res[0] = min;
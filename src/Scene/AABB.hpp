@@ -12,6 +12,8 @@ struct AABB {
 	void add_point(glm::vec3 p);
 	void merge(const AABB& other);
 	static AABB merge(const AABB& A, const AABB& B);
+	// bounds of this box after the affine transform m (still axis aligned, so possibly looser)
+	AABB transformed(const glm::mat4& m) const;
 	std::vector<glm::vec3> corners();
 	std::string str() { return "min: " + myn::s3(min) + ", max: " + myn::s3(max); }
 
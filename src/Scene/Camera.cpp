@@ -9,14 +9,17 @@ using namespace glm;
 
 void Camera::set_local_position(vec3 local_position) {
 	_local_position = local_position;
+	mark_transform_dirty();
 }
 
 void Camera::setRotation(quat rotation) {
 	_rotation = rotation;
+	mark_transform_dirty();
 }
 
 void Camera::set_scale(vec3 scale) {
 	_scale = vec3(1);
+	mark_transform_dirty();
 }
 
 Camera::Camera(uint32_t w, uint32_t h, bool _ortho) :
@@ -56,6 +59,7 @@ void Camera::update_control(float elapsed) {
 		vec3 forward = this->forward();
 		vec3 right = this->right();
 		vec3 local_up = this->up();
+		vec3 old_position = _local_position;
 
 		if (state[SDL_SCANCODE_LSHIFT]) {
 			// up, down
@@ -88,6 +92,8 @@ void Camera::update_control(float elapsed) {
 			}
 		}
 
+		if (_local_position != old_position) mark_transform_dirty();
+
 		// rotation
 		int mouse_x, mouse_y;
 		if (SDL_GetMouseState(&mouse_x, &mouse_y) & SDL_BUTTON_LEFT) {
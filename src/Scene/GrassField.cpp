@@ -22,6 +22,7 @@ bool GrassField::handle_event(SDL_Event event) {
 
 void GrassField::set_local_position(vec3 local_position) {
 	_local_position = local_position;
+	mark_transform_dirty();
 	/*
 	generate_aabb();
 	get_scene()->generate_aabb();
@@ -30,6 +31,7 @@ void GrassField::set_local_position(vec3 local_position) {
 
 void GrassField::setRotation(quat rotation) {
 	_rotation = rotation;
+	mark_transform_dirty();
 	/*
 	generate_aabb();
 	get_scene()->generate_aabb();
@@ -38,6 +40,7 @@ void GrassField::setRotation(quat rotation) {
 
 void GrassField::set_scale(vec3 scale) {
 	_scale = scale;
+	mark_transform_dirty();
 	/*
 	generate_aabb();
 	get_scene()->generate_aabb();
@@ -33,8 +33,7 @@ void MeshObject::set_local_position(glm::vec3 in_local_position)
 {
 	if (!locked) {
 		_local_position = in_local_position;
-		generate_aabb();
-		//get_scene()->generate_aabb();
+		mark_transform_dirty();
 	}
 }
 
@@ -42,8 +41,7 @@ void MeshObject::setRotation(glm::quat in_rotation)
 {
 	if (!locked) {
 		_rotation = in_rotation;
-		generate_aabb();
-		//get_scene()->generate_aabb();
+		mark_transform_dirty();
 	}
 }
 
@@ -51,16 +49,14 @@ void MeshObject::set_scale(glm::vec3 in_scale)
 {
 	if (!locked) {
 		_scale = in_scale;
-		generate_aabb();
-		//get_scene()->generate_aabb();
+		mark_transform_dirty();
 	}
 }
 
 void MeshObject::generate_aabb()
 {
-	glm::mat4 o2w = object_to_world();
-	aabb = AABB();
+	local_aabb = AABB();
 	for (int i=0; i<mesh->get_num_vertices(); i++) {
-		aabb.add_point(o2w * glm::vec4(mesh->get_vertices()[i].position, 1));
+		local_aabb.add_point(mesh->get_vertices()[i].position);
 	}
 }
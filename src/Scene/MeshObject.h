@@ -27,7 +27,10 @@ public:
 
 	Mesh* mesh = nullptr;
 	BSDF* bsdf = nullptr;
-	AABB aabb;
+	AABB local_aabb; // of the mesh, in object space
+
+	// follows the object (and its ancestors) around; computed from local_aabb on every call
+	AABB world_aabb() const { return local_aabb.transformed(object_to_world()); }
 
 private:
 	void generate_aabb();
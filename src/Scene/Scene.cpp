@@ -19,7 +19,7 @@ void Scene::generate_aabb() {
 	std::vector<MeshObject*> meshes = get_meshes();
 	aabb = AABB();
 	for (auto & mesh : meshes) {
-		aabb.merge(mesh->aabb);
+		aabb.merge(mesh->world_aabb());
 	}
 }
 
@@ -1,5 +1,6 @@
 #include "SceneObject.hpp"
 #include "Utils/myn/Log.h"
+#include "Utils/myn/Threading.h"
 #include <queue>
 #if GRAPHICS_DISPLAY
 #include <imgui.h>
@@ -7,7 +8,10 @@
 
 using namespace glm;
 
+uint64_t SceneObject::hierarchy_version = 0;
+
 SceneObject::SceneObject(SceneObject* _parent, std::string _name) {
+	hierarchy_version++;
 
 	parent = _parent;
 	name = _name;
@@ -21,6 +25,7 @@ SceneObject::SceneObject(SceneObject* _parent, std::string _name) {
 }
 
 SceneObject::~SceneObject() {
+	hierarchy_version++;
 	for (auto & child : children) delete child;
 	children.clear();
 }
@@ -61,6 +66,8 @@ bool SceneObject::add_child(SceneObject* child) {
 	}
 	children.push_back(child);
 	child->parent = this;
+	child->mark_world_dirty();
+	hierarchy_version++;
 	return true;
 }
 
@@ -79,15 +86,28 @@ bool SceneObject::try_remove_child(SceneObject *child)
 	for (auto p = children.begin(); p != children.end(); p++) {
 		if (*p == child) {
 			children.erase(p);
+			child->mark_world_dirty();
+			hierarchy_version++;
 			return true;
 		}
 	}
 	return false;
 }
 
-mat4 SceneObject::object_to_parent() const {
+void SceneObject::mark_transform_dirty() {
+	local_dirty = true;
+	mark_world_dirty();
+}
+
+void SceneObject::mark_world_dirty() {
+	if (world_dirty) return; // then the whole subtree already is
+	world_dirty = true;
+	for (auto child : children) child->mark_world_dirty();
+}
+
+void SceneObject::update_local_transform() const {
 	vec3 sc = _scale;
-	return mat4( // translate
+	cached_object_to_parent = mat4( // translate
 		vec4(1, 0, 0, 0),
 		vec4(0, 1, 0, 0),
 		vec4(0, 0, 1, 0),
@@ -99,16 +119,7 @@ mat4 SceneObject::object_to_parent() const {
 		vec4(0, 0, sc.z, 0),
 		vec4(0, 0, 0, 1)
 	);
-}
-
-mat4 SceneObject::object_to_world() const {
-	if (parent) return parent->object_to_world() * object_to_parent();
-	else return object_to_parent();
-}
-
-mat4 SceneObject::parent_to_object() const {
-	vec3 sc = scale();
-	return mat4( // inv scale
+	cached_parent_to_object = mat4( // inv scale
 		vec4(1.0f / sc.x, 0, 0, 0),
 		vec4(0, 1.0f / sc.y, 0, 0),
 		vec4(0, 0, 1.0f / sc.z, 0),
@@ -120,11 +131,66 @@ mat4 SceneObject::parent_to_object() const {
 		vec4(0, 0, 1, 0),
 		vec4(-local_position(), 1)
 	);
+	local_dirty = false;
+}
+
+void SceneObject::update_world_transform() const {
+	if (local_dirty) update_local_transform();
+	if (parent) {
+		cached_object_to_world = parent->cached_object_to_world * cached_object_to_parent;
+		cached_world_to_object = cached_parent_to_object * parent->cached_world_to_object;
+		cached_object_to_world_rotation = parent->cached_object_to_world_rotation * mat3_cast(rotation());
+	} else {
+		cached_object_to_world = cached_object_to_parent;
+		cached_world_to_object = cached_parent_to_object;
+		cached_object_to_world_rotation = mat3_cast(rotation());
+	}
+	world_dirty = false;
+}
+
+void SceneObject::ensure_world_transform() const {
+	if (!world_dirty) return;
+	if (parent) parent->ensure_world_transform();
+	update_world_transform();
+}
+
+void SceneObject::update_world_transforms() {
+	if (parent) parent->ensure_world_transform();
+
+	// each level only reads the one above it
+	std::vector<SceneObject*> level = { this };
+	std::vector<SceneObject*> next_level;
+	while (!level.empty()) {
+		auto update_one = [&](uint32_t i) {
+			if (level[i]->world_dirty) level[i]->update_world_transform();
+		};
+		if (level.size() >= 64) myn::WorkerPool::shared().parallel_for(level.size(), update_one);
+		else for (uint32_t i = 0; i < level.size(); i++) update_one(i);
+
+		next_level.clear();
+		for (auto obj : level) next_level.insert(next_level.end(), obj->children.begin(), obj->children.end());
+		level.swap(next_level);
+	}
+}
+
+mat4 SceneObject::object_to_parent() const {
+	if (local_dirty) update_local_transform();
+	return cached_object_to_parent;
+}
+
+mat4 SceneObject::object_to_world() const {
+	ensure_world_transform();
+	return cached_object_to_world;
+}
+
+mat4 SceneObject::parent_to_object() const {
+	if (local_dirty) update_local_transform();
+	return cached_parent_to_object;
 }
 
 mat3 SceneObject::object_to_world_rotation() const {
-	if (!parent) return mat3_cast(rotation());
-	return parent->object_to_world_rotation() * mat3_cast(rotation());
+	ensure_world_transform();
+	return cached_object_to_world_rotation;
 }
 
 mat3 SceneObject::world_to_object_rotation() const {
@@ -132,8 +198,8 @@ mat3 SceneObject::world_to_object_rotation() const {
 }
 
 mat4 SceneObject::world_to_object() const {
-	if (parent) return parent_to_object() * parent->world_to_object();
-	else return parent_to_object();
+	ensure_world_transform();
+	return cached_world_to_object;
 }
 
 vec3 SceneObject::world_position() const {
@@ -181,8 +247,9 @@ void SceneObject::draw_transform_ui(bool global) const
 
 	vec3 rot = eulerAngles(qrot);
 
-	ImGui::DragFloat3("pos", (float*)&_local_position, 0.05f);
-	ImGui::DragFloat3("scl", (float*)&_scale, 0.05f);
+	bool changed = ImGui::DragFloat3("pos", (float*)&_local_position, 0.05f);
+	changed |= ImGui::DragFloat3("scl", (float*)&_scale, 0.05f);
+	if (changed) const_cast<SceneObject*>(this)->mark_transform_dirty();
 	//ImGui::DragFloat3("rot", (float*)&_rotation, 15.0f);
 	ImGui::Text("%.3f, %.3f, %.3f [rotation]", degrees(rot.x), degrees(rot.y), degrees(rot.z));
 
@@ -194,6 +261,7 @@ void SceneObject::draw_transform_ui(bool global) const
 
 void SceneObject::toggle_enabled() {
 	_enabled = !_enabled;
+	hierarchy_version++;
 	if (_enabled) on_enable();
 	else on_disable();
 }
@@ -207,4 +275,5 @@ void SceneObject::rotate_around_axis(glm::vec3 ws_axis_unitvec, float theta) {
 		ws_axis_unitvec.y * sin_half_theta,
 		ws_axis_unitvec.z * sin_half_theta);
 	_rotation = normalize(qrot * _rotation);
+	mark_transform_dirty();
 }
\ No newline at end of file
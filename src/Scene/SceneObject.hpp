@@ -41,9 +41,9 @@ public:
 
 	// other operations
 
-	virtual void set_local_position(glm::vec3 local_position) { _local_position = local_position; }
-	virtual void setRotation(glm::quat rotation) { _rotation = rotation; }
-	virtual void set_scale(glm::vec3 scale) { _scale = scale; }
+	virtual void set_local_position(glm::vec3 local_position) { _local_position = local_position; mark_transform_dirty(); }
+	virtual void setRotation(glm::quat rotation) { _rotation = rotation; mark_transform_dirty(); }
+	virtual void set_scale(glm::vec3 scale) { _scale = scale; mark_transform_dirty(); }
 
 	void rotate_around_axis(glm::vec3 ws_axis_unitvec, float radians);
 
@@ -54,7 +54,7 @@ public:
 	virtual void drawConfigUI() {};
 #endif
 
-	// transformation
+	// transformation. These are cached, and only get recomputed after the object or one of its ancestors moved
 	glm::mat4 object_to_parent() const;
 	glm::mat4 object_to_world() const;
 	glm::mat4 parent_to_object() const;
@@ -68,9 +68,18 @@ public:
 	glm::quat rotation() const { return _rotation; }
 	glm::vec3 scale() const { return _scale; }
 
+	// recomputes the outdated world transforms in this subtree, one depth level at a time (in parallel within a level).
+	// Called once per frame, so the queries above don't need to walk up the hierarchy; afterwards, they're also safe to
+	// call from multiple threads until something moves again
+	void update_world_transforms();
+
 	bool enabled() const { return _enabled; }
 	void toggle_enabled();
 
+	// bumped whenever any object is created, destroyed, re-parented, enabled or disabled; lets systems that mirror
+	// the scene tree (ie. RenderList) tell whether they need to walk it again
+	static uint64_t hierarchy_version;
+
 	std::string name;
 
 protected:
@@ -79,8 +88,26 @@ protected:
 	glm::quat _rotation; // {w, x, y, z}
 	glm::vec3 _scale;
 
+	// has to be called after changing _local_position, _rotation or _scale directly
+	void mark_transform_dirty();
+
 	virtual void on_enable() {}
 	virtual void on_disable() {}
 
 	bool _enabled = true;
+
+private:
+	void mark_world_dirty();
+	void update_local_transform() const;
+	void update_world_transform() const; // expects the parent's to be up to date
+	void ensure_world_transform() const;
+
+	// invariant: if an object's world transform is dirty, so are its descendants'
+	mutable bool local_dirty = true;
+	mutable bool world_dirty = true;
+	mutable glm::mat4 cached_object_to_parent;
+	mutable glm::mat4 cached_parent_to_object;
+	mutable glm::mat4 cached_object_to_world;
+	mutable glm::mat4 cached_world_to_object;
+	mutable glm::mat3 cached_object_to_world_rotation;
 };
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "Utils/myn/Log.h"
+#include "Utils/myn/FastMath.h"
+#include "Utils/myn/CpuTexture.h"
+#include "CpuSkyAtmosphere/CpuSkyAtmosphere.h"
+#include <cxxopts/cxxopts.hpp>
+#include <cmath>
+#include <fstream>
+#include <functional>
+
+/*
+ * Accuracy check for the CPUSKY_FAST_MATH path:
+ * - the myn::fast kernels against double precision std:: functions, over their whole input ranges
+ * - the sky luts and the final sky texture against the ones built with libm: this same file is built once with
+ *   CPUSKY_FAST_MATH=0 to dump the reference (--dump) and once with the default settings to compare against it (--compare)
+ * Returns non-zero if anything is outside its error bound.
+ */
+
+namespace {
+
+struct KernelCheck {
+	const char* name;
+	float minX, maxX;
+	bool relative;
+	double bound;
+	std::function<float(float)> approx;
+	std::function<double(double)> reference;
+};
+
+bool checkKernel(const KernelCheck& check) {
+	constexpr uint32_t numSamples = 1 << 20;
+	double maxError = 0;
+	float worstX = check.minX;
+	for (uint32_t i = 0; i <= numSamples; i++) {
+		float x = check.minX + (check.maxX - check.minX) * float(i) / float(numSamples);
+		double ref = check.reference(double(x));
+		double error = std::abs(double(check.approx(x)) - ref);
+		if (check.relative) error /= std::max(std::abs(ref), 1e-30);
+		if (!(error <= maxError)) { // also catches nan
+			maxError = error;
+			worstX = x;
+		}
+	}
+	bool ok = maxError <= check.bound;
+	LOG("%-6s max %s error %.3g at %g (bound %.3g)%s", check.name, check.relative ? "relative" : "absolute",
+		maxError, worstX, check.bound, ok ? "" : " FAILED")
+	return ok;
+}
+
+bool checkKernels() {
+	bool ok = true;
+	ok &= checkKernel({"exp", -87.0f, 88.0f, true, 1e-5,
+		[](float x) { return myn::fast::exp(x); }, [](double x) { return std::exp(x); }});
+	// log over the whole normal float range: sampled by exponent
+	ok &= checkKernel({"log", -126.0f, 127.99f, false, 2e-5,
+		[](float e) { return myn::fast::log(std::exp2(e)); }, [](double e) { return std::log(double(std::exp2(float(e)))); }});
+	ok &= checkKernel({"acos", -1.0f, 1.0f, false, 1e-6,
+		[](float x) { return myn::fast::acos(x); }, [](double x) { return std::acos(x); }});
+	// atan2 around the full circle
+	ok &= checkKernel({"atan2", -3.14159265f, 3.14159265f, false, 5e-6,
+		[](float a) { return myn::fast::atan(2.0f * std::sin(a), 2.0f * std::cos(a)); },
+		[](double a) { return std::atan2(2.0f * std::sin(float(a)), 2.0f * std::cos(float(a))); }});
+	return ok;
+}
+
+struct SkyOutputs {
+	myn::CpuTexture transmittanceLut;
+	myn::CpuTexture multiScatteredLut;
+	myn::CpuTexture skyViewLut;
+	myn::CpuTexture skyTexture;
+};
+
+// same sizes and inputs as CpuSkyAtmosphere::updateLuts (default rendering params)
+SkyOutputs computeSky() {
+	SkyOutputs outputs;
+	myn::sky::CpuSkyAtmosphere sky;
+	auto& params = sky.renderingParams;
+
+	outputs.transmittanceLut = myn::CpuTexture(256, 64, myn::CpuTexture::F_RGB32F, myn::CpuTexture::L_Tiled);
+	myn::sky::TransmittanceLutSim transmittanceSim(&outputs.transmittanceLut);
+	transmittanceSim.atmosphere = params.atmosphere;
+	transmittanceSim.runSim();
+
+	outputs.multiScatteredLut = myn::CpuTexture(32, 32, myn::CpuTexture::F_RGB32F, myn::CpuTexture::L_Tiled);
+	myn::sky::MultiScatteredLutSim multiScatteredSim(&outputs.multiScatteredLut);
+	multiScatteredSim.transmittanceLut = &outputs.transmittanceLut;
+	multiScatteredSim.atmosphere = params.atmosphere;
+	multiScatteredSim.runSim();
+
+	outputs.skyViewLut = myn::CpuTexture(192, 108, myn::CpuTexture::F_RGB32F, myn::CpuTexture::L_Tiled);
+	myn::sky::SkyViewLutSim skyViewSim(&outputs.skyViewLut);
+	skyViewSim.transmittanceLut = &outputs.transmittanceLut;
+	skyViewSim.multiScatteredLut = &outputs.multiScatteredLut;
+	skyViewSim.renderingParams = &params;
+	skyViewSim.runSim();
+
+	sky.updateLuts();
+	outputs.skyTexture = sky.createSkyTexture(256, 128);
+	return outputs;
+}
+
+void forEachTexel(const myn::CpuTexture& texture, const std::function<void(const glm::vec3&)>& fn) {
+	for (int y = 0; y < texture.getHeight(); y++) {
+		for (int x = 0; x < texture.getWidth(); x++) fn(glm::vec3(texture.loadTexel(x, y)));
+	}
+}
+
+bool dumpSky(const std::string& path) {
+	SkyOutputs outputs = computeSky();
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		ERR("failed to open '%s' for writing", path.c_str())
+		return false;
+	}
+	for (auto* texture : {&outputs.transmittanceLut, &outputs.multiScatteredLut, &outputs.skyViewLut, &outputs.skyTexture}) {
+		forEachTexel(*texture, [&](const glm::vec3& texel) {
+			file.write(reinterpret_cast<const char*>(&texel), sizeof(texel));
+		});
+	}
+	LOG("wrote reference sky to '%s'", path.c_str())
+	return file.good();
+}
+
+bool compareSky(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		ERR("failed to open reference '%s'", path.c_str())
+		return false;
+	}
+	SkyOutputs outputs = computeSky();
+
+	struct Comparison {
+		const char* name;
+		const myn::CpuTexture* texture;
+		bool relative; // luts hold radiance / transmittance spanning orders of magnitude
+		double bound;
+	};
+	Comparison comparisons[] = {
+		{"transmittance lut", &outputs.transmittanceLut, true, 1e-4},
+		{"multiple scattering lut", &outputs.multiScatteredLut, true, 2e-4},
+		// the uv <-> view direction mapping goes through acos, which is steep near the horizon
+		{"sky view lut", &outputs.skyViewLut, true, 5e-3},
+		{"sky texture", &outputs.skyTexture, false, 1.0 / 255.0}, // tonemapped & gamma corrected
+	};
+	bool ok = true;
+	for (auto& comparison : comparisons) {
+		double maxError = 0;
+		bool truncated = false;
+		forEachTexel(*comparison.texture, [&](const glm::vec3& texel) {
+			glm::vec3 ref;
+			if (!file.read(reinterpret_cast<char*>(&ref), sizeof(ref))) {
+				truncated = true;
+				return;
+			}
+			for (int c = 0; c < 3; c++) {
+				double error = std::abs(double(texel[c]) - double(ref[c]));
+				// relative, except near zero where the absolute error is what shows
+				if (comparison.relative) error /= std::max(std::abs(double(ref[c])), 1e-4);
+				if (!(error <= maxError)) maxError = error;
+			}
+		});
+		if (truncated) {
+			ERR("reference '%s' doesn't match the lut sizes", path.c_str())
+			return false;
+		}
+		bool passed = maxError <= comparison.bound;
+		LOG("%-24s max %s error %.3g (bound %.3g)%s", comparison.name, comparison.relative ? "relative" : "absolute",
+			maxError, comparison.bound, passed ? "" : " FAILED")
+		ok &= passed;
+	}
+	return ok;
+}
+
+}
+
+int main(int argc, const char * argv[])
+{
+	cxxopts::Options options("sky_accuracy", "fast math accuracy check");
+	options.allow_unrecognised_options();
+	options.add_options()
+		("dump", "write the sky luts (reference build) to this path", cxxopts::value<std::string>())
+		("compare", "check the kernels, and the sky luts against the reference at this path", cxxopts::value<std::string>());
+
+	auto optargs = options.parse(argc, argv);
+
+	if (optargs.count("dump")) {
+		return dumpSky(optargs["dump"].as<std::string>()) ? 0 : 1;
+	}
+
+	bool ok = checkKernels();
+	if (optargs.count("compare")) {
+		ok &= compareSky(optargs["compare"].as<std::string>());
+	}
+	LOG("%s", ok ? "all within bounds" : "accuracy check FAILED")
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "Utils/myn/Log.h"
+#include "Render/TextureStreamingPolicy.h"
+#include <cmath>
+#include <limits>
+#include <string>
+
+/*
+ * Checks for the texture streaming residency policy (TextureStreamingPolicy.h): which mips get resident for given
+ * footprints and budgets. Returns non-zero if any of them fails.
+ */
+
+using namespace texture_streaming;
+
+namespace {
+
+bool check(bool passed, const char* what) {
+	LOG("%s%s", what, passed ? "" : " FAILED")
+	return passed;
+}
+
+// a square texture of the given size, 1 byte per texel, mips down to 1x1
+ResidencyRequest squareRequest(uint32_t size, uint32_t tailMip, uint32_t wantedMip, float priority) {
+	ResidencyRequest request = { .tail_mip = tailMip, .wanted_mip = wantedMip, .priority = priority };
+	for (uint32_t s = size; s > 0; s /= 2) request.mip_sizes.push_back(uint64_t(s) * s);
+	return request;
+}
+
+uint64_t residentBytes(const std::vector<ResidencyRequest>& requests, const std::vector<uint32_t>& firstMips) {
+	uint64_t total = 0;
+	for (size_t i = 0; i < requests.size(); i++) {
+		for (uint32_t mip = firstMips[i]; mip < requests[i].tail_mip; mip++) total += requests[i].mip_sizes[mip];
+	}
+	return total;
+}
+
+bool checkChooseResidentMips() {
+	bool ok = true;
+
+	// 1024^2 textures with their tails at mip 4 (64x64)
+	{
+		std::vector<ResidencyRequest> requests = { squareRequest(1024, 4, 0, 100) };
+		auto mips = choose_resident_mips(requests, std::numeric_limits<uint64_t>::max());
+		ok &= check(mips[0] == 0, "unlimited budget: gets the wanted mip");
+
+		mips = choose_resident_mips(requests, 0);
+		ok &= check(mips[0] == 4, "no budget: only the tail");
+	}
+	{
+		std::vector<ResidencyRequest> requests = { squareRequest(1024, 4, 4, 100), squareRequest(1024, 4, 6, 100) };
+		auto mips = choose_resident_mips(requests, std::numeric_limits<uint64_t>::max());
+		ok &= check(mips[0] == 4 && mips[1] == 4, "wanting the tail or coarser: stays at the tail");
+	}
+	{
+		// mip 3 (128^2) costs 16k, mip 2 (256^2) 64k
+		std::vector<ResidencyRequest> requests = { squareRequest(1024, 4, 2, 10), squareRequest(1024, 4, 0, 10) };
+		auto mips = choose_resident_mips(requests, 128 * 128);
+		ok &= check(mips[0] == 4 && mips[1] == 3, "most under-resolved gets upgraded first");
+
+		bool fits = true;
+		for (uint64_t budget : { 1000, 20000, 100000, 300000, 1000000 }) {
+			fits &= residentBytes(requests, choose_resident_mips(requests, budget)) <= budget;
+		}
+		ok &= check(fits, "resident mips fit into the budget");
+	}
+	{
+		std::vector<ResidencyRequest> requests = { squareRequest(1024, 4, 0, 10), squareRequest(1024, 4, 0, 500) };
+		auto mips = choose_resident_mips(requests, 128 * 128);
+		ok &= check(mips[0] == 4 && mips[1] == 3, "equally under-resolved: larger footprint first");
+	}
+	{
+		// the big texture's next mip (128^2) doesn't fit, the small one's (64^2) still does
+		std::vector<ResidencyRequest> requests = { squareRequest(4096, 6, 0, 10), squareRequest(64, 1, 0, 10) };
+		auto mips = choose_resident_mips(requests, 10000);
+		ok &= check(mips[0] == 6 && mips[1] == 0, "what doesn't fit is skipped, smaller upgrades still happen");
+	}
+	return ok;
+}
+
+bool checkMipForFootprint() {
+	bool ok = true;
+	ok &= check(mip_for_footprint(1024, 1024, 1024, 11) == 0, "footprint as large as the texture: mip 0");
+	ok &= check(mip_for_footprint(1024, 1024, 4096, 11) == 0, "larger footprint: still mip 0");
+	ok &= check(mip_for_footprint(1024, 1024, 256, 11) == 2, "quarter size footprint: mip 2");
+	ok &= check(mip_for_footprint(1024, 1024, 300, 11) == 1, "in between: the finer mip");
+	ok &= check(mip_for_footprint(1024, 256, 256, 11) == 2, "non square: goes by the longer side");
+	ok &= check(mip_for_footprint(1024, 1024, 0.5f, 11) == 10, "sub-pixel footprint: coarsest mip");
+	ok &= check(mip_for_footprint(1024, 1024, 0, 11) == 10, "not on screen: coarsest mip");
+	ok &= check(mip_for_footprint(1024, 1024, 100, 0) == 0, "no mips");
+	return ok;
+}
+
+bool checkScreenFootprint() {
+	bool ok = true;
+	const float halfFov = 0.5f; // tan(0.5) ~ 0.546
+	float inside = screen_footprint(glm::vec3(-1), glm::vec3(1), glm::vec3(0.5f), halfFov, 1080);
+	ok &= check(inside == std::numeric_limits<float>::max(), "camera inside the bounds: as large as it gets");
+
+	float near = screen_footprint(glm::vec3(-1), glm::vec3(1), glm::vec3(0, 0, 10), halfFov, 1080);
+	float far = screen_footprint(glm::vec3(-1), glm::vec3(1), glm::vec3(0, 0, 20), halfFov, 1080);
+	ok &= check(near > 0 && std::abs(near / far - 2.0f) < 1e-4f, "twice as far: half the footprint");
+
+	float taller = screen_footprint(glm::vec3(-1), glm::vec3(1), glm::vec3(0, 0, 10), halfFov, 2160);
+	ok &= check(std::abs(taller / near - 2.0f) < 1e-4f, "scales with the viewport height");
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = checkChooseResidentMips();
+	ok &= checkMipForFootprint();
+	ok &= checkScreenFootprint();
+	LOG("%s", ok ? "all passed" : "texture streaming policy check FAILED")
+	return ok ? 0 : 1;
+}
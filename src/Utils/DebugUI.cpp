@@ -1,7 +1,10 @@
 #include "DebugUI.h"
+#include "Utils/myn/Profiler.h"
 #include <unordered_map>
 #include <imgui.h>
 #include <vector>
+#include <string_view>
+#include <algorithm>
 
 std::unordered_map<std::string, std::vector<std::function<void()>>> UIMap;
 
@@ -75,6 +78,75 @@ void ui::sliderFloat(
 	});
 }
 
+void ui::profilerView(const std::string &traceFile, const std::string &category)
+{
+	if (!UIMap.contains(category))
+		UIMap[category] = std::vector<std::function<void()>>();
+
+	auto& categoryList = UIMap[category];
+
+	categoryList.emplace_back([traceFile, paused = false, frame = myn::profiler::Frame()]() mutable {
+		using namespace myn::profiler;
+		if (!paused) frame = last_frame();
+
+		ImGui::Checkbox("pause", &paused);
+		ImGui::SameLine();
+		if (!is_capturing()) {
+			if (ImGui::Button("start trace capture")) start_capture();
+		} else if (ImGui::Button(("stop and save trace to " + traceFile).c_str())) {
+			stop_capture(traceFile);
+		}
+
+		auto drawList = ImGui::GetWindowDrawList();
+		float rowHeight = ImGui::GetTextLineHeight() + 2;
+		float width = ImGui::GetContentRegionAvail().x;
+		ImVec2 mouse = ImGui::GetMousePos();
+
+		// events are sorted by track, one block per track
+		for (size_t i = 0; i < frame.events.size();)
+		{
+			uint32_t track = frame.events[i].track;
+			size_t trackEnd = i;
+			uint32_t maxDepth = 0;
+			while (trackEnd < frame.events.size() && frame.events[trackEnd].track == track) {
+				maxDepth = std::max(maxDepth, frame.events[trackEnd].event.depth);
+				trackEnd++;
+			}
+
+			// the gpu row is a different (older) frame, so it gets its own time range
+			uint64_t begin = track == GPU_TRACK ? frame.gpu_begin_ns : frame.begin_ns;
+			uint64_t end = track == GPU_TRACK ? frame.gpu_end_ns : frame.end_ns;
+			double duration = double(std::max(end, begin + 1) - begin);
+			ImGui::Text("%s (%.3f ms)", track_name(track).c_str(), duration * 1e-6);
+
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			ImGui::InvisibleButton(("##track" + std::to_string(track)).c_str(), ImVec2(width, (maxDepth + 1) * rowHeight));
+			bool hovered = ImGui::IsItemHovered();
+
+			for (; i < trackEnd; i++)
+			{
+				auto& e = frame.events[i].event;
+				// scopes that started in an earlier frame (background jobs) are cut off at its start
+				double t0 = std::clamp(double(int64_t(e.begin_ns - begin)), 0.0, duration);
+				double t1 = std::clamp(double(int64_t(e.end_ns - begin)), 0.0, duration);
+				ImVec2 min = { origin.x + float(t0 / duration * width), origin.y + e.depth * rowHeight };
+				ImVec2 max = { std::max(min.x + 1, origin.x + float(t1 / duration * width)), min.y + rowHeight - 1 };
+
+				float hue = float(std::hash<std::string_view>()(e.name) % 1024) / 1024.0f;
+				drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.6f));
+				if (max.x - min.x > 8) {
+					drawList->PushClipRect(min, max, true);
+					drawList->AddText(ImVec2(min.x + 2, min.y + 1), IM_COL32_WHITE, e.name);
+					drawList->PopClipRect();
+				}
+				if (hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+					ImGui::SetTooltip("%s: %.3f ms", e.name, double(e.end_ns - e.begin_ns) * 1e-6);
+				}
+			}
+		}
+	});
+}
+
 void ui::drawUI()
 {
 	for (const auto& category : UIMap)
@@ -37,6 +37,12 @@ void sliderFloat(
 	const std::string &formatStr="%.3f",
 	const std::string &category="Default");
 
+// flame view of the last frame (a row per thread that recorded scopes, and one for the gpu), with a button to
+// capture a chrome trace of the frames in between into traceFile (see myn::profiler)
+void profilerView(
+	const std::string &traceFile,
+	const std::string &category="Profiler");
+
 void drawUI();
 
 void usePurpleStyle();
@@ -0,0 +1,90 @@
+#include "BinaryFile.h"
+#include "Log.h"
+#include <fstream>
+#include <filesystem>
+#ifdef WINOS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace myn
+{
+	MappedFile::MappedFile(const std::string &path) {
+#ifdef WINOS
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+			CloseHandle(file);
+			return;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			CloseHandle(file);
+			return;
+		}
+		mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!mapped) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return;
+		}
+		mapped_size = file_size.QuadPart;
+		file_handle = file;
+		mapping_handle = mapping;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		struct stat st{};
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			return;
+		}
+		void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file alive
+		if (ptr == MAP_FAILED) return;
+		mapped = ptr;
+		mapped_size = st.st_size;
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+		if (!mapped) return;
+#ifdef WINOS
+		UnmapViewOfFile(mapped);
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+#else
+		munmap(mapped, mapped_size);
+#endif
+	}
+
+	bool BinaryWriter::save(const std::string &path) const {
+		std::string tmp_path = path + ".tmp";
+		{
+			std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				WARN("failed to open '%s' for writing", tmp_path.c_str())
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+			if (!file.good()) {
+				WARN("failed to write '%s'", tmp_path.c_str())
+				return false;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tmp_path, path, ec);
+		if (ec) {
+			WARN("failed to move '%s' to '%s': %s", tmp_path.c_str(), path.c_str(), ec.message().c_str())
+			std::filesystem::remove(tmp_path, ec);
+			return false;
+		}
+		return true;
+	}
+
+}// namespace myn
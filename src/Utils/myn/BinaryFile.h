@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+namespace myn
+{
+	// read-only memory mapping of a whole file. Pages are only read in when touched.
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool is_open() const { return mapped != nullptr; }
+		const uint8_t* data() const { return static_cast<const uint8_t*>(mapped); }
+		size_t size() const { return mapped_size; }
+
+	private:
+		void* mapped = nullptr;
+		size_t mapped_size = 0;
+#ifdef WINOS
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#endif
+	};
+
+	// collects plain data into a byte buffer, then writes it out in one go.
+	// Arrays are 16-byte aligned so a reader can use them in place.
+	class BinaryWriter {
+	public:
+		template<typename T>
+		void write(const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			append(&value, sizeof(T));
+		}
+
+		template<typename T>
+		void write_array(const T* values, uint64_t count) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			write(count);
+			align(16);
+			append(values, count * sizeof(T));
+		}
+
+		template<typename T>
+		void write_vector(const std::vector<T>& values) { write_array(values.data(), values.size()); }
+
+		void write_string(const std::string& str) { write_array(str.data(), str.size()); }
+
+		// writes to a temporary file first and then renames it, so nobody ever maps a half written file
+		bool save(const std::string& path) const;
+
+		size_t size() const { return bytes.size(); }
+
+	private:
+		void append(const void* src, size_t size) {
+			if (size == 0) return;
+			size_t offset = bytes.size();
+			bytes.resize(offset + size);
+			memcpy(&bytes[offset], src, size);
+		}
+		void align(size_t alignment) { bytes.resize((bytes.size() + alignment - 1) / alignment * alignment); }
+
+		std::vector<uint8_t> bytes;
+	};
+
+	// reads back what BinaryWriter wrote. Reading past the end returns zeros and makes ok() false.
+	class BinaryReader {
+	public:
+		BinaryReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+		template<typename T>
+		T read() {
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value{};
+			if (fits(sizeof(T))) memcpy(&value, data + offset, sizeof(T));
+			offset += sizeof(T);
+			return value;
+		}
+
+		// zero-copy view of an array written with write_array; valid as long as the underlying data is
+		template<typename T>
+		const T* read_array(uint64_t& out_count) {
+			out_count = read<uint64_t>();
+			offset = (offset + 15) / 16 * 16;
+			if (!fits(out_count * sizeof(T))) {
+				out_count = 0;
+				return nullptr;
+			}
+			auto ptr = reinterpret_cast<const T*>(data + offset);
+			offset += out_count * sizeof(T);
+			return ptr;
+		}
+
+		template<typename T>
+		void read_vector(std::vector<T>& out_values) {
+			uint64_t count = 0;
+			const T* values = read_array<T>(count);
+			out_values.assign(values, values + count);
+		}
+
+		std::string read_string() {
+			uint64_t count = 0;
+			const char* chars = read_array<char>(count);
+			return count > 0 ? std::string(chars, count) : std::string();
+		}
+
+		bool ok() const { return !overrun; }
+
+	private:
+		bool fits(uint64_t num_bytes) {
+			if (offset + num_bytes > size) overrun = true;
+			return !overrun;
+		}
+
+		const uint8_t* data;
+		size_t size;
+		size_t offset = 0;
+		bool overrun = false;
+	};
+
+}// namespace myn
@@ -0,0 +1,349 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+	// BC7 and BC6H interpolation weights for 4 bit indices, out of 64
+	constexpr int WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// packs bits into a zeroed block, least significant first
+	struct BlockWriter {
+		uint8_t* out;
+		uint32_t pos = 0;
+		explicit BlockWriter(uint8_t* out) : out(out) { memset(out, 0, myn::bc::BLOCK_SIZE_BYTES); }
+		void write(uint32_t value, uint32_t num_bits) {
+			for (uint32_t i = 0; i < num_bits; i++, pos++) {
+				if ((value >> i) & 1) out[pos / 8] |= uint8_t(1 << (pos % 8));
+			}
+		}
+	};
+
+	// the 16 pixels of block (bx, by), edge pixels repeated for partial blocks
+	template<typename T, int C>
+	void fetch_block(const T* pixels, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, T out[16][C]) {
+		for (uint32_t y = 0; y < 4; y++) {
+			uint32_t py = std::min(by * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; x++) {
+				uint32_t px = std::min(bx * 4 + x, width - 1);
+				memcpy(out[y * 4 + x], &pixels[(size_t(py) * width + px) * 4], sizeof(T) * C);
+			}
+		}
+	}
+
+	// mean and direction of largest variance (power iteration on the covariance)
+	template<int N>
+	void principal_axis(const float points[16][N], float mean[N], float axis[N]) {
+		for (int c = 0; c < N; c++) {
+			mean[c] = 0;
+			for (int i = 0; i < 16; i++) mean[c] += points[i][c];
+			mean[c] /= 16.0f;
+		}
+		float cov[N][N] = {};
+		for (int i = 0; i < 16; i++) {
+			for (int a = 0; a < N; a++) {
+				for (int b = 0; b < N; b++) cov[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+			}
+		}
+		for (int c = 0; c < N; c++) axis[c] = 1.0f;
+		for (int iter = 0; iter < 8; iter++) {
+			float next[N] = {};
+			float len = 0;
+			for (int a = 0; a < N; a++) {
+				for (int b = 0; b < N; b++) next[a] += cov[a][b] * axis[b];
+				len += next[a] * next[a];
+			}
+			if (len < 1e-12f) {
+				// (nearly) flat block
+				for (int c = 0; c < N; c++) axis[c] = 0;
+				return;
+			}
+			len = std::sqrt(len);
+			for (int c = 0; c < N; c++) axis[c] = next[c] / len;
+		}
+	}
+
+	// endpoints at the extremes of the points' projection onto the principal axis
+	template<int N>
+	void initial_endpoints(const float points[16][N], float lo, float hi, float e0[N], float e1[N]) {
+		float mean[N], axis[N];
+		principal_axis<N>(points, mean, axis);
+		float tmin = 0, tmax = 0;
+		for (int i = 0; i < 16; i++) {
+			float t = 0;
+			for (int c = 0; c < N; c++) t += (points[i][c] - mean[c]) * axis[c];
+			tmin = std::min(tmin, t);
+			tmax = std::max(tmax, t);
+		}
+		for (int c = 0; c < N; c++) {
+			e0[c] = std::clamp(mean[c] + axis[c] * tmin, lo, hi);
+			e1[c] = std::clamp(mean[c] + axis[c] * tmax, lo, hi);
+		}
+	}
+
+	// least squares endpoints for fixed indices. Returns false if the indices don't constrain them (all the same)
+	template<int N>
+	bool fit_endpoints(const float points[16][N], const uint8_t indices[16], float lo, float hi, float e0[N], float e1[N]) {
+		float aa = 0, ab = 0, bb = 0;
+		float ax[N] = {}, bx[N] = {};
+		for (int i = 0; i < 16; i++) {
+			float w = WEIGHTS4[indices[i]] / 64.0f;
+			aa += (1 - w) * (1 - w);
+			ab += (1 - w) * w;
+			bb += w * w;
+			for (int c = 0; c < N; c++) {
+				ax[c] += (1 - w) * points[i][c];
+				bx[c] += w * points[i][c];
+			}
+		}
+		float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f) return false;
+		for (int c = 0; c < N; c++) {
+			e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, lo, hi);
+			e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, lo, hi);
+		}
+		return true;
+	}
+
+	// the first index of a subset is stored without its top bit, so it has to be < 8: swap the endpoints if it isn't
+	template<typename T, int N>
+	void fix_anchor(T e0[N], T e1[N], uint8_t indices[16]) {
+		if (indices[0] < 8) return;
+		for (int c = 0; c < N; c++) std::swap(e0[c], e1[c]);
+		for (int i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+	}
+
+	//-------- BC7 (mode 6) --------
+
+	struct Bc7Candidate {
+		uint8_t endpoints[2][4]; // 7 bits + p bit
+		uint8_t pbits[2];
+		uint8_t indices[16];
+		float error;
+	};
+
+	void evaluate_bc7(const float points[16][4], const float e0[4], const float e1[4], int p0, int p1, Bc7Candidate& out) {
+		out.pbits[0] = p0;
+		out.pbits[1] = p1;
+		for (int c = 0; c < 4; c++) {
+			out.endpoints[0][c] = uint8_t(std::clamp(int(std::lround((e0[c] - p0) * 0.5f)), 0, 127) << 1 | p0);
+			out.endpoints[1][c] = uint8_t(std::clamp(int(std::lround((e1[c] - p1) * 0.5f)), 0, 127) << 1 | p1);
+		}
+		float palette[16][4];
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 4; c++) {
+				palette[i][c] = float(((64 - WEIGHTS4[i]) * out.endpoints[0][c] + WEIGHTS4[i] * out.endpoints[1][c] + 32) >> 6);
+			}
+		}
+		out.error = 0;
+		for (int p = 0; p < 16; p++) {
+			float best = 1e30f;
+			for (int i = 0; i < 16; i++) {
+				float err = 0;
+				for (int c = 0; c < 4; c++) {
+					float d = palette[i][c] - points[p][c];
+					err += d * d;
+				}
+				if (err < best) {
+					best = err;
+					out.indices[p] = i;
+				}
+			}
+			out.error += best;
+		}
+	}
+
+	// tries all 4 p bit combinations
+	void best_bc7(const float points[16][4], const float e0[4], const float e1[4], Bc7Candidate& best) {
+		for (int p0 = 0; p0 < 2; p0++) {
+			for (int p1 = 0; p1 < 2; p1++) {
+				Bc7Candidate candidate;
+				evaluate_bc7(points, e0, e1, p0, p1, candidate);
+				if (candidate.error < best.error) best = candidate;
+			}
+		}
+	}
+
+	void encode_bc7_block(const uint8_t pixels[16][4], uint8_t* out) {
+		float points[16][4];
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 4; c++) points[i][c] = pixels[i][c];
+		}
+
+		Bc7Candidate best;
+		best.error = 1e30f;
+		float e0[4], e1[4];
+		initial_endpoints<4>(points, 0.0f, 255.0f, e0, e1);
+		best_bc7(points, e0, e1, best);
+		// refine once with the indices that came out of it
+		if (best.error > 0 && fit_endpoints<4>(points, best.indices, 0.0f, 255.0f, e0, e1)) {
+			best_bc7(points, e0, e1, best);
+		}
+
+		uint8_t endpoints[2][5];
+		for (int e = 0; e < 2; e++) {
+			memcpy(endpoints[e], best.endpoints[e], 4);
+			endpoints[e][4] = best.pbits[e];
+		}
+		fix_anchor<uint8_t, 5>(endpoints[0], endpoints[1], best.indices);
+
+		BlockWriter writer(out);
+		writer.write(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++) {
+			writer.write(endpoints[0][c] >> 1, 7);
+			writer.write(endpoints[1][c] >> 1, 7);
+		}
+		writer.write(endpoints[0][4], 1);
+		writer.write(endpoints[1][4], 1);
+		writer.write(best.indices[0], 3);
+		for (int i = 1; i < 16; i++) writer.write(best.indices[i], 4);
+	}
+
+	//-------- BC4 / BC5 --------
+
+	void encode_bc4_block(const uint8_t values[16], uint8_t* out) {
+		uint8_t lo = 255, hi = 0;
+		for (int i = 0; i < 16; i++) {
+			lo = std::min(lo, values[i]);
+			hi = std::max(hi, values[i]);
+		}
+		// red0 > red1 selects the 8 value palette
+		out[0] = hi;
+		out[1] = lo;
+		int palette[8] = { hi, lo };
+		for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * hi + (i - 1) * lo) / 7;
+
+		uint64_t bits = 0;
+		if (hi != lo) {
+			for (int p = 0; p < 16; p++) {
+				int best = 0;
+				for (int i = 1; i < 8; i++) {
+					if (std::abs(palette[i] - values[p]) < std::abs(palette[best] - values[p])) best = i;
+				}
+				bits |= uint64_t(best) << (3 * p);
+			}
+		}
+		for (int i = 0; i < 6; i++) out[2 + i] = uint8_t(bits >> (8 * i));
+	}
+
+	void encode_bc5_block(const uint8_t pixels[16][4], uint8_t* out) {
+		uint8_t red[16], green[16];
+		for (int i = 0; i < 16; i++) {
+			red[i] = pixels[i][0];
+			green[i] = pixels[i][1];
+		}
+		encode_bc4_block(red, out);
+		encode_bc4_block(green, out + 8);
+	}
+
+	//-------- BC6H (mode 11) --------
+	// works with the 16 bit values the hardware interpolates: a half float h is stored as roughly h * 64 / 31
+
+	uint32_t bc6h_unquantize(uint32_t q) {
+		if (q == 0) return 0;
+		if (q == 1023) return 0xffff;
+		return ((q << 16) + 0x8000) >> 10;
+	}
+
+	struct Bc6hCandidate {
+		uint32_t endpoints[2][3]; // 10 bits
+		uint8_t indices[16];
+		float error;
+	};
+
+	void evaluate_bc6h(const float halves[16][3], const float e0[3], const float e1[3], Bc6hCandidate& out) {
+		float palette[16][3];
+		uint32_t unquantized[2][3];
+		for (int c = 0; c < 3; c++) {
+			out.endpoints[0][c] = std::clamp(int(std::lround((e0[c] - 32) / 64.0f)), 0, 1023);
+			out.endpoints[1][c] = std::clamp(int(std::lround((e1[c] - 32) / 64.0f)), 0, 1023);
+			unquantized[0][c] = bc6h_unquantize(out.endpoints[0][c]);
+			unquantized[1][c] = bc6h_unquantize(out.endpoints[1][c]);
+		}
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) {
+				uint32_t interpolated = ((64 - WEIGHTS4[i]) * unquantized[0][c] + WEIGHTS4[i] * unquantized[1][c] + 32) >> 6;
+				palette[i][c] = float((interpolated * 31) >> 6);
+			}
+		}
+		out.error = 0;
+		for (int p = 0; p < 16; p++) {
+			float best = 1e30f;
+			for (int i = 0; i < 16; i++) {
+				float err = 0;
+				for (int c = 0; c < 3; c++) {
+					float d = palette[i][c] - halves[p][c];
+					err += d * d;
+				}
+				if (err < best) {
+					best = err;
+					out.indices[p] = i;
+				}
+			}
+			out.error += best;
+		}
+	}
+
+	void encode_bc6h_block(const float pixels[16][4], uint8_t* out) {
+		// half floats compare about like their bit patterns, so errors are measured (and endpoints fit) in those
+		float halves[16][3];
+		float points[16][3];
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) {
+				float value = std::isnan(pixels[i][c]) ? 0.0f : std::clamp(pixels[i][c], 0.0f, 65504.0f);
+				halves[i][c] = float(glm::packHalf1x16(value));
+				points[i][c] = halves[i][c] * 64.0f / 31.0f;
+			}
+		}
+
+		float e0[3], e1[3];
+		initial_endpoints<3>(points, 0.0f, 65535.0f, e0, e1);
+		Bc6hCandidate best;
+		evaluate_bc6h(halves, e0, e1, best);
+		if (best.error > 0 && fit_endpoints<3>(points, best.indices, 0.0f, 65535.0f, e0, e1)) {
+			Bc6hCandidate refined;
+			evaluate_bc6h(halves, e0, e1, refined);
+			if (refined.error < best.error) best = refined;
+		}
+		fix_anchor<uint32_t, 3>(best.endpoints[0], best.endpoints[1], best.indices);
+
+		BlockWriter writer(out);
+		writer.write(0x03, 5); // mode 11
+		for (int e = 0; e < 2; e++) {
+			for (int c = 0; c < 3; c++) writer.write(best.endpoints[e][c], 10);
+		}
+		writer.write(best.indices[0], 3);
+		for (int i = 1; i < 16; i++) writer.write(best.indices[i], 4);
+	}
+
+	template<typename T, typename EncodeBlock>
+	void encode_blocks(const T* pixels, uint32_t width, uint32_t height, uint8_t* out_blocks, EncodeBlock encode_block) {
+		uint32_t blocks_x = (width + 3) / 4;
+		uint32_t blocks_y = (height + 3) / 4;
+		for (uint32_t by = 0; by < blocks_y; by++) {
+			for (uint32_t bx = 0; bx < blocks_x; bx++) {
+				T block[16][4];
+				fetch_block<T, 4>(pixels, width, height, bx, by, block);
+				encode_block(block, out_blocks + (size_t(by) * blocks_x + bx) * myn::bc::BLOCK_SIZE_BYTES);
+			}
+		}
+	}
+}
+
+namespace myn::bc
+{
+	void encode_bc7(const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *out_blocks) {
+		encode_blocks(rgba, width, height, out_blocks, encode_bc7_block);
+	}
+
+	void encode_bc5(const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *out_blocks) {
+		encode_blocks(rgba, width, height, out_blocks, encode_bc5_block);
+	}
+
+	void encode_bc6h(const float *rgba, uint32_t width, uint32_t height, uint8_t *out_blocks) {
+		encode_blocks(rgba, width, height, out_blocks, encode_bc6h_block);
+	}
+
+}// namespace myn::bc
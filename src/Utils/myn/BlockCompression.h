@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace myn::bc
+{
+	// all encoders write 16 bytes per 4x4 block, blocks in row-major order. Images whose size isn't a multiple of 4
+	// get their edge pixels repeated to fill the last row/column of blocks.
+
+	constexpr uint32_t BLOCK_SIZE_BYTES = 16;
+
+	inline size_t compressed_size(uint32_t width, uint32_t height) {
+		return size_t((width + 3) / 4) * ((height + 3) / 4) * BLOCK_SIZE_BYTES;
+	}
+
+	// rgba8 -> BC7. Only uses mode 6 (one subset, rgba endpoints), which handles color + alpha well enough and is
+	// much cheaper to search than all 8 modes
+	void encode_bc7(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* out_blocks);
+
+	// red and green of rgba8 -> BC5 (two BC4 blocks), ie. for tangent space normal maps
+	void encode_bc5(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* out_blocks);
+
+	// rgba32f (alpha is ignored, negative values clamp to 0) -> BC6H unsigned float. Only uses mode 11
+	// (one region, 10 bit endpoints)
+	void encode_bc6h(const float* rgba, uint32_t width, uint32_t height, uint8_t* out_blocks);
+
+}// namespace myn::bc
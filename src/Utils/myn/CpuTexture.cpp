@@ -3,56 +3,104 @@
 //
 
 #include <stb_image/stb_image_write.h>
+#ifdef WINOS
 #include <windows.h>
+#endif
 #include "CpuTexture.h"
 #include "Log.h"
+#include <glm/gtc/packing.hpp>
+#include <cstdlib>
 
 namespace myn {
 
 using namespace glm;
 
-// default to a 1x1 black texture
-CpuTexture::CpuTexture() : width(1), height(1), buffer(1) {
-	buffer[0] = vec4(0, 0, 0, 0);
+namespace {
+uint32_t texelSizeOf(CpuTexture::Format format) {
+	switch (format) {
+		case CpuTexture::F_RGBA32F: return 4 * sizeof(float);
+		case CpuTexture::F_RGB32F: return 3 * sizeof(float);
+		case CpuTexture::F_RGBA16F: return 4 * sizeof(uint16_t);
+	}
+	return 0;
 }
 
-CpuTexture::CpuTexture(int width, int height) : width(width), height(height), buffer(width * height) {}
+inline vec2 applyWrapMode(vec2 uv, CpuTexture::WrapMode wm) {
+	if (wm == CpuTexture::WM_Clamp) {
+		return glm::clamp(uv, vec2(0), vec2(1));
+	} else if (wm == CpuTexture::WM_Wrap) {
+		float usign = uv.x >= 0 ? 1 : -1;
+		float vsign = uv.y >= 0 ? 1 : -1;
+		return glm::fract(glm::abs(uv)) * vec2(usign, vsign);
+	}
+	ASSERT(false)
+	return uv;
+}
+}
+
+// default to a 1x1 black texture
+CpuTexture::CpuTexture() : CpuTexture(1, 1) {}
+
+CpuTexture::CpuTexture(int width, int height, Format format, Layout layout)
+: width(width), height(height), format(format), layout(layout), texelSize(texelSizeOf(format)) {
+	uint32_t numTexels = width * height;
+	if (layout == L_Tiled) {
+		tilesX = (width + 3) / 4;
+		uint32_t tilesY = (height + 3) / 4;
+		numTexels = tilesX * tilesY * 16;
+	}
+	buffer.resize(numTexels * texelSize, 0);
+}
 
 void CpuTexture::storeTexel(int x, int y, const glm::vec4 &col) {
-	buffer[y * width + x] = col;
+	uint8_t* texel = buffer.data() + texelIndex(x, y) * texelSize;
+	if (format == F_RGBA32F) {
+		*(vec4*)texel = col;
+	} else if (format == F_RGB32F) {
+		*(vec3*)texel = vec3(col);
+	} else {
+		*(u16vec4*)texel = packHalf(col);
+	}
 }
 
 glm::vec4 CpuTexture::loadTexel(int x, int y) const {
-	return buffer[y * width + x];
+	const uint8_t* texel = buffer.data() + texelIndex(x, y) * texelSize;
+	if (format == F_RGBA32F) {
+		return *(const vec4*)texel;
+	} else if (format == F_RGB32F) {
+		return vec4(*(const vec3*)texel, 1);
+	} else {
+		return unpackHalf(*(const u16vec4*)texel);
+	}
 }
 
 void CpuTexture::writeFile(const std::string &filename, bool gammaCorrect, bool openFile) const {
-	std::vector<u8vec4> u8buf(buffer.size());
-	for (int i = 0; i < buffer.size(); i++) {
-		auto p = buffer[i];
-		p = clamp(p, vec4(0), vec4(1));
-		if (gammaCorrect) {
-			const vec4 gamma(vec3(0.455f), 1.0f);
-			p = glm::pow(p, gamma);
+	std::vector<u8vec4> u8buf(width * height);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			auto p = loadTexel(x, y);
+			p = clamp(p, vec4(0), vec4(1));
+			if (gammaCorrect) {
+				const vec4 gamma(vec3(0.455f), 1.0f);
+				p = glm::pow(p, gamma);
+			}
+			u8buf[y * width + x] = u8vec4(p.x * 255, p.y * 255, p.z * 255, p.w * 255);
 		}
-		u8buf[i] = u8vec4(p.x * 255, p.y * 255, p.z * 255, p.w * 255);
 	}
 	stbi_write_png(filename.c_str(), width, height, 4, u8buf.data(), width * 4);
 	if (openFile) {
+#ifdef WINOS
 		ShellExecute(0, "open", filename.c_str(), 0, 0, SW_SHOW);
+#elif defined(MACOS)
+		std::system(("open \"" + filename + "\"").c_str());
+#else
+		std::system(("xdg-open \"" + filename + "\"").c_str());
+#endif
 	}
 }
 
 glm::vec4 CpuTexture::sampleBilinear(glm::vec2 uv, CpuTexture::WrapMode wm) const {
-	if (wm == WM_Clamp) {
-		uv = glm::clamp(uv, vec2(0), vec2(1));
-	} else if (wm == WM_Wrap) {
-		float usign = uv.x >= 0 ? 1 : -1;
-		float vsign = uv.y >= 0 ? 1 : -1;
-		uv = glm::fract(glm::abs(uv)) * vec2(usign, vsign);
-	} else {
-		ASSERT(false)
-	}
+	uv = applyWrapMode(uv, wm);
 	vec2 coords = vec2(width * uv.x, height * uv.y);
 	vec2 deci = glm::fract(coords);
 	ivec2 c00(
@@ -70,6 +118,51 @@ glm::vec4 CpuTexture::sampleBilinear(glm::vec2 uv, CpuTexture::WrapMode wm) cons
 	return y0 * (1.0f - deci.y) + y1 * deci.y;
 }
 
+void CpuTexture::sampleBilinear(const glm::vec2 *uvs, glm::vec4 *outColors, uint32_t count, WrapMode wm) const {
+	constexpr uint32_t BatchSize = 8;
+	float u[BatchSize], v[BatchSize], fx[BatchSize], fy[BatchSize];
+	int x0[BatchSize], y0[BatchSize], x1[BatchSize], y1[BatchSize];
+
+	for (uint32_t base = 0; base < count; base += BatchSize) {
+		uint32_t n = glm::min(BatchSize, count - base);
+
+		// wrap: branch on mode once per batch, lanes themselves are branch-free
+		if (wm == WM_Clamp) {
+			for (uint32_t i = 0; i < n; i++) {
+				u[i] = glm::clamp(uvs[base + i].x, 0.0f, 1.0f);
+				v[i] = glm::clamp(uvs[base + i].y, 0.0f, 1.0f);
+			}
+		} else {
+			for (uint32_t i = 0; i < n; i++) {
+				vec2 uv = applyWrapMode(uvs[base + i], wm);
+				u[i] = uv.x;
+				v[i] = uv.y;
+			}
+		}
+
+		// coordinates & weights
+		for (uint32_t i = 0; i < n; i++) {
+			float cx = u[i] * width;
+			float cy = v[i] * height;
+			float flx = glm::floor(cx);
+			float fly = glm::floor(cy);
+			fx[i] = cx - flx;
+			fy[i] = cy - fly;
+			x0[i] = glm::min(width - 1, int(flx));
+			y0[i] = glm::min(height - 1, int(fly));
+			x1[i] = glm::min(width - 1, x0[i] + 1);
+			y1[i] = glm::min(height - 1, y0[i] + 1);
+		}
+
+		// fetch & filter
+		for (uint32_t i = 0; i < n; i++) {
+			vec4 r0 = glm::mix(loadTexel(x0[i], y0[i]), loadTexel(x1[i], y0[i]), fx[i]);
+			vec4 r1 = glm::mix(loadTexel(x0[i], y1[i]), loadTexel(x1[i], y1[i]), fx[i]);
+			outColors[base + i] = glm::mix(r0, r1, fy[i]);
+		}
+	}
+}
+
 
 } // namespace myn
 
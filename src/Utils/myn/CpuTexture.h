@@ -17,9 +17,20 @@ public:
 		WM_Clamp
 	} WrapMode;
 
+	typedef enum {
+		F_RGBA32F,
+		F_RGB32F, // alpha reads back as 1
+		F_RGBA16F
+	} Format;
+
+	typedef enum {
+		L_Linear, // row-major
+		L_Tiled   // 4x4 tiles, z-order inside each tile, so a bilinear footprint mostly stays within one tile
+	} Layout;
+
 	CpuTexture();
 
-	CpuTexture(int width, int height);
+	CpuTexture(int width, int height, Format format = F_RGBA32F, Layout layout = L_Linear);
 
 	void storeTexel(int x, int y, const glm::vec4 &col);
 
@@ -27,16 +38,35 @@ public:
 
 	glm::vec4 sampleBilinear(glm::vec2 uv, WrapMode wm) const;
 
+	// filters count uvs at once; wrap mode handling is hoisted out of the loop and the
+	// coordinate math runs over SIMD-friendly arrays before the texel fetches
+	void sampleBilinear(const glm::vec2* uvs, glm::vec4* outColors, uint32_t count, WrapMode wm) const;
+
 	int getWidth() const { return width; }
 
 	int getHeight() const { return height; }
 
+	Format getFormat() const { return format; }
+
+	Layout getLayout() const { return layout; }
+
 	void writeFile(const std::string &filename, bool gammaCorrect, bool openFile) const;
 
 private:
 	int width = 0;
 	int height = 0;
-	std::vector<glm::vec4> buffer;
+	Format format = F_RGBA32F;
+	Layout layout = L_Linear;
+	uint32_t texelSize = 0;
+	uint32_t tilesX = 0;
+	std::vector<uint8_t> buffer;
+
+	uint32_t texelIndex(int x, int y) const {
+		if (layout == L_Linear) return y * width + x;
+		uint32_t tx = x & 3, ty = y & 3;
+		uint32_t morton = (tx & 1) | ((ty & 1) << 1) | ((tx & 2) << 1) | ((ty & 2) << 2);
+		return (((y >> 2) * tilesX + (x >> 2)) << 4) + morton;
+	}
 };
 
 }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <bit>
+#include <cstdint>
+
+// Polynomial approximations of transcendental functions, with the same names and signatures as glm's
+// so call sites can switch between the two (see CPUSKY_FAST_MATH). Branch-free where possible so the
+// vec3 overloads vectorize. Max errors vs. double precision std:: functions:
+//   exp:   ~4e-6 relative        log:  ~1e-5 absolute (normal float range; ~3e-7 relative)
+//   acos:  ~5e-7 absolute        atan: ~2e-6 absolute
+//   sqrt:  hardware (already a single instruction, no approximation needed)
+
+namespace myn::fast {
+
+	inline float exp(float x) {
+		// clamp to where the result is a normal float
+		x = glm::clamp(x, -87.3f, 88.3f);
+		// x = n * ln2 + r, |r| <= ln2 / 2. Round to nearest by adding & subtracting 1.5 * 2^23 (avoids a floorf call)
+		float n = (x * 1.44269504f + 12582912.0f) - 12582912.0f;
+		float r = x - n * 0.693359375f; // ln2 split in two (Cody-Waite) to keep r exact
+		r = r - n * -2.12194440e-4f;
+		// exp(r) on [-ln2/2, ln2/2], degree 4 (chebyshev fit)
+		float p = 4.1875644452e-2f;
+		p = p * r + 1.6792143017e-1f;
+		p = p * r + 4.9999372139e-1f;
+		p = p * r + 9.9996229465e-1f;
+		p = p * r + 1.0f;
+		// * 2^n
+		auto scale = std::bit_cast<float>(uint32_t(int32_t(n) + 127) << 23);
+		return p * scale;
+	}
+
+	inline float log(float x) {
+		// x = m * 2^e, m in [sqrt(0.5), sqrt(2))
+		auto bits = std::bit_cast<uint32_t>(x);
+		int32_t e = int32_t((bits >> 23) & 0xff) - 127;
+		float m = std::bit_cast<float>((bits & 0x007fffff) | 0x3f800000);
+		bool upper = m > 1.41421356f;
+		m = upper ? m * 0.5f : m;
+		e += upper ? 1 : 0;
+		// log(m) = 2 atanh(t), t = (m - 1) / (m + 1) in [-0.172, 0.172]
+		float t = (m - 1.0f) / (m + 1.0f);
+		float t2 = t * t;
+		float p = 1.0f / 7.0f;
+		p = p * t2 + 1.0f / 5.0f;
+		p = p * t2 + 1.0f / 3.0f;
+		p = p * t2 + 1.0f;
+		float res = 2.0f * t * p;
+		return res + float(e) * 0.693147181f;
+	}
+
+	inline float sqrt(float x) {
+		return glm::sqrt(x);
+	}
+
+	inline float acos(float x) {
+		// Abramowitz & Stegun 4.4.46, on |x|; mirrored for negative x
+		float a = glm::min(glm::abs(x), 1.0f);
+		float p = -0.0012624911f;
+		p = p * a + 0.0066700901f;
+		p = p * a - 0.0170881256f;
+		p = p * a + 0.0308918810f;
+		p = p * a - 0.0501743046f;
+		p = p * a + 0.0889789874f;
+		p = p * a - 0.2145988016f;
+		p = p * a + 1.5707963050f;
+		float res = glm::sqrt(1.0f - a) * p;
+		return x < 0 ? 3.14159265359f - res : res;
+	}
+
+	// atan2, named like glm::atan(y, x)
+	inline float atan(float y, float x) {
+		float ax = glm::abs(x);
+		float ay = glm::abs(y);
+		float mx = glm::max(ax, ay);
+		if (mx == 0) return 0;
+		// atan on [0, 1]
+		float z = glm::min(ax, ay) / mx;
+		float z2 = z * z;
+		float p = -0.01172120f;
+		p = p * z2 + 0.05265332f;
+		p = p * z2 - 0.11643287f;
+		p = p * z2 + 0.19354346f;
+		p = p * z2 - 0.33262347f;
+		p = p * z2 + 0.99997726f;
+		float res = p * z;
+		// back to the full circle
+		if (ay > ax) res = 1.57079632679f - res;
+		if (x < 0) res = 3.14159265359f - res;
+		return y < 0 ? -res : res;
+	}
+
+	//-------- vec3 versions --------
+
+	inline glm::vec3 exp(const glm::vec3 &v) { return {exp(v.x), exp(v.y), exp(v.z)}; }
+
+	inline glm::vec3 log(const glm::vec3 &v) { return {log(v.x), log(v.y), log(v.z)}; }
+
+	inline glm::vec3 sqrt(const glm::vec3 &v) { return glm::sqrt(v); }
+
+	inline glm::vec3 acos(const glm::vec3 &v) { return {acos(v.x), acos(v.y), acos(v.z)}; }
+
+	inline glm::vec3 atan(const glm::vec3 &y, const glm::vec3 &x) { return {atan(y.x, x.x), atan(y.y, x.y), atan(y.z, x.z)}; }
+
+} // namespace myn::fast
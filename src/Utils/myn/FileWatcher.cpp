@@ -0,0 +1,111 @@
+#include "FileWatcher.h"
+#include "Log.h"
+#include <filesystem>
+#if !defined(WINOS) && !defined(MACOS)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace myn
+{
+	FileWatcher::FileWatcher(float debounce_seconds) : debounce_seconds(debounce_seconds) {
+#if !defined(WINOS) && !defined(MACOS)
+		inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotify_fd < 0) {
+			WARN("inotify_init1 failed, file changes won't be picked up")
+			return;
+		}
+#endif
+		thread = std::thread([this]() { watch_loop(); });
+	}
+
+	FileWatcher::~FileWatcher() {
+		quit = true;
+		if (thread.joinable()) thread.join();
+#if !defined(WINOS) && !defined(MACOS)
+		if (inotify_fd >= 0) close(inotify_fd);
+#endif
+	}
+
+	void FileWatcher::watch(const std::string &path, const std::string &key) {
+		auto normalized = std::filesystem::path(path).lexically_normal().string();
+		std::lock_guard<std::mutex> lock(m);
+		path_to_key[normalized] = key;
+#if defined(WINOS) || defined(MACOS)
+		std::error_code ec;
+		last_write_times[normalized] = std::filesystem::last_write_time(normalized, ec).time_since_epoch().count();
+#else
+		if (inotify_fd < 0) return;
+		// watch the directory rather than the file itself: editors often save by writing a new file and renaming it
+		// over the old one, which would silently end a watch on the file
+		auto dir = std::filesystem::path(normalized).parent_path().string();
+		for (auto& p : watched_dirs) {
+			if (p.second == dir) return;
+		}
+		int wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0) {
+			WARN("failed to watch '%s'", dir.c_str())
+			return;
+		}
+		watched_dirs[wd] = dir;
+#endif
+	}
+
+	std::vector<std::string> FileWatcher::poll_changes() {
+		std::vector<std::string> keys;
+		auto now = Clock::now();
+		std::lock_guard<std::mutex> lock(m);
+		for (auto it = changed.begin(); it != changed.end();) {
+			if (std::chrono::duration<float>(now - it->second).count() >= debounce_seconds) {
+				keys.push_back(it->first);
+				it = changed.erase(it);
+			} else {
+				it++;
+			}
+		}
+		return keys;
+	}
+
+	void FileWatcher::mark_changed(const std::string &path) {
+		// lock is held by the caller
+		auto it = path_to_key.find(path);
+		if (it != path_to_key.end()) changed[it->second] = Clock::now();
+	}
+
+	void FileWatcher::watch_loop() {
+#if defined(WINOS) || defined(MACOS)
+		while (!quit) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			std::lock_guard<std::mutex> lock(m);
+			for (auto& p : last_write_times) {
+				std::error_code ec;
+				int64_t write_time = std::filesystem::last_write_time(p.first, ec).time_since_epoch().count();
+				if (ec || write_time == p.second) continue;
+				p.second = write_time;
+				mark_changed(p.first);
+			}
+		}
+#else
+		alignas(inotify_event) char buffer[4096];
+		while (!quit) {
+			// wake up every now and then to check for quit
+			pollfd pfd = { .fd = inotify_fd, .events = POLLIN, .revents = 0 };
+			if (poll(&pfd, 1, 100) <= 0) continue;
+
+			ssize_t len;
+			while ((len = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+				std::lock_guard<std::mutex> lock(m);
+				for (char* ptr = buffer; ptr < buffer + len;) {
+					auto event = reinterpret_cast<const inotify_event*>(ptr);
+					ptr += sizeof(inotify_event) + event->len;
+					auto dir = watched_dirs.find(event->wd);
+					if (dir == watched_dirs.end() || event->len == 0) continue;
+					mark_changed((std::filesystem::path(dir->second) / event->name).string());
+				}
+			}
+		}
+#endif
+	}
+
+}// namespace myn
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+namespace myn
+{
+	// watches files for changes on a background thread: inotify on linux, polling last write times elsewhere.
+	// A changed file is only handed out once it has been quiet for debounce_seconds, so editors that save in
+	// several steps (truncate, write, rename..) cause one change instead of a few.
+	class FileWatcher {
+	public:
+		explicit FileWatcher(float debounce_seconds = 0.25f);
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// key is what poll_changes() returns when the file at path changes
+		void watch(const std::string& path, const std::string& key);
+
+		// keys of the files that changed (and settled) since the last call. Cheap, doesn't touch the file system
+		std::vector<std::string> poll_changes();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void watch_loop();
+		void mark_changed(const std::string& path);
+
+		float debounce_seconds;
+		std::thread thread;
+		std::atomic<bool> quit = false;
+
+		std::mutex m;
+		std::unordered_map<std::string, std::string> path_to_key;
+		std::unordered_map<std::string, Clock::time_point> changed; // key -> time of the latest change
+#if defined(WINOS) || defined(MACOS)
+		std::unordered_map<std::string, int64_t> last_write_times; // path -> last seen write time
+#else
+		int inotify_fd = -1;
+		std::unordered_map<int, std::string> watched_dirs; // watch descriptor -> directory
+#endif
+	};
+
+}// namespace myn
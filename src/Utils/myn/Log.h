@@ -1,12 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include <cstring>
 
 // for showing last relative_path node, see: https://stackoverflow.com/questions/8487986/file-macro-shows-full-path
 #ifdef WINOS
 #define PATH_ELIM_SLASH '\\'
 #endif
-#ifdef MACOS
+#if defined(MACOS) || defined(LINUXOS)
 #define PATH_ELIM_SLASH '/'
 #endif
 #define __FILENAME__ (strrchr(__FILE__, PATH_ELIM_SLASH) ? strrchr(__FILE__, PATH_ELIM_SLASH) + 1 : __FILE__)
@@ -39,7 +40,7 @@
 #define NEWLINE { printf("\n"); fflush(stdout); }
 #endif
 
-#ifdef MACOS
+#if defined(MACOS) || defined(LINUXOS)
 #define NEWLINE printf("\n");
 #endif
 
@@ -119,7 +120,7 @@
 #if DEBUG
 
 #define EXPECT_M(STATEMENT, EXPECTED, ...) { \
-	if (STATEMENT != EXPECTED) { \
+	if ((STATEMENT) != (EXPECTED)) { \
 		COLOR_RED \
 		printf("["); LOCATION; printf("]"); \
 		printf("[Assertion failed] "); \
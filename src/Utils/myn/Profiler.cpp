@@ -0,0 +1,228 @@
+#include "Profiler.h"
+#include "Log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#define EVENTS_PER_THREAD 8192
+#define MAX_CAPTURED_EVENTS (4 * 1024 * 1024)
+
+namespace myn::profiler
+{
+	namespace
+	{
+		struct ThreadBuffer {
+			uint32_t track = 0;
+			Event events[EVENTS_PER_THREAD];
+			// event i is at events[i % EVENTS_PER_THREAD]. Only the owning thread writes, only the main thread reads
+			std::atomic<uint64_t> num_written = 0;
+			std::atomic<bool> exited = false;
+			uint64_t num_read = 0; // main thread only
+		};
+
+		// for threads that come and go: the main thread frees the buffer once it drained it for the last time
+		struct ThreadBufferOwner {
+			ThreadBuffer* buffer = nullptr;
+			~ThreadBufferOwner() { if (buffer) buffer->exited.store(true, std::memory_order_release); }
+		};
+
+		thread_local ThreadBufferOwner thread_owner;
+		thread_local uint32_t thread_depth = 0;
+
+		std::mutex registry_mutex;
+		std::vector<ThreadBuffer*> buffers;
+		std::vector<std::string> track_names; // indexed by track
+		uint32_t next_track = GPU_TRACK + 1;
+
+		// main thread only
+		uint64_t last_frame_end_ns = 0;
+		Frame completed_frame;
+		std::vector<Event> gpu_frame;
+		bool capturing = false;
+		bool capture_full = false;
+		std::vector<TrackEvent> captured;
+
+		ThreadBuffer& thread_buffer() {
+			if (!thread_owner.buffer) {
+				auto buffer = new ThreadBuffer();
+				std::lock_guard<std::mutex> lock(registry_mutex);
+				buffer->track = next_track++;
+				buffers.push_back(buffer);
+				thread_owner.buffer = buffer;
+			}
+			return *thread_owner.buffer;
+		}
+
+		void drain(ThreadBuffer& buffer, std::vector<TrackEvent>& out) {
+			uint64_t end = buffer.num_written.load(std::memory_order_acquire);
+			uint64_t begin = std::max(buffer.num_read, end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0);
+			size_t first = out.size();
+			for (uint64_t i = begin; i < end; i++) {
+				out.push_back({ .track = buffer.track, .event = buffer.events[i % EVENTS_PER_THREAD] });
+			}
+			// the thread kept recording during the copy: drop whatever it could have overwritten meanwhile, including the
+			// slot it may be writing right now (event number written, not counted yet)
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t written = buffer.num_written.load(std::memory_order_relaxed);
+			if (written + 1 > EVENTS_PER_THREAD && written + 1 - EVENTS_PER_THREAD > begin) {
+				uint64_t num_overwritten = std::min(end, written + 1 - EVENTS_PER_THREAD) - begin;
+				out.erase(out.begin() + first, out.begin() + first + num_overwritten);
+			}
+			buffer.num_read = end;
+		}
+
+		void capture(const std::vector<TrackEvent>& events) {
+			if (!capturing || capture_full) return;
+			if (captured.size() + events.size() > MAX_CAPTURED_EVENTS) {
+				WARN("trace capture is full (%d events), stop it to save what's there", MAX_CAPTURED_EVENTS)
+				capture_full = true;
+				return;
+			}
+			captured.insert(captured.end(), events.begin(), events.end());
+		}
+
+		void write_json_string(std::ofstream& out, const char* str) {
+			out << '"';
+			for (const char* c = str; *c; c++) {
+				if (*c == '"' || *c == '\\') out << '\\' << *c;
+				else if ((unsigned char)*c >= 0x20) out << *c;
+			}
+			out << '"';
+		}
+	}
+
+	uint64_t now() {
+		static const auto start_time = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+	}
+
+	void set_thread_name(const std::string &name) {
+		auto& buffer = thread_buffer();
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		if (track_names.size() <= buffer.track) track_names.resize(buffer.track + 1);
+		track_names[buffer.track] = name;
+	}
+
+	std::string track_name(uint32_t track) {
+		if (track == GPU_TRACK) return "gpu";
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		if (track < track_names.size() && !track_names[track].empty()) return track_names[track];
+		return "thread " + std::to_string(track);
+	}
+
+	Scope::Scope(const char* name) {
+		strncpy(event.name, name, MAX_NAME_LENGTH);
+		event.name[MAX_NAME_LENGTH] = '\0';
+		event.depth = thread_depth++;
+		event.begin_ns = now();
+	}
+
+	Scope::~Scope() {
+		event.end_ns = now();
+		thread_depth--;
+		auto& buffer = thread_buffer();
+		uint64_t n = buffer.num_written.load(std::memory_order_relaxed);
+		buffer.events[n % EVENTS_PER_THREAD] = event;
+		buffer.num_written.store(n + 1, std::memory_order_release);
+	}
+
+	void add_gpu_frame(const std::vector<Event> &events) {
+		gpu_frame = events;
+		std::vector<TrackEvent> track_events;
+		for (auto& event : events) track_events.push_back({ .track = GPU_TRACK, .event = event });
+		capture(track_events);
+	}
+
+	void end_frame() {
+		uint64_t frame_end_ns = now();
+		std::vector<TrackEvent> events;
+		{
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			for (auto it = buffers.begin(); it != buffers.end();) {
+				// checked before draining, so the last events of a thread that just exited aren't missed
+				bool exited = (*it)->exited.load(std::memory_order_acquire);
+				drain(**it, events);
+				if (exited) {
+					delete *it;
+					it = buffers.erase(it);
+				} else {
+					it++;
+				}
+			}
+		}
+		capture(events);
+
+		completed_frame.begin_ns = last_frame_end_ns;
+		completed_frame.end_ns = frame_end_ns;
+		completed_frame.events = std::move(events);
+		completed_frame.gpu_begin_ns = gpu_frame.empty() ? 0 : UINT64_MAX;
+		completed_frame.gpu_end_ns = 0;
+		for (auto& event : gpu_frame) {
+			completed_frame.events.push_back({ .track = GPU_TRACK, .event = event });
+			completed_frame.gpu_begin_ns = std::min(completed_frame.gpu_begin_ns, event.begin_ns);
+			completed_frame.gpu_end_ns = std::max(completed_frame.gpu_end_ns, event.end_ns);
+		}
+		std::sort(completed_frame.events.begin(), completed_frame.events.end(), [](const TrackEvent& a, const TrackEvent& b) {
+			if (a.track != b.track) return a.track < b.track;
+			if (a.event.begin_ns != b.event.begin_ns) return a.event.begin_ns < b.event.begin_ns;
+			return a.event.depth < b.event.depth;
+		});
+		last_frame_end_ns = frame_end_ns;
+	}
+
+	const Frame& last_frame() {
+		return completed_frame;
+	}
+
+	void start_capture() {
+		captured.clear();
+		capture_full = false;
+		capturing = true;
+	}
+
+	bool is_capturing() {
+		return capturing;
+	}
+
+	bool stop_capture(const std::string &path) {
+		capturing = false;
+		auto directory = std::filesystem::path(path).parent_path();
+		if (!directory.empty()) std::filesystem::create_directories(directory);
+		std::ofstream out(path);
+		if (!out.is_open()) {
+			WARN("failed to write trace to '%s'", path.c_str())
+			captured.clear();
+			return false;
+		}
+
+		// cpu threads are one process, the gpu another, so the gpu gets its own group in the viewer
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"cpu\"}},\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"gpu\"}}";
+		std::vector<uint32_t> tracks;
+		for (auto& e : captured) {
+			if (std::find(tracks.begin(), tracks.end(), e.track) == tracks.end()) tracks.push_back(e.track);
+		}
+		for (auto track : tracks) {
+			out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << (track == GPU_TRACK ? 2 : 1) << ",\"tid\":" << track << ",\"args\":{\"name\":";
+			write_json_string(out, track_name(track).c_str());
+			out << "}}";
+		}
+		char times[64];
+		for (auto& e : captured) {
+			out << ",\n{\"name\":";
+			write_json_string(out, e.event.name);
+			snprintf(times, sizeof(times), ",\"ts\":%.3f,\"dur\":%.3f", e.event.begin_ns * 1e-3, (e.event.end_ns - e.event.begin_ns) * 1e-3);
+			out << ",\"ph\":\"X\",\"pid\":" << (e.track == GPU_TRACK ? 2 : 1) << ",\"tid\":" << e.track << times << "}";
+		}
+		out << "\n]}\n";
+		LOG("wrote %zu events to trace '%s'", captured.size(), path.c_str())
+		captured.clear();
+		return true;
+	}
+
+}// namespace myn::profiler
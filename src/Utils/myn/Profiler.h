@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Nestable cpu scopes from any thread, plus gpu scopes (see PassTimer), collected once per frame for the flame view in
+ * DebugUI and optionally captured into a chrome trace (open in chrome://tracing or ui.perfetto.dev).
+ * Recording a scope is lock free: each thread writes into its own ring of events, which the main thread drains in
+ * end_frame(). A thread that records more than a ring's worth of scopes in one frame loses the oldest ones.
+ */
+namespace myn::profiler
+{
+	// names get cut off past this many characters
+	constexpr uint32_t MAX_NAME_LENGTH = 43;
+
+	// events of the gpu go on their own track (see PassTimer)
+	constexpr uint32_t GPU_TRACK = 0;
+
+	struct Event {
+		uint64_t begin_ns; // since the program started
+		uint64_t end_ns;
+		uint32_t depth; // number of enclosing scopes on the same track
+		char name[MAX_NAME_LENGTH + 1];
+	};
+
+	struct TrackEvent {
+		uint32_t track; // thread id (numbered from 1 in the order threads first recorded something), or GPU_TRACK
+		Event event;
+	};
+
+	// nanoseconds since the program started (same clock as the events)
+	uint64_t now();
+
+	// calling thread's name in traces and the flame view (otherwise "thread <id>")
+	void set_thread_name(const std::string &name);
+
+	// records a scope from its construction to its destruction on the calling thread
+	class Scope {
+	public:
+		explicit Scope(const char* name);
+		explicit Scope(const std::string &name) : Scope(name.c_str()) {}
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		Event event;
+	};
+
+	// one frame's worth of resolved gpu scopes, already mapped onto the cpu clock. Main thread only
+	void add_gpu_frame(const std::vector<Event> &events);
+
+	// main thread, once per frame: collects what every thread recorded since the last call
+	void end_frame();
+
+	// everything that ended during the last frame (from the end_frame() before the last one to the last one), sorted by
+	// track then begin time. The gpu events are those of the most recently resolved gpu frame, which trails behind
+	struct Frame {
+		uint64_t begin_ns = 0;
+		uint64_t end_ns = 0;
+		std::vector<TrackEvent> events;
+		uint64_t gpu_begin_ns = 0;
+		uint64_t gpu_end_ns = 0;
+	};
+	const Frame& last_frame();
+
+	std::string track_name(uint32_t track);
+
+	// trace capture: events collected from here on are kept until stop_capture(), which writes them as chrome trace json
+	void start_capture();
+	bool is_capturing();
+	bool stop_capture(const std::string &path);
+
+}// namespace myn::profiler
+
+#define PROFILE_SCOPE_CONCAT_INNER(A, B) A##B
+#define PROFILE_SCOPE_CONCAT(A, B) PROFILE_SCOPE_CONCAT_INNER(A, B)
+#define PROFILE_SCOPE(NAME) myn::profiler::Scope PROFILE_SCOPE_CONCAT(__profileScope, __LINE__)(NAME);
@@ -2,9 +2,9 @@
 // Created by miyehn on 11/10/2022.
 //
 
-#include <thread>
 #include "ShaderSimulator.h"
 #include "Log.h"
+#include "Threading.h"
 
 namespace myn {
 using namespace glm;
@@ -19,35 +19,25 @@ void ShaderSimulator::runSim() {
 	});
 }
 
-void ShaderSimulator::dispatchShader(const std::function<vec4(uint32_t, uint32_t)> &kernel) {
+void ShaderSimulator::dispatchTiles(const std::function<void(uint32_t, uint32_t, uint32_t, uint32_t)> &tileKernel) {
 
-#define SHADERSIM_MULTITHREADED 1
-#define SHADERSIM_NUM_THREADS 16
+	uint32_t width = output->getWidth();
+	uint32_t height = output->getHeight();
+	uint32_t tilesX = (width + SHADERSIM_TILE_SIZE - 1) / SHADERSIM_TILE_SIZE;
+	uint32_t tilesY = (height + SHADERSIM_TILE_SIZE - 1) / SHADERSIM_TILE_SIZE;
+
+	auto runTile = [&](uint32_t tile) {
+		uint32_t x0 = (tile % tilesX) * SHADERSIM_TILE_SIZE;
+		uint32_t y0 = (tile / tilesX) * SHADERSIM_TILE_SIZE;
+		tileKernel(x0, y0, glm::min(x0 + SHADERSIM_TILE_SIZE, width), glm::min(y0 + SHADERSIM_TILE_SIZE, height));
+	};
 
 #if SHADERSIM_MULTITHREADED
-	std::thread threads[SHADERSIM_NUM_THREADS];
-	uint32_t rowsPerThread = (output->getHeight() + SHADERSIM_NUM_THREADS - 1) / SHADERSIM_NUM_THREADS;
-	for (int tid = 0; tid < SHADERSIM_NUM_THREADS; tid++) {
-		auto startRow = rowsPerThread * tid;
-		auto endRow = glm::min(rowsPerThread * (tid + 1), uint32_t(output->getHeight()));
-		threads[tid] = std::thread([this, startRow, endRow, kernel](int tid){
-			for (auto h = startRow; h < endRow; h++) {
-				for (auto w = 0; w < output->getWidth(); w++) {
-					output->storeTexel(w, h, kernel(w, h));
-				}
-			}
-		}, tid);
-	}
-	for (int tid = 0; tid < SHADERSIM_NUM_THREADS; tid++) {
-		threads[tid].join();
-	}
+	WorkerPool::shared().parallel_for(tilesX * tilesY, runTile);
 #else
-	for (auto h = 0; h < output->getHeight(); h++) {
-		for (auto w = 0; w < output->getWidth(); w++) {
-			output->storeTexel(w, h, kernel(w, h));
-		}
+	for (uint32_t tile = 0; tile < tilesX * tilesY; tile++) {
+		runTile(tile);
 	}
 #endif
 }
 } // namespace myn
-
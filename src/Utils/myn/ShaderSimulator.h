@@ -9,6 +9,9 @@
 #include <functional>
 #include "CpuTexture.h"
 
+#define SHADERSIM_MULTITHREADED 1
+#define SHADERSIM_TILE_SIZE 16 // multiple of the batch widths, so batches never straddle tiles
+
 namespace myn
 {
 class ShaderSimulator {
@@ -19,10 +22,45 @@ public:
 
 protected:
 
-	void dispatchShader(const std::function<glm::vec4(uint32_t, uint32_t)> &kernel);
+	// kernel: glm::vec4(uint32_t x, uint32_t y). Templated so it gets inlined into the per-tile loop
+	template<typename Kernel>
+	void dispatchShader(const Kernel &kernel) {
+		dispatchTiles([this, &kernel](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) {
+			for (auto y = y0; y < y1; y++) {
+				for (auto x = x0; x < x1; x++) {
+					output->storeTexel(x, y, kernel(x, y));
+				}
+			}
+		});
+	}
+
+	// batch kernel: void(uint32_t x, uint32_t y, glm::vec4 (&out)[BatchWidth]), shading texels [x, x + BatchWidth) of row y
+	// at once so it can be written with SIMD. Texels past the end of a row are shaded but discarded.
+	template<uint32_t BatchWidth, typename BatchKernel>
+	void dispatchShaderBatched(const BatchKernel &kernel) {
+		static_assert(BatchWidth == 4 || BatchWidth == 8);
+		static_assert(SHADERSIM_TILE_SIZE % BatchWidth == 0);
+		dispatchTiles([this, &kernel](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) {
+			glm::vec4 batch[BatchWidth];
+			for (auto y = y0; y < y1; y++) {
+				for (auto x = x0; x < x1; x += BatchWidth) {
+					kernel(x, y, batch);
+					for (uint32_t i = 0; i < BatchWidth && x + i < x1; i++) {
+						output->storeTexel(x + i, y, batch[i]);
+					}
+				}
+			}
+		});
+	}
 
 	// note: shader does not own the texture(s).
 	CpuTexture* output = nullptr;
+
+private:
+
+	// splits output into SHADERSIM_TILE_SIZE tiles, which pool workers claim one at a time.
+	// tileKernel(x0, y0, x1, y1) shades the half-open rect [x0, x1) x [y0, y1)
+	void dispatchTiles(const std::function<void(uint32_t, uint32_t, uint32_t, uint32_t)> &tileKernel);
 };
 
 namespace sky {
@@ -0,0 +1,266 @@
+#include "Threading.h"
+#include "Log.h"
+#include "Profiler.h"
+#include <thread>
+#ifdef WINOS
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+
+namespace myn
+{
+namespace
+{
+	thread_local uint32_t thread_numa_node = 0;
+	thread_local bool is_pool_worker = false;
+	thread_local bool is_background_worker = false; // of a JobQueue
+	thread_local bool is_dispatching = false; // calling thread of a parallel_for, while it runs jobs itself
+
+	CpuTopology query_topology() {
+		CpuTopology topology;
+#ifdef WINOS
+		ULONG highest_node = 0;
+		if (GetNumaHighestNodeNumber(&highest_node)) {
+			for (ULONG node = 0; node <= highest_node; node++) {
+				ULONGLONG mask = 0;
+				if (!GetNumaNodeProcessorMask((UCHAR)node, &mask) || mask == 0) continue;
+				std::vector<uint32_t> cores;
+				for (uint32_t i = 0; i < 64; i++) {
+					if (mask & (1ull << i)) cores.push_back(i);
+				}
+				topology.cores_per_node.push_back(cores);
+			}
+		}
+#elif defined(__linux__)
+		for (uint32_t node = 0; ; node++) {
+			std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			if (!file.is_open()) break;
+			// format: "0-15,32-47"
+			std::vector<uint32_t> cores;
+			std::string range;
+			while (std::getline(file, range, ',')) {
+				uint32_t first = 0, last = 0;
+				char dash = 0;
+				std::istringstream ss(range);
+				ss >> first;
+				last = (ss >> dash >> last) ? last : first;
+				for (uint32_t i = first; i <= last; i++) cores.push_back(i);
+			}
+			if (!cores.empty()) topology.cores_per_node.push_back(cores);
+		}
+#endif
+		if (topology.cores_per_node.empty()) {
+			// no NUMA info (or macOS): one node with all hardware threads
+			std::vector<uint32_t> cores;
+			for (uint32_t i = 0; i < std::max(1u, std::thread::hardware_concurrency()); i++) cores.push_back(i);
+			topology.cores_per_node.push_back(cores);
+		}
+		return topology;
+	}
+
+	bool pin_current_thread_to_core(uint32_t core) {
+#ifdef WINOS
+		return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		// macOS has no hard affinity api; the scheduler decides
+		return false;
+#endif
+	}
+}
+
+	uint32_t CpuTopology::num_cores() const {
+		uint32_t count = 0;
+		for (auto& cores : cores_per_node) count += cores.size();
+		return count;
+	}
+
+	const CpuTopology& cpu_topology() {
+		static CpuTopology topology = query_topology();
+		return topology;
+	}
+
+	uint32_t numa_node_for_worker(uint32_t worker_index) {
+		return worker_index % cpu_topology().num_nodes();
+	}
+
+	bool pin_current_thread(uint32_t worker_index) {
+		auto& topology = cpu_topology();
+		uint32_t node = numa_node_for_worker(worker_index);
+		auto& cores = topology.cores_per_node[node];
+		uint32_t core = cores[(worker_index / topology.num_nodes()) % cores.size()];
+		thread_numa_node = node;
+		return pin_current_thread_to_core(core);
+	}
+
+	bool pin_current_thread_to_node(uint32_t node) {
+		auto& topology = cpu_topology();
+		ASSERT(node < topology.num_nodes())
+		thread_numa_node = node;
+#ifdef WINOS
+		ULONGLONG mask = 0;
+		for (auto core : topology.cores_per_node[node]) mask |= 1ull << core;
+		return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto core : topology.cores_per_node[node]) CPU_SET(core, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	uint32_t current_thread_numa_node() {
+		return thread_numa_node;
+	}
+
+	//--------------- persistent worker pool -----------------------
+
+	WorkerPool::WorkerPool(uint32_t num_threads) {
+		for (uint32_t i = 0; i < num_threads; i++) {
+			workers.emplace_back([this, i]() {
+				profiler::set_thread_name("worker " + std::to_string(i));
+				worker_loop();
+			});
+		}
+	}
+
+	WorkerPool::~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(m);
+			quit = true;
+		}
+		work_cv.notify_all();
+		for (auto& t : workers) t.join();
+	}
+
+	WorkerPool& WorkerPool::shared() {
+		static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	void WorkerPool::parallel_for(uint32_t num_jobs, const std::function<void(uint32_t)> &job) {
+		if (num_jobs == 0) return;
+		if (is_pool_worker || is_dispatching || is_background_worker || workers.empty() || num_jobs == 1) {
+			for (uint32_t i = 0; i < num_jobs; i++) job(i);
+			return;
+		}
+
+		std::lock_guard<std::mutex> dispatch_lock(dispatch_mutex);
+		{
+			std::lock_guard<std::mutex> lock(m);
+			current_job = &job;
+			current_num_jobs = num_jobs;
+			next_job = 0;
+			active_workers = workers.size();
+			generation++;
+		}
+		work_cv.notify_all();
+
+		// calling thread helps out instead of idling (and must not dispatch again from its jobs: dispatch_mutex is held)
+		is_dispatching = true;
+		run_jobs();
+		is_dispatching = false;
+
+		std::unique_lock<std::mutex> lock(m);
+		done_cv.wait(lock, [this] { return active_workers == 0; });
+		current_job = nullptr;
+	}
+
+	void WorkerPool::run_jobs() {
+		uint32_t i;
+		while ((i = next_job.fetch_add(1)) < current_num_jobs) {
+			(*current_job)(i);
+		}
+	}
+
+	void WorkerPool::worker_loop() {
+		is_pool_worker = true;
+		uint64_t seen_generation = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(m);
+				work_cv.wait(lock, [this, seen_generation] { return quit || generation != seen_generation; });
+				if (quit) return;
+				seen_generation = generation;
+			}
+			run_jobs();
+			{
+				std::lock_guard<std::mutex> lock(m);
+				if (--active_workers == 0) done_cv.notify_one();
+			}
+		}
+	}
+
+	//--------------- background job queue -----------------------
+
+	JobQueue::JobQueue(uint32_t num_threads) {
+		for (uint32_t i = 0; i < num_threads; i++) {
+			workers.emplace_back([this, i]() {
+				profiler::set_thread_name("background " + std::to_string(i));
+				worker_loop();
+			});
+		}
+	}
+
+	JobQueue::~JobQueue() {
+		{
+			std::lock_guard<std::mutex> lock(m);
+			quit = true;
+			jobs.clear();
+		}
+		work_cv.notify_all();
+		for (auto& t : workers) t.join();
+	}
+
+	JobQueue& JobQueue::background() {
+		// hardware_concurrency() is 0 if it can't tell
+		static JobQueue queue(std::max(1u, std::max(1u, std::thread::hardware_concurrency()) - 1));
+		return queue;
+	}
+
+	void JobQueue::push(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(m);
+			jobs.push_back(std::move(job));
+		}
+		work_cv.notify_one();
+	}
+
+	void JobQueue::wait_idle() {
+		std::unique_lock<std::mutex> lock(m);
+		idle_cv.wait(lock, [this] { return jobs.empty() && running_jobs == 0; });
+	}
+
+	void JobQueue::worker_loop() {
+		is_background_worker = true;
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m);
+				work_cv.wait(lock, [this] { return quit || !jobs.empty(); });
+				if (quit) return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				running_jobs++;
+			}
+			job();
+			{
+				std::lock_guard<std::mutex> lock(m);
+				running_jobs--;
+				if (jobs.empty() && running_jobs == 0) idle_cv.notify_all();
+			}
+		}
+	}
+
+}// namespace myn
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <deque>
+
+namespace myn
+{
+	// cpu topology as seen by the os; on platforms without NUMA info this is a single node with all cores
+	struct CpuTopology {
+		std::vector<std::vector<uint32_t>> cores_per_node;
+		uint32_t num_cores() const;
+		uint32_t num_nodes() const { return cores_per_node.size(); }
+	};
+
+	const CpuTopology& cpu_topology();
+
+	// which node worker #worker_index gets placed on; workers are spread round-robin across nodes
+	uint32_t numa_node_for_worker(uint32_t worker_index);
+
+	// pin the calling thread to a core chosen for worker #worker_index. Returns false if pinning isn't supported
+	bool pin_current_thread(uint32_t worker_index);
+
+	// pin the calling thread to any core of the given node (for first-touch allocation on that node)
+	bool pin_current_thread_to_node(uint32_t node);
+
+	// node the calling thread was last pinned to (0 if never pinned)
+	uint32_t current_thread_numa_node();
+
+	//--------------- persistent worker pool -----------------------
+	// threads are created once and sleep between dispatches. Jobs are claimed dynamically (one at a time)
+	// so uneven job costs still balance out.
+	class WorkerPool {
+	public:
+		explicit WorkerPool(uint32_t num_threads);
+		~WorkerPool();
+
+		// shared pool with one thread per hardware thread (minus the caller, who also works)
+		static WorkerPool& shared();
+
+		uint32_t num_threads() const { return workers.size(); }
+
+		// runs job(i) for every i in [0, num_jobs) on the workers and the calling thread; returns when all are done.
+		// Nested calls (from inside a job, on a worker or the calling thread) run serially on that thread, and so do
+		// calls from JobQueue threads: background work shouldn't hold up the dispatches the frame waits on.
+		void parallel_for(uint32_t num_jobs, const std::function<void(uint32_t)> &job);
+
+	private:
+		void worker_loop();
+		void run_jobs();
+
+		std::vector<std::thread> workers;
+
+		std::mutex dispatch_mutex; // one dispatch at a time
+		std::mutex m;
+		std::condition_variable work_cv;
+		std::condition_variable done_cv;
+		uint64_t generation = 0;
+		uint32_t active_workers = 0;
+		bool quit = false;
+
+		const std::function<void(uint32_t)>* current_job = nullptr;
+		uint32_t current_num_jobs = 0;
+		std::atomic<uint32_t> next_job = 0;
+	};
+
+	//--------------- background job queue -----------------------
+	// fire-and-forget jobs (file io, decoding) that shouldn't block the calling thread. Jobs start in FIFO order.
+	class JobQueue {
+	public:
+		explicit JobQueue(uint32_t num_threads);
+		~JobQueue(); // jobs that haven't started yet are dropped
+
+		static JobQueue& background();
+
+		void push(std::function<void()> job);
+
+		// blocks until every job pushed so far has finished
+		void wait_idle();
+
+	private:
+		void worker_loop();
+
+		std::vector<std::thread> workers;
+
+		std::mutex m;
+		std::condition_variable work_cv;
+		std::condition_variable idle_cv;
+		std::deque<std::function<void()>> jobs;
+		uint32_t running_jobs = 0;
+		bool quit = false;
+	};
+
+}// namespace myn